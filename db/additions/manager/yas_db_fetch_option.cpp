@@ -25,3 +25,11 @@ void fetch_option::add_select_option(db::select_option option) {
 db::select_option_map_t const &fetch_option::select_options() const {
     return _sel_options;
 }
+
+void fetch_option::exclude_attributes(std::string const &table, db::string_set_t attr_names) {
+    _excluded_attributes[table].merge(attr_names);
+}
+
+db::string_set_map_t const &fetch_option::excluded_attributes() const {
+    return _excluded_attributes;
+}
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <db/yas_db_additional_types.h>
 #include <db/yas_db_select_option.h>
 
 #include <unordered_map>
@@ -18,7 +19,13 @@ struct fetch_option final {
     void add_select_option(db::select_option);
     [[nodiscard]] select_option_map_t const &select_options() const;
 
+    // 全てのフィールドを取得する時に、指定したアトリビュートを読み込まない。大きなBLOBを後からread_attribute_blobで読み込む場合に使う
+    // 読み込まなかったアトリビュートはセーブしても前の値のまま
+    void exclude_attributes(std::string const &table, db::string_set_t attr_names);
+    [[nodiscard]] db::string_set_map_t const &excluded_attributes() const;
+
    private:
     select_option_map_t _sel_options;
+    db::string_set_map_t _excluded_attributes;
 };
 }  // namespace yas::db
@@ -6,25 +6,184 @@
 
 #include <cpp_utils/yas_thread.h>
 #include <cpp_utils/yas_unless.h>
+#include <dispatch/dispatch.h>
 
 #include "yas_db_attribute.h"
 #include "yas_db_database.h"
 #include "yas_db_index.h"
 #include "yas_db_info.h"
 #include "yas_db_manager_utils.h"
+#include "yas_db_reader_pool.h"
 #include "yas_db_relation.h"
 #include "yas_db_sql_utils.h"
 #include "yas_db_utils.h"
 
+#include <algorithm>
+#include <iterator>
+
 using namespace yas;
 using namespace yas::db;
 
-manager::manager(std::filesystem::path const &db_path, db::model const &model, std::size_t const priority_count)
-    : _database(database::make_shared(db_path)),
+namespace yas::db {
+// 読み込み専用の接続を使う場合は、書き込みと並行して読み込めるようにWALにする
+static db::open_option to_writer_open_option(db::connection_option const &connection_option) {
+    db::open_option open_option = connection_option.open_option;
+    if (connection_option.reader_count > 0) {
+        open_option.journal_mode = db::journal_mode::wal;
+    }
+    return open_option;
+}
+
+// メモリ上のデータベースは閉じると破棄されるので開いたままにする
+// 別の接続からは見えないか、共有キャッシュのテーブル単位のロックで並行して読み込めないので、読み込み専用の接続は使わない
+static db::connection_option to_manager_connection_option(std::filesystem::path const &db_path,
+                                                          db::connection_option &&connection_option) {
+    if (db::is_in_memory_path(db_path)) {
+        connection_option.persistent = true;
+        connection_option.idle_timeout = 0.0;
+        connection_option.reader_count = 0;
+    }
+    return std::move(connection_option);
+}
+
+static void setup_database(db::database_ptr const &database, db::connection_option const &connection_option) {
+    std::size_t const capacity = connection_option.statement_cache_capacity;
+    database->set_statement_cache_capacity(capacity);
+    database->set_should_cache_statements(capacity > 0);
+    database->set_busy_retry_policy(connection_option.busy_retry_policy);
+}
+
+// トランザクションをコミットする。実行中にキャンセルされていたら、途中までの結果を残さないようにコミットしない
+// キャンセルの判定はデータベースに設定されている中断のハンドラで行う
+static manager_result_t commit_unless_canceled(db::database_ptr const &db) {
+    if (auto const &handler = db->interruption_handler(); handler && handler()) {
+        return db::make_error_result(manager_error_type::canceled);
+    }
+
+    db::commit(db);
+
+    return manager_result_t{nullptr};
+}
+
+// 開始されているトランザクションの中でオブジェクトデータを取得して、トランザクションを終了する
+static manager_result_t fetch_in_transaction(db::database_ptr const &db, db::model const &model,
+                                             db::fetch_option const &fetch_option,
+                                             db::query_plan_checker_ptr const &checker,
+                                             db::object_data_vector_map_t &fetched_datas) {
+    manager_result_t state{nullptr};
+
+    if (auto fetch_result = db::fetch(db, model, fetch_option, checker)) {
+        fetched_datas = std::move(fetch_result.value());
+    } else {
+        state = manager_result_t{std::move(fetch_result.error())};
+    }
+
+    // トランザクション終了
+    if (state) {
+        state = commit_unless_canceled(db);
+    }
+    if (!state) {
+        db::rollback(db);
+        fetched_datas.clear();
+    }
+
+    return state;
+}
+
+// オブジェクトデータのオブジェクトIDをエンティティごとにまとめる
+static db::integer_set_map_t to_object_ids(db::object_data_vector_map_t const &datas) {
+    db::integer_set_map_t obj_ids;
+
+    for (auto const &[entity_name, entity_datas] : datas) {
+        for (auto const &data : entity_datas) {
+            if (data.object_id.is_stable()) {
+                obj_ids[entity_name].insert(data.object_id.stable());
+            }
+        }
+    }
+
+    return obj_ids;
+}
+
+// オブジェクトデータのうち、オブジェクトIDがfilter_idsに含まれるもののIDをまとめる
+static db::integer_set_map_t filter_object_ids(db::object_data_vector_map_t const &datas,
+                                               db::integer_set_map_t const &filter_ids) {
+    db::integer_set_map_t obj_ids;
+
+    for (auto const &[entity_name, entity_ids] : to_object_ids(datas)) {
+        auto const it = filter_ids.find(entity_name);
+        if (it == filter_ids.end()) {
+            continue;
+        }
+
+        db::integer_set_t filtered;
+        std::set_intersection(entity_ids.begin(), entity_ids.end(), it->second.begin(), it->second.end(),
+                              std::inserter(filtered, filtered.end()));
+
+        if (!filtered.empty()) {
+            obj_ids.emplace(entity_name, std::move(filtered));
+        }
+    }
+
+    return obj_ids;
+}
+
+// obj_idsに含まれるオブジェクトデータを取得し直したもので置き換える。取得し直して見つからなかったものは取り除く
+// 並び順は元のデータのまま
+static void replace_object_datas(db::object_data_vector_map_t &datas, db::integer_set_map_t const &obj_ids,
+                                 db::object_data_vector_map_t &&reloaded_datas) {
+    for (auto &[entity_name, entity_datas] : datas) {
+        auto const ids_it = obj_ids.find(entity_name);
+        if (ids_it == obj_ids.end()) {
+            continue;
+        }
+
+        std::unordered_map<db::integer::type, db::object_data> reloaded;
+        if (auto const it = reloaded_datas.find(entity_name); it != reloaded_datas.end()) {
+            for (auto &data : it->second) {
+                reloaded.emplace(data.object_id.stable(), std::move(data));
+            }
+        }
+
+        db::object_data_vector_t replaced_datas;
+        replaced_datas.reserve(entity_datas.size());
+
+        for (auto &data : entity_datas) {
+            auto const obj_id = data.object_id.stable();
+            if (!ids_it->second.contains(obj_id)) {
+                replaced_datas.emplace_back(std::move(data));
+            } else if (auto const it = reloaded.find(obj_id); it != reloaded.end()) {
+                replaced_datas.emplace_back(std::move(it->second));
+            }
+        }
+
+        entity_datas = std::move(replaced_datas);
+    }
+}
+}  // namespace yas::db
+
+manager::manager(std::filesystem::path const &db_path, db::model const &model, std::size_t const priority_count,
+                 db::connection_option &&connection_option)
+    : _database(database::make_shared(db_path, to_writer_open_option(connection_option))),
       _model(model),
+      _connection_option(std::move(connection_option)),
+      _query_plan_checker(this->_connection_option.query_plan_warning_handler
+                              ? query_plan_checker::make_shared(this->_connection_option.query_plan_warning_handler)
+                              : nullptr),
+      _reader_pool(this->_connection_option.reader_count > 0
+                       ? reader_pool::make_shared(db_path, this->_database->open_option(),
+                                                  this->_connection_option.reader_count)
+                       : nullptr),
       _task_queue(task_queue<std::nullptr_t>::make_shared(priority_count)),
       _db_info(observing::value::holder<db::info_opt>::make_shared(std::nullopt)),
       _db_object_notifier(observing::notifier<db::object_ptr>::make_shared()) {
+    setup_database(this->_database, this->_connection_option);
+
+    if (this->_reader_pool) {
+        for (std::size_t idx = 0; idx < this->_reader_pool->count(); ++idx) {
+            setup_database(this->_reader_pool->reader_at(idx).database, this->_connection_option);
+        }
+    }
 }
 
 // バックグラウンド処理を保留するカウントをあげる
@@ -65,6 +224,10 @@ db::model const &manager::model() const {
     return this->_model;
 }
 
+db::connection_option const &manager::connection_option() const {
+    return this->_connection_option;
+}
+
 db::value const &manager::current_save_id() const {
     if (auto const &info = this->_db_info->value()) {
         return info->current_save_id_value();
@@ -119,8 +282,9 @@ void manager::setup(db::completion_f completion) {
 
             // トランザクション終了
             if (state) {
-                db::commit(db);
-            } else {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
                 db::rollback(db);
             }
         } else {
@@ -141,7 +305,7 @@ void manager::setup(db::completion_f completion) {
         auto completion_on_main = [manager, state = std::move(state), info = std::move(info),
                                    completion = std::move(completion)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(info));
+                manager->_set_db_info(std::move(info), std::nullopt);
             }
             completion(std::move(state));
         };
@@ -179,8 +343,9 @@ void manager::clear(db::cancellation_f cancellation, db::completion_f completion
 
             // トランザクション終了
             if (state) {
-                db::commit(db);
-            } else {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
                 db::rollback(db);
                 db_info = std::nullopt;
             }
@@ -192,7 +357,7 @@ void manager::clear(db::cancellation_f cancellation, db::completion_f completion
         auto completion_on_main = [completion = std::move(completion), manager, state = std::move(state),
                                    db_info = std::move(db_info)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(db_info));
+                manager->_set_db_info(std::move(db_info), std::nullopt);
                 manager->_clear_cached_objects();
             }
             completion(std::move(state));
@@ -230,8 +395,9 @@ void manager::purge(db::cancellation_f cancellation, db::completion_f completion
 
             // トランザクション終了
             if (state) {
-                db::commit(db);
-            } else {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
                 db::rollback(db);
             }
         } else {
@@ -249,7 +415,7 @@ void manager::purge(db::cancellation_f cancellation, db::completion_f completion
         auto completion_on_main = [completion = std::move(completion), manager, state = std::move(state),
                                    db_info = std::move(db_info)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(db_info));
+                manager->_set_db_info(std::move(db_info), std::nullopt);
                 manager->_purge_cached_objects();
             }
 
@@ -267,30 +433,39 @@ void manager::reset(db::cancellation_f cancellation, db::completion_f completion
 
     auto preparation = [manager]() { return manager->_changed_object_ids_for_reset(); };
 
-    auto impl_completion = [completion = std::move(completion), manager](manager_result_t &&state,
-                                                                         db::object_data_vector_map_t &&fetched_datas) {
-        auto completion_on_main = [manager, completion = std::move(completion), state = std::move(state),
-                                   fetched_datas = std::move(fetched_datas)]() mutable {
-            if (state) {
-                manager->_load_and_cache_object_map(fetched_datas, true, false);
-                manager->_erase_changed_objects(fetched_datas);
-                manager->_created_objects.clear();
-                completion(manager_result_t{nullptr});
-            } else {
-                completion(manager_result_t{std::move(state.error())});
-            }
-        };
-
-        thread::perform_sync_on_main(std::move(completion_on_main));
+    auto completion_on_main = [completion = std::move(completion), manager](
+                                  manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas) {
+        if (state) {
+            manager->_load_and_cache_object_map(fetched_datas, true, false);
+            manager->_erase_changed_objects(fetched_datas);
+            manager->_created_objects.clear();
+            completion(manager_result_t{nullptr});
+        } else {
+            completion(manager_result_t{std::move(state.error())});
+        }
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), std::move(impl_completion));
+    // 変更されたオブジェクトを書き換えるので、他の処理と並行せずに取得する
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), fetch_mode::writer,
+                                      std::move(completion_on_main));
 }
 
 void manager::execute(db::cancellation_f cancellation, db::execution_f &&execution) {
     this->_execute(std::move(cancellation), std::move(execution));
 }
 
+// 開いたままのデータベースを、それまでに追加されたタスクが終わった後に閉じる
+// persistentでなければタスクごとに閉じているので、閉じる必要はない
+void manager::close_database() {
+    auto op_lambda = [manager = this->_weak_manager.lock()](auto const &) {
+        manager->_database->close();
+        if (manager->_reader_pool) {
+            manager->_reader_pool->close_all();
+        }
+    };
+    this->_task_queue->push_back(task<std::nullptr_t>::make_shared(std::move(op_lambda)));
+}
+
 void manager::insert_objects(db::cancellation_f cancellation, db::insert_count_preparation_f preparation,
                              db::vector_completion_f completion) {
     // エンティティごとの数を指定してデータベースにオブジェクトを挿入する
@@ -360,8 +535,9 @@ void manager::insert_objects(db::cancellation_f cancellation, db::insert_values_
 
             // トランザクション終了
             if (state) {
-                db::commit(db);
-            } else {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
                 db::rollback(db);
                 inserted_datas.clear();
             }
@@ -373,7 +549,7 @@ void manager::insert_objects(db::cancellation_f cancellation, db::insert_values_
         auto completion_on_main = [state = std::move(state), inserted_datas = std::move(inserted_datas), manager,
                                    completion = std::move(completion), db_info = std::move(ret_db_info)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(db_info));
+                manager->_set_db_info(std::move(db_info), to_object_ids(inserted_datas));
                 auto loaded_objects = manager->_load_and_cache_object_vector(inserted_datas, false, false);
                 completion(manager_vector_result_t{std::move(loaded_objects)});
             } else {
@@ -391,86 +567,70 @@ void manager::fetch_objects(db::cancellation_f cancellation, db::fetch_option_pr
                             db::vector_completion_f completion) {
     auto manager = this->_weak_manager.lock();
 
-    auto impl_completion = [completion = std::move(completion), manager](manager_result_t &&state,
-                                                                         db::object_data_vector_map_t &&fetched_datas) {
-        auto completion_on_main = [state = std::move(state), completion = std::move(completion),
-                                   fetched_datas = std::move(fetched_datas), manager]() mutable {
-            if (state) {
-                auto loaded_objects = manager->_load_and_cache_object_vector(fetched_datas, false, false);
-                completion(manager_vector_result_t{std::move(loaded_objects)});
-            } else {
-                completion(manager_vector_result_t{std::move(state.error())});
-            }
-        };
-
-        thread::perform_sync_on_main(std::move(completion_on_main));
+    auto completion_on_main = [completion = std::move(completion), manager](
+                                  manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas) {
+        if (state) {
+            auto loaded_objects = manager->_load_and_cache_object_vector(fetched_datas, false, false);
+            completion(manager_vector_result_t{std::move(loaded_objects)});
+        } else {
+            completion(manager_vector_result_t{std::move(state.error())});
+        }
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), std::move(impl_completion));
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), fetch_mode::reader,
+                                      std::move(completion_on_main));
 }
 
 void manager::fetch_const_objects(db::cancellation_f cancellation, db::fetch_option_preparation_f preparation,
                                   db::const_vector_completion_f completion) {
     auto manager = this->_weak_manager.lock();
 
-    auto impl_completion = [completion = std::move(completion), manager](manager_result_t &&state,
-                                                                         db::object_data_vector_map_t &&fetched_datas) {
-        auto completion_on_main = [state = std::move(state), completion = std::move(completion),
-                                   fetched_datas = std::move(fetched_datas), manager]() mutable {
-            if (state) {
-                completion(manager_const_vector_result_t{db::to_const_vector_objects(manager->model(), fetched_datas)});
-            } else {
-                completion(manager_const_vector_result_t{std::move(state.error())});
-            }
-        };
-
-        thread::perform_sync_on_main(std::move(completion_on_main));
+    auto completion_on_main = [completion = std::move(completion), manager](
+                                  manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas) {
+        if (state) {
+            completion(manager_const_vector_result_t{db::to_const_vector_objects(manager->model(), fetched_datas)});
+        } else {
+            completion(manager_const_vector_result_t{std::move(state.error())});
+        }
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), std::move(impl_completion));
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), fetch_mode::const_reader,
+                                      std::move(completion_on_main));
 }
 
 void manager::fetch_objects(db::cancellation_f cancellation, db::fetch_ids_preparation_f preparation,
                             db::map_completion_f completion) {
     auto manager = this->_weak_manager.lock();
 
-    auto impl_completion = [completion = std::move(completion), manager](manager_result_t &&state,
-                                                                         db::object_data_vector_map_t &&fetched_datas) {
-        auto completion_on_main = [manager, completion = std::move(completion), state = std::move(state),
-                                   fetched_datas = std::move(fetched_datas)]() mutable {
-            if (state) {
-                auto loaded_objects = manager->_load_and_cache_object_map(fetched_datas, false, false);
-                completion(manager_map_result_t{std::move(loaded_objects)});
-            } else {
-                completion(manager_map_result_t{std::move(state.error())});
-            }
-        };
-
-        thread::perform_sync_on_main(std::move(completion_on_main));
+    auto completion_on_main = [completion = std::move(completion), manager](
+                                  manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas) {
+        if (state) {
+            auto loaded_objects = manager->_load_and_cache_object_map(fetched_datas, false, false);
+            completion(manager_map_result_t{std::move(loaded_objects)});
+        } else {
+            completion(manager_map_result_t{std::move(state.error())});
+        }
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), std::move(impl_completion));
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), fetch_mode::reader,
+                                      std::move(completion_on_main));
 }
 
 void manager::fetch_const_objects(db::cancellation_f cancellation, db::fetch_ids_preparation_f preparation,
                                   db::const_map_completion_f completion) {
     auto manager = this->_weak_manager.lock();
 
-    auto impl_completion = [completion = std::move(completion), manager](manager_result_t &&state,
-                                                                         db::object_data_vector_map_t &&fetched_datas) {
-        auto completion_on_main = [manager, completion = std::move(completion), state = std::move(state),
-                                   fetched_datas = std::move(fetched_datas)]() mutable {
-            if (state) {
-                completion(manager_const_map_result_t{db::to_const_map_objects(manager->model(), fetched_datas)});
-            } else {
-                completion(manager_const_map_result_t{std::move(state.error())});
-            }
-        };
-
-        thread::perform_sync_on_main(std::move(completion_on_main));
+    auto completion_on_main = [completion = std::move(completion), manager](
+                                  manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas) {
+        if (state) {
+            completion(manager_const_map_result_t{db::to_const_map_objects(manager->model(), fetched_datas)});
+        } else {
+            completion(manager_const_map_result_t{std::move(state.error())});
+        }
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), std::move(impl_completion));
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(preparation), fetch_mode::const_reader,
+                                      std::move(completion_on_main));
 }
 
 void manager::save(db::cancellation_f cancellation, db::map_completion_f completion) {
@@ -523,8 +683,9 @@ void manager::save(db::cancellation_f cancellation, db::map_completion_f complet
 
                 // トランザクション終了
                 if (state) {
-                    db::commit(db);
-                } else {
+                    state = commit_unless_canceled(db);
+                }
+                if (!state) {
                     db::rollback(db);
                     saved_datas.clear();
                 }
@@ -537,7 +698,7 @@ void manager::save(db::cancellation_f cancellation, db::map_completion_f complet
         auto completion_on_main = [manager, state = std::move(state), completion = std::move(completion),
                                    saved_datas = std::move(saved_datas), db_info = std::move(db_info)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(db_info));
+                manager->_set_db_info(std::move(db_info), to_object_ids(saved_datas));
                 auto loaded_objects = manager->_load_and_cache_object_map(saved_datas, false, true);
                 manager->_erase_changed_objects(saved_datas);
                 completion(manager_map_result_t{std::move(loaded_objects)});
@@ -552,6 +713,75 @@ void manager::save(db::cancellation_f cancellation, db::map_completion_f complet
     this->execute(std::move(cancellation), std::move(execution));
 }
 
+// バックグラウンドでデータベースをpathのファイルへバックアップする
+// pages_per_stepページずつコピーして、1ステップごとにタスクキューへ積み直すので、間に追加されたタスクはその合間に実行される
+// progressとcompletionはメインスレッドで呼ばれる。progressがfalseを返したら中止する
+// 始まった後にキャンセルされたら、次のステップでcanceledのエラーとしてcompletionを呼ぶ
+void manager::backup(db::cancellation_f cancellation, std::filesystem::path const &path, db::backup_progress_f progress,
+                     db::completion_f completion, int const pages_per_step) {
+    auto manager = this->_weak_manager.lock();
+
+    auto execution = [cancellation, path, progress = std::move(progress), completion = std::move(completion),
+                      pages_per_step, manager](auto const &) mutable {
+        if (auto backup_result = manager->database()->make_backup(path)) {
+            manager->_execute_backup_step(std::move(backup_result.value()), std::move(cancellation), pages_per_step,
+                                          std::move(progress), std::move(completion));
+        } else {
+            manager_result_t state =
+                db::make_error_result(manager_error_type::backup_failed, std::move(backup_result.error()));
+
+            auto completion_on_main = [&completion, &state]() { completion(std::move(state)); };
+            thread::perform_sync_on_main(std::move(completion_on_main));
+        }
+    };
+
+    this->_execute(std::move(cancellation), std::move(execution));
+}
+
+// バックグラウンドでオブジェクトのアトリビュートのBLOBを、全体を読み込まずにchunk_sizeずつhandlerに渡す
+// オブジェクトが読み込まれた時点のセーブIDのデータを読む。保存されていない変更は含まない
+// handlerはバックグラウンドで呼ばれ、falseを返したらそこで終了する。completionはメインスレッドで呼ばれる
+void manager::read_attribute_blob(db::cancellation_f cancellation, db::const_object_ptr const &object,
+                                  std::string const &attr_name, db::blob_chunk_handler_f handler,
+                                  db::completion_f completion, std::size_t const chunk_size) {
+    auto execution = [entity_name = object->entity_name(), obj_id = object->object_id().stable_value(),
+                      save_id = object->save_id(), attr_name, handler = std::move(handler),
+                      completion = std::move(completion), chunk_size,
+                      manager = this->_weak_manager.lock()](auto const &) mutable {
+        auto const &db = manager->database();
+
+        manager_result_t state{nullptr};
+
+        // 読み込みのみなので、他の接続の読み込みを妨げないようにDEFERREDでトランザクションを開始する
+        if (auto begin_result = db::begin_deferred_transaction(db)) {
+            auto const version_rows = manager->model().entity(entity_name).version_rows;
+            if (auto open_result =
+                    db::open_attribute_blob(db, entity_name, attr_name, obj_id, save_id, version_rows)) {
+                if (auto read_result = open_result.value()->read_chunks(chunk_size, handler); !read_result) {
+                    state = db::make_error_result(manager_error_type::select_failed, std::move(read_result.error()));
+                }
+            } else {
+                state = db::make_error_result(manager_error_type::select_failed, std::move(open_result.error()));
+            }
+
+            if (state) {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
+                db::rollback(db);
+            }
+        } else {
+            state =
+                db::make_error_result(manager_error_type::begin_transaction_failed, std::move(begin_result.error()));
+        }
+
+        auto completion_on_main = [&completion, &state]() { completion(std::move(state)); };
+        thread::perform_sync_on_main(std::move(completion_on_main));
+    };
+
+    this->_execute(std::move(cancellation), std::move(execution));
+}
+
 void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f preparation,
                      db::vector_completion_f completion) {
     auto manager = this->_weak_manager.lock();
@@ -596,7 +826,15 @@ void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f p
                     auto const &entity_name = entity_model_pair.first;
                     // リバートするためのデータをデータベースから取得する
                     // カレントとの位置によってredoかundoが内部で呼ばれる
-                    if (auto select_result = db::select_for_revert(db, entity_name, rev_save_id, current_save_id)) {
+                    // WITHOUT ROWIDのテーブルもあるので、rowidではなくpk_idで最後のデータを判断する
+                    auto select_result =
+                        db::select_for_revert(db, entity_name, rev_save_id, current_save_id, db::pk_id_field);
+                    if (select_result) {
+                        // deltaのエンティティなら保存していないアトリビュートを前のデータから埋める
+                        select_result =
+                            db::fill_delta_rows(db, entity_model_pair.second, std::move(select_result.value()));
+                    }
+                    if (select_result) {
                         reverted_attrs.emplace(entity_name, std::move(select_result.value()));
                     } else {
                         reverted_attrs.clear();
@@ -614,8 +852,7 @@ void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f p
                     auto const &rel_models = manager->model().relations(entity_name);
 
                     // アトリビュートのみのデータから関連のデータを加えてobject_dataを生成する
-                    if (auto obj_datas_result =
-                            db::make_entity_object_datas(db, entity_name, rel_models, entity_attrs)) {
+                    if (auto obj_datas_result = db::make_entity_object_datas(db, rel_models, entity_attrs)) {
                         reverted_datas.emplace(entity_name, std::move(obj_datas_result.value()));
                     } else {
                         reverted_attrs.clear();
@@ -627,6 +864,11 @@ void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f p
                 }
             }
 
+            if (state) {
+                // フェッチで使うヘッドをリバートしたセーブIDの時点にする
+                state = db::revert_heads(db, manager->model(), rev_save_id, current_save_id);
+            }
+
             if (state) {
                 // リバートしたセーブIDでinfoを更新する
                 if (auto update_result = db::update_current_save_id(db, db::value{rev_save_id})) {
@@ -638,8 +880,9 @@ void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f p
 
             // トランザクション終了
             if (state) {
-                db::commit(db);
-            } else {
+                state = commit_unless_canceled(db);
+            }
+            if (!state) {
                 db::rollback(db);
                 reverted_datas.clear();
                 ret_db_info = std::nullopt;
@@ -653,7 +896,7 @@ void manager::revert(db::cancellation_f cancellation, db::revert_preparation_f p
                                    reverted_datas = std::move(reverted_datas),
                                    db_info = std::move(ret_db_info)]() mutable {
             if (state) {
-                manager->_set_db_info(std::move(db_info));
+                manager->_set_db_info(std::move(db_info), to_object_ids(reverted_datas));
                 auto loaded_objects = manager->_load_and_cache_object_vector(reverted_datas, false, false);
                 completion(manager_vector_result_t{std::move(loaded_objects)});
             } else {
@@ -865,10 +1108,57 @@ void manager::_purge_cached_objects() {
 }
 
 // データベース情報を置き換える
-void manager::_set_db_info(db::info_opt &&info) {
+// 書き込みの結果が反映される時に必ず呼ばれるので、書き込みの世代を進める
+// 読み込み専用の接続で取得している途中なら、書き込んだオブジェクトIDを記録しておく。nulloptは全てのオブジェクトが変わりうる
+void manager::_set_db_info(db::info_opt &&info, std::optional<db::integer_set_map_t> &&written_ids) {
+    ++this->_write_generation;
+
+    if (!this->_reading_write_generations.empty()) {
+        this->_written_object_ids.emplace_back(this->_write_generation, std::move(written_ids));
+    }
+
     this->_db_info->set_value(std::move(info));
 }
 
+// 読み込み専用の接続で取得を始める時に呼び、取得を始めた時点の書き込みの世代を返す
+std::size_t manager::_begin_tracking_writes() {
+    std::size_t const write_generation = this->_write_generation;
+    this->_reading_write_generations.insert(write_generation);
+    return write_generation;
+}
+
+// 読み込み専用の接続での取得が終わった時に呼び、取得している間に書き込まれたオブジェクトIDをまとめて返す
+// 全てのオブジェクトが変わりうる書き込みがあればnulloptを返す
+std::optional<db::integer_set_map_t> manager::_end_tracking_writes(std::size_t const write_generation) {
+    std::optional<db::integer_set_map_t> written_ids = db::integer_set_map_t{};
+
+    for (auto const &[generation, obj_ids] : this->_written_object_ids) {
+        if (generation <= write_generation) {
+            continue;
+        }
+        if (!obj_ids) {
+            written_ids = std::nullopt;
+            break;
+        }
+        for (auto const &[entity_name, entity_ids] : *obj_ids) {
+            (*written_ids)[entity_name].insert(entity_ids.begin(), entity_ids.end());
+        }
+    }
+
+    this->_reading_write_generations.erase(this->_reading_write_generations.find(write_generation));
+
+    // 取得している途中のもので一番古い世代までの記録は使われないので削除する
+    if (this->_reading_write_generations.empty()) {
+        this->_written_object_ids.clear();
+    } else {
+        std::size_t const oldest_generation = *this->_reading_write_generations.begin();
+        std::erase_if(this->_written_object_ids,
+                      [oldest_generation](auto const &pair) { return pair.first <= oldest_generation; });
+    }
+
+    return written_ids;
+}
+
 // データベースに保存するために、全てのエンティティで変更のあったオブジェクトのobject_dataを取得する
 db::object_data_vector_map_t manager::_changed_datas_for_save() {
     db::object_data_vector_map_t changed_datas;
@@ -996,66 +1286,344 @@ void manager::_execute(db::cancellation_f &&cancellation, db::execution_f &&exec
         if (!task.is_canceled() && !cancellation()) {
             auto const &db = manager->_database;
             db->open();
+            // 実行中にキャンセルされたら、SQLを中断して残りの処理を失敗させる
+            db->set_interruption_handler([&task, &cancellation]() { return task.is_canceled() || cancellation(); });
             execution(task);
-            db->close();
+            db->set_interruption_handler(nullptr);
+            manager->_did_execute();
         }
     };
 
     this->_task_queue->push_back(task<std::nullptr_t>::make_shared(std::move(op_lambda)));
 }
 
+// delay後にタスクキューの末尾に追加する。待っている間もタスクキューの他のタスクは実行される
+void manager::_execute_after(std::chrono::microseconds const delay, db::cancellation_f &&cancellation,
+                             db::execution_f &&execution) {
+    struct context_t {
+        manager_wptr weak_manager;
+        db::cancellation_f cancellation;
+        db::execution_f execution;
+    };
+
+    auto *context = new context_t{.weak_manager = this->_weak_manager,
+                                  .cancellation = std::move(cancellation),
+                                  .execution = std::move(execution)};
+
+    dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(delay.count() * NSEC_PER_USEC)),
+                     dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), context, [](void *context) {
+                         auto *execution_context = static_cast<context_t *>(context);
+                         if (auto manager = execution_context->weak_manager.lock()) {
+                             manager->_execute(std::move(execution_context->cancellation),
+                                               std::move(execution_context->execution));
+                         }
+                         delete execution_context;
+                     });
+}
+
+// バックアップを1ステップ進める。終わっていなければ次のステップをタスクキューの末尾に追加する
+// ロックが取れなかった場合はbusy_retry_policyの時間だけ待ってから追加する
+void manager::_execute_backup_step(db::backup_ptr &&backup, db::cancellation_f &&cancellation,
+                                   int const pages_per_step, db::backup_progress_f &&progress,
+                                   db::completion_f &&completion, int const busy_retry_count) {
+    std::optional<manager_result_t> state = std::nullopt;
+    int next_busy_retry_count = 0;
+
+    if (cancellation()) {
+        // ステップの間にキャンセルされたら、残りをコピーせずに終了する
+        state = db::make_error_result(manager_error_type::canceled);
+    } else if (auto step_result = backup->step(pages_per_step)) {
+        bool should_continue = true;
+
+        if (progress) {
+            auto progress_on_main = [&should_continue, &progress, &step_result]() {
+                should_continue = progress(step_result.value());
+            };
+            thread::perform_sync_on_main(std::move(progress_on_main));
+        }
+
+        if (!should_continue) {
+            db::error error{db::error_type::sqlite, SQLITE_INTERRUPT, "backup was canceled."};
+            state = db::make_error_result(manager_error_type::backup_failed, std::move(error));
+        } else if (backup->is_done()) {
+            state = manager_result_t{nullptr};
+        }
+    } else {
+        int const code = step_result.error().code().raw_value();
+        if (code == SQLITE_BUSY || code == SQLITE_LOCKED) {
+            // ロックが取れなかった場合は待ってから次のステップでやり直す
+            next_busy_retry_count = busy_retry_count + 1;
+        } else {
+            state = db::make_error_result(manager_error_type::backup_failed, std::move(step_result.error()));
+        }
+    }
+
+    if (state) {
+        backup = nullptr;
+
+        auto completion_on_main = [&completion, &state]() { completion(std::move(*state)); };
+        thread::perform_sync_on_main(std::move(completion_on_main));
+        return;
+    }
+
+    auto execution = [backup = std::move(backup), cancellation, pages_per_step, progress = std::move(progress),
+                      completion = std::move(completion), busy_retry_count = next_busy_retry_count,
+                      manager = this->_weak_manager.lock()](auto const &) mutable {
+        manager->_execute_backup_step(std::move(backup), std::move(cancellation), pages_per_step,
+                                      std::move(progress), std::move(completion), busy_retry_count);
+    };
+
+    // キャンセルで次のステップが飛ばされるとcompletionが呼ばれないので、キャンセルはステップの中で判定する
+    if (next_busy_retry_count > 0) {
+        std::uniform_real_distribution<double> distribution{0.0, 1.0};
+        std::chrono::microseconds const delay =
+            this->_connection_option.busy_retry_policy.delay(busy_retry_count, distribution(this->_busy_retry_random));
+        this->_execute_after(delay, db::cancellation_f{db::no_cancellation}, std::move(execution));
+    } else {
+        this->_execute(db::cancellation_f{db::no_cancellation}, std::move(execution));
+    }
+}
+
+// タスクの実行後の処理。persistentでなければバックアップ中を除いてデータベースを閉じる
+void manager::_did_execute() {
+    if (!this->_connection_option.persistent) {
+        // バックアップの途中ならステップの間も開いたままにする
+        if (!this->_database->has_backups()) {
+            this->_database->close();
+        }
+        return;
+    }
+
+    this->_last_execution_time = std::chrono::steady_clock::now();
+
+    if (this->_connection_option.idle_timeout > 0.0 && !this->_idle_check_scheduled) {
+        this->_schedule_idle_check(this->_connection_option.idle_timeout);
+    }
+}
+
+// delay秒後にタスクキューでアイドル状態かを確認する
+void manager::_schedule_idle_check(double const delay) {
+    this->_idle_check_scheduled = true;
+
+    auto *context = new manager_wptr{this->_weak_manager};
+
+    dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(delay * NSEC_PER_SEC)),
+                     dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), context, [](void *context) {
+                         auto *weak_manager = static_cast<manager_wptr *>(context);
+                         if (auto manager = weak_manager->lock()) {
+                             auto op_lambda = [manager](auto const &) { manager->_close_database_if_idle(); };
+                             manager->_task_queue->push_back(task<std::nullptr_t>::make_shared(std::move(op_lambda)));
+                         }
+                         delete weak_manager;
+                     });
+}
+
+// 最後のタスクの実行からidle_timeout秒経っていればデータベースを閉じる。経っていなければ残りの時間で確認し直す
+void manager::_close_database_if_idle() {
+    this->_idle_check_scheduled = false;
+
+    if (!this->_database->sqlite_handle()) {
+        return;
+    }
+
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - this->_last_execution_time;
+    double const remain = this->_connection_option.idle_timeout - elapsed.count();
+
+    if (remain > 0.0) {
+        this->_schedule_idle_check(remain);
+    } else if (!this->_database->has_backups()) {
+        // バックアップの途中なら閉じない。次のステップの実行後に確認し直す
+        this->_database->close();
+        if (this->_reader_pool) {
+            this->_reader_pool->close_all();
+        }
+    }
+}
+
 // バックグラウンドでデータベースからオブジェクトデータを取得する。条件はselect_optionで指定。単独のエンティティのみ
+// 読み込み専用の接続が空いていれば、それまでのタスクの結果が反映された時点から並行して取得する
+// その間に書き込まれたオブジェクトは書き込み用の接続で取得し直す。条件に合うかは読み込み専用の接続で取得した時点のまま
+// completionはメインスレッドで呼ばれる
 void manager::_execute_fetch_object_datas(
-    db::cancellation_f &&cancellation, db::fetch_option_preparation_f &&preparation,
+    db::cancellation_f &&cancellation, db::fetch_option_preparation_f &&preparation, fetch_mode const mode,
     std::function<void(manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas)> &&completion) {
-    auto execution = [preparation = std::move(preparation), completion = std::move(completion),
-                      manager = this->_weak_manager.lock()](auto const &) mutable {
+    auto op_lambda = [cancellation = std::move(cancellation), preparation = std::move(preparation), mode,
+                      completion = std::move(completion),
+                      manager = this->_weak_manager.lock()](auto const &task) mutable {
+        if (task.is_canceled() || cancellation()) {
+            return;
+        }
+
         // データベースからデータを取得する条件をメインスレッドで準備する
         db::fetch_option fetch_option;
         auto preparation_on_main = [&fetch_option, &preparation]() { fetch_option = preparation(); };
         thread::perform_sync_on_main(std::move(preparation_on_main));
 
+        if (mode != fetch_mode::writer) {
+            if (auto const reader_idx = manager->_begin_reading()) {
+                // 読み込み専用の接続でトランザクションを開始できたら、取得は接続ごとのタスクキューで行う
+                // キャッシュに読み込む場合は、取得している間に書き込まれたオブジェクトを記録しておく
+                std::size_t write_generation = 0;
+                if (mode == fetch_mode::reader) {
+                    auto begin_tracking_on_main = [&manager, &write_generation]() {
+                        write_generation = manager->_begin_tracking_writes();
+                    };
+                    thread::perform_sync_on_main(std::move(begin_tracking_on_main));
+                }
+
+                auto reader_lambda = [cancellation = std::move(cancellation), fetch_option, mode,
+                                      completion = std::move(completion), manager, idx = *reader_idx,
+                                      write_generation](auto const &reader_task) mutable {
+                    auto const &db = manager->_reader_pool->reader_at(idx).database;
+                    db::object_data_vector_map_t fetched_datas;
+                    db->set_interruption_handler(
+                        [&reader_task, &cancellation]() { return reader_task.is_canceled() || cancellation(); });
+                    manager_result_t state = fetch_in_transaction(db, manager->model(), fetch_option,
+                                                                  manager->_query_plan_checker, fetched_datas);
+                    db->set_interruption_handler(nullptr);
+
+                    if (!manager->_connection_option.persistent) {
+                        db->close();
+                    }
+
+                    manager->_reader_pool->release(idx);
+
+                    // 取得し直すオブジェクトID。nulloptなら全て取得し直す
+                    std::optional<db::integer_set_map_t> outdated_ids = db::integer_set_map_t{};
+
+                    auto completion_on_main = [&]() {
+                        if (mode == fetch_mode::reader) {
+                            // 取得している間に書き込まれたオブジェクトは、キャッシュを古いデータで上書きしないように取得し直す
+                            auto const written_ids = manager->_end_tracking_writes(write_generation);
+                            if (state && written_ids) {
+                                outdated_ids = filter_object_ids(fetched_datas, *written_ids);
+                            } else if (state) {
+                                outdated_ids = std::nullopt;
+                            }
+                        }
+
+                        if (outdated_ids && outdated_ids->empty()) {
+                            completion(std::move(state), std::move(fetched_datas));
+                        }
+                    };
+
+                    thread::perform_sync_on_main(std::move(completion_on_main));
+
+                    if (!outdated_ids) {
+                        // 全てのオブジェクトが変わりうる書き込みがあったら、書き込み用の接続で全て取得し直す
+                        db::fetch_option_preparation_f retry_preparation = [fetch_option]() { return fetch_option; };
+                        manager->_execute_fetch_object_datas(std::move(cancellation), std::move(retry_preparation),
+                                                             fetch_mode::writer, std::move(completion));
+                    } else if (!outdated_ids->empty()) {
+                        // 書き込まれたオブジェクトだけを書き込み用の接続で取得し直して置き換える
+                        db::fetch_option retry_option = db::to_fetch_option(*outdated_ids);
+                        for (auto const &[table, attr_names] : fetch_option.excluded_attributes()) {
+                            retry_option.exclude_attributes(table, attr_names);
+                        }
+                        db::fetch_option_preparation_f retry_preparation = [retry_option = std::move(retry_option)]() {
+                            return retry_option;
+                        };
+                        auto retry_completion = [fetched_datas = std::move(fetched_datas),
+                                                 obj_ids = std::move(*outdated_ids),
+                                                 completion = std::move(completion)](
+                                                    manager_result_t &&state,
+                                                    db::object_data_vector_map_t &&reloaded_datas) mutable {
+                            if (state) {
+                                replace_object_datas(fetched_datas, obj_ids, std::move(reloaded_datas));
+                                completion(std::move(state), std::move(fetched_datas));
+                            } else {
+                                completion(std::move(state), std::move(reloaded_datas));
+                            }
+                        };
+                        manager->_execute_fetch_object_datas(std::move(cancellation), std::move(retry_preparation),
+                                                             fetch_mode::writer, std::move(retry_completion));
+                    }
+                };
+
+                manager->_reader_pool->reader_at(*reader_idx)
+                    .queue->push_back(yas::task<std::nullptr_t>::make_shared(std::move(reader_lambda)));
+
+                manager->_did_execute();
+                return;
+            }
+        }
+
+        // 書き込み用の接続で取得する
+        manager->_database->open();
+
         auto const &db = manager->database();
-        auto const &model = manager->model();
         manager_result_t state{nullptr};
         db::object_data_vector_map_t fetched_datas;
 
-        if (auto begin_result = db::begin_transaction(db)) {
-            // トランザクション開始
-            if (auto fetch_result = db::fetch(db, model, fetch_option)) {
-                fetched_datas = std::move(fetch_result.value());
-            } else {
-                state = manager_result_t{std::move(fetch_result.error())};
-            }
+        db->set_interruption_handler([&task, &cancellation]() { return task.is_canceled() || cancellation(); });
 
-            // トランザクション終了
-            if (state) {
-                db::commit(db);
-            } else {
-                db::rollback(db);
-                fetched_datas.clear();
-            }
+        // 読み込みのみなので、他の接続の読み込みを妨げないようにDEFERREDでトランザクションを開始する
+        if (auto begin_result = db::begin_deferred_transaction(db)) {
+            state = fetch_in_transaction(db, manager->model(), fetch_option, manager->_query_plan_checker,
+                                         fetched_datas);
         } else {
             state =
                 db::make_error_result(manager_error_type::begin_transaction_failed, std::move(begin_result.error()));
         }
 
+        db->set_interruption_handler(nullptr);
+
         // 結果を返す
-        completion(std::move(state), std::move(fetched_datas));
+        auto completion_on_main = [&completion, &state, &fetched_datas]() {
+            completion(std::move(state), std::move(fetched_datas));
+        };
+
+        thread::perform_sync_on_main(std::move(completion_on_main));
+
+        manager->_did_execute();
     };
 
-    this->_execute(std::move(cancellation), std::move(execution));
+    this->_task_queue->push_back(task<std::nullptr_t>::make_shared(std::move(op_lambda)));
 }
 
 // バックグラウンドでデータベースからオブジェクトデータを取得する。条件はobject_idで指定。単独のエンティティのみ
 void manager::_execute_fetch_object_datas(
-    db::cancellation_f &&cancellation, fetch_ids_preparation_f &&ids_preparation,
+    db::cancellation_f &&cancellation, fetch_ids_preparation_f &&ids_preparation, fetch_mode const mode,
     std::function<void(manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas)> &&completion) {
     db::fetch_option_preparation_f opt_preparation = [ids_preparation = std::move(ids_preparation)]() {
         return db::to_fetch_option(ids_preparation());
     };
 
-    this->_execute_fetch_object_datas(std::move(cancellation), std::move(opt_preparation), std::move(completion));
+    this->_execute_fetch_object_datas(std::move(cancellation), std::move(opt_preparation), mode,
+                                      std::move(completion));
+}
+
+// 空いている読み込み専用の接続を開いて、読み込みのトランザクションを開始する
+// スナップショットを書き込み用のキューの順番で確定させるために、ここで読み込みを1回しておく
+// 書き込み用の接続に登録された関数と接続しているデータベースは、フェッチのSQLで使えるように読み込み用の接続にも登録する
+std::optional<std::size_t> manager::_begin_reading() {
+    if (!this->_reader_pool) {
+        return std::nullopt;
+    }
+
+    auto const reader_idx = this->_reader_pool->acquire();
+    if (!reader_idx) {
+        return std::nullopt;
+    }
+
+    auto const &db = this->_reader_pool->reader_at(*reader_idx).database;
+
+    if (db->copy_registrations(*this->_database) && this->_reader_pool->open(*reader_idx)) {
+        if (db::begin_deferred_transaction(db)) {
+            if (db::fetch_info(db)) {
+                return reader_idx;
+            }
+            db::rollback(db);
+        }
+    }
+
+    if (!this->_connection_option.persistent) {
+        db->close();
+    }
+
+    this->_reader_pool->release(*reader_idx);
+
+    return std::nullopt;
 }
 
 // オブジェクトに変更があった時の処理
@@ -1103,8 +1671,9 @@ void manager::_object_did_change(db::object_ptr const &object) {
 }
 
 manager_ptr manager::make_shared(std::filesystem::path const &db_path, db::model const &model,
-                                 std::size_t const priority_count) {
-    auto shared = manager_ptr(new manager{db_path, model, priority_count});
+                                 std::size_t const priority_count, db::connection_option connection_option) {
+    auto shared = manager_ptr(new manager{db_path, model, priority_count,
+                                          to_manager_connection_option(db_path, std::move(connection_option))});
     shared->_prepare(shared);
     return shared;
 }
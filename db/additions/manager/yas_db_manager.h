@@ -6,13 +6,19 @@
 
 #include <cpp_utils/yas_task_queue.h>
 #include <db/yas_db_additional_protocol.h>
+#include <db/yas_db_backup.h>
+#include <db/yas_db_blob_stream.h>
 #include <db/yas_db_fetch_option.h>
 #include <db/yas_db_manager_error.h>
 #include <db/yas_db_model.h>
 #include <db/yas_db_object.h>
 #include <db/yas_db_ptr.h>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <random>
+#include <set>
 
 namespace yas::db {
 class select_option;
@@ -25,8 +31,10 @@ struct manager final {
     using db_object_observing_handler_f = std::function<void(object_ptr const &)>;
 
     [[nodiscard]] std::filesystem::path const &database_path() const;
+    // 書き込み用の接続。executeの中で登録した関数や接続したデータベースは、読み込み専用の接続でのフェッチでも使える
     [[nodiscard]] db::database_ptr const &database() const;
     [[nodiscard]] db::model const &model() const;
+    [[nodiscard]] db::connection_option const &connection_option() const;
     [[nodiscard]] db::value const &current_save_id() const;
     [[nodiscard]] db::value const &last_save_id() const;
 
@@ -40,6 +48,7 @@ struct manager final {
     [[nodiscard]] bool is_suspended() const;
 
     void execute(db::cancellation_f, db::execution_f &&);
+    void close_database();
 
     void setup(db::completion_f);
     void clear(db::cancellation_f, db::completion_f);
@@ -53,6 +62,11 @@ struct manager final {
     void fetch_const_objects(db::cancellation_f, db::fetch_ids_preparation_f, db::const_map_completion_f);
     void save(db::cancellation_f, db::map_completion_f);
     void revert(db::cancellation_f, db::revert_preparation_f, db::vector_completion_f);
+    void backup(db::cancellation_f, std::filesystem::path const &, db::backup_progress_f, db::completion_f,
+                int const pages_per_step = db::default_backup_pages_per_step);
+    void read_attribute_blob(db::cancellation_f, db::const_object_ptr const &, std::string const &attr_name,
+                             db::blob_chunk_handler_f, db::completion_f,
+                             std::size_t const chunk_size = db::default_blob_chunk_size);
 
     [[nodiscard]] std::optional<db::object_ptr> cached_or_created_object(std::string const &entity_name,
                                                                          db::object_id const &object_id) const;
@@ -68,13 +82,29 @@ struct manager final {
     [[nodiscard]] db::object_ptr make_object(std::string const &entity_name);
 
     [[nodiscard]] static manager_ptr make_shared(std::filesystem::path const &db_path, db::model const &model,
-                                                 std::size_t const priority_count = 1);
+                                                 std::size_t const priority_count = 1,
+                                                 db::connection_option connection_option = {});
 
    private:
+    enum class fetch_mode {
+        writer,
+        reader,
+        const_reader,
+    };
+
     db::manager_wptr _weak_manager;
     db::database_ptr _database;
     db::model _model;
+    db::connection_option const _connection_option;
+    db::query_plan_checker_ptr const _query_plan_checker;
+    db::reader_pool_ptr const _reader_pool;
+    std::atomic<std::size_t> _write_generation = 0;
+    std::multiset<std::size_t> _reading_write_generations;
+    std::vector<std::pair<std::size_t, std::optional<db::integer_set_map_t>>> _written_object_ids;
     std::shared_ptr<task_queue<std::nullptr_t>> _task_queue;
+    std::chrono::steady_clock::time_point _last_execution_time;
+    bool _idle_check_scheduled = false;
+    std::minstd_rand _busy_retry_random{std::random_device{}()};
     std::size_t _suspend_count = 0;
     mutable db::weak_pool<db::object_id, db::object> _cached_objects;
     db::tmp_object_map_map_t _created_objects;
@@ -83,7 +113,8 @@ struct manager final {
     observing::notifier_ptr<db::object_ptr> const _db_object_notifier;
     observing::canceller_pool _pool;
 
-    manager(std::filesystem::path const &db_path, db::model const &model, std::size_t const priority_count);
+    manager(std::filesystem::path const &db_path, db::model const &model, std::size_t const priority_count,
+            db::connection_option &&);
 
     void _prepare(manager_ptr const &);
 
@@ -100,17 +131,26 @@ struct manager final {
                                                     bool const is_save);
     void _clear_cached_objects();
     void _purge_cached_objects();
-    void _set_db_info(db::info_opt &&);
+    void _set_db_info(db::info_opt &&, std::optional<db::integer_set_map_t> &&written_ids);
+    std::size_t _begin_tracking_writes();
+    std::optional<db::integer_set_map_t> _end_tracking_writes(std::size_t const write_generation);
     db::object_data_vector_map_t _changed_datas_for_save();
     db::integer_set_map_t _changed_object_ids_for_reset();
     void _erase_changed_objects(db::object_data_vector_map_t const &);
     std::optional<db::object_ptr> _inserted_object(std::string const &entity_name, std::string const &tmp_obj_id) const;
     void _execute(db::cancellation_f &&, db::execution_f &&);
+    void _execute_after(std::chrono::microseconds const delay, db::cancellation_f &&, db::execution_f &&);
+    void _execute_backup_step(db::backup_ptr &&, db::cancellation_f &&, int const pages_per_step,
+                              db::backup_progress_f &&, db::completion_f &&, int const busy_retry_count = 0);
+    void _did_execute();
+    void _schedule_idle_check(double const delay);
+    void _close_database_if_idle();
     void _execute_fetch_object_datas(
-        db::cancellation_f &&, db::fetch_option_preparation_f &&,
+        db::cancellation_f &&, db::fetch_option_preparation_f &&, fetch_mode const,
         std::function<void(db::manager_result_t &&state, db::object_data_vector_map_t &&fetched_datas)> &&);
-    void _execute_fetch_object_datas(db::cancellation_f &&, fetch_ids_preparation_f &&,
+    void _execute_fetch_object_datas(db::cancellation_f &&, fetch_ids_preparation_f &&, fetch_mode const,
                                      std::function<void(db::manager_result_t &&, db::object_data_vector_map_t &&)> &&);
+    std::optional<std::size_t> _begin_reading();
     void _object_did_change(db::object_ptr const &);
 };
 }  // namespace yas::db
@@ -37,6 +37,8 @@ std::string yas::to_string(manager_error_type const &error) {
             return "begin_transaction_failed";
         case manager_error_type::vacuum_failed:
             return "vacuum_failed";
+        case manager_error_type::backup_failed:
+            return "backup_failed";
         case manager_error_type::select_info_failed:
             return "select_info_failed";
         case manager_error_type::update_info_failed:
@@ -57,6 +59,8 @@ std::string yas::to_string(manager_error_type const &error) {
             return "create_relation_table_failed";
         case manager_error_type::create_index_failed:
             return "create_index_failed";
+        case manager_error_type::create_head_table_failed:
+            return "create_head_table_failed";
         case manager_error_type::insert_attributes_failed:
             return "insert_attributes_failed";
         case manager_error_type::insert_relation_failed:
@@ -65,6 +69,8 @@ std::string yas::to_string(manager_error_type const &error) {
             return "save_id_not_found";
         case manager_error_type::update_save_id_failed:
             return "update_save_id_failed";
+        case manager_error_type::update_head_failed:
+            return "update_head_failed";
         case manager_error_type::delete_failed:
             return "delete_failed";
         case manager_error_type::purge_failed:
@@ -77,6 +83,8 @@ std::string yas::to_string(manager_error_type const &error) {
             return "select_revert_failed";
         case manager_error_type::select_relation_removed_failed:
             return "select_relation_removed_failed";
+        case manager_error_type::explain_query_plan_failed:
+            return "explain_query_plan_failed";
         case manager_error_type::make_object_datas_failed:
             return "make_object_datas_failed";
         case manager_error_type::out_of_range_save_id:
@@ -85,6 +93,8 @@ std::string yas::to_string(manager_error_type const &error) {
             return "select_failed";
         case manager_error_type::last_insert_rowid_failed:
             return "last_insert_rowid_failed";
+        case manager_error_type::canceled:
+            return "canceled";
         case manager_error_type::none:
             return "none";
     }
@@ -17,6 +17,7 @@ enum class manager_error_type {
     alter_entity_table_failed,
     create_relation_table_failed,
     create_index_failed,
+    create_head_table_failed,
 
     insert_info_failed,
     insert_attributes_failed,
@@ -24,12 +25,14 @@ enum class manager_error_type {
 
     update_info_failed,
     update_save_id_failed,
+    update_head_failed,
 
     select_failed,
     select_info_failed,
     select_last_failed,
     select_revert_failed,
     select_relation_removed_failed,
+    explain_query_plan_failed,
 
     make_object_datas_failed,
 
@@ -37,12 +40,14 @@ enum class manager_error_type {
     purge_failed,
     purge_relation_failed,
     vacuum_failed,
+    backup_failed,
 
     invalid_version_text,
     version_not_found,
     save_id_not_found,
     out_of_range_save_id,
     last_insert_rowid_failed,
+    canceled,
 };
 
 struct manager_error final {
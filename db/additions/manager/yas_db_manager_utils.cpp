@@ -9,6 +9,9 @@
 #include <cpp_utils/yas_stl_utils.h>
 #include <cpp_utils/yas_unless.h>
 
+#include <algorithm>
+#include <optional>
+
 #include "yas_db_attribute.h"
 #include "yas_db_database.h"
 #include "yas_db_entity.h"
@@ -19,15 +22,30 @@
 #include "yas_db_object.h"
 #include "yas_db_object_id.h"
 #include "yas_db_relation.h"
+#include "yas_db_row_set.h"
 #include "yas_db_sql_utils.h"
 #include "yas_db_value.h"
 
 using namespace yas;
 
 namespace yas::db {
-// 指定したsave_id以前で、object_idが同じなら最後のものをselectする条件
+// バッチの実行で失敗していたら、最初に失敗した行のエラーをmanagerのエラーにする
+static db::manager_result_t to_manager_result(db::batch_update_result_t const &batch_result,
+                                              db::manager_error_type const error_type) {
+    if (!batch_result) {
+        return db::make_error_result(error_type, batch_result.error());
+    }
+
+    if (auto const &row_errors = batch_result.value().row_errors; !row_errors.empty()) {
+        return db::make_error_result(error_type, row_errors.front().error);
+    }
+
+    return db::manager_result_t{nullptr};
+}
+
+// 指定したsave_id以前で、object_idが同じならkey_fieldが最大のものをselectする条件
 std::string last_where_exprs(std::string const &table, std::string const &where_exprs, db::value const &last_save_id,
-                             bool const include_removed) {
+                             bool const include_removed, std::string const &key_field) {
     std::vector<std::string> components;
 
     if (last_save_id) {
@@ -39,10 +57,10 @@ std::string last_where_exprs(std::string const &table, std::string const &where_
     }
 
     db::select_option option{.table = table,
-                             .fields = {"MAX(" + db::rowid_field + ")"},
+                             .fields = {"MAX(" + key_field + ")"},
                              .where_exprs = joined(components, " AND "),
                              .group_by = db::object_id_field};
-    std::string result_exprs = db::in_expr(db::rowid_field, option);
+    std::string result_exprs = db::in_expr(key_field, option);
 
     if (!include_removed) {
         static std::string const exclude_removed_expr = db::action_field + " != '" + db::remove_action + "'";
@@ -52,22 +70,285 @@ std::string last_where_exprs(std::string const &table, std::string const &where_
     return result_exprs;
 }
 
+// ヘッドのテーブルに置き換える行。フィールドの並びはentity::head_fieldsに合わせる
+// deltaのエンティティならアトリビュートの値も全て入れる
+static db::value_vector_t to_head_row(db::entity const &entity, db::value_map_t const &attributes) {
+    db::value_vector_t row;
+    row.reserve(entity.head_fields.size());
+
+    for (std::string const &field : entity.head_fields) {
+        if (field == db::removed_field) {
+            bool const removed = attributes.at(db::action_field).get<db::text>() == db::remove_action;
+            row.emplace_back(db::integer::type{removed ? 1 : 0});
+        } else if (auto const it = attributes.find(field); it != attributes.end()) {
+            row.push_back(it->second);
+        } else {
+            row.push_back(db::null_value());
+        }
+    }
+
+    return row;
+}
+
+// changedの値から、そのデータに保存したアトリビュートの名前を取り出す
+static db::string_set_t to_changed_names(db::value const &changed) {
+    db::string_set_t names;
+    std::string_view text = changed.get<db::text>();
+
+    while (!text.empty()) {
+        std::size_t const pos = text.find(',');
+        names.emplace(text.substr(0, pos));
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(pos + 1);
+    }
+
+    return names;
+}
+
+// changedのフィールドにattr_nameが含まれているかの条件。LIKEだと_が任意の1文字に一致するのでinstrで調べる
+static std::string changed_contains_expr(std::string const &field, std::string const &attr_name) {
+    return "instr(',' || " + field + " || ',', '," + attr_name + ",') > 0";
+}
+
+// deltaのエンティティに保存する行にする。changed_namesにないアトリビュートは保存せずにNULLかデフォルト値にする
+static db::value_map_t to_delta_row(db::entity const &entity, db::value_map_t attributes,
+                                    std::vector<std::string> const &changed_names) {
+    for (auto const &pair : entity.custom_attributes) {
+        if (!contains(changed_names, pair.first)) {
+            db::attribute const &attr = pair.second;
+            attributes.insert_or_assign(pair.first, attr.not_null ? attr.default_value : db::null_value());
+        }
+    }
+
+    attributes.insert_or_assign(db::changed_field, db::value{joined(changed_names, ",")});
+
+    return attributes;
+}
+
+// deltaのエンティティに保存する行にする。オブジェクトから変更したアトリビュートの名前が渡されていれば、それだけを保存する
+// updateでないか名前が渡されていなければ、全てのアトリビュートを保存する
+static db::value_map_t to_delta_save_row(db::entity const &entity, db::value_map_t attributes) {
+    auto const it = attributes.find(db::changed_field);
+    if (it == attributes.end() || !it->second ||
+        attributes.at(db::action_field).get<db::text>() != db::update_action) {
+        attributes.insert_or_assign(db::changed_field, db::null_value());
+        return attributes;
+    }
+
+    db::string_set_t const names = db::to_changed_names(it->second);
+    std::vector<std::string> changed_names(names.begin(), names.end());
+    std::sort(changed_names.begin(), changed_names.end());
+
+    return db::to_delta_row(entity, std::move(attributes), changed_names);
+}
+
+// deltaのエンティティで、ヘッドのうち更新する値。保存したデータを指す値とchanged_namesのアトリビュート
+static db::value_map_t to_delta_head_row(db::value_map_t const &attributes, db::string_set_t const &changed_names) {
+    db::value_map_t head_row{{db::object_id_field, attributes.at(db::object_id_field)},
+                             {db::pk_id_field, attributes.at(db::pk_id_field)},
+                             {db::removed_field, db::value{db::integer::type{0}}},
+                             {db::save_id_field, attributes.at(db::save_id_field)},
+                             {db::action_field, attributes.at(db::action_field)}};
+    for (std::string const &name : changed_names) {
+        head_row.emplace(name, attributes.at(name));
+    }
+    return head_row;
+}
+
+// deltaのエンティティで、ヘッドのうち保存したデータを指す値と変更のあったアトリビュートだけを更新するsql
+// フィールドはhead_rowのキーから取る
+static std::string sql_for_update_delta_head(db::entity const &entity, db::value_map_t const &head_row) {
+    std::vector<std::string> fields;
+    fields.reserve(head_row.size());
+    for (auto const &pair : head_row) {
+        if (pair.first != db::object_id_field) {
+            fields.push_back(pair.first);
+        }
+    }
+    std::sort(fields.begin(), fields.end());
+
+    return db::update_sql(entity.head_table, fields, db::equal_field_expr(db::object_id_field));
+}
+
+// deltaのエンティティで、ヘッドが指している最後のデータに全てのアトリビュートをヘッドから書き戻す
+static db::update_result_t fill_last_delta_rows(db::database_ptr const &db, db::entity const &entity) {
+    std::vector<std::string> set_exprs;
+
+    if (!entity.custom_attributes.empty()) {
+        std::string const fields = joined(
+            to_vector<std::string>(entity.custom_attributes, [](auto const &pair) { return pair.first; }), ", ");
+        std::string const head_pk_id = entity.head_table + "." + db::pk_id_field;
+        std::string const entity_pk_id = entity.name + "." + db::pk_id_field;
+        db::select_option const head_option{
+            .table = entity.head_table, .fields = {fields}, .where_exprs = db::expr(head_pk_id, "=", entity_pk_id)};
+        set_exprs.push_back("(" + fields + ") = (" + db::select_sql(head_option) + ")");
+    }
+    set_exprs.push_back(db::changed_field + " = NULL");
+
+    db::select_option const head_pk_option{.table = entity.head_table, .fields = {db::pk_id_field}};
+    std::string const where_exprs =
+        joined({db::changed_field + " IS NOT NULL", db::in_expr(db::pk_id_field, head_pk_option)}, " AND ");
+
+    return db->execute_update("UPDATE " + entity.name + " SET " + joined(set_exprs, ", ") + " WHERE " + where_exprs +
+                              ";");
+}
+
+// deltaからfullに変えたエンティティで、全てのアトリビュートを保存していないデータに前のデータから値を埋める
+// アトリビュートごとに、そのアトリビュートを保存した前の最後のデータから入れる
+static db::update_result_t fill_all_delta_rows(db::database_ptr const &db, db::entity const &entity) {
+    std::string const prev_table = "prev_" + entity.name;
+    std::string const prev_changed = prev_table + "." + db::changed_field;
+
+    for (auto const &pair : entity.custom_attributes) {
+        std::string const &attr_name = pair.first;
+
+        std::vector<std::string> const prev_exprs{
+            db::expr(prev_table + "." + db::object_id_field, "=", entity.name + "." + db::object_id_field),
+            db::expr(prev_table + "." + db::pk_id_field, "<", entity.name + "." + db::pk_id_field),
+            "(" + prev_changed + " IS NULL OR " + db::changed_contains_expr(prev_changed, attr_name) + ")"};
+        db::select_option const prev_option{
+            .table = entity.name + " AS " + prev_table,
+            .fields = {prev_table + "." + attr_name},
+            .where_exprs = joined(prev_exprs, " AND "),
+            .field_orders = {{prev_table + "." + db::pk_id_field, db::order::descending}},
+            .limit_range = {.location = 0, .length = 1}};
+        std::string const not_stored_expr = "NOT " + db::changed_contains_expr(db::changed_field, attr_name);
+        std::string const where_exprs = joined({db::changed_field + " IS NOT NULL", not_stored_expr}, " AND ");
+
+        if (auto ul = unless(db->execute_update("UPDATE " + entity.name + " SET " + attr_name + " = (" +
+                                                db::select_sql(prev_option) + ") WHERE " + where_exprs + ";"))) {
+            return std::move(ul.value);
+        }
+    }
+
+    return db->execute_update("UPDATE " + entity.name + " SET " + db::changed_field + " = NULL WHERE " +
+                              db::changed_field + " IS NOT NULL;");
+}
+
+// fullのエンティティで、読み込んでいなかったアトリビュートを同じオブジェクトの前のデータから埋める
+static db::update_result_t fill_unloaded_attribute(db::database_ptr const &db, db::entity const &entity,
+                                                   std::string const &attr_name, db::value_vector_t const &pk_ids) {
+    std::string const prev_table = "prev_" + entity.name;
+
+    std::vector<std::string> const prev_exprs{
+        db::expr(prev_table + "." + db::object_id_field, "=", entity.name + "." + db::object_id_field),
+        db::expr(prev_table + "." + db::pk_id_field, "<", entity.name + "." + db::pk_id_field)};
+    db::select_option const prev_option{.table = entity.name + " AS " + prev_table,
+                                        .fields = {prev_table + "." + attr_name},
+                                        .where_exprs = joined(prev_exprs, " AND "),
+                                        .field_orders = {{prev_table + "." + db::pk_id_field, db::order::descending}},
+                                        .limit_range = {.location = 0, .length = 1}};
+
+    return db->execute_update("UPDATE " + entity.name + " SET " + attr_name + " = (" + db::select_sql(prev_option) +
+                              ") WHERE " + db::in_expr(db::pk_id_field, pk_ids) + ";");
+}
+
+// obj_id_exprsに一致するオブジェクトのヘッドを、save_id以前で最後のデータから作り直す。obj_id_exprsが空なら全てのオブジェクト
+static db::update_result_t rebuild_heads(db::database_ptr const &db, db::entity const &entity,
+                                         db::value const &save_id, std::string const &obj_id_exprs) {
+    if (auto ul = unless(db->execute_update(db::delete_sql(entity.head_table, obj_id_exprs)))) {
+        return std::move(ul.value);
+    }
+
+    if (entity.version_rows == db::version_rows::delta) {
+        // 最後のデータに全てのアトリビュートがあるとは限らないので、前のデータから埋めてからヘッドにする
+        db::select_result_t select_result = db::select_last(
+            db, db::select_option{.table = entity.name, .where_exprs = obj_id_exprs}, save_id, true, db::pk_id_field);
+        if (select_result) {
+            select_result = db::fill_delta_rows(db, entity, std::move(select_result.value()));
+        }
+        if (!select_result) {
+            return db::update_result_t{std::move(select_result.error())};
+        }
+
+        std::vector<db::value_vector_t> head_rows;
+        head_rows.reserve(select_result.value().size());
+        for (db::value_map_t const &attributes : select_result.value()) {
+            head_rows.emplace_back(db::to_head_row(entity, attributes));
+        }
+
+        db::batch_update_result_t const batch_result =
+            db->execute_update_batch(entity.sql_for_replace_head(), head_rows);
+        if (!batch_result) {
+            return db::update_result_t{batch_result.error()};
+        }
+        if (auto const &row_errors = batch_result.value().row_errors; !row_errors.empty()) {
+            return db::update_result_t{row_errors.front().error};
+        }
+        return db::update_result_t{nullptr};
+    }
+
+    static std::string const removed_expr = db::expr(db::action_field, "=", "'" + db::remove_action + "'");
+    db::select_option const option{
+        .table = entity.name,
+        .fields = {db::object_id_field, db::pk_id_field, removed_expr},
+        .where_exprs = db::last_where_exprs(entity.name, obj_id_exprs, save_id, true, db::pk_id_field)};
+    std::string const fields = joined({db::object_id_field, db::pk_id_field, db::removed_field}, ", ");
+
+    return db->execute_update("INSERT INTO " + entity.head_table + "(" + fields + ") " + db::select_sql(option) + ";");
+}
+
+// WITHOUT ROWIDのエンティティのテーブルに次に振るpk_idを取得する
+static db::integer::type next_pk_id(db::database_ptr const &db, std::string const &entity_name) {
+    if (db::value const max_value = db::max(db, entity_name, db::pk_id_field)) {
+        return max_value.get<db::integer>() + 1;
+    }
+    return 1;
+}
+
 // 単独の関連の関連先のidの配列をDBから取得する
-db::value_vector_result_t select_relation_target_ids(db::database_ptr const &db, std::string const &rel_table,
-                                                     db::value const &save_id, db::value const &src_obj_id) {
-    std::string where_exprs =
-        joined({db::equal_field_expr(db::save_id_field), db::equal_field_expr(db::src_obj_id_field)}, " and ");
-    db::select_option option{.table = rel_table,
-                             .where_exprs = std::move(where_exprs),
-                             .arguments = {{db::save_id_field, save_id}, {db::src_obj_id_field, src_obj_id}}};
+db::value_vector_result_t select_relation_target_ids(db::database_ptr const &db, db::relation const &rel,
+                                                     db::value const &save_id, db::value const &src_obj_id,
+                                                     db::value const &src_pk_id) {
+    db::select_option option{.table = rel.table, .fields = {db::tgt_obj_id_field}};
+
+    if (rel.layout == db::table_layout::clustered && src_pk_id) {
+        // ソースのデータのpk_idで続けて並んでいる範囲だけを読む
+        option.where_exprs = db::equal_field_expr(db::src_pk_id_field);
+        option.arguments = {{db::src_pk_id_field, src_pk_id}};
+    } else {
+        option.where_exprs =
+            joined({db::equal_field_expr(db::save_id_field), db::equal_field_expr(db::src_obj_id_field)}, " and ");
+        option.arguments = {{db::save_id_field, save_id}, {db::src_obj_id_field, src_obj_id}};
+    }
+
+    // 関連先のidだけが必要なのでvalue_mapを作らずに直接取得する
+    db::value_vector_t rel_tgts;
+
+    if (rel.encoding == db::relation_encoding::packed) {
+        // ソースのデータごとに1行なので、BLOBから関連先のidの配列を取り出す
+        option.fields = {db::tgt_obj_ids_field};
 
-    if (db::select_result_t select_result = db::select(db, option)) {
-        auto const &result_rels = select_result.value();
-        db::value_vector_t rel_tgts;
-        rel_tgts.reserve(result_rels.size());
-        for (auto const &result_rel : result_rels) {
-            rel_tgts.push_back(result_rel.at(db::tgt_obj_id_field));
+        std::optional<db::error> unpack_error = std::nullopt;
+
+        if (auto select_result = db::select_each(db, option, [&rel_tgts, &unpack_error](db::row_set &row_set) {
+                if (auto unpack_result = db::unpack_relation_ids(row_set.get<std::span<std::byte const>>(0))) {
+                    rel_tgts = std::move(unpack_result.value());
+                    return true;
+                } else {
+                    unpack_error = std::move(unpack_result.error());
+                    return false;
+                }
+            })) {
+            if (unpack_error) {
+                return db::value_vector_result_t{std::move(*unpack_error)};
+            }
+            return db::value_vector_result_t{std::move(rel_tgts)};
+        } else {
+            return db::value_vector_result_t{std::move(select_result.error())};
         }
+    }
+
+    if (rel.layout == db::table_layout::clustered) {
+        option.field_orders = {{db::position_field, db::order::ascending}};
+    }
+
+    if (auto select_result = db::select_each(db, option, [&rel_tgts](db::row_set &row_set) {
+            rel_tgts.emplace_back(row_set.get<int64_t>(0));
+            return true;
+        })) {
         return db::value_vector_result_t{std::move(rel_tgts)};
     } else {
         return db::value_vector_result_t{std::move(select_result.error())};
@@ -76,14 +357,15 @@ db::value_vector_result_t select_relation_target_ids(db::database_ptr const &db,
 
 // 単独のオブジェクトの全ての関連の関連先のidの配列をDBから取得する
 db::value_vector_map_result_t select_relation_data(db::database_ptr const &db, db::relation_map_t const &rel_models,
-                                                   db::value const &save_id, db::value const &src_obj_id) {
+                                                   db::value const &save_id, db::value const &src_obj_id,
+                                                   db::value const &src_pk_id) {
     db::value_vector_map_t relations;
 
     for (auto const &rel_model_pair : rel_models) {
         std::string const &rel_name = rel_model_pair.first;
-        std::string const &rel_table = rel_model_pair.second.table;
 
-        if (db::value_vector_result_t result = db::select_relation_target_ids(db, rel_table, save_id, src_obj_id)) {
+        if (db::value_vector_result_t result =
+                db::select_relation_target_ids(db, rel_model_pair.second, save_id, src_obj_id, src_pk_id)) {
             relations.emplace(rel_name, std::move(result.value()));
         } else {
             return db::value_vector_map_result_t{std::move(result.error())};
@@ -112,19 +394,133 @@ static void get_relation_ids(db::integer_set_map_t &out_ids, db::object_ptr cons
         }
     }
 }
+// フェッチでカレントセーブIDの時点の最後のデータを取得するselect_optionにする
+// deltaのエンティティは最後のデータにアトリビュートが揃っていないので、ヘッドから直接取得する
+// 全てのフィールドを取得する時に、読み込まないアトリビュートを除いたフィールドにする
+static db::select_option to_excluded_select_option(db::entity const &entity, db::select_option option,
+                                                  db::fetch_option const &fetch_option) {
+    auto const it = fetch_option.excluded_attributes().find(entity.name);
+    if (it == fetch_option.excluded_attributes().end() || option.fields != std::vector<std::string>{"*"}) {
+        return option;
+    }
+
+    option.fields.clear();
+    for (auto const &pair : entity.all_attributes) {
+        if (!entity.custom_attributes.contains(pair.first) || !it->second.contains(pair.first)) {
+            option.fields.emplace_back(pair.first);
+        }
+    }
+
+    return option;
+}
+
+static db::select_option to_fetch_select_option(db::entity const &entity, db::select_option const &option) {
+    if (entity.version_rows == db::version_rows::delta) {
+        return db::to_snapshot_select_option(entity, option);
+    }
+    return db::to_head_select_option(option);
+}
 }  // namespace yas::db
 
 #pragma mark - select
 
 db::select_result_t db::select_last(db::database_ptr const &db, db::select_option option, db::value const &save_id,
-                                    bool const include_removed) {
-    option.where_exprs = db::last_where_exprs(option.table, option.where_exprs, save_id, include_removed);
-    return db::select(db, option);
+                                    bool const include_removed, std::string const &key_field) {
+    return db::select(db, db::to_last_select_option(std::move(option), save_id, include_removed, key_field));
+}
+
+db::select_each_result_t db::select_last_each(db::database_ptr const &db, db::select_option option,
+                                              db::value const &save_id, db::row_handler_f const &handler,
+                                              bool const include_removed, std::string const &key_field) {
+    return db::select_each(db, db::to_last_select_option(std::move(option), save_id, include_removed, key_field),
+                           handler);
+}
+
+db::blob_stream_result_t db::open_attribute_blob(db::database_ptr const &db, std::string const &entity_name,
+                                                 std::string const &attr_name, db::value const &obj_id,
+                                                 db::value const &save_id, db::version_rows const version_rows) {
+    std::optional<sqlite3_int64> pk_id = std::nullopt;
+
+    std::string where_exprs = db::equal_field_expr(db::object_id_field);
+
+    if (version_rows == db::version_rows::delta) {
+        // アトリビュートを保存していない差分の行は除いて、アトリビュートのある最後の行を開く
+        std::string const changed_expr = "(" + db::changed_field + " IS NULL OR " +
+                                         db::changed_contains_expr(db::changed_field, attr_name) + ")";
+        where_exprs = joined({where_exprs, changed_expr}, " AND ");
+    }
+
+    db::select_option option{.table = entity_name,
+                             .fields = {db::pk_id_field},
+                             .where_exprs = std::move(where_exprs),
+                             .arguments = {{db::object_id_field, obj_id}}};
+
+    auto select_result = db::select_last_each(
+        db, std::move(option), save_id,
+        [&pk_id](db::row_set &row_set) {
+            pk_id = row_set.get<int64_t>(0);
+            return false;
+        },
+        false, db::pk_id_field);
+
+    if (!select_result) {
+        return db::blob_stream_result_t{std::move(select_result.error())};
+    }
+
+    if (!pk_id) {
+        return db::blob_stream_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    return db->open_blob(entity_name, attr_name, *pk_id);
+}
+
+db::select_option db::to_last_select_option(db::select_option option, db::value const &save_id,
+                                            bool const include_removed, std::string const &key_field) {
+    option.where_exprs = db::last_where_exprs(option.table, option.where_exprs, save_id, include_removed, key_field);
+    return option;
+}
+
+db::select_option db::to_head_select_option(db::select_option option, bool const include_removed) {
+    db::select_option const head_option{
+        .table = db::head_table_name(option.table),
+        .fields = {db::pk_id_field},
+        .where_exprs = include_removed ? "" : db::expr(db::removed_field, "=", "0")};
+
+    std::string head_exprs = db::in_expr(db::pk_id_field, head_option);
+
+    if (option.where_exprs.empty()) {
+        option.where_exprs = std::move(head_exprs);
+    } else {
+        option.where_exprs = joined({std::move(head_exprs), "(" + option.where_exprs + ")"}, " AND ");
+    }
+
+    return option;
+}
+
+db::select_option db::to_snapshot_select_option(db::entity const &entity, db::select_option option,
+                                                bool const include_removed) {
+    option.table = entity.head_table;
+
+    // 全てのフィールドなら、ヘッドにだけあるフィールドは含めない
+    if (option.fields == std::vector<std::string>{"*"}) {
+        option.fields = to_vector<std::string>(entity.all_attributes, [](auto const &pair) { return pair.first; });
+    }
+
+    if (!include_removed) {
+        std::string removed_exprs = db::expr(db::removed_field, "=", "0");
+        if (option.where_exprs.empty()) {
+            option.where_exprs = std::move(removed_exprs);
+        } else {
+            option.where_exprs = joined({std::move(removed_exprs), "(" + option.where_exprs + ")"}, " AND ");
+        }
+    }
+
+    return option;
 }
 
 db::select_result_t db::select_for_undo(db::database_ptr const &db, std::string const &table,
-                                        db::integer::type const revert_save_id,
-                                        db::integer::type const current_save_id) {
+                                        db::integer::type const revert_save_id, db::integer::type const current_save_id,
+                                        std::string const &key_field) {
     // リバート先のセーブIDはカレントより小さくないといけない
     if (current_save_id <= revert_save_id) {
         throw "revert_save_id greater than or equal to current_save_id";
@@ -138,15 +534,15 @@ db::select_result_t db::select_for_undo(db::database_ptr const &db, std::string
         .table = table, .fields = {db::object_id_field}, .distinct = true, .where_exprs = reverting_where};
     std::string const reverting_obj_ids_expr = db::in_expr(db::object_id_field, reverting_option);
 
-    // 戻そうとしているobject_idと一致し、リバート時点より前のデータの中で最後のもののrowidの集合を取得する
+    // 戻そうとしているobject_idと一致し、リバート時点より前のデータの中で最後のもののkey_fieldの集合を取得する
     // つまり、アンドゥ時点より前に挿入されて、アンドゥ時点より後に変更があったデータを取得する
     std::string const reverted_last_where =
         joined({reverting_obj_ids_expr, db::expr(db::save_id_field, "<=", std::to_string(revert_save_id))}, " AND ");
     db::select_option reverted_last_option{.table = table,
-                                           .fields = {"MAX(" + db::rowid_field + ")"},
+                                           .fields = {"MAX(" + key_field + ")"},
                                            .where_exprs = reverted_last_where,
                                            .group_by = db::object_id_field};
-    std::string const reverted_last_rowids_where = db::in_expr(db::rowid_field, reverted_last_option);
+    std::string const reverted_last_rowids_where = db::in_expr(key_field, reverted_last_option);
     db::select_option option{.table = table,
                              .where_exprs = reverted_last_rowids_where,
                              .field_orders = {{db::object_id_field, db::order::ascending}}};
@@ -178,8 +574,8 @@ db::select_result_t db::select_for_undo(db::database_ptr const &db, std::string
 }
 
 db::select_result_t db::select_for_redo(db::database_ptr const &db, std::string const &table,
-                                        db::integer::type const revert_save_id,
-                                        db::integer::type const current_save_id) {
+                                        db::integer::type const revert_save_id, db::integer::type const current_save_id,
+                                        std::string const &key_field) {
     // リバート先のセーブIDはカレントより後でないといけない
     if (revert_save_id <= current_save_id) {
         throw "current_save_id greater than or equal to revert_save_id";
@@ -190,40 +586,180 @@ db::select_result_t db::select_for_redo(db::database_ptr const &db, std::string
                              .where_exprs = db::expr(db::save_id_field, ">", std::to_string(current_save_id)),
                              .field_orders = {{db::object_id_field, db::order::ascending}}};
 
-    return db::select_last(db, std::move(option), db::value{revert_save_id}, true);
+    return db::select_last(db, std::move(option), db::value{revert_save_id}, true, key_field);
 }
 
 db::select_result_t db::select_for_revert(db::database_ptr const &db, std::string const &table,
                                           db::integer::type const revert_save_id,
-                                          db::integer::type const current_save_id) {
+                                          db::integer::type const current_save_id, std::string const &key_field) {
     // リバート先のセーブIDによってアンドゥとリドゥに分岐する
     if (revert_save_id < current_save_id) {
-        return db::select_for_undo(db, table, revert_save_id, current_save_id);
+        return db::select_for_undo(db, table, revert_save_id, current_save_id, key_field);
     } else if (current_save_id < revert_save_id) {
-        return db::select_for_redo(db, table, revert_save_id, current_save_id);
+        return db::select_for_redo(db, table, revert_save_id, current_save_id, key_field);
     }
 
     return db::select_result_t{db::value_map_vector_t{}};
 }
 
-db::select_result_t db::select_for_save(db::database_ptr const &db, std::string const &entity_table,
-                                        std::string const &rel_table, db::value_vector_t const &tgt_obj_ids) {
-    // 最後のオブジェクトのpk_idを取得するsql
-    std::string const last_exprs = db::last_where_exprs(entity_table, "", nullptr, false);
-    db::select_option const last_option{.table = entity_table, .fields = {db::pk_id_field}, .where_exprs = last_exprs};
+db::select_result_t db::fill_delta_rows(db::database_ptr const &db, db::entity const &entity,
+                                        db::value_map_vector_t rows) {
+    if (entity.version_rows != db::version_rows::delta) {
+        return db::select_result_t{std::move(rows)};
+    }
+
+    // 全てのアトリビュートを保存していないデータのオブジェクトIDを集める
+    db::integer_set_t obj_ids;
+    db::integer::type max_pk_id = 0;
+
+    for (db::value_map_t const &row : rows) {
+        if (auto const it = row.find(db::changed_field); it != row.end() && it->second) {
+            obj_ids.insert(row.at(db::object_id_field).get<db::integer>());
+            max_pk_id = std::max(max_pk_id, row.at(db::pk_id_field).get<db::integer>());
+        }
+    }
+
+    if (obj_ids.empty()) {
+        return db::select_result_t{std::move(rows)};
+    }
+
+    // それより前のデータを新しい順に取得する
+    db::select_option const option{
+        .table = entity.name,
+        .where_exprs = joined(
+            {db::in_expr(db::object_id_field, obj_ids), db::expr(db::pk_id_field, "<", std::to_string(max_pk_id))},
+            " AND "),
+        .field_orders = {{db::pk_id_field, db::order::descending}}};
+
+    db::select_result_t select_result = db::select(db, option);
+    if (!select_result) {
+        return select_result;
+    }
+
+    std::unordered_map<db::integer::type, std::vector<db::value_map_t const *>> histories;
+    for (db::value_map_t const &prev_row : select_result.value()) {
+        histories[prev_row.at(db::object_id_field).get<db::integer>()].push_back(&prev_row);
+    }
+
+    for (db::value_map_t &row : rows) {
+        auto const it = row.find(db::changed_field);
+        if (it == row.end() || !it->second) {
+            continue;
+        }
+
+        db::string_set_t const stored_names = to_changed_names(it->second);
+        db::string_set_t missing_names;
+        for (auto const &pair : entity.custom_attributes) {
+            if (stored_names.count(pair.first) == 0) {
+                missing_names.insert(pair.first);
+            }
+        }
+
+        // 新しい方から辿って、まだない値をそのアトリビュートを保存した最後のデータから入れる
+        db::integer::type const pk_id = row.at(db::pk_id_field).get<db::integer>();
+
+        for (db::value_map_t const *prev_row : histories[row.at(db::object_id_field).get<db::integer>()]) {
+            if (missing_names.empty()) {
+                break;
+            }
+
+            if (pk_id <= prev_row->at(db::pk_id_field).get<db::integer>()) {
+                continue;
+            }
+
+            db::value const &prev_changed = prev_row->at(db::changed_field);
+
+            if (!prev_changed) {
+                // 全てのアトリビュートを保存したデータより前は辿らなくてよい
+                for (std::string const &name : missing_names) {
+                    row.insert_or_assign(name, prev_row->at(name));
+                }
+                missing_names.clear();
+                break;
+            }
+
+            for (std::string const &name : to_changed_names(prev_changed)) {
+                if (missing_names.erase(name) > 0) {
+                    row.insert_or_assign(name, prev_row->at(name));
+                }
+            }
+        }
+
+        // 全てのアトリビュートが揃ったデータにする
+        row.insert_or_assign(db::changed_field, db::null_value());
+    }
+
+    return db::select_result_t{std::move(rows)};
+}
+
+db::select_result_t db::select_for_save(db::database_ptr const &db, db::entity const &entity,
+                                        db::relation const &rel, db::value_vector_t const &tgt_obj_ids) {
+    // 最後のオブジェクトのpk_idをヘッドから取得するsql
+    db::select_option const last_option{.table = entity.head_table,
+                                        .fields = {db::pk_id_field},
+                                        .where_exprs = db::expr(db::removed_field, "=", "0")};
+
+    std::string src_pk_in_expr;
+
+    if (rel.encoding == db::relation_encoding::packed) {
+        // BLOBの中は条件にできないので、最後のオブジェクトの関連を読んでtgt_obj_idsを含むsrc_pk_idを集める
+        db::integer_set_t tgt_ids;
+        for (db::value const &tgt_obj_id : tgt_obj_ids) {
+            tgt_ids.insert(tgt_obj_id.get<db::integer>());
+        }
+
+        db::integer_set_t src_pk_ids;
+        std::optional<db::error> unpack_error = std::nullopt;
+
+        db::select_option const packed_option{.table = rel.table,
+                                              .fields = {db::src_pk_id_field, db::tgt_obj_ids_field},
+                                              .where_exprs = db::in_expr(db::src_pk_id_field, last_option)};
+
+        if (auto select_result = db::select_each(
+                db, packed_option, [&tgt_ids, &src_pk_ids, &unpack_error](db::row_set &row_set) {
+                    auto unpack_result = db::unpack_relation_ids(row_set.get<std::span<std::byte const>>(1));
+                    if (!unpack_result) {
+                        unpack_error = std::move(unpack_result.error());
+                        return false;
+                    }
+
+                    for (db::value const &rel_tgt_id : unpack_result.value()) {
+                        if (tgt_ids.count(rel_tgt_id.get<db::integer>()) > 0) {
+                            src_pk_ids.insert(row_set.get<int64_t>(0));
+                            break;
+                        }
+                    }
+                    return true;
+                })) {
+            if (unpack_error) {
+                return db::select_result_t{std::move(*unpack_error)};
+            }
+        } else {
+            return db::select_result_t{std::move(select_result.error())};
+        }
+
+        src_pk_in_expr = db::in_expr(db::pk_id_field, src_pk_ids);
+    } else {
+        // 最後のオブジェクトの中でtgt_obj_idsに一致する関連のsrc_pk_idを取得するsql
+        std::string const tgt_where_exprs = joined(
+            {db::in_expr(db::src_pk_id_field, last_option), db::in_expr(db::tgt_obj_id_field, tgt_obj_ids)}, " AND ");
+        db::select_option const src_pk_option{
+            .table = rel.table, .fields = {db::src_pk_id_field}, .where_exprs = tgt_where_exprs};
 
-    // 最後のオブジェクトの中でtgt_obj_idsに一致する関連のsrc_pk_idを取得するsql
-    std::string const tgt_where_exprs = joined(
-        {db::in_expr(db::src_pk_id_field, last_option), db::in_expr(db::tgt_obj_id_field, tgt_obj_ids)}, " AND ");
-    db::select_option src_pk_option{
-        .table = rel_table, .fields = {db::src_pk_id_field}, .where_exprs = tgt_where_exprs};
+        src_pk_in_expr = db::in_expr(db::pk_id_field, src_pk_option);
+    }
 
     // これまでの条件に一致しつつ、アクションがremoveでないアトリビュートを取得する
-    std::string const where_exprs =
-        joined({db::field_expr(db::action_field, "!="), db::in_expr(db::pk_id_field, src_pk_option)}, " AND ");
-    db::select_option option{.table = entity_table,
+    std::string const where_exprs = joined({db::field_expr(db::action_field, "!="), src_pk_in_expr}, " AND ");
+    db::select_option option{.table = entity.name,
                              .where_exprs = where_exprs,
                              .arguments = {{db::action_field, db::remove_action_value()}}};
+
+    if (entity.version_rows == db::version_rows::delta) {
+        // 全てのアトリビュートが揃っているヘッドから取得する
+        option = db::to_snapshot_select_option(entity, std::move(option), true);
+    }
+
     return db::select(db, option);
 }
 
@@ -439,32 +975,43 @@ db::manager_result_t db::make_error_result(db::manager_error_type const &error_t
     return db::manager_result_t{db::manager_error{error_type, std::move(db_error)}};
 }
 
+// 単独のオブジェクトのアトリビュートの値を元に関連の値をデータベースから取得してobject_dataを生成する
+db::object_data_result_t db::make_object_data(db::database_ptr const &db, db::relation_map_t const &rel_models,
+                                              db::value_map_t &&attrs) {
+    db::id_vector_map_t rels;
+
+    if (attrs.count(db::save_id_field) > 0) {
+        db::value const &save_id = attrs.at(db::save_id_field);
+        db::value const &src_obj_id = attrs.at(db::object_id_field);
+        db::value const src_pk_id = attrs.count(db::pk_id_field) > 0 ? attrs.at(db::pk_id_field) : db::null_value();
+
+        if (db::value_vector_map_result_t rel_data_result =
+                db::select_relation_data(db, rel_models, save_id, src_obj_id, src_pk_id)) {
+            rels = db::to_stable_ids(rel_data_result.value());
+        } else {
+            return db::object_data_result_t{std::move(rel_data_result.error())};
+        }
+    }
+
+    db::object_id obj_id = db::make_stable_id(attrs.at(db::object_id_field));
+
+    return db::object_data_result_t{
+        db::object_data{.object_id = std::move(obj_id), .attributes = std::move(attrs), .relations = std::move(rels)}};
+}
+
 // 単独のエンティティでオブジェクトのアトリビュートの値を元に関連の値をデータベースから取得してobject_dataのvectorを生成する
-db::object_data_vector_result_t db::make_entity_object_datas(db::database_ptr const &db, std::string const &entity_name,
+db::object_data_vector_result_t db::make_entity_object_datas(db::database_ptr const &db,
                                                              db::relation_map_t const &rel_models,
                                                              db::value_map_vector_t const &entity_attrs) {
     db::object_data_vector_t entity_datas;
     entity_datas.reserve(entity_attrs.size());
 
     for (db::value_map_t attrs : entity_attrs) {
-        db::id_vector_map_t rels;
-
-        if (attrs.count(db::save_id_field) > 0) {
-            db::value const &save_id = attrs.at(db::save_id_field);
-            db::value const &src_obj_id = attrs.at(db::object_id_field);
-
-            if (db::value_vector_map_result_t rel_data_result =
-                    db::select_relation_data(db, rel_models, save_id, src_obj_id)) {
-                rels = db::to_stable_ids(rel_data_result.value());
-            } else {
-                return db::object_data_vector_result_t{std::move(rel_data_result.error())};
-            }
+        if (auto result = db::make_object_data(db, rel_models, std::move(attrs))) {
+            entity_datas.emplace_back(std::move(result.value()));
+        } else {
+            return db::object_data_vector_result_t{std::move(result.error())};
         }
-
-        db::object_id obj_id = db::make_stable_id(attrs.at(db::object_id_field));
-
-        entity_datas.emplace_back(db::object_data{
-            .object_id = std::move(obj_id), .attributes = std::move(attrs), .relations = std::move(rels)});
     }
 
     return db::object_data_vector_result_t{std::move(entity_datas)};
@@ -480,7 +1027,12 @@ db::manager_result_t db::migrate_db_if_needed(db::database_ptr const &db, db::mo
             db::info const &info = select_result.value();
             if (model.version() <= info.version()) {
                 // モデルのバージョンがデータベースのバージョンがより低ければマイグレーションを行わない
-                return db::manager_result_t{nullptr};
+                // 自動のインデックスやヘッドのテーブルがない古いデータベースなら作成する
+                // ヘッドにも自動のインデックスを作るので、ヘッドのテーブルを先に作る
+                if (auto ul = unless(db::create_head_tables_if_needed(db, model))) {
+                    return std::move(ul.value);
+                }
+                return db::create_auto_indices(db, model);
             }
         } else {
             return update_result;
@@ -534,7 +1086,12 @@ db::manager_result_t db::migrate_db_if_needed(db::database_ptr const &db, db::mo
         }
     }
 
-    return db::manager_result_t{nullptr};
+    // ヘッドにも自動のインデックスを作るので、ヘッドのテーブルを先に作る
+    if (auto ul = unless(db::create_head_tables_if_needed(db, model))) {
+        return std::move(ul.value);
+    }
+
+    return db::create_auto_indices(db, model);
 }
 
 db::manager_result_t db::create_info_and_tables(db::database_ptr const &db, db::model const &model) {
@@ -568,6 +1125,84 @@ db::manager_result_t db::create_info_and_tables(db::database_ptr const &db, db::
         }
     }
 
+    // ヘッドにも自動のインデックスを作るので、ヘッドのテーブルを先に作る
+    if (auto ul = unless(db::create_head_tables_if_needed(db, model))) {
+        return std::move(ul.value);
+    }
+
+    return db::create_auto_indices(db, model);
+}
+
+db::manager_result_t db::create_auto_indices(db::database_ptr const &db, db::model const &model) {
+    // すでにあれば何もしないSQLなので、毎回全て実行する
+    for (auto const &index_pair : model.auto_indices()) {
+        if (auto ul = unless(db->execute_update(index_pair.second.sql_for_create()))) {
+            return db::make_error_result(db::manager_error_type::create_index_failed, std::move(ul.value.error()));
+        }
+    }
+
+    return db::manager_result_t{nullptr};
+}
+
+db::manager_result_t db::create_head_tables_if_needed(db::database_ptr const &db, db::model const &model) {
+    std::optional<db::value> current_save_id = std::nullopt;
+
+    for (auto const &entity_pair : model.entities()) {
+        db::entity const &entity = entity_pair.second;
+
+        if (entity.version_rows == db::version_rows::full) {
+            // deltaから変えたエンティティなら、fullとして読めるように全てのデータにアトリビュートを埋める
+            if (db::column_exists(db, db::changed_field, entity.name)) {
+                if (auto ul = unless(db::fill_all_delta_rows(db, entity))) {
+                    return db::make_error_result(db::manager_error_type::alter_entity_table_failed,
+                                                 std::move(ul.value.error()));
+                }
+            }
+        } else {
+            // fullから変えたエンティティなら、それまでのデータは全てのアトリビュートを保存したものになる
+            if (!db::column_exists(db, db::changed_field, entity.name)) {
+                std::string const changed_sql = db::changed_field + " " + db::text::name;
+                if (auto ul = unless(db->execute_update(db::alter_table_sql(entity.name, changed_sql)))) {
+                    return db::make_error_result(db::manager_error_type::alter_entity_table_failed,
+                                                 std::move(ul.value.error()));
+                }
+            }
+
+            // アトリビュートが足りないヘッドは作り直す
+            if (db::table_exists(db, entity.head_table) &&
+                !std::all_of(entity.head_fields.begin(), entity.head_fields.end(), [&db, &entity](auto const &field) {
+                    return db::column_exists(db, field, entity.head_table);
+                })) {
+                if (auto ul = unless(db->execute_update(db::drop_table_sql(entity.head_table)))) {
+                    return db::make_error_result(db::manager_error_type::create_head_table_failed,
+                                                 std::move(ul.value.error()));
+                }
+            }
+        }
+
+        if (db::table_exists(db, entity.head_table)) {
+            continue;
+        }
+
+        if (auto ul = unless(db->execute_update(entity.sql_for_create_head()))) {
+            return db::make_error_result(db::manager_error_type::create_head_table_failed,
+                                         std::move(ul.value.error()));
+        }
+
+        if (!current_save_id) {
+            if (auto info_result = db::fetch_info(db)) {
+                current_save_id = info_result.value().current_save_id_value();
+            } else {
+                return db::manager_result_t{std::move(info_result.error())};
+            }
+        }
+
+        // すでにあるデータからカレントセーブIDの時点のヘッドを作る
+        if (auto ul = unless(db::rebuild_heads(db, entity, *current_save_id, ""))) {
+            return db::make_error_result(db::manager_error_type::update_head_failed, std::move(ul.value.error()));
+        }
+    }
+
     return db::manager_result_t{nullptr};
 }
 
@@ -582,6 +1217,10 @@ db::manager_result_t db::clear_db(db::database_ptr const &db, db::model const &m
             return db::make_error_result(db::manager_error_type::delete_failed, std::move(ul.value.error()));
         }
 
+        if (auto ul = unless(db->execute_update(db::delete_sql(entity.head_table)))) {
+            return db::make_error_result(db::manager_error_type::delete_failed, std::move(ul.value.error()));
+        }
+
         for (auto const &rel_pair : entity.relations) {
             std::string const rel_table_name = rel_pair.second.table;
 
@@ -607,26 +1246,54 @@ db::manager_fetch_result_t db::insert(db::database_ptr const &db, db::model cons
     }
 
     db::object_data_vector_map_t inserted_datas;
-    db::integer::type start_obj_id = 1;
     db::value next_save_id = info.next_save_id_value();
 
     for (auto &values_pair : values) {
         std::string const &entity_name = values_pair.first;
         auto &entity_values = values_pair.second;
 
+        if (entity_values.empty()) {
+            continue;
+        }
+
         // エンティティのデータ中のオブジェクトIDの最大値から次のIDを取得する
         // まだデータがなければ初期値の1のまま
+        db::integer::type start_obj_id = 1;
         if (db::value const max_value = db::max(db, entity_name, db::object_id_field)) {
             start_obj_id = max_value.get<db::integer>() + 1;
         }
 
+        // WITHOUT ROWIDのテーブルならpk_idも振る
+        std::optional<db::integer::type> start_pk_id = std::nullopt;
+        if (model.entity(entity_name).layout == db::table_layout::clustered) {
+            start_pk_id = db::next_pk_id(db, entity_name);
+        }
+
+        // フィールドの並びが同じオブジェクトが続く間はひとつのステートメントでまとめて挿入する
+        std::vector<std::string> batch_fields;
+        std::vector<db::value_vector_t> batch_rows;
+
+        auto insert_batch = [&db, &entity_name, &batch_fields, &batch_rows]() {
+            if (batch_rows.empty()) {
+                return db::manager_result_t{nullptr};
+            }
+            auto result = db::to_manager_result(
+                db->execute_update_batch(db::insert_sql(entity_name, batch_fields), batch_rows),
+                db::manager_error_type::insert_attributes_failed);
+            batch_rows.clear();
+            return result;
+        };
+
         std::size_t idx = 0;
         for (auto &obj_values : entity_values) {
             // オブジェクトの値を与えてデータベースに挿入する
-            db::value obj_id_value{start_obj_id + idx};
-
             std::vector<std::string> fields{db::object_id_field, db::save_id_field};
-            db::value_vector_t args{obj_id_value, next_save_id};
+            db::value_vector_t args{db::value{start_obj_id + static_cast<db::integer::type>(idx)}, next_save_id};
+
+            if (start_pk_id) {
+                fields.push_back(db::pk_id_field);
+                args.emplace_back(*start_pk_id + static_cast<db::integer::type>(idx));
+            }
 
             fields.reserve(fields.size() + obj_values.size());
             args.reserve(args.size() + obj_values.size());
@@ -636,34 +1303,61 @@ db::manager_fetch_result_t db::insert(db::database_ptr const &db, db::model cons
                 args.emplace_back(std::move(value.second));
             }
 
-            if (auto ul = unless(db->execute_update(db::insert_sql(entity_name, fields), std::move(args)))) {
-                return db::manager_fetch_result_t{
-                    db::manager_error{db::manager_error_type::insert_attributes_failed, std::move(ul.value.error())}};
+            if (fields != batch_fields) {
+                if (auto ul = unless(insert_batch())) {
+                    return db::manager_fetch_result_t{std::move(ul.value.error())};
+                }
+                batch_fields = std::move(fields);
             }
 
-            // 挿入したオブジェクトのattributeをデータベースから取得する
-            db::select_option option{.table = entity_name,
-                                     .where_exprs = db::equal_field_expr(db::object_id_field),
-                                     .arguments = {{std::make_pair(db::object_id_field, obj_id_value)}}};
-
-            if (db::select_result_t select_result = db::select(db, std::move(option))) {
-                // データをobject_dataにしてcompletionに返すinserted_datasに追加
-                if (inserted_datas.count(entity_name) == 0) {
-                    db::object_data_vector_t entity_datas{};
-                    entity_datas.reserve(entity_values.size());
-                    inserted_datas.emplace(entity_name, std::move(entity_datas));
-                }
+            batch_rows.emplace_back(std::move(args));
+
+            ++idx;
+        }
+
+        if (auto ul = unless(insert_batch())) {
+            return db::manager_fetch_result_t{std::move(ul.value.error())};
+        }
+
+        // 挿入したオブジェクトのattributeをデータベースからまとめて取得する
+        db::integer::type const end_obj_id = start_obj_id + static_cast<db::integer::type>(entity_values.size());
+        db::select_option option{
+            .table = entity_name,
+            .where_exprs = joined({db::expr(db::object_id_field, ">=", ":start_obj_id"),
+                                   db::expr(db::object_id_field, "<", ":end_obj_id")},
+                                  " AND "),
+            .arguments = {{"start_obj_id", db::value{start_obj_id}}, {"end_obj_id", db::value{end_obj_id}}},
+            .field_orders = {{db::object_id_field, db::order::ascending}}};
+
+        if (db::select_result_t select_result = db::select(db, std::move(option))) {
+            // データをobject_dataにしてcompletionに返すinserted_datasに追加
+            db::object_data_vector_t entity_datas{};
+            entity_datas.reserve(entity_values.size());
+
+            std::vector<db::value_vector_t> head_rows;
+            head_rows.reserve(entity_values.size());
+
+            db::entity const &entity = model.entity(entity_name);
+
+            for (auto &attributes : select_result.value()) {
+                head_rows.emplace_back(db::to_head_row(entity, attributes));
 
-                auto &attributes = select_result.value().at(0);
                 db::object_id obj_id = db::make_stable_id(attributes.at(db::object_id_field));
-                inserted_datas.at(entity_name)
-                    .emplace_back(db::object_data{.object_id = std::move(obj_id), .attributes = std::move(attributes)});
-            } else {
-                return db::manager_fetch_result_t{
-                    db::manager_error{db::manager_error_type::select_failed, std::move(select_result.error())}};
+                entity_datas.emplace_back(db::object_data{
+                    .object_id = std::move(obj_id), .attributes = std::move(attributes), .relations = {}});
             }
 
-            ++idx;
+            // 挿入したオブジェクトをヘッドに加える
+            if (auto ul = unless(db::to_manager_result(
+                    db->execute_update_batch(entity.sql_for_replace_head(), head_rows),
+                    db::manager_error_type::update_head_failed))) {
+                return db::manager_fetch_result_t{std::move(ul.value.error())};
+            }
+
+            inserted_datas.emplace(entity_name, std::move(entity_datas));
+        } else {
+            return db::manager_fetch_result_t{
+                db::manager_error{db::manager_error_type::select_failed, std::move(select_result.error())}};
         }
     }
 
@@ -671,44 +1365,77 @@ db::manager_fetch_result_t db::insert(db::database_ptr const &db, db::model cons
 }
 
 db::manager_fetch_result_t db::fetch(db::database_ptr const &db, db::model const &model,
-                                     db::fetch_option const &fetch_option) {
-    // カレントセーブIDをデータベースから取得
-    db::value current_save_id = db::null_value();
-    if (db::manager_info_result_t info_select_result = db::fetch_info(db)) {
-        current_save_id = info_select_result.value().current_save_id_value();
-    } else {
-        return db::manager_fetch_result_t{std::move(info_select_result.error())};
-    }
-
+                                     db::fetch_option const &fetch_option, db::query_plan_checker_ptr const &checker) {
     db::object_data_vector_map_t fetched_datas;
 
     for (auto const &pair : fetch_option.select_options()) {
         std::string const entity_name = pair.first;
         db::select_option const &sel_option = pair.second;
         db::relation_map_t const &rel_models = model.relations(entity_name);
+        db::entity const &entity = model.entity(entity_name);
+        // ヘッドはカレントセーブIDの時点の最後のデータを指しているので、履歴をまとめずに取得できる
+        db::select_option const last_option =
+            db::to_fetch_select_option(entity, db::to_excluded_select_option(entity, sel_option, fetch_option));
+
+        if (checker) {
+            checker->check(db, last_option);
+        }
+
+        // カレントセーブIDまでで条件にあった最後のデータをデータベースから1行ずつ取得し、
+        // アトリビュートのみのデータから関連のデータを加えてobject_dataを生成する
+        db::object_data_vector_t entity_obj_datas;
+        std::optional<db::error> make_error = std::nullopt;
 
-        // カレントセーブIDまでで条件にあった最後のデータをデータベースから取得する
-        if (db::select_result_t select_result = db::select_last(db, sel_option, current_save_id)) {
-            // アトリビュートのみのデータから関連のデータを加えてobject_dataを生成する
-            auto &entity_attrs = select_result.value();
-            if (auto obj_datas_result = db::make_entity_object_datas(db, entity_name, rel_models, entity_attrs)) {
-                auto &entity_obj_datas = obj_datas_result.value();
-                if (entity_obj_datas.size() > 0) {
-                    fetched_datas.emplace(entity_name, std::move(entity_obj_datas));
+        db::select_each_result_t select_result =
+            db::select_each(db, last_option, [&](db::row_set &row_set) {
+                if (auto obj_data_result = db::make_object_data(db, rel_models, row_set.values())) {
+                    entity_obj_datas.emplace_back(std::move(obj_data_result.value()));
+                    return true;
+                } else {
+                    make_error = std::move(obj_data_result.error());
+                    return false;
                 }
-            } else {
-                return db::manager_fetch_result_t{db::manager_error{db::manager_error_type::make_object_datas_failed,
-                                                                    std::move(obj_datas_result.error())}};
-            }
-        } else {
+            });
+
+        if (!select_result) {
+            return db::manager_fetch_result_t{db::manager_error{db::manager_error_type::select_last_failed,
+                                                                std::move(select_result.error())}};
+        }
+
+        if (make_error) {
             return db::manager_fetch_result_t{
-                db::manager_error{db::manager_error_type::select_last_failed, std::move(select_result.error())}};
+                db::manager_error{db::manager_error_type::make_object_datas_failed, std::move(*make_error)}};
+        }
+
+        if (entity_obj_datas.size() > 0) {
+            fetched_datas.emplace(entity_name, std::move(entity_obj_datas));
         }
     }
 
     return db::manager_fetch_result_t{std::move(fetched_datas)};
 }
 
+db::manager_query_plan_result_t db::explain_fetch(db::database_ptr const &db, db::model const &model,
+                                                  db::fetch_option const &fetch_option) {
+    db::query_plan_map_t plans;
+
+    for (auto const &pair : fetch_option.select_options()) {
+        // fetchと同じくヘッドからカレントセーブIDの時点の最後のデータを取得するSQLにする
+        db::entity const &entity = model.entity(pair.first);
+        db::select_option const last_option =
+            db::to_fetch_select_option(entity, db::to_excluded_select_option(entity, pair.second, fetch_option));
+
+        if (auto explain_result = db::explain_query_plan(db, last_option)) {
+            plans.emplace(pair.first, std::move(explain_result.value()));
+        } else {
+            return db::manager_query_plan_result_t{db::manager_error{db::manager_error_type::explain_query_plan_failed,
+                                                                     std::move(explain_result.error())}};
+        }
+    }
+
+    return db::manager_query_plan_result_t{std::move(plans)};
+}
+
 db::update_result_t db::purge_attributes(db::database_ptr const &db, std::string const &table) {
     db::select_option const option{
         .table = table, .fields = {"MAX(" + db::pk_id_field + ")"}, .group_by = db::object_id_field};
@@ -744,12 +1471,25 @@ db::manager_result_t db::purge_db(db::database_ptr const &db, db::model const &m
     for (auto const &entity_pair : model.entities()) {
         std::string const &entity_name = entity_pair.first;
         db::entity const &entity = entity_pair.second;
+        bool const is_delta = entity.version_rows == db::version_rows::delta;
+
+        if (is_delta) {
+            // 最後のデータだけが残るので、全てのアトリビュートをヘッドから書き戻しておく
+            if (auto ul = unless(db::fill_last_delta_rows(db, entity))) {
+                return db::make_error_result(db::manager_error_type::purge_failed, std::move(ul.value.error()));
+            }
+        }
 
         // エンティティのデータをパージする（同じオブジェクトIDのデータは最後のものだけ生かす）
         if (db::update_result_t purge_result = db::purge_attributes(db, entity_name)) {
             // 残ったデータのセーブIDを全て1にする
             std::string const update_entity_sql = db::update_sql(entity_name, save_id_fields);
-            if (db::update_result_t update_result = db->execute_update(update_entity_sql, one_value_args)) {
+            db::update_result_t update_result = db->execute_update(update_entity_sql, one_value_args);
+            if (update_result && is_delta) {
+                // ヘッドもセーブIDを持っているので合わせる
+                update_result = db->execute_update(db::update_sql(entity.head_table, save_id_fields), one_value_args);
+            }
+            if (update_result) {
                 for (auto const &rel_pair : entity.relations) {
                     db::relation const &relation = rel_pair.second;
                     std::string const &rel_table_name = relation.table;
@@ -796,50 +1536,129 @@ db::manager_fetch_result_t db::save(db::database_ptr const &db, db::model const
     for (auto const &entity_pair : changed_datas) {
         std::string const &entity_name = entity_pair.first;
         auto const &changed_entity_datas = entity_pair.second;
-        std::string const entity_insert_sql = model.entity(entity_name).sql_for_insert();
+        db::entity const &entity = model.entity(entity_name);
+        std::string const entity_insert_sql = entity.sql_for_insert();
+        bool const is_clustered = entity.layout == db::table_layout::clustered;
+        bool const is_delta = entity.version_rows == db::version_rows::delta;
 
         db::object_data_vector_t entity_saved_datas;
+        entity_saved_datas.reserve(changed_entity_datas.size());
 
-        for (db::object_data changed_data : changed_entity_datas) {
-            db::object_data saved_data{.object_id = db::null_id()};
+        std::vector<db::value_map_t> rows;
+        rows.reserve(changed_entity_datas.size());
+
+        // まだオブジェクトIDがないデータに振るID。最初に必要になった時にデータベース上の最大値+1で初期化する
+        std::optional<db::integer::type> next_obj_id = std::nullopt;
+        // WITHOUT ROWIDのテーブルで保存するデータに振るpk_id
+        std::optional<db::integer::type> next_pk_id = std::nullopt;
+        // 読み込んでいなかったアトリビュートごとの、そのアトリビュートが無いデータのインデックス
+        std::map<std::string, std::vector<std::size_t>> unloaded_indices;
 
-            // 保存するデータのアトリビュートのidは削除する（rowidなのでいらない）
-            erase_if_exists(changed_data.attributes, db::pk_id_field);
+        for (db::object_data changed_data : changed_entity_datas) {
+            if (is_clustered) {
+                // 保存するデータのアトリビュートのidは新しく振り直す
+                if (!next_pk_id) {
+                    next_pk_id = db::next_pk_id(db, entity_name);
+                }
+                replace(changed_data.attributes, db::pk_id_field, db::value{*next_pk_id});
+                ++*next_pk_id;
+            } else {
+                // 保存するデータのアトリビュートのidは削除する（rowidなのでいらない）
+                erase_if_exists(changed_data.attributes, db::pk_id_field);
+            }
             // 保存するデータのセーブIDを今セーブするIDに置き換える
             replace(changed_data.attributes, db::save_id_field, next_save_id);
 
             if (changed_data.attributes.count(db::object_id_field) == 0) {
                 // 保存するデータにまだオブジェクトIDがなければ（挿入されてtemporaryな状態）データベース上の最大値+1をセットする
-                db::integer::type obj_id = 0;
-                if (db::value max_value = db::max(db, entity_name, db::object_id_field)) {
-                    obj_id = max_value.get<db::integer>();
+                if (!next_obj_id) {
+                    db::integer::type obj_id = 0;
+                    if (db::value max_value = db::max(db, entity_name, db::object_id_field)) {
+                        obj_id = max_value.get<db::integer>();
+                    }
+                    next_obj_id = obj_id + 1;
                 }
-                db::integer::type const next_obj_id = obj_id + 1;
-                replace(changed_data.attributes, db::object_id_field, db::value{next_obj_id});
-                changed_data.object_id.set_stable(next_obj_id);
+                replace(changed_data.attributes, db::object_id_field, db::value{*next_obj_id});
+                changed_data.object_id.set_stable(*next_obj_id);
+                ++*next_obj_id;
             }
 
-            // データベースにアトリビュートのデータを挿入する
-            if (db::update_result_t update_result = db->execute_update(entity_insert_sql, changed_data.attributes)) {
-                saved_data.attributes = changed_data.attributes;
+            entity_saved_datas.emplace_back(
+                db::object_data{.object_id = db::object_id{changed_data.attributes.at(db::object_id_field),
+                                                           changed_data.object_id.temporary_value()},
+                                .attributes = changed_data.attributes,
+                                .relations = {}});
+
+            if (is_delta) {
+                rows.emplace_back(db::to_delta_save_row(entity, std::move(changed_data.attributes)));
             } else {
-                return db::manager_fetch_result_t{db::manager_error{db::manager_error_type::insert_attributes_failed,
-                                                                    std::move(update_result.error())}};
+                // 読み込んでいなかったアトリビュートは仮の値で挿入して、後で前のデータから埋める
+                for (auto const &pair : entity.custom_attributes) {
+                    if (!changed_data.attributes.contains(pair.first)) {
+                        changed_data.attributes.emplace(
+                            pair.first, pair.second.not_null ? pair.second.default_value : db::null_value());
+                        unloaded_indices[pair.first].push_back(rows.size());
+                    }
+                }
+                rows.emplace_back(std::move(changed_data.attributes));
+            }
+        }
+
+        // データベースにアトリビュートのデータをまとめて挿入する
+        db::batch_update_result_t const batch_result = db->execute_update_batch(entity_insert_sql, rows);
+
+        if (auto ul = unless(db::to_manager_result(batch_result, db::manager_error_type::insert_attributes_failed))) {
+            return db::manager_fetch_result_t{std::move(ul.value.error())};
+        }
+
+        // 挿入したデータのrowidをセットして、オブジェクトのヘッドを挿入したデータに置き換える
+        // deltaで変更のあったアトリビュートだけを保存したデータなら、ヘッドもそのアトリビュートだけを更新する
+        auto const &rowids = batch_result.value().last_insert_rowids;
+
+        std::vector<db::value_vector_t> head_rows;
+        head_rows.reserve(entity_saved_datas.size());
+        std::map<std::string, std::vector<db::value_map_t>> delta_head_rows;
+
+        for (std::size_t idx = 0; idx < entity_saved_datas.size(); ++idx) {
+            auto &attributes = entity_saved_datas.at(idx).attributes;
+            if (!is_clustered) {
+                attributes.emplace(db::pk_id_field, db::value{rowids.at(idx)});
             }
 
-            // 挿入したデータのrowidを取得
-            if (db::row_result_t row_result = db->last_insert_rowid()) {
-                db::value pk_id{std::move(row_result.value())};
-                saved_data.attributes.emplace(db::pk_id_field, std::move(pk_id));
+            if (is_delta && rows.at(idx).at(db::changed_field)) {
+                db::value const &changed = rows.at(idx).at(db::changed_field);
+                delta_head_rows[changed.get<db::text>()].emplace_back(
+                    db::to_delta_head_row(attributes, db::to_changed_names(changed)));
             } else {
-                return db::manager_fetch_result_t{
-                    db::manager_error{db::manager_error_type::last_insert_rowid_failed, std::move(row_result.error())}};
+                head_rows.emplace_back(db::to_head_row(entity, attributes));
             }
+        }
 
-            saved_data.object_id = db::object_id{changed_data.attributes.at(db::object_id_field),
-                                                 changed_data.object_id.temporary_value()};
+        if (auto ul = unless(db::to_manager_result(
+                db->execute_update_batch(entity.sql_for_replace_head(), head_rows),
+                db::manager_error_type::update_head_failed))) {
+            return db::manager_fetch_result_t{std::move(ul.value.error())};
+        }
+
+        for (auto const &pair : delta_head_rows) {
+            std::string const sql = db::sql_for_update_delta_head(entity, pair.second.front());
+            if (auto ul = unless(db::to_manager_result(db->execute_update_batch(sql, pair.second),
+                                                       db::manager_error_type::update_head_failed))) {
+                return db::manager_fetch_result_t{std::move(ul.value.error())};
+            }
+        }
+
+        for (auto const &[attr_name, indices] : unloaded_indices) {
+            db::value_vector_t pk_ids;
+            pk_ids.reserve(indices.size());
+            for (std::size_t const idx : indices) {
+                pk_ids.push_back(entity_saved_datas.at(idx).attributes.at(db::pk_id_field));
+            }
 
-            entity_saved_datas.emplace_back(std::move(saved_data));
+            if (auto ul = unless(db::fill_unloaded_attribute(db, entity, attr_name, pk_ids))) {
+                return db::manager_fetch_result_t{
+                    db::manager_error{db::manager_error_type::insert_attributes_failed, std::move(ul.value.error())}};
+            }
         }
 
         saved_datas.emplace(entity_name, std::move(entity_saved_datas));
@@ -923,7 +1742,7 @@ db::manager_result_t db::remove_relations_at_save(db::database_ptr const &db, db
             for (auto const &rel_name : rel_names) {
                 db::relation const &rel = model.relation(inv_entity_name, rel_name);
                 if (db::select_result_t select_result =
-                        db::select_for_save(db, inv_entity_name, rel.table, tgt_obj_ids)) {
+                        db::select_for_save(db, model.entity(inv_entity_name), rel, tgt_obj_ids)) {
                     for (auto const &attr : select_result.value()) {
                         std::string obj_id_str = to_string(attr.at(db::object_id_field));
                         if (entity_attrs_map.count(obj_id_str) == 0) {
@@ -946,8 +1765,7 @@ db::manager_result_t db::remove_relations_at_save(db::database_ptr const &db, db
                     to_vector<db::value_map_t>(entity_attrs_map, [](auto &pair) { return std::move(pair.second); });
 
                 auto const &rel_models = model.relations(inv_entity_name);
-                if (auto obj_datas_result =
-                        db::make_entity_object_datas(db, inv_entity_name, rel_models, entity_attrs_vec)) {
+                if (auto obj_datas_result = db::make_entity_object_datas(db, rel_models, entity_attrs_vec)) {
                     // 同じidのオブジェクトは上書きかスキップする？
                     // すでにsaveしたものは被っていないはず
                     inv_removed_datas = std::move(obj_datas_result.value());
@@ -958,45 +1776,95 @@ db::manager_result_t db::remove_relations_at_save(db::database_ptr const &db, db
             }
 
             if (inv_removed_datas.size() > 0) {
-                std::string const &entity_insert_sql = model.entity(inv_entity_name).sql_for_insert();
+                db::entity const &inv_entity = model.entity(inv_entity_name);
+                std::string const &entity_insert_sql = inv_entity.sql_for_insert();
                 auto const &rel_models = model.relations(inv_entity_name);
+                bool const is_clustered = inv_entity.layout == db::table_layout::clustered;
+                bool const is_delta = inv_entity.version_rows == db::version_rows::delta;
+                std::optional<db::integer::type> next_pk_id = std::nullopt;
 
                 for (db::object_data &obj_data : inv_removed_datas) {
-                    // 保存するデータのアトリビュートのidは削除する（rowidなのでいらない）
-                    erase_if_exists(obj_data.attributes, db::pk_id_field);
-                    // 保存するデータのセーブIDを今セーブするIDに置き換える
-                    replace(obj_data.attributes, db::save_id_field, next_save_id);
-                    replace(obj_data.attributes, db::object_id_field, obj_data.object_id.stable_value());
-                    // データベースにアトリビュートのデータを挿入する
-                    if (auto ul = unless(db->execute_update(entity_insert_sql, obj_data.attributes))) {
-                        return db::make_error_result(db::manager_error_type::insert_attributes_failed,
-                                                     std::move(ul.value.error()));
-                        break;
+                    db::value src_pk_id = obj_data.attributes.at(db::pk_id_field);
+                    db::value const src_obj_id = obj_data.object_id.stable_value();
+
+                    if (obj_data.attributes.at(db::save_id_field) == next_save_id) {
+                        // 同じセーブですでに保存されたデータなら、行を増やさずにそのデータの関連を入れ直す
+                        db::value_map_t const args{{db::src_pk_id_field, src_pk_id}};
+                        for (auto const &rel_pair : rel_models) {
+                            std::string const sql =
+                                db::delete_sql(rel_pair.second.table, db::equal_field_expr(db::src_pk_id_field));
+                            if (auto ul = unless(db->execute_update(sql, args))) {
+                                return db::make_error_result(db::manager_error_type::delete_failed,
+                                                             std::move(ul.value.error()));
+                            }
+                        }
+                    } else {
+                        if (is_clustered) {
+                            // 保存するデータのアトリビュートのidは新しく振り直す
+                            if (!next_pk_id) {
+                                next_pk_id = db::next_pk_id(db, inv_entity_name);
+                            }
+                            replace(obj_data.attributes, db::pk_id_field, db::value{*next_pk_id});
+                            ++*next_pk_id;
+                        } else {
+                            // 保存するデータのアトリビュートのidは削除する（rowidなのでいらない）
+                            erase_if_exists(obj_data.attributes, db::pk_id_field);
+                        }
+                        // 保存するデータのセーブIDを今セーブするIDに置き換える
+                        replace(obj_data.attributes, db::save_id_field, next_save_id);
+                        replace(obj_data.attributes, db::object_id_field, src_obj_id);
+                        // データベースにアトリビュートのデータを挿入する
+                        // deltaならアトリビュートは変わっていないので、関連のためのデータとして値を保存しない
+                        db::update_result_t insert_result =
+                            is_delta ? db->execute_update(entity_insert_sql,
+                                                          db::to_delta_row(inv_entity, obj_data.attributes, {}))
+                                     : db->execute_update(entity_insert_sql, obj_data.attributes);
+                        if (auto ul = unless(std::move(insert_result))) {
+                            return db::make_error_result(db::manager_error_type::insert_attributes_failed,
+                                                         std::move(ul.value.error()));
+                        }
+
+                        // pk_idを取得してセットする
+                        db::row_result_t row_result =
+                            is_clustered ? db::row_result_t{obj_data.attributes.at(db::pk_id_field).get<db::integer>()}
+                                         : db->last_insert_rowid();
+                        if (!row_result) {
+                            return db::make_error_result(db::manager_error_type::last_insert_rowid_failed,
+                                                         std::move(row_result.error()));
+                        }
+
+                        src_pk_id = db::value{std::move(row_result.value())};
+                        obj_data.attributes.insert_or_assign(db::pk_id_field, src_pk_id);
+
+                        // deltaならアトリビュートは変わっていないので、ヘッドはデータを指す値だけを更新する
+                        db::update_result_t head_result{nullptr};
+                        if (is_delta) {
+                            db::value_map_t const head_row = db::to_delta_head_row(obj_data.attributes, {});
+                            head_result = db->execute_update(db::sql_for_update_delta_head(inv_entity, head_row),
+                                                             head_row);
+                        } else {
+                            head_result = db->execute_update(inv_entity.sql_for_replace_head(),
+                                                             db::to_head_row(inv_entity, obj_data.attributes));
+                        }
+                        if (auto ul = unless(std::move(head_result))) {
+                            return db::make_error_result(db::manager_error_type::update_head_failed,
+                                                         std::move(ul.value.error()));
+                        }
                     }
 
-                    // pk_idを取得してセットする
-                    if (db::row_result_t row_result = db->last_insert_rowid()) {
-                        db::value const src_pk_id = db::value{std::move(row_result.value())};
-                        db::value const src_obj_id = obj_data.attributes.at(db::object_id_field);
-
-                        for (auto const &rel_pair : obj_data.relations) {
-                            // データベースに関連のデータを挿入する
-                            db::relation const &rel_model = rel_models.at(rel_pair.first);
-                            auto const rel_tgt_obj_ids =
-                                filter(rel_pair.second, [&tgt_obj_ids](db::object_id const &obj_id) {
-                                    return !contains(tgt_obj_ids, obj_id.stable_value());
-                                });
-                            if (rel_tgt_obj_ids.size() > 0) {
-                                if (auto ul =
-                                        unless(db::insert_relations(db, rel_model, src_pk_id, src_obj_id,
-                                                                    db::to_values(rel_tgt_obj_ids), next_save_id))) {
-                                    return std::move(ul.value);
-                                }
+                    for (auto const &rel_pair : obj_data.relations) {
+                        // データベースに関連のデータを挿入する
+                        db::relation const &rel_model = rel_models.at(rel_pair.first);
+                        auto const rel_tgt_obj_ids =
+                            filter(rel_pair.second, [&tgt_obj_ids](db::object_id const &obj_id) {
+                                return !contains(tgt_obj_ids, obj_id.stable_value());
+                            });
+                        if (rel_tgt_obj_ids.size() > 0) {
+                            if (auto ul = unless(db::insert_relations(db, rel_model, src_pk_id, src_obj_id,
+                                                                      db::to_values(rel_tgt_obj_ids), next_save_id))) {
+                                return std::move(ul.value);
                             }
                         }
-                    } else {
-                        return db::make_error_result(db::manager_error_type::last_insert_rowid_failed,
-                                                     std::move(row_result.error()));
                     }
                 }
             }
@@ -1006,6 +1874,32 @@ db::manager_result_t db::remove_relations_at_save(db::database_ptr const &db, db
     return db::manager_result_t{nullptr};
 }
 
+db::manager_result_t db::revert_heads(db::database_ptr const &db, db::model const &model,
+                                      db::integer::type const revert_save_id,
+                                      db::integer::type const current_save_id) {
+    db::integer::type const begin_save_id = std::min(revert_save_id, current_save_id);
+    db::integer::type const end_save_id = std::max(revert_save_id, current_save_id);
+
+    std::string const changed_where = joined({db::expr(db::save_id_field, ">", std::to_string(begin_save_id)),
+                                              db::expr(db::save_id_field, "<=", std::to_string(end_save_id))},
+                                             " AND ");
+
+    for (auto const &entity_pair : model.entities()) {
+        db::entity const &entity = entity_pair.second;
+
+        // リバート先とカレントの間で変更のあったオブジェクトのヘッドを作り直す
+        db::select_option const changed_option{
+            .table = entity.name, .fields = {db::object_id_field}, .where_exprs = changed_where, .distinct = true};
+
+        if (auto ul = unless(db::rebuild_heads(db, entity, db::value{revert_save_id},
+                                               db::in_expr(db::object_id_field, changed_option)))) {
+            return db::make_error_result(db::manager_error_type::update_head_failed, std::move(ul.value.error()));
+        }
+    }
+
+    return db::manager_result_t{nullptr};
+}
+
 // 指定したsave_idより大きいsave_idのデータを、全てのエンティティに対してデータベース上から削除する
 db::manager_result_t db::delete_next_to_last(db::database_ptr const &db, db::model const &model,
                                              db::value const &save_id) {
@@ -1035,17 +1929,38 @@ db::manager_result_t db::insert_relations(db::database_ptr const &db, db::relati
                                           db::value const &src_pk_id, db::value const &src_obj_id,
                                           db::value_vector_t const &rel_tgt_obj_ids, db::value const &save_id) {
     std::string const &rel_insert_sql = rel_model.sql_for_insert();
-    auto src_pk_id_pair = std::make_pair(db::src_pk_id_field, src_pk_id);
-    auto src_obj_id_pair = std::make_pair(db::src_obj_id_field, src_obj_id);
-    auto save_id_pair = std::make_pair(db::save_id_field, save_id);
 
-    for (db::value const &rel_tgt_obj_id : rel_tgt_obj_ids) {
-        auto tgt_obj_id_pair = std::make_pair(db::tgt_obj_id_field, rel_tgt_obj_id);
+    if (rel_model.encoding == db::relation_encoding::packed) {
+        // 関連先がなければ行を作らない。読む時に行がなければ空の関連になる
+        if (rel_tgt_obj_ids.empty()) {
+            return db::manager_result_t{nullptr};
+        }
 
-        db::value_map_t args{src_pk_id_pair, src_obj_id_pair, std::move(tgt_obj_id_pair), save_id_pair};
-        if (auto ul = unless(db->execute_update(rel_insert_sql, std::move(args)))) {
+        // 関連先の数によらず1行だけ挿入する
+        db::value_vector_t const args{src_pk_id, src_obj_id, save_id, db::pack_relation_ids(rel_tgt_obj_ids)};
+        if (auto ul = unless(db->execute_update(rel_insert_sql, args))) {
             return db::make_error_result(db::manager_error_type::insert_relation_failed, std::move(ul.value.error()));
         }
+        return db::manager_result_t{nullptr};
     }
-    return db::manager_result_t{nullptr};
+
+    // insert_sqlのフィールドの順番で引数を並べる
+    std::vector<db::value_vector_t> rows;
+    rows.reserve(rel_tgt_obj_ids.size());
+
+    if (rel_model.layout == db::table_layout::clustered) {
+        // 関連先の並び順をpositionとして保存する
+        db::integer::type position = 0;
+        for (db::value const &rel_tgt_obj_id : rel_tgt_obj_ids) {
+            rows.emplace_back(db::value_vector_t{src_pk_id, src_obj_id, rel_tgt_obj_id, save_id, db::value{position}});
+            ++position;
+        }
+    } else {
+        for (db::value const &rel_tgt_obj_id : rel_tgt_obj_ids) {
+            rows.emplace_back(db::value_vector_t{src_pk_id, src_obj_id, rel_tgt_obj_id, save_id});
+        }
+    }
+
+    return db::to_manager_result(db->execute_update_batch(rel_insert_sql, rows),
+                                 db::manager_error_type::insert_relation_failed);
 }
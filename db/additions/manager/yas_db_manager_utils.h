@@ -6,6 +6,7 @@
 
 #include <db/yas_db_additional_protocol.h>
 #include <db/yas_db_manager_error.h>
+#include <db/yas_db_query_plan.h>
 #include <db/yas_db_utils.h>
 
 namespace yas {
@@ -20,21 +21,54 @@ class fetch_option;
 // select
 
 namespace yas::db {
+// key_fieldは挿入した順に増えていくフィールドで、その最大のものを最後のデータとする
+// エンティティのテーブルはWITHOUT ROWIDの場合もあるので、pk_idを指定する
+
 // 指定したsave_id以前で最後のデータをDBから取得する
 [[nodiscard]] db::select_result_t select_last(db::database_ptr const &db, db::select_option option,
-                                              value const &save_id = nullptr, bool const include_removed = false);
+                                              value const &save_id = nullptr, bool const include_removed = false,
+                                              std::string const &key_field = db::rowid_field);
+// 指定したsave_id以前で最後のデータを、まとめずに1行ずつhandlerに渡す
+db::select_each_result_t select_last_each(db::database_ptr const &db, db::select_option option,
+                                          db::value const &save_id, db::row_handler_f const &handler,
+                                          bool const include_removed = false,
+                                          std::string const &key_field = db::rowid_field);
+// 指定したsave_id以前で最後のデータを取得するselect_optionに変換する
+[[nodiscard]] db::select_option to_last_select_option(db::select_option option, db::value const &save_id,
+                                                      bool const include_removed = false,
+                                                      std::string const &key_field = db::rowid_field);
+// カレントセーブIDの時点で最後のデータを、ヘッドのテーブルから取得するselect_optionに変換する
+// 履歴をまとめないので、データの数はオブジェクトの数だけに比例する
+[[nodiscard]] db::select_option to_head_select_option(db::select_option option, bool const include_removed = false);
+// deltaのエンティティで、カレントセーブIDの時点の全てのアトリビュートをヘッドのテーブルから取得するselect_optionに変換する
+[[nodiscard]] db::select_option to_snapshot_select_option(db::entity const &entity, db::select_option option,
+                                                          bool const include_removed = false);
+// deltaのエンティティのデータで保存していないアトリビュートを、それより前のデータから埋める
+// fullのエンティティならそのまま返す
+[[nodiscard]] db::select_result_t fill_delta_rows(db::database_ptr const &db, db::entity const &entity,
+                                                  db::value_map_vector_t rows);
+// オブジェクトのアトリビュートのBLOBを、値を読み込まずに少しずつ読むために開く。save_id以前で最後のデータの行を開く
+// WITHOUT ROWIDのテーブルは開けないのでエラーになる。deltaのエンティティではアトリビュートを保存した最後の行を開く
+[[nodiscard]] db::blob_stream_result_t open_attribute_blob(
+    db::database_ptr const &db, std::string const &entity_name, std::string const &attr_name, db::value const &obj_id,
+    db::value const &save_id, db::version_rows const version_rows = db::version_rows::full);
 // アンドゥするためにキャッシュを上書きするデータをDBから取得する
 db::select_result_t select_for_undo(db::database_ptr const &db, std::string const &table_name,
-                                    db::integer::type const revert_save_id, db::integer::type const current_save_id);
+                                    db::integer::type const revert_save_id, db::integer::type const current_save_id,
+                                    std::string const &key_field = db::rowid_field);
 // リドゥーするためにキャッシュを上書きするデータをDBから取得する
 db::select_result_t select_for_redo(db::database_ptr const &db, std::string const &table_name,
-                                    db::integer::type const revert_save_id, db::integer::type const current_save_id);
+                                    db::integer::type const revert_save_id, db::integer::type const current_save_id,
+                                    std::string const &key_field = db::rowid_field);
 // リバートするためにキャッシュを上書きするデータをDBから取得する
 db::select_result_t select_for_revert(db::database_ptr const &db, std::string const &table_name,
-                                      db::integer::type const revert_save_id, db::integer::type const current_save_id);
+                                      db::integer::type const revert_save_id, db::integer::type const current_save_id,
+                                      std::string const &key_field = db::rowid_field);
 // セーブのために、関連先がremoveされたオブジェクトのアトリビュートをDBから取得する
-db::select_result_t select_for_save(db::database_ptr const &db, std::string const &entity_table_name,
-                                    std::string const &rel_table_name, db::value_vector_t const &tgt_obj_ids);
+// packedの関連ではtgt_obj_idで絞り込めないので、最後のオブジェクトの関連のBLOBを読んで調べる
+// その場合は1回ごとに、removeされていない全てのオブジェクトの関連の総数に比例した時間がかかる
+db::select_result_t select_for_save(db::database_ptr const &db, db::entity const &entity, db::relation const &rel,
+                                    db::value_vector_t const &tgt_obj_ids);
 }  // namespace yas::db
 
 // info
@@ -96,9 +130,13 @@ namespace yas::db {
 // managerから返すエラーを簡易的に生成する
 db::manager_result_t make_error_result(db::manager_error_type const &error_type, db::error db_error = nullptr);
 
+// 単独のオブジェクトのアトリビュートの値を元にobject_dataを生成する
+// 内部でDBから関連先の情報を取得している
+db::object_data_result_t make_object_data(db::database_ptr const &db, db::relation_map_t const &rel_models,
+                                          db::value_map_t &&attrs);
 // エンティティ単位で、複数のオブジェクトのアトリビュートの値を元にobject_dataの配列を生成する
 // 内部でDBから関連先の情報を取得している
-db::object_data_vector_result_t make_entity_object_datas(db::database_ptr const &db, std::string const &entity_name,
+db::object_data_vector_result_t make_entity_object_datas(db::database_ptr const &db,
                                                          db::relation_map_t const &rel_models,
                                                          db::value_map_vector_t const &entity_attrs);
 }  // namespace yas::db
@@ -112,6 +150,15 @@ db::manager_result_t migrate_db_if_needed(db::database_ptr const &db, db::model
 // 新規にDB情報やテーブルをDB上に作成する
 db::manager_result_t create_info_and_tables(db::database_ptr const &db, db::model const &model);
 
+// モデルから導いたマネージャ用のインデックスをDB上に作成する。すでにあるものはそのまま
+// deltaのエンティティのヘッドにも作るので、create_head_tables_if_neededの後に呼ぶ
+db::manager_result_t create_auto_indices(db::database_ptr const &db, db::model const &model);
+
+// ヘッドのテーブルがないエンティティがあれば作成して、カレントセーブIDの時点のデータからヘッドを作る
+// deltaのエンティティでアトリビュートが足りないヘッドも作り直す。作り直したヘッドのインデックスはcreate_auto_indicesで作る
+// deltaからfullに変えたエンティティは、全てのアトリビュートを保存していないデータに前のデータから値を埋める
+db::manager_result_t create_head_tables_if_needed(db::database_ptr const &db, db::model const &model);
+
 // DB上のデータをクリアする
 db::manager_result_t clear_db(db::database_ptr const &db, db::model const &model);
 }  // namespace yas::db
@@ -124,8 +171,13 @@ db::manager_fetch_result_t insert(db::database_ptr const &db, db::model const &m
                                   db::value_map_vector_map_t &&values);
 
 // select_optionでの条件に一致したデータをDBから取得する
+// checkerがあれば、取得する前にエンティティごとのクエリプランを調べる
 db::manager_fetch_result_t fetch(db::database_ptr const &db, db::model const &model,
-                                 db::fetch_option const &fetch_option);
+                                 db::fetch_option const &fetch_option,
+                                 db::query_plan_checker_ptr const &checker = nullptr);
+// fetchでエンティティごとに実行されるSQLのクエリプランを取得する
+db::manager_query_plan_result_t explain_fetch(db::database_ptr const &db, db::model const &model,
+                                              db::fetch_option const &fetch_option);
 
 // DB上のアトリビュートのデータをパージする
 db::update_result_t purge_attributes(db::database_ptr const &db, std::string const &table_name);
@@ -142,6 +194,10 @@ db::manager_fetch_result_t save(db::database_ptr const &db, db::model const &mod
 db::manager_result_t remove_relations_at_save(db::database_ptr const &db, db::model const &model, db::info const &info,
                                               db::object_data_vector_map_t const &changed_datas);
 
+// ヘッドをリバート先のセーブIDの時点に戻す。カレントとの間で変更のあったオブジェクトだけ作り直す
+db::manager_result_t revert_heads(db::database_ptr const &db, db::model const &model,
+                                  db::integer::type const revert_save_id, db::integer::type const current_save_id);
+
 // 全てのエンティティの指定したidより大きいsave_idのデータを削除する
 db::manager_result_t delete_next_to_last(db::database_ptr const &db, db::model const &model, db::value const &save_id);
 
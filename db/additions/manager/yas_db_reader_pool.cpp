@@ -0,0 +1,103 @@
+//
+//  yas_db_reader_pool.cpp
+//
+
+#include "yas_db_reader_pool.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+#include "yas_db_database.h"
+
+using namespace yas;
+using namespace yas::db;
+
+namespace yas::db {
+// 読み込み専用の接続ではデータベースファイルに書き込む設定やロックを変える設定はしない
+static db::open_option to_reader_option(db::open_option option) {
+    option.page_size = std::nullopt;
+    option.locking_mode = std::nullopt;
+    option.journal_mode = std::nullopt;
+    return option;
+}
+}  // namespace yas::db
+
+reader_pool::reader_pool(std::filesystem::path const &db_path, db::open_option const &writer_option,
+                         std::size_t const count)
+    : _idles(count, true), _closing_counts(count, 0) {
+    this->_readers.reserve(count);
+
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        this->_readers.emplace_back(
+            db::reader{.database = database::make_shared(db_path, to_reader_option(writer_option)),
+                       .queue = task_queue<std::nullptr_t>::make_shared()});
+    }
+}
+
+std::size_t reader_pool::count() const {
+    return this->_readers.size();
+}
+
+std::size_t reader_pool::idle_count() const {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return std::count(this->_idles.begin(), this->_idles.end(), true);
+}
+
+db::reader const &reader_pool::reader_at(std::size_t const idx) const {
+    return this->_readers.at(idx);
+}
+
+// 使われていない接続を取得する。全て使われていればnullopt
+// 閉じるタスクが残っている接続は、取得した側と接続のタスクキューで同時に使うことになるので取得しない
+std::optional<std::size_t> reader_pool::acquire() {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    for (std::size_t idx = 0; idx < this->_idles.size(); ++idx) {
+        if (this->_idles.at(idx) && this->_closing_counts.at(idx) == 0) {
+            this->_idles.at(idx) = false;
+            return idx;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void reader_pool::release(std::size_t const idx) {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_idles.at(idx) = true;
+}
+
+bool reader_pool::open(std::size_t const idx) {
+    return this->_readers.at(idx).database->open(SQLITE_OPEN_READONLY);
+}
+
+// それぞれの接続のタスクキューで、それまでに追加されたタスクが終わった後に閉じる
+// 閉じ終わるまではacquireで取得されない
+void reader_pool::close_all() {
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        for (auto &closing_count : this->_closing_counts) {
+            ++closing_count;
+        }
+    }
+
+    for (std::size_t idx = 0; idx < this->_readers.size(); ++idx) {
+        auto op_lambda = [weak_pool = this->_weak_pool, idx](auto const &) {
+            if (auto const pool = weak_pool.lock()) {
+                pool->_readers.at(idx).database->close();
+
+                std::lock_guard<std::mutex> lock(pool->_mutex);
+                --pool->_closing_counts.at(idx);
+            }
+        };
+        this->_readers.at(idx).queue->push_back(task<std::nullptr_t>::make_shared(std::move(op_lambda)));
+    }
+}
+
+reader_pool_ptr reader_pool::make_shared(std::filesystem::path const &db_path, db::open_option const &writer_option,
+                                         std::size_t const count) {
+    auto shared = reader_pool_ptr(new reader_pool{db_path, writer_option, count});
+    shared->_weak_pool = shared;
+    return shared;
+}
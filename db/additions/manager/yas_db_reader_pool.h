@@ -0,0 +1,51 @@
+//
+//  yas_db_reader_pool.h
+//
+
+#pragma once
+
+#include <cpp_utils/yas_task_queue.h>
+#include <db/yas_db_open_option.h>
+#include <db/yas_db_ptr.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace yas::db {
+struct reader final {
+    db::database_ptr const database;
+    std::shared_ptr<task_queue<std::nullptr_t>> const queue;
+};
+
+struct reader_pool final {
+    [[nodiscard]] std::size_t count() const;
+    [[nodiscard]] std::size_t idle_count() const;
+    [[nodiscard]] db::reader const &reader_at(std::size_t const idx) const;
+
+    [[nodiscard]] std::optional<std::size_t> acquire();
+    void release(std::size_t const idx);
+
+    [[nodiscard]] bool open(std::size_t const idx);
+    void close_all();
+
+    [[nodiscard]] static reader_pool_ptr make_shared(std::filesystem::path const &db_path,
+                                                     db::open_option const &writer_option, std::size_t const count);
+
+   private:
+    std::vector<db::reader> _readers;
+    std::vector<bool> _idles;
+    // 接続のタスクキューに追加されて、まだ閉じ終わっていない数
+    std::vector<std::size_t> _closing_counts;
+    mutable std::mutex _mutex;
+    std::weak_ptr<reader_pool> _weak_pool;
+
+    reader_pool(std::filesystem::path const &db_path, db::open_option const &writer_option, std::size_t const count);
+
+    reader_pool(reader_pool const &) = delete;
+    reader_pool(reader_pool &&) = delete;
+    reader_pool &operator=(reader_pool const &) = delete;
+    reader_pool &operator=(reader_pool &&) = delete;
+};
+}  // namespace yas::db
@@ -77,6 +77,12 @@ attribute const &attribute::id_attribute() {
     return attr;
 }
 
+attribute const &attribute::clustered_id_attribute() {
+    // WITHOUT ROWIDのテーブルでは主キーにならないので、値はマネージャで振る
+    static attribute const attr{{db::pk_id_field, attribute_type::integer, nullptr, false, false, true}};
+    return attr;
+}
+
 attribute const &attribute::object_id_attribute() {
     static attribute const attr{{db::object_id_field, attribute_type::integer, db::value{db::integer::type{0}}, true}};
     return attr;
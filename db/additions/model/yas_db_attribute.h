@@ -22,6 +22,7 @@ struct attribute final {
     [[nodiscard]] std::string sql() const;
 
     [[nodiscard]] static db::attribute const &id_attribute();
+    [[nodiscard]] static db::attribute const &clustered_id_attribute();
     [[nodiscard]] static db::attribute const &object_id_attribute();
     [[nodiscard]] static db::attribute const &save_id_attribute();
     [[nodiscard]] static db::attribute const &action_attribute();
@@ -6,6 +6,8 @@
 
 #include <cpp_utils/yas_stl_utils.h>
 
+#include <algorithm>
+
 #include "yas_db_additional_protocol.h"
 #include "yas_db_attribute.h"
 #include "yas_db_relation.h"
@@ -25,12 +27,14 @@ static db::attribute_map_t make_attributes(std::vector<db::attribute_args> const
     return attributes;
 }
 
-static db::attribute_map_t make_all_attributes(std::vector<db::attribute_args> const &args_vec) {
+static db::attribute_map_t make_all_attributes(std::vector<db::attribute_args> const &args_vec,
+                                               db::table_layout const layout) {
     db::attribute_map_t attributes = make_attributes(args_vec);
 
     attributes.reserve(args_vec.size() + 4);
 
-    db::attribute const &id_attr = db::attribute::id_attribute();
+    db::attribute const &id_attr = (layout == db::table_layout::clustered) ? db::attribute::clustered_id_attribute()
+                                                                            : db::attribute::id_attribute();
     attributes.emplace(id_attr.name, id_attr);
 
     db::attribute const &obj_id_attr = db::attribute::object_id_attribute();
@@ -45,30 +49,68 @@ static db::attribute_map_t make_all_attributes(std::vector<db::attribute_args> c
     return attributes;
 }
 
-static db::relation_map_t make_relations(std::vector<db::relation_args> &&args_vec, std::string const &source) {
+static std::vector<std::string> make_head_fields(db::attribute_map_t const &custom_attributes,
+                                                 db::version_rows const version_rows) {
+    std::vector<std::string> fields{db::object_id_field, db::pk_id_field, db::removed_field};
+
+    if (version_rows == db::version_rows::delta) {
+        fields.push_back(db::save_id_field);
+        fields.push_back(db::action_field);
+
+        // アトリビュートはハッシュの順なので、名前の順に並べて毎回同じにする
+        std::vector<std::string> custom_names =
+            to_vector<std::string>(custom_attributes, [](auto const &pair) { return pair.first; });
+        std::sort(custom_names.begin(), custom_names.end());
+
+        fields.insert(fields.end(), custom_names.begin(), custom_names.end());
+    }
+
+    return fields;
+}
+
+static db::relation_map_t make_relations(std::vector<db::relation_args> &&args_vec, std::string const &source,
+                                        db::table_layout const layout) {
     db::relation_map_t relations;
     relations.reserve(args_vec.size());
 
     for (db::relation_args &args : args_vec) {
         std::string name = args.name;
-        relations.emplace(std::move(name), db::relation{std::move(args), source});
+        relations.emplace(std::move(name), db::relation{std::move(args), source, layout});
     }
 
     return relations;
 }
 }  // namespace yas
 
+std::string db::head_table_name(std::string const &entity_name) {
+    return "head_" + entity_name;
+}
+
 entity::entity(entity_args args, db::string_set_map_t inv_rel_names)
     : name(std::move(args.name)),
-      all_attributes(make_all_attributes(args.attributes)),
+      head_table(db::head_table_name(this->name)),
+      layout(args.layout.value_or(db::table_layout::rowid)),
+      version_rows(args.version_rows),
+      all_attributes(make_all_attributes(args.attributes, this->layout)),
       custom_attributes(make_attributes(args.attributes)),
-      relations(make_relations(std::move(args.relations), this->name)),
-      inverse_relation_names(std::move(inv_rel_names)) {
+      relations(make_relations(std::move(args.relations), this->name, this->layout)),
+      inverse_relation_names(std::move(inv_rel_names)),
+      head_fields(make_head_fields(this->custom_attributes, this->version_rows)) {
 }
 
 std::string entity::sql_for_create() const {
     auto mapped_attrs =
         to_vector<std::string>(this->all_attributes, [](auto const &pair) { return pair.second.sql(); });
+
+    if (this->version_rows == db::version_rows::delta) {
+        mapped_attrs.push_back(db::changed_field + " " + db::text::name);
+    }
+
+    if (this->layout == db::table_layout::clustered) {
+        // オブジェクトごとに履歴がセーブIDの順に続けて置かれるようにする
+        return db::create_without_rowid_table_sql(this->name, mapped_attrs, {db::object_id_field, db::save_id_field});
+    }
+
     return db::create_table_sql(this->name, mapped_attrs);
 }
 
@@ -78,6 +120,15 @@ std::string entity::sql_for_update() const {
 }
 
 std::string entity::sql_for_insert() const {
+    if (this->layout == db::table_layout::clustered) {
+        // pk_idは自動で振られないので含める
+        auto mapped_fields = to_vector<std::string>(this->all_attributes, [](auto const &pair) { return pair.first; });
+        if (this->version_rows == db::version_rows::delta) {
+            mapped_fields.push_back(db::changed_field);
+        }
+        return db::insert_sql(this->name, mapped_fields);
+    }
+
     std::vector<std::string> mapped_fields;
     for (auto const &pair : this->all_attributes) {
         std::string const &field_name = pair.first;
@@ -85,5 +136,29 @@ std::string entity::sql_for_insert() const {
             mapped_fields.push_back(field_name);
         }
     }
+    if (this->version_rows == db::version_rows::delta) {
+        mapped_fields.push_back(db::changed_field);
+    }
     return db::insert_sql(this->name, mapped_fields);
 }
+
+std::string entity::sql_for_create_head() const {
+    std::vector<std::string> fields{db::object_id_field + " INTEGER PRIMARY KEY",
+                                    db::pk_id_field + " INTEGER NOT NULL", db::removed_field + " INTEGER NOT NULL"};
+
+    if (this->version_rows == db::version_rows::delta) {
+        // ヘッドの値は履歴から作り直されるので、制約やデフォルト値は付けずに型だけにする
+        for (auto const &field : this->head_fields) {
+            if (field == db::object_id_field || field == db::pk_id_field || field == db::removed_field) {
+                continue;
+            }
+            fields.push_back(field + " " + this->all_attributes.at(field).type);
+        }
+    }
+
+    return db::create_table_sql(this->head_table, fields);
+}
+
+std::string entity::sql_for_replace_head() const {
+    return db::replace_sql(this->head_table, this->head_fields);
+}
@@ -8,19 +8,30 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace yas::db {
+// オブジェクトごとに最後のデータのpk_idを持つテーブルの名前
+[[nodiscard]] std::string head_table_name(std::string const &entity_name);
+
 struct entity final {
     std::string const name;
+    std::string const head_table;
+    db::table_layout const layout;
+    db::version_rows const version_rows;
     db::attribute_map_t const all_attributes;
     db::attribute_map_t const custom_attributes;
     db::relation_map_t const relations;
     db::string_set_map_t const inverse_relation_names;
+    // ヘッドのテーブルのフィールドの並び。deltaならpk_id以外のアトリビュートも全て持つ
+    std::vector<std::string> const head_fields;
 
     entity(entity_args, db::string_set_map_t inv_rel_names);
 
     [[nodiscard]] std::string sql_for_create() const;
     [[nodiscard]] std::string sql_for_update() const;
     [[nodiscard]] std::string sql_for_insert() const;
+    [[nodiscard]] std::string sql_for_create_head() const;
+    [[nodiscard]] std::string sql_for_replace_head() const;
 };
 }  // namespace yas::db
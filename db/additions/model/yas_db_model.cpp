@@ -4,6 +4,8 @@
 
 #include "yas_db_model.h"
 
+#include <cpp_utils/yas_stl_utils.h>
+
 #include <unordered_map>
 #include <vector>
 
@@ -40,6 +42,62 @@ static std::unordered_map<std::string, db::string_set_map_t> make_inverse_relati
 
     return entity_inv_rel_names;
 }
+
+static void add_auto_index(db::index_map_t &indices, std::string const &table, std::vector<std::string> fields) {
+    std::string name = "auto_" + table + "_" + joined(fields, "_");
+    indices.emplace(name, db::index{{.name = name, .entity = table, .attributes = std::move(fields)}});
+}
+
+static db::index_map_t make_auto_indices(db::entity_map_t const &entities, db::index_map_t const &model_indices) {
+    db::index_map_t indices;
+
+    for (auto const &entity_pair : entities) {
+        db::entity const &entity = entity_pair.second;
+
+        // clusteredのテーブルは主キーで並んでいるので、主キーと同じ並びのインデックスは作らない
+        bool const is_clustered = entity.layout == db::table_layout::clustered;
+
+        // select_lastなどでオブジェクトIDごとにセーブIDまでの最後のデータを探す
+        if (!is_clustered) {
+            add_auto_index(indices, entity.name, {db::object_id_field, db::save_id_field});
+        }
+
+        for (auto const &rel_pair : entity.relations) {
+            db::relation const &relation = rel_pair.second;
+            std::string const &rel_table = relation.table;
+
+            // オブジェクトのデータを作る時にセーブIDとソースのオブジェクトIDで関連を探す
+            add_auto_index(indices, rel_table, {db::save_id_field, db::src_obj_id_field});
+
+            // packedならsrc_pk_idがrowidで、関連先のidはBLOBの中にあるので、残りのインデックスは作らない
+            if (relation.encoding == db::relation_encoding::packed) {
+                continue;
+            }
+
+            // パージやリバートでソースのデータのrowidから関連を探す
+            if (!is_clustered) {
+                add_auto_index(indices, rel_table, {db::src_pk_id_field});
+            }
+            // セーブ時に削除されたオブジェクトを関連先に持つデータを探す
+            add_auto_index(indices, rel_table, {db::tgt_obj_id_field});
+        }
+    }
+
+    // deltaのエンティティはヘッドから条件に合うものを探すので、モデルのインデックスをヘッドにも作る
+    for (auto const &index_pair : model_indices) {
+        db::index const &index = index_pair.second;
+        if (entities.count(index.entity) == 0) {
+            continue;
+        }
+
+        db::entity const &entity = entities.at(index.entity);
+        if (entity.version_rows == db::version_rows::delta) {
+            add_auto_index(indices, entity.head_table, index.attributes);
+        }
+    }
+
+    return indices;
+}
 }  // namespace yas::db
 
 model::model(model_args args) : _args(to_args(std::move(args))) {
@@ -57,6 +115,10 @@ db::index_map_t const &model::indices() const {
     return this->_args.indices;
 }
 
+db::index_map_t const &model::auto_indices() const {
+    return this->_args.auto_indices;
+}
+
 db::entity const &model::entity(std::string const &entity) const {
     return this->entities().at(entity);
 }
@@ -126,7 +188,9 @@ model::args model::to_args(model_args &&args) {
         std::string name = entity_args.name;
         entities.emplace(std::move(name), db::entity{{.name = std::move(entity_args.name),
                                                       .attributes = std::move(entity_args.attributes),
-                                                      .relations = std::move(entity_args.relations)},
+                                                      .relations = std::move(entity_args.relations),
+                                                      .layout = entity_args.layout.value_or(args.layout),
+                                                      .version_rows = entity_args.version_rows},
                                                      std::move(inv_rel_names)});
     }
 
@@ -138,5 +202,10 @@ model::args model::to_args(model_args &&args) {
         indices.emplace(std::move(name), db::index{std::move(index_args)});
     }
 
-    return {.version = std::move(args.version), .entities = std::move(entities), .indices = std::move(indices)};
+    db::index_map_t auto_indices = args.auto_indices ? make_auto_indices(entities, indices) : db::index_map_t{};
+
+    return {.version = std::move(args.version),
+            .entities = std::move(entities),
+            .indices = std::move(indices),
+            .auto_indices = std::move(auto_indices)};
 }
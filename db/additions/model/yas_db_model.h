@@ -20,6 +20,7 @@ struct model final {
     [[nodiscard]] yas::version const &version() const;
     [[nodiscard]] db::entity_map_t const &entities() const;
     [[nodiscard]] db::index_map_t const &indices() const;
+    [[nodiscard]] db::index_map_t const &auto_indices() const;
 
     [[nodiscard]] db::entity const &entity(std::string const &entity) const;
     [[nodiscard]] db::attribute_map_t const &attributes(std::string const &entity) const;
@@ -39,6 +40,7 @@ struct model final {
         yas::version const version;
         db::entity_map_t const entities;
         db::index_map_t const indices;
+        db::index_map_t const auto_indices;
     };
 
     args _args;
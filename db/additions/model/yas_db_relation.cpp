@@ -10,11 +10,13 @@
 using namespace yas;
 using namespace yas::db;
 
-relation::relation(relation_args args, std::string source)
+relation::relation(relation_args args, std::string source, db::table_layout const layout)
     : name(std::move(args.name)),
       source(std::move(source)),
       target(std::move(args.target)),
       many(args.many),
+      encoding(args.encoding),
+      layout(layout),
       table("rel_" + this->source + "_" + this->name) {
     if (this->name.size() == 0) {
         throw std::invalid_argument("invalid name");
@@ -22,17 +24,83 @@ relation::relation(relation_args args, std::string source)
 }
 
 std::string relation::sql_for_create() const {
+    if (this->encoding == db::relation_encoding::packed) {
+        // ソースのデータごとに1行なので、src_pk_idをrowidにすればどちらのlayoutでも続けて置かれる
+        return db::create_table_sql(
+            this->table, {db::src_pk_id_field + " INTEGER PRIMARY KEY",
+                          db::attribute{{db::src_obj_id_field, db::attribute_type::integer}}.sql(),
+                          db::attribute{{db::save_id_field, db::attribute_type::integer}}.sql(),
+                          db::attribute{{db::tgt_obj_ids_field, db::attribute_type::blob}}.sql()});
+    }
+
     std::string id_sql = db::attribute::id_attribute().sql();
     std::string src_pk_id_sql = db::attribute{{db::src_pk_id_field, db::attribute_type::integer}}.sql();
     std::string src_obj_id_sql = db::attribute{{db::src_obj_id_field, db::attribute_type::integer}}.sql();
     std::string tgt_obj_id_sql = db::attribute{{db::tgt_obj_id_field, db::attribute_type::integer}}.sql();
     std::string save_id_sql = db::attribute{{db::save_id_field, db::attribute_type::integer}}.sql();
 
+    if (this->layout == db::table_layout::clustered) {
+        // ソースのデータごとに関連先が並び順のまま続けて置かれるようにする
+        std::string position_sql = db::attribute{{db::position_field, db::attribute_type::integer}}.sql();
+        return db::create_without_rowid_table_sql(
+            this->table,
+            {std::move(src_pk_id_sql), std::move(position_sql), std::move(src_obj_id_sql), std::move(tgt_obj_id_sql),
+             std::move(save_id_sql)},
+            {db::src_pk_id_field, db::position_field});
+    }
+
     return db::create_table_sql(this->table, {std::move(id_sql), std::move(src_pk_id_sql), std::move(src_obj_id_sql),
                                               std::move(tgt_obj_id_sql), std::move(save_id_sql)});
 }
 
 std::string relation::sql_for_insert() const {
+    if (this->encoding == db::relation_encoding::packed) {
+        return db::insert_sql(this->table,
+                              {db::src_pk_id_field, db::src_obj_id_field, db::save_id_field, db::tgt_obj_ids_field});
+    }
+
+    if (this->layout == db::table_layout::clustered) {
+        return db::insert_sql(this->table, {db::src_pk_id_field, db::src_obj_id_field, db::tgt_obj_id_field,
+                                            db::save_id_field, db::position_field});
+    }
+
     return db::insert_sql(this->table,
                           {db::src_pk_id_field, db::src_obj_id_field, db::tgt_obj_id_field, db::save_id_field});
 }
+
+db::value db::pack_relation_ids(db::value_vector_t const &ids) {
+    std::vector<std::byte> bytes;
+    bytes.reserve(1 + ids.size() * sizeof(int64_t));
+    bytes.push_back(std::byte{db::packed_ids_version});
+
+    for (db::value const &id : ids) {
+        uint64_t const bits = static_cast<uint64_t>(id.get<db::integer>());
+        for (std::size_t idx = 0; idx < sizeof(uint64_t); ++idx) {
+            bytes.push_back(static_cast<std::byte>((bits >> (idx * 8)) & 0xff));
+        }
+    }
+
+    return db::value{bytes.data(), bytes.size()};
+}
+
+db::value_vector_result_t db::unpack_relation_ids(std::span<std::byte const> const bytes) {
+    if (bytes.size() == 0 || bytes[0] != std::byte{db::packed_ids_version} ||
+        (bytes.size() - 1) % sizeof(int64_t) != 0) {
+        return db::value_vector_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    std::size_t const count = (bytes.size() - 1) / sizeof(int64_t);
+    db::value_vector_t ids;
+    ids.reserve(count);
+
+    for (std::size_t id_idx = 0; id_idx < count; ++id_idx) {
+        std::span<std::byte const> const id_bytes = bytes.subspan(1 + id_idx * sizeof(int64_t), sizeof(int64_t));
+        uint64_t bits = 0;
+        for (std::size_t idx = 0; idx < sizeof(uint64_t); ++idx) {
+            bits |= static_cast<uint64_t>(id_bytes[idx]) << (idx * 8);
+        }
+        ids.emplace_back(static_cast<int64_t>(bits));
+    }
+
+    return db::value_vector_result_t{std::move(ids)};
+}
@@ -4,22 +4,34 @@
 
 #pragma once
 
+#include <db/yas_db_additional_types.h>
+
+#include <cstddef>
+#include <span>
 #include <string>
 
 namespace yas::db {
-class relation_args;
-
 struct relation final {
     std::string const name;
     std::string const source;
     std::string const target;
     bool const many;
+    db::relation_encoding const encoding;
+    db::table_layout const layout;
 
     std::string const table;
 
-    explicit relation(relation_args, std::string source);
+    explicit relation(relation_args, std::string source, db::table_layout const layout = db::table_layout::rowid);
 
     [[nodiscard]] std::string sql_for_create() const;
     [[nodiscard]] std::string sql_for_insert() const;
 };
+
+// packedの関連のBLOBの形式のバージョン
+static uint8_t constexpr packed_ids_version = 1;
+
+// 関連先のidの配列を、先頭1バイトのバージョンに続けてint64のリトルエンディアンで並べたBLOBに詰める
+[[nodiscard]] db::value pack_relation_ids(db::value_vector_t const &);
+// BLOBから関連先のidの配列を取り出す。バージョンやサイズが合わなければエラーを返す
+[[nodiscard]] db::value_vector_result_t unpack_relation_ids(std::span<std::byte const> const);
 }  // namespace yas::db
@@ -7,6 +7,8 @@
 #include <cpp_utils/yas_fast_each.h>
 #include <cpp_utils/yas_stl_utils.h>
 
+#include <algorithm>
+
 #include "yas_db_attribute.h"
 #include "yas_db_manager_utils.h"
 #include "yas_db_model.h"
@@ -362,6 +364,10 @@ enum db::object_status object::status() const {
     return this->_status;
 }
 
+bool object::is_attribute_loaded(std::string const &attr_name) const {
+    return !this->_unloaded_attribute_names.contains(attr_name);
+}
+
 void object::remove() {
     if (this->_is_equal_to_action(db::remove_action)) {
         return;
@@ -376,6 +382,7 @@ void object::remove() {
     });
 
     this->_relations.clear();
+    this->_unloaded_attribute_names.clear();
 
     this->_set_attribute_value(db::action_field, db::remove_action_value(), false);
 }
@@ -399,7 +406,8 @@ db::object_data object::save_data(db::object_id_pool &pool) const {
     for (auto const &pair : this->_entity.all_attributes) {
         std::string const &attr_name = pair.first;
 
-        if (attr_name == db::save_id_field || attr_name == db::object_id_field) {
+        if (attr_name == db::save_id_field || attr_name == db::object_id_field ||
+            this->_unloaded_attribute_names.contains(attr_name)) {
             continue;
         }
 
@@ -412,6 +420,15 @@ db::object_data object::save_data(db::object_id_pool &pool) const {
         }
     }
 
+    // deltaのエンティティの更新なら、読み込んでから変更したアトリビュートの名前を渡す
+    if (this->_entity.version_rows == db::version_rows::delta && this->_status != db::object_status::created &&
+        this->_is_equal_to_action(db::update_action)) {
+        std::vector<std::string> changed_names(this->_changed_attribute_names.begin(),
+                                               this->_changed_attribute_names.end());
+        std::sort(changed_names.begin(), changed_names.end());
+        attributes.emplace(db::changed_field, db::value{joined(changed_names, ",")});
+    }
+
     for (auto const &pair : this->_entity.relations) {
         std::string const &rel_name = pair.first;
         if (this->_relations.count(rel_name) > 0) {
@@ -468,10 +485,14 @@ void object::load_data(db::object_data const &obj_data, bool const force) {
 
         this->_update_identifier(obj_data);
 
+        bool const is_saved = obj_data.attributes.count(db::save_id_field) > 0;
+
         for (auto const &pair : this->_entity.all_attributes) {
             std::string const &attr_name = pair.first;
             if (obj_data.attributes.count(attr_name) > 0) {
                 this->_set_attribute_value(attr_name, obj_data.attributes.at(attr_name), true);
+            } else if (is_saved && this->_entity.custom_attributes.count(attr_name) > 0) {
+                this->_unloaded_attribute_names.insert(attr_name);
             }
         }
 
@@ -482,7 +503,7 @@ void object::load_data(db::object_data const &obj_data, bool const force) {
             }
         }
 
-        if (obj_data.attributes.count(db::save_id_field) > 0) {
+        if (is_saved) {
             this->_status = db::object_status::saved;
         }
 
@@ -502,6 +523,8 @@ void object::clear_data() {
 
 void object::_clear() {
     this->const_object::_clear();
+    this->_changed_attribute_names.clear();
+    this->_unloaded_attribute_names.clear();
     this->_status = db::object_status::invalid;
 }
 
@@ -523,6 +546,11 @@ void object::_set_attribute_value(std::string const &attr_name, db::value const
             this->_set_update_action();
         }
 
+        if (this->_entity.custom_attributes.count(attr_name) > 0) {
+            this->_changed_attribute_names.insert(attr_name);
+            this->_unloaded_attribute_names.erase(attr_name);
+        }
+
         if (this->_status != db::object_status::created) {
             this->_status = db::object_status::changed;
         }
@@ -78,6 +78,8 @@ struct object final : const_object, manageable_object {
     void remove_all_relations(std::string const &rel_name);
 
     db::object_status status() const;
+    // フェッチで除いたために読み込んでいないアトリビュートならfalse。値はread_attribute_blobで読み込む
+    [[nodiscard]] bool is_attribute_loaded(std::string const &attr_name) const;
 
     void remove();
 
@@ -91,6 +93,10 @@ struct object final : const_object, manageable_object {
     object(db::entity const &entity);
 
     enum db::object_status _status = db::object_status::invalid;
+    // 読み込んでから変更したアトリビュートの名前。deltaのエンティティで変更のあったものだけを保存するのに使う
+    db::string_set_t _changed_attribute_names;
+    // フェッチで除いて読み込んでいないアトリビュートの名前。セーブしても前の値のままにする
+    db::string_set_t _unloaded_attribute_names;
     observing::fetcher_ptr<object_event> _fetcher = nullptr;
     db::object_wptr _weak_object;
 
@@ -0,0 +1,184 @@
+//
+//  yas_db_column_batch.cpp
+//
+
+#include "yas_db_column_batch.h"
+
+#include <cpp_utils/yas_result.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "yas_db_database.h"
+#include "yas_db_error.h"
+#include "yas_db_row_set.h"
+#include "yas_db_select_option.h"
+#include "yas_db_statement.h"
+
+using namespace yas;
+
+namespace yas::db {
+static void append_row(db::column_vector &column, db::row_set const &row_set, int const column_idx,
+                       std::size_t const row_idx) {
+    if (row_idx % 64 == 0) {
+        column.null_bits.push_back(0);
+    }
+
+    bool const is_null = sqlite3_column_type(row_set.statement()->stmt(), column_idx) == SQLITE_NULL;
+
+    if (is_null) {
+        column.null_bits.back() |= (uint64_t{1} << (row_idx % 64));
+    }
+
+    switch (column.type) {
+        case db::column_type::integer:
+            column.integers.push_back(is_null ? 0 : row_set.get<int64_t>(column_idx));
+            break;
+        case db::column_type::real:
+            column.reals.push_back(is_null ? 0.0 : row_set.get<double>(column_idx));
+            break;
+        case db::column_type::text: {
+            if (!is_null) {
+                std::string_view const text = row_set.get<std::string_view>(column_idx);
+                auto const *const data = reinterpret_cast<std::byte const *>(text.data());
+                column.arena.insert(column.arena.end(), data, data + text.size());
+            }
+            column.offsets.push_back(column.arena.size());
+        } break;
+        case db::column_type::blob: {
+            if (!is_null) {
+                std::span<std::byte const> const blob = row_set.get<std::span<std::byte const>>(column_idx);
+                column.arena.insert(column.arena.end(), blob.begin(), blob.end());
+            }
+            column.offsets.push_back(column.arena.size());
+        } break;
+    }
+}
+}  // namespace yas::db
+
+#pragma mark - column_vector
+
+bool db::column_vector::is_null(std::size_t const row_idx) const {
+    return (this->null_bits.at(row_idx / 64) >> (row_idx % 64)) & 1;
+}
+
+std::string_view db::column_vector::text(std::size_t const row_idx) const {
+    auto const bytes = this->blob(row_idx);
+    return std::string_view{reinterpret_cast<char const *>(bytes.data()), bytes.size()};
+}
+
+std::span<std::byte const> db::column_vector::blob(std::size_t const row_idx) const {
+    std::size_t const begin = this->offsets.at(row_idx);
+    std::size_t const end = this->offsets.at(row_idx + 1);
+    return std::span<std::byte const>{this->arena.data() + begin, end - begin};
+}
+
+#pragma mark - column_batch
+
+db::column_vector const &db::column_batch::column(std::string_view const name) const {
+    auto const it = std::find_if(this->columns.begin(), this->columns.end(),
+                                 [&name](db::column_vector const &column) { return column.name == name; });
+
+    if (it == this->columns.end()) {
+        throw std::out_of_range(std::string(__PRETTY_FUNCTION__) + " : column '" + std::string(name) +
+                                "' is not found.");
+    }
+
+    return *it;
+}
+
+void db::column_batch::clear() {
+    this->row_count = 0;
+
+    for (db::column_vector &column : this->columns) {
+        column.integers.clear();
+        column.reals.clear();
+        column.arena.clear();
+        column.offsets.clear();
+        column.null_bits.clear();
+
+        if (column.type == db::column_type::text || column.type == db::column_type::blob) {
+            column.offsets.push_back(0);
+        }
+    }
+}
+
+#pragma mark -
+
+db::select_each_result_t db::select_columns(db::database_ptr const &db, db::select_option option,
+                                            std::vector<db::column_spec> const &specs,
+                                            db::column_batch_handler_f const &handler, std::size_t const batch_size) {
+    if (specs.empty() || batch_size == 0) {
+        throw std::invalid_argument(std::string(__PRETTY_FUNCTION__) + " : specs or batch_size is empty.");
+    }
+
+    option.fields.clear();
+    option.fields.reserve(specs.size());
+
+    db::column_batch batch;
+    batch.columns.reserve(specs.size());
+
+    for (db::column_spec const &spec : specs) {
+        option.fields.push_back(spec.name);
+        batch.columns.emplace_back(db::column_vector{.name = spec.name,
+                                                     .type = spec.type,
+                                                     .integers = {},
+                                                     .reals = {},
+                                                     .arena = {},
+                                                     .offsets = {},
+                                                     .null_bits = {}});
+    }
+
+    batch.clear();
+
+    for (db::column_vector &column : batch.columns) {
+        switch (column.type) {
+            case db::column_type::integer:
+                column.integers.reserve(batch_size);
+                break;
+            case db::column_type::real:
+                column.reals.reserve(batch_size);
+                break;
+            case db::column_type::text:
+            case db::column_type::blob:
+                column.offsets.reserve(batch_size + 1);
+                break;
+        }
+        column.null_bits.reserve((batch_size + 63) / 64);
+    }
+
+    std::size_t handled_count = 0;
+    bool is_stopped = false;
+
+    auto const send_batch = [&batch, &handler, &handled_count, &is_stopped]() {
+        handled_count += batch.row_count;
+        is_stopped = !handler(batch);
+        batch.clear();
+    };
+
+    auto select_result = db::select_each(db, option, [&](db::row_set &row_set) {
+        int column_idx = 0;
+        for (db::column_vector &column : batch.columns) {
+            db::append_row(column, row_set, column_idx, batch.row_count);
+            ++column_idx;
+        }
+
+        ++batch.row_count;
+
+        if (batch.row_count == batch_size) {
+            send_batch();
+        }
+
+        return !is_stopped;
+    });
+
+    if (!select_result) {
+        return select_result;
+    }
+
+    if (!is_stopped && batch.row_count > 0) {
+        send_batch();
+    }
+
+    return db::select_each_result_t{handled_count};
+}
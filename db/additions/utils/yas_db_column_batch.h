@@ -0,0 +1,70 @@
+//
+//  yas_db_column_batch.h
+//
+
+#pragma once
+
+#include <db/yas_db_ptr.h>
+#include <db/yas_db_utils.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yas::db {
+class select_option;
+
+enum class column_type {
+    integer,
+    real,
+    text,
+    blob,
+};
+
+struct column_spec final {
+    std::string name;
+    db::column_type type;
+};
+
+// 1カラム分の値を型ごとの配列で持つ。NULLはビットマップで表し、値の配列には0や空が入る
+struct column_vector final {
+    std::string name;
+    db::column_type type;
+
+    std::vector<int64_t> integers;
+    std::vector<double> reals;
+    // textとblobは全行分をarenaに詰めて、行ごとの開始位置をoffsetsに持つ（offsetsの要素数は行数+1）
+    std::vector<std::byte> arena;
+    std::vector<std::size_t> offsets;
+    std::vector<uint64_t> null_bits;
+
+    [[nodiscard]] bool is_null(std::size_t const row_idx) const;
+    [[nodiscard]] std::string_view text(std::size_t const row_idx) const;
+    [[nodiscard]] std::span<std::byte const> blob(std::size_t const row_idx) const;
+};
+
+struct column_batch final {
+    std::size_t row_count = 0;
+    std::vector<db::column_vector> columns;
+
+    [[nodiscard]] db::column_vector const &column(std::string_view const name) const;
+
+    // 確保したメモリは残したまま中身を空にする
+    void clear();
+};
+
+static std::size_t constexpr default_column_batch_size = 1024;
+
+using column_batch_handler_f = std::function<bool(db::column_batch const &)>;
+
+// select_optionのfieldsをspecsのカラムに置き換えて実行し、batch_size行ごとにカラム単位の配列にしてhandlerに渡す
+// handlerがfalseを返したらそこで終了する。成功すればhandlerに渡した行数を返す
+db::select_each_result_t select_columns(db::database_ptr const &db, db::select_option option,
+                                        std::vector<db::column_spec> const &specs,
+                                        db::column_batch_handler_f const &handler,
+                                        std::size_t const batch_size = db::default_column_batch_size);
+}  // namespace yas::db
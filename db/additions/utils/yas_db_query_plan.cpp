@@ -0,0 +1,99 @@
+//
+//  yas_db_query_plan.cpp
+//
+
+#include "yas_db_query_plan.h"
+
+#include <algorithm>
+
+#include "yas_db_database.h"
+#include "yas_db_query_profiler.h"
+#include "yas_db_row_set.h"
+#include "yas_db_select_option.h"
+#include "yas_db_sql_utils.h"
+
+using namespace yas;
+using namespace yas::db;
+
+#pragma mark - query_plan_step
+
+bool query_plan_step::is_table_scan() const {
+    // 古いSQLiteでは"SCAN TABLE t"、新しいSQLiteでは"SCAN t"になる
+    // サブクエリの結果や定数行の走査、インデックスを使った走査は含めない
+    std::string_view const detail = this->detail;
+    return detail.starts_with("SCAN ") && !detail.starts_with("SCAN CONSTANT ROW") &&
+           detail.find("SUBQUERY") == std::string_view::npos && detail.find("subquery") == std::string_view::npos &&
+           detail.find(" USING ") == std::string_view::npos;
+}
+
+bool query_plan_step::is_index_scan() const {
+    std::string_view const detail = this->detail;
+    return detail.starts_with("SCAN ") && detail.find(" INDEX ") != std::string_view::npos;
+}
+
+bool query_plan_step::uses_temp_b_tree() const {
+    return this->detail.find("TEMP B-TREE") != std::string::npos;
+}
+
+#pragma mark - query_plan
+
+bool query_plan::has_table_scan() const {
+    return std::any_of(this->steps.begin(), this->steps.end(),
+                       [](db::query_plan_step const &step) { return step.is_table_scan(); });
+}
+
+bool query_plan::has_temp_b_tree() const {
+    return std::any_of(this->steps.begin(), this->steps.end(),
+                       [](db::query_plan_step const &step) { return step.uses_temp_b_tree(); });
+}
+
+#pragma mark - explain
+
+db::query_plan_result_t db::explain_query_plan(db::database_ptr const &db, std::string const &sql,
+                                               db::value_map_t const &arguments) {
+    db::query_plan plan{.sql = sql, .steps = {}};
+
+    if (db::query_result_t result = db->execute_query("EXPLAIN QUERY PLAN " + sql, arguments)) {
+        auto &row_set = result.value();
+        while (row_set->next()) {
+            plan.steps.emplace_back(db::query_plan_step{.id = static_cast<int>(row_set->get<int64_t>(0)),
+                                                        .parent = static_cast<int>(row_set->get<int64_t>(1)),
+                                                        .detail = std::string{row_set->get<std::string_view>(3)}});
+        }
+    } else {
+        return db::query_plan_result_t{std::move(result.error())};
+    }
+
+    return db::query_plan_result_t{std::move(plan)};
+}
+
+db::query_plan_result_t db::explain_query_plan(db::database_ptr const &db, db::select_option const &option) {
+    return db::explain_query_plan(db, db::select_sql(option) + ";", option.arguments);
+}
+
+#pragma mark - query_plan_checker
+
+query_plan_checker::query_plan_checker(db::query_plan_warning_f &&handler) : _handler(std::move(handler)) {
+}
+
+void query_plan_checker::check(db::database_ptr const &db, db::select_option const &option) {
+    std::string const sql = db::select_sql(option) + ";";
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        if (!this->_checked_sqls.insert(db::normalize_sql(sql)).second) {
+            return;
+        }
+    }
+
+    if (auto result = db::explain_query_plan(db, sql, option.arguments)) {
+        db::query_plan const &plan = result.value();
+        if (plan.has_table_scan() || plan.has_temp_b_tree()) {
+            this->_handler(plan);
+        }
+    }
+}
+
+query_plan_checker_ptr query_plan_checker::make_shared(db::query_plan_warning_f handler) {
+    return query_plan_checker_ptr(new query_plan_checker{std::move(handler)});
+}
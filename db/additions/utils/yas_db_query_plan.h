@@ -0,0 +1,70 @@
+//
+//  yas_db_query_plan.h
+//
+
+#pragma once
+
+#include <cpp_utils/yas_result.h>
+#include <db/yas_db_error.h>
+#include <db/yas_db_ptr.h>
+#include <db/yas_db_types.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace yas::db {
+class select_option;
+
+// EXPLAIN QUERY PLANの1行
+struct query_plan_step final {
+    int id;
+    int parent;
+    std::string detail;
+
+    // インデックスを使わずにテーブルを全件走査している
+    [[nodiscard]] bool is_table_scan() const;
+    // インデックスを全件走査している
+    [[nodiscard]] bool is_index_scan() const;
+    // ORDER BYやGROUP BYなどのために一時的なB-Treeを作っている
+    [[nodiscard]] bool uses_temp_b_tree() const;
+};
+
+struct query_plan final {
+    std::string sql;
+    std::vector<db::query_plan_step> steps;
+
+    [[nodiscard]] bool has_table_scan() const;
+    [[nodiscard]] bool has_temp_b_tree() const;
+};
+
+using query_plan_result_t = result<db::query_plan, db::error>;
+using query_plan_warning_f = std::function<void(db::query_plan const &)>;
+
+[[nodiscard]] db::query_plan_result_t explain_query_plan(db::database_ptr const &db, std::string const &sql,
+                                                         db::value_map_t const &arguments = {});
+[[nodiscard]] db::query_plan_result_t explain_query_plan(db::database_ptr const &db,
+                                                         db::select_option const &option);
+
+// 同じ形のSQLごとに1度だけクエリプランを調べて、全件走査か一時的なB-Treeがあればhandlerに渡す
+// 値だけが違うSQLは同じ形として扱う。複数のスレッドから呼ばれても良い
+struct query_plan_checker final {
+    void check(db::database_ptr const &db, db::select_option const &option);
+
+    [[nodiscard]] static query_plan_checker_ptr make_shared(db::query_plan_warning_f);
+
+   private:
+    db::query_plan_warning_f const _handler;
+    std::unordered_set<std::string> _checked_sqls;
+    std::mutex _mutex;
+
+    explicit query_plan_checker(db::query_plan_warning_f &&);
+
+    query_plan_checker(query_plan_checker const &) = delete;
+    query_plan_checker(query_plan_checker &&) = delete;
+    query_plan_checker &operator=(query_plan_checker const &) = delete;
+    query_plan_checker &operator=(query_plan_checker &&) = delete;
+};
+}  // namespace yas::db
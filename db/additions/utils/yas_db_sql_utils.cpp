@@ -19,6 +19,14 @@ std::string yas::db::create_table_sql(std::string const &table, std::vector<std:
     return "CREATE TABLE IF NOT EXISTS " + table + " (" + joined_fields + ");";
 }
 
+std::string yas::db::create_without_rowid_table_sql(std::string const &table, std::vector<std::string> const &fields,
+                                                   std::vector<std::string> const &primary_keys) {
+    std::string const joined_fields = joined(fields, db::field_separator);
+    std::string const joined_keys = joined(primary_keys, db::field_separator);
+    return "CREATE TABLE IF NOT EXISTS " + table + " (" + joined_fields + ", PRIMARY KEY(" + joined_keys +
+           ")) WITHOUT ROWID;";
+}
+
 std::string yas::db::alter_table_sql(std::string const &table, std::string const &field) {
     return "ALTER TABLE " + table + " ADD COLUMN " + field + ";";
 }
@@ -50,6 +58,13 @@ std::string yas::db::insert_sql(std::string const &table, std::vector<std::strin
     return stream.str();
 }
 
+std::string yas::db::replace_sql(std::string const &table, std::vector<std::string> const &fields) {
+    std::string const joined_fields = joined(fields, db::field_separator);
+    std::string const joined_values = joined(
+        to_vector<std::string>(fields, [](std::string const &field) { return ":" + field; }), db::field_separator);
+    return "INSERT OR REPLACE INTO " + table + "(" + joined_fields + ") VALUES(" + joined_values + ");";
+}
+
 std::string yas::db::update_sql(std::string const &table, std::vector<std::string> const &fields,
                                 std::string const &where_exprs) {
     std::ostringstream stream;
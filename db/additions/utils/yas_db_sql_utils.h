@@ -14,6 +14,9 @@ class field_order;
 class range;
 
 [[nodiscard]] std::string create_table_sql(std::string const &table, std::vector<std::string> const &fields);
+[[nodiscard]] std::string create_without_rowid_table_sql(std::string const &table,
+                                                         std::vector<std::string> const &fields,
+                                                         std::vector<std::string> const &primary_keys);
 [[nodiscard]] std::string alter_table_sql(std::string const &table, std::string const &field);
 [[nodiscard]] std::string drop_table_sql(std::string const &table);
 
@@ -22,6 +25,7 @@ class range;
 [[nodiscard]] std::string drop_index_sql(std::string const &index);
 
 [[nodiscard]] std::string insert_sql(std::string const &table, std::vector<std::string> const &fields = {});
+[[nodiscard]] std::string replace_sql(std::string const &table, std::vector<std::string> const &fields);
 [[nodiscard]] std::string update_sql(std::string const &table, std::vector<std::string> const &fields,
                                      std::string const &where_exprs = "");
 [[nodiscard]] std::string delete_sql(std::string const &table, std::string const &where_exprs = "");
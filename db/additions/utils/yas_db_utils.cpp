@@ -8,6 +8,8 @@
 #include <cpp_utils/yas_stl_utils.h>
 #include <cpp_utils/yas_unless.h>
 
+#include <optional>
+
 #include "yas_db_additional_protocol.h"
 #include "yas_db_attribute.h"
 #include "yas_db_database.h"
@@ -42,6 +44,20 @@ db::update_result_t db::drop_index(db::database_ptr const &db, std::string const
     return db->execute_update(db::drop_index_sql(index_name));
 }
 
+namespace yas::db {
+// キャンセルで中断された後でもロールバックは最後まで実行する
+static db::update_result_t execute_update_without_interruption(db::database_ptr const &db, std::string const &sql) {
+    db::database::interruption_f handler = db->interruption_handler();
+    int const instruction_interval = db->interruption_instruction_interval();
+
+    db->set_interruption_handler(nullptr);
+    db::update_result_t result = db->execute_update(sql);
+    db->set_interruption_handler(std::move(handler), instruction_interval);
+
+    return result;
+}
+}  // namespace yas::db
+
 db::update_result_t db::begin_transaction(db::database_ptr const &db) {
     return db->execute_update("BEGIN EXCLUSIVE TRANSACTION");
 }
@@ -55,7 +71,7 @@ db::update_result_t db::commit(db::database_ptr const &db) {
 }
 
 db::update_result_t db::rollback(db::database_ptr const &db) {
-    return db->execute_update("ROLLBACK TRANSACTION");
+    return db::execute_update_without_interruption(db, "ROLLBACK TRANSACTION");
 }
 
 #if SQLITE_VERSION_NUMBER >= 3007000
@@ -84,7 +100,8 @@ db::update_result_t db::rollback_save_point(db::database_ptr const &db, std::str
     if (name.size() == 0) {
         return db::update_result_t{db::error{db::error_type::invalid_argument}};
     }
-    return db->execute_update("ROLLBACK TRANSACTION TO SAVEPOINT '" + escape_save_point_name(name) + "';");
+    return db::execute_update_without_interruption(
+        db, "ROLLBACK TRANSACTION TO SAVEPOINT '" + escape_save_point_name(name) + "';");
 }
 
 db::update_result_t db::in_save_point(db::database_ptr const &db, std::function<void(bool &rollback)> const function) {
@@ -168,29 +185,62 @@ bool db::column_exists(db::database_ptr const &db, std::string column_name, std:
 }
 
 db::select_result_t db::select(db::database_ptr const &db, db::select_option const &option) {
+    db::value_map_vector_t value_map_vector;
+
+    if (auto result = db::select_each(db, option, [&value_map_vector](db::row_set &row_set) {
+            value_map_vector.emplace_back(row_set.values());
+            return true;
+        });
+        !result) {
+        return db::select_result_t{std::move(result.error())};
+    }
+
+    return db::select_result_t{std::move(value_map_vector)};
+}
+
+db::select_each_result_t db::select_each(db::database_ptr const &db, db::select_option const &option,
+                                         db::row_handler_f const &handler) {
     std::string const sql = db::select_sql(option) + ";";
 
-    db::value_map_vector_t value_map_vector;
+    std::size_t count = 0;
 
     if (db::query_result_t result = db->execute_query(sql, option.arguments)) {
-        auto row_set = result.value();
-        while (row_set->next()) {
-            value_map_vector.emplace_back(row_set->values());
+        auto &row_set = result.value();
+        while (true) {
+            db::next_result_code const next_result = row_set->next();
+            if (!next_result) {
+                // SQLITE_DONE以外で終わったら、中断やエラーで途中までしか取得できていない
+                if (next_result.raw_value() != SQLITE_DONE) {
+                    return db::select_each_result_t{
+                        db::error{db::error_type::sqlite, next_result.raw_value(), db->last_error_message()}};
+                }
+                break;
+            }
+
+            ++count;
+            if (!handler(*row_set)) {
+                break;
+            }
         }
     } else {
-        return db::select_result_t{std::move(result.error())};
+        return db::select_each_result_t{std::move(result.error())};
     }
 
-    return db::select_result_t{value_map_vector};
+    return db::select_each_result_t{count};
 }
 
 db::select_single_result_t db::select_single(db::database_ptr const &db, db::select_option option) {
     option.limit_range = {.location = 0, .length = 1};
 
-    if (db::select_result_t result = db::select(db, option)) {
-        if (result.value().size() > 0) {
-            return db::select_single_result_t{std::move(result.value().at(0))};
-        }
+    std::optional<db::value_map_t> values = std::nullopt;
+
+    db::select_each_result_t const result = db::select_each(db, option, [&values](db::row_set &row_set) {
+        values = row_set.values();
+        return false;
+    });
+
+    if (result && values) {
+        return db::select_single_result_t{std::move(*values)};
     }
 
     return db::select_single_result_t{nullptr};
@@ -15,6 +15,8 @@ class select_option;
 
 using select_result_t = result<db::value_map_vector_t, db::error>;
 using select_single_result_t = result<db::value_map_t, std::nullptr_t>;
+using select_each_result_t = result<std::size_t, db::error>;
+using row_handler_f = std::function<bool(db::row_set &)>;
 
 db::update_result_t create_table(db::database_ptr const &db, std::string const &table_name,
                                  std::vector<std::string> const &fields);
@@ -47,6 +49,11 @@ db::update_result_t in_save_point(db::database_ptr const &db, std::function<void
 
 [[nodiscard]] db::select_result_t select(db::database_ptr const &db, db::select_option const &option);
 
+// 結果をまとめずに1行ずつhandlerに渡す。handlerがfalseを返したらそこで終了する。成功すればhandlerに渡した行数を返す
+// 中断などでSQLITE_DONEまで読めなければエラーを返す
+db::select_each_result_t select_each(db::database_ptr const &db, db::select_option const &option,
+                                     db::row_handler_f const &handler);
+
 [[nodiscard]] db::select_single_result_t select_single(db::database_ptr const &db, db::select_option option);
 
 [[nodiscard]] db::value max(db::database_ptr const &db, std::string const &table_name, std::string const &field);
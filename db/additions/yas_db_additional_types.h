@@ -5,10 +5,15 @@
 #pragma once
 
 #include <cpp_utils/yas_version.h>
+#include <db/yas_db_busy_retry.h>
 #include <db/yas_db_object_id.h>
+#include <db/yas_db_open_option.h>
+#include <db/yas_db_query_plan.h>
+#include <db/yas_db_statement_cache.h>
 #include <db/yas_db_value.h>
 #include <db/yas_db_weak_pool.h>
 
+#include <optional>
 #include <set>
 #include <unordered_set>
 
@@ -67,6 +72,7 @@ static std::string const version_field = "version";
 static std::string const current_save_id_field = "cur_save_id";
 static std::string const last_save_id_field = "last_save_id";
 
+using object_data_result_t = result<db::object_data, db::error>;
 using object_data_vector_result_t = result<db::object_data_vector_t, db::error>;
 using value_vector_result_t = result<std::vector<db::value>, db::error>;
 using value_vector_map_result_t = result<db::value_vector_map_t, db::error>;
@@ -78,6 +84,8 @@ using manager_const_vector_result_t = result<db::const_object_vector_map_t, db::
 using manager_const_map_result_t = result<db::const_object_map_map_t, db::manager_error>;
 using manager_info_result_t = result<db::info, db::manager_error>;
 using manager_fetch_result_t = result<db::object_data_vector_map_t, db::manager_error>;
+using query_plan_map_t = std::unordered_map<std::string, db::query_plan>;
+using manager_query_plan_result_t = result<db::query_plan_map_t, db::manager_error>;
 
 using cancellation_f = std::function<bool(void)>;
 using execution_f = std::function<void(task<std::nullptr_t> const &)>;
@@ -101,12 +109,38 @@ using const_map_completion_f = std::function<void(db::manager_const_map_result_t
 
 static std::function<bool(void)> const no_cancellation = []() { return false; };
 
+struct connection_option final {
+    // trueならタスクの実行後もデータベースを閉じずに開いたままにする
+    // メモリ上のデータベースでは常にtrueになり、idle_timeoutとreader_countは0になる
+    bool persistent = false;
+    // persistentの場合に、タスクの実行がこの秒数なければデータベースを閉じる。0以下なら自動では閉じない
+    double idle_timeout = 0.0;
+    // データベースを開いた時に適用するpragmaの設定
+    db::open_option open_option;
+    // フェッチに使う読み込み専用の接続の数。1以上ならjournal_modeはWALになる
+    std::size_t reader_count = 0;
+    // 接続ごとにキャッシュするステートメントの数。0ならキャッシュしない
+    std::size_t statement_cache_capacity = db::default_statement_cache_capacity;
+    // ロックされていた場合に再試行するまでの待ち時間の設定
+    db::busy_retry_policy busy_retry_policy;
+    // 設定されていれば、フェッチの条件の形ごとに初回だけクエリプランを調べて、全件走査か一時的なB-Treeがあれば呼ばれる
+    // インデックスの不足を見つけるためのデバッグ用
+    db::query_plan_warning_f query_plan_warning_handler = nullptr;
+};
+
 // for attribute
 static std::string const pk_id_field = "pk_id";
 static std::string const object_id_field = "obj_id";
 static std::string const save_id_field = "save_id";
 static std::string const action_field = "action";
 
+// for head
+static std::string const removed_field = "removed";
+
+// for delta
+// デルタのデータで保存したアトリビュートの名前を,で繋げたもの。NULLなら全てのアトリビュートを保存したデータ
+static std::string const changed_field = "changed";
+
 static std::string const insert_action = "insert";
 static std::string const update_action = "update";
 static std::string const remove_action = "remove";
@@ -133,16 +167,43 @@ using attribute_args_vector_t = std::vector<attribute_args>;
 static std::string const src_pk_id_field = "src_pk_id";
 static std::string const src_obj_id_field = "src_obj_id";
 static std::string const tgt_obj_id_field = "tgt_obj_id";
+static std::string const position_field = "position";
+static std::string const tgt_obj_ids_field = "tgt_obj_ids";
+
+enum class relation_encoding {
+    // 関連先1つごとに1行を保存する
+    rows,
+    // 関連先のidの配列を、ソースのデータごとに1つのBLOBに詰めて1行で保存する
+    // 関連先のidで検索できないので、関連先のオブジェクトをremoveしたセーブのたびに、
+    // この関連の全てのオブジェクトの最後の関連のBLOBを読む。関連の総数が多くremoveも多いなら使わない
+    packed,
+};
 
 struct relation_args final {
     std::string name;
     std::string target;
     bool const many = false;
+    // テーブルを作成する時にだけ使われ、既存のテーブルは変更しない
+    db::relation_encoding const encoding = db::relation_encoding::rows;
 };
 
 using relation_args_vector_t = std::vector<relation_args>;
 
 // for entity
+enum class table_layout {
+    // pk_idをrowidにした通常のテーブル。データは挿入した順に並ぶ
+    rowid,
+    // WITHOUT ROWIDのテーブル。エンティティはobj_idとsave_id、関連はsrc_pk_idとpositionの順に並ぶ
+    clustered,
+};
+
+enum class version_rows {
+    // セーブごとに全てのアトリビュートを保存する
+    full,
+    // セーブごとに変更のあったアトリビュートだけを保存する。ヘッドにはカレントの全てのアトリビュートを持つ
+    delta,
+};
+
 using attribute_map_t = std::unordered_map<std::string, db::attribute>;
 using relation_map_t = std::unordered_map<std::string, db::relation>;
 using string_set_t = std::unordered_set<std::string>;
@@ -152,6 +213,10 @@ struct entity_args final {
     std::string name;
     db::attribute_args_vector_t attributes;
     db::relation_args_vector_t relations;
+    // 指定しなければmodel_argsのlayoutになる
+    std::optional<db::table_layout> layout = std::nullopt;
+    // deltaからfullに戻したら、セットアップの時に全てのアトリビュートを保存していないデータを前のデータから埋める
+    db::version_rows version_rows = db::version_rows::full;
 };
 
 using entity_args_vector_t = std::vector<entity_args>;
@@ -174,5 +239,9 @@ struct model_args final {
     yas::version version;
     std::vector<db::entity_args> entities;
     std::vector<db::index_args> indices;
+    // マネージャが使うクエリのためのインデックスを自動で作成する
+    bool auto_indices = true;
+    // エンティティと関連のテーブルの並び。テーブルを作成する時にだけ使われ、既存のテーブルは変更しない
+    db::table_layout layout = db::table_layout::rowid;
 };
 }  // namespace yas::db
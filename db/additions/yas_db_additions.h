@@ -6,6 +6,7 @@
 
 #include <db/yas_db_attribute.h>
 #include <db/yas_db_cf_utils.h>
+#include <db/yas_db_column_batch.h>
 #include <db/yas_db_entity.h>
 #include <db/yas_db_index.h>
 #include <db/yas_db_info.h>
@@ -15,6 +16,8 @@
 #include <db/yas_db_object.h>
 #include <db/yas_db_object_id.h>
 #include <db/yas_db_object_utils.h>
+#include <db/yas_db_query_plan.h>
+#include <db/yas_db_reader_pool.h>
 #include <db/yas_db_relation.h>
 #include <db/yas_db_sql_utils.h>
 #include <db/yas_db_utils.h>
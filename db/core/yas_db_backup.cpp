@@ -0,0 +1,91 @@
+//
+//  yas_db_backup.cpp
+//
+
+#include "yas_db_backup.h"
+
+#include "yas_db_error.h"
+
+using namespace yas;
+using namespace yas::db;
+
+#pragma mark - backup_progress
+
+bool backup_progress::is_done() const {
+    return this->remaining == 0;
+}
+
+#pragma mark - backup
+
+backup::backup(std::filesystem::path const &destination_path, sqlite3 *const destination,
+               sqlite3_backup *const backup)
+    : _destination_path(destination_path), _destination(destination), _backup(backup) {
+}
+
+backup::~backup() {
+    this->close();
+}
+
+uintptr_t backup::identifier() const {
+    return reinterpret_cast<uintptr_t>(this);
+}
+
+std::filesystem::path const &backup::destination_path() const {
+    return this->_destination_path;
+}
+
+bool backup::is_closed() const {
+    return this->_backup == nullptr;
+}
+
+bool backup::is_done() const {
+    return this->_is_done;
+}
+
+db::backup_progress backup::progress() const {
+    if (!this->_backup) {
+        return db::backup_progress{};
+    }
+    return db::backup_progress{.remaining = sqlite3_backup_remaining(this->_backup),
+                               .page_count = sqlite3_backup_pagecount(this->_backup)};
+}
+
+db::backup_step_result_t backup::step(int const pages) {
+    if (this->is_closed()) {
+        return db::backup_step_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (this->_is_done) {
+        return db::backup_step_result_t{this->progress()};
+    }
+
+    int const result_code = sqlite3_backup_step(this->_backup, pages);
+
+    switch (result_code) {
+        case SQLITE_DONE:
+            this->_is_done = true;
+            return db::backup_step_result_t{this->progress()};
+        case SQLITE_OK:
+            return db::backup_step_result_t{this->progress()};
+        default:
+            return db::backup_step_result_t{
+                db::error{db::error_type::sqlite, result_code, sqlite3_errmsg(this->_destination)}};
+    }
+}
+
+void backup::close() {
+    if (this->_backup) {
+        sqlite3_backup_finish(this->_backup);
+        this->_backup = nullptr;
+    }
+
+    if (this->_destination) {
+        sqlite3_close(this->_destination);
+        this->_destination = nullptr;
+    }
+}
+
+backup_ptr backup::make_shared(std::filesystem::path const &destination_path, sqlite3 *const destination,
+                               sqlite3_backup *const backup) {
+    return backup_ptr(new db::backup{destination_path, destination, backup});
+}
@@ -0,0 +1,62 @@
+//
+//  yas_db_backup.h
+//
+
+#pragma once
+
+#include <db/yas_db_protocol.h>
+#include <db/yas_db_ptr.h>
+#include <db/yas_db_types.h>
+#include <sqlite3.h>
+
+#include <filesystem>
+#include <functional>
+
+namespace yas::db {
+static int const default_backup_pages_per_step = 100;
+
+struct backup_progress final {
+    int remaining = 0;
+    int page_count = 0;
+
+    [[nodiscard]] bool is_done() const;
+};
+
+using backup_step_result_t = result<db::backup_progress, db::error>;
+// falseを返したらバックアップを中止する
+using backup_progress_f = std::function<bool(db::backup_progress const &)>;
+
+// sqlite3_backupでコピー元の接続から別のファイルへ少しずつページをコピーする
+// コピー元の接続を通した変更はコピー先にも反映されるので、ステップの合間に書き込んでも最初からやり直しにはならない
+struct backup final : closable {
+    ~backup();
+
+    [[nodiscard]] uintptr_t identifier() const;
+    [[nodiscard]] std::filesystem::path const &destination_path() const;
+    [[nodiscard]] bool is_closed() const;
+    [[nodiscard]] bool is_done() const;
+    [[nodiscard]] db::backup_progress progress() const;
+
+    // pagesのページ数だけコピーする。負の値なら残り全てをコピーする
+    // ロックが取れなかった場合はSQLITE_BUSYかSQLITE_LOCKEDのエラーを返すので、後でもう一度呼べば良い
+    db::backup_step_result_t step(int const pages);
+
+    [[nodiscard]] static backup_ptr make_shared(std::filesystem::path const &destination_path,
+                                                sqlite3 *const destination, sqlite3_backup *const);
+
+   private:
+    std::filesystem::path const _destination_path;
+    sqlite3 *_destination;
+    sqlite3_backup *_backup;
+    bool _is_done = false;
+
+    backup(std::filesystem::path const &destination_path, sqlite3 *const destination, sqlite3_backup *const);
+
+    backup(backup const &) = delete;
+    backup(backup &&) = delete;
+    backup &operator=(backup const &) = delete;
+    backup &operator=(backup &&) = delete;
+
+    void close() override;
+};
+}  // namespace yas::db
@@ -0,0 +1,147 @@
+//
+//  yas_db_blob_stream.cpp
+//
+
+#include "yas_db_blob_stream.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "yas_db_error.h"
+
+using namespace yas;
+using namespace yas::db;
+
+blob_stream::blob_stream(sqlite3 *const sqlite_handle, sqlite3_blob *const blob, db::blob_open_mode const mode)
+    : _sqlite_handle(sqlite_handle), _blob(blob), _mode(mode) {
+}
+
+blob_stream::~blob_stream() {
+    this->close();
+}
+
+uintptr_t blob_stream::identifier() const {
+    return reinterpret_cast<uintptr_t>(this);
+}
+
+bool blob_stream::is_closed() const {
+    return this->_blob == nullptr;
+}
+
+db::blob_open_mode blob_stream::mode() const {
+    return this->_mode;
+}
+
+std::size_t blob_stream::size() const {
+    if (!this->_blob) {
+        return 0;
+    }
+    return static_cast<std::size_t>(sqlite3_blob_bytes(this->_blob));
+}
+
+db::blob_read_result_t blob_stream::read(std::size_t const offset, std::span<std::byte> const buffer) const {
+    if (this->is_closed()) {
+        return db::blob_read_result_t{db::error{db::error_type::closed}};
+    }
+
+    std::size_t const size = this->size();
+
+    if (offset > size) {
+        return db::blob_read_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    std::size_t const length = std::min(buffer.size(), size - offset);
+
+    if (length == 0) {
+        return db::blob_read_result_t{std::size_t{0}};
+    }
+
+    int const result_code =
+        sqlite3_blob_read(this->_blob, buffer.data(), static_cast<int>(length), static_cast<int>(offset));
+
+    if (result_code != SQLITE_OK) {
+        return db::blob_read_result_t{this->_error(result_code)};
+    }
+
+    return db::blob_read_result_t{length};
+}
+
+db::blob_read_result_t blob_stream::read_chunks(std::size_t const chunk_size,
+                                                db::blob_chunk_handler_f const &handler) const {
+    if (this->is_closed()) {
+        return db::blob_read_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (chunk_size == 0) {
+        return db::blob_read_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    std::vector<std::byte> buffer(std::min(chunk_size, this->size()));
+    std::size_t offset = 0;
+
+    while (offset < this->size()) {
+        auto read_result = this->read(offset, buffer);
+        if (!read_result) {
+            return read_result;
+        }
+
+        std::size_t const length = read_result.value();
+        offset += length;
+
+        if (!handler(std::span<std::byte const>{buffer.data(), length})) {
+            break;
+        }
+    }
+
+    return db::blob_read_result_t{offset};
+}
+
+db::update_result_t blob_stream::write(std::size_t const offset, std::span<std::byte const> const data) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (this->_mode != db::blob_open_mode::read_write || offset + data.size() > this->size()) {
+        return db::update_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    int const result_code =
+        sqlite3_blob_write(this->_blob, data.data(), static_cast<int>(data.size()), static_cast<int>(offset));
+
+    if (result_code != SQLITE_OK) {
+        return db::update_result_t{this->_error(result_code)};
+    }
+
+    return db::update_result_t{nullptr};
+}
+
+db::update_result_t blob_stream::reopen(sqlite3_int64 const rowid) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+
+    int const result_code = sqlite3_blob_reopen(this->_blob, rowid);
+
+    if (result_code != SQLITE_OK) {
+        return db::update_result_t{this->_error(result_code)};
+    }
+
+    return db::update_result_t{nullptr};
+}
+
+blob_stream_ptr blob_stream::make_shared(sqlite3 *const sqlite_handle, sqlite3_blob *const blob,
+                                         db::blob_open_mode const mode) {
+    return blob_stream_ptr(new blob_stream{sqlite_handle, blob, mode});
+}
+
+db::error blob_stream::_error(int const result_code) const {
+    return db::error{db::error_type::sqlite, result_code, sqlite3_errmsg(this->_sqlite_handle)};
+}
+
+void blob_stream::close() {
+    if (this->_blob) {
+        sqlite3_blob_close(this->_blob);
+        this->_blob = nullptr;
+    }
+    this->_sqlite_handle = nullptr;
+}
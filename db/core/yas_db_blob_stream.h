@@ -0,0 +1,64 @@
+//
+//  yas_db_blob_stream.h
+//
+
+#pragma once
+
+#include <db/yas_db_protocol.h>
+#include <db/yas_db_ptr.h>
+#include <db/yas_db_types.h>
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <functional>
+#include <span>
+
+namespace yas::db {
+enum class blob_open_mode {
+    read_only,
+    read_write,
+};
+
+using blob_read_result_t = result<std::size_t, db::error>;
+using blob_chunk_handler_f = std::function<bool(std::span<std::byte const> const)>;
+
+static std::size_t const default_blob_chunk_size = 64 * 1024;
+
+// sqlite3_blobで1つのセルのBLOBを、全体をメモリに読み込まずに位置を指定して読み書きする
+// 書き込みでBLOBのサイズは変えられないので、先にzeroblob()などで必要なサイズを確保しておく
+struct blob_stream final : closable {
+    ~blob_stream();
+
+    [[nodiscard]] uintptr_t identifier() const;
+    [[nodiscard]] bool is_closed() const;
+    [[nodiscard]] db::blob_open_mode mode() const;
+    [[nodiscard]] std::size_t size() const;
+
+    // offsetからbufferのサイズ分を読み込む。末尾を越える分は読まずに、読み込んだサイズを返す
+    db::blob_read_result_t read(std::size_t const offset, std::span<std::byte> const buffer) const;
+    // 先頭からchunk_sizeずつ読み込んでhandlerに渡す。handlerがfalseを返したらそこで終了する。読み込んだサイズを返す
+    db::blob_read_result_t read_chunks(std::size_t const chunk_size, db::blob_chunk_handler_f const &handler) const;
+    db::update_result_t write(std::size_t const offset, std::span<std::byte const> const data);
+
+    // 同じテーブルとカラムの別の行を開き直す
+    db::update_result_t reopen(sqlite3_int64 const rowid);
+
+    [[nodiscard]] static blob_stream_ptr make_shared(sqlite3 *const, sqlite3_blob *const, db::blob_open_mode const);
+
+   private:
+    sqlite3 *_sqlite_handle;
+    sqlite3_blob *_blob;
+    db::blob_open_mode const _mode;
+
+    blob_stream(sqlite3 *const, sqlite3_blob *const, db::blob_open_mode const);
+
+    blob_stream(blob_stream const &) = delete;
+    blob_stream(blob_stream &&) = delete;
+    blob_stream &operator=(blob_stream const &) = delete;
+    blob_stream &operator=(blob_stream &&) = delete;
+
+    db::error _error(int const result_code) const;
+
+    void close() override;
+};
+}  // namespace yas::db
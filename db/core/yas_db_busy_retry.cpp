@@ -0,0 +1,21 @@
+//
+//  yas_db_busy_retry.cpp
+//
+
+#include "yas_db_busy_retry.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace yas;
+using namespace yas::db;
+
+std::chrono::microseconds busy_retry_policy::delay(int const retry_count, double const random) const {
+    double const initial = static_cast<double>(this->initial_delay.count());
+    double const max = static_cast<double>(this->max_delay.count());
+
+    double const base = std::min(initial * std::pow(std::max(this->multiplier, 1.0), retry_count), max);
+    double const jitter = std::clamp(this->jitter, 0.0, 1.0);
+
+    return std::chrono::microseconds{static_cast<std::chrono::microseconds::rep>(base * (1.0 - jitter * random))};
+}
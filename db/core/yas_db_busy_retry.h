@@ -0,0 +1,29 @@
+//
+//  yas_db_busy_retry.h
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace yas::db {
+struct busy_retry_policy final {
+    std::chrono::microseconds initial_delay{100};
+    std::chrono::microseconds max_delay{50000};
+    double multiplier = 2.0;
+    // 待ち時間を最大でこの割合だけランダムに短くする（0.0〜1.0）
+    double jitter = 0.5;
+
+    // randomは0.0以上1.0未満
+    [[nodiscard]] std::chrono::microseconds delay(int const retry_count, double const random) const;
+};
+
+struct busy_retry_stats final {
+    std::size_t busy_count = 0;
+    std::size_t retry_count = 0;
+    std::size_t timeout_count = 0;
+    std::chrono::microseconds total_wait{0};
+    std::chrono::microseconds max_wait{0};
+};
+}  // namespace yas::db
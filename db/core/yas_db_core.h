@@ -4,7 +4,15 @@
 
 #pragma once
 
+#include <db/yas_db_backup.h>
+#include <db/yas_db_blob_stream.h>
+#include <db/yas_db_busy_retry.h>
 #include <db/yas_db_database.h>
+#include <db/yas_db_function.h>
+#include <db/yas_db_open_option.h>
+#include <db/yas_db_prepared_statement.h>
+#include <db/yas_db_query_profiler.h>
 #include <db/yas_db_row_set.h>
 #include <db/yas_db_statement.h>
+#include <db/yas_db_statement_cache.h>
 #include <db/yas_db_value.h>
@@ -8,9 +8,12 @@
 #include <cpp_utils/yas_result.h>
 #include <cpp_utils/yas_stl_utils.h>
 
+#include <algorithm>
 #include <mutex>
+#include <thread>
 
 #include "yas_db_error.h"
+#include "yas_db_prepared_statement.h"
 #include "yas_db_row_set.h"
 #include "yas_db_statement.h"
 #include "yas_db_value.h"
@@ -19,7 +22,9 @@ using namespace yas;
 using namespace yas::db;
 
 namespace yas::db {
-static std::map<uint8_t, database_wptr> _databases;
+static std::string quote_schema_name(std::string const &schema) {
+    return "\"" + replaced(schema, "\"", "\"\"") + "\"";
+}
 
 static void bind(db::value const &value, int column_idx, sqlite3_stmt *stmt) {
     std::type_info const &type = value.type();
@@ -43,6 +48,32 @@ static void bind(db::value const &value, int column_idx, sqlite3_stmt *stmt) {
 }
 }  // namespace yas::db
 
+#pragma mark - in memory
+
+std::filesystem::path db::shared_memory_path(std::string const &name) {
+    return "file:" + name + "?mode=memory&cache=shared";
+}
+
+bool db::is_in_memory_path(std::filesystem::path const &path) {
+    std::string const string = path.string();
+
+    if (string == db::in_memory_path) {
+        return true;
+    }
+
+    if (string.starts_with("file:")) {
+        return string.starts_with("file::memory:") || string.find("mode=memory") != std::string::npos;
+    }
+
+    return false;
+}
+
+#pragma mark - batch_update_summary
+
+bool batch_update_summary::has_row_errors() const {
+    return !this->row_errors.empty();
+}
+
 #pragma mark - database
 
 std::string database::sqlite_lib_version() {
@@ -53,13 +84,12 @@ bool database::sqlite_thread_safe() {
     return sqlite3_threadsafe() != 0;
 }
 
-database::database(std::string const &path) : _database_path(path) {
+database::database(std::string const &path, db::open_option &&open_option)
+    : _database_path(path), _open_option(std::move(open_option)) {
 }
 
 database::~database() {
     this->close();
-
-    db::_databases.erase(this->_db_key);
 }
 
 std::filesystem::path const &database::database_path() const {
@@ -70,12 +100,72 @@ sqlite3 *database::sqlite_handle() const {
     return this->_sqlite_handle;
 }
 
+db::open_option const &database::open_option() const {
+    return this->_open_option;
+}
+
+db::open_option database::effective_open_option() const {
+    auto pragma_value = [this](std::string const &name) -> db::value {
+        if (auto query_result = this->execute_query("PRAGMA " + name + ";")) {
+            auto const &row_set = query_result.value();
+            if (row_set->next()) {
+                return row_set->column_value(0);
+            }
+        }
+        return db::null_value();
+    };
+
+    db::open_option option;
+
+    if (db::value const value = pragma_value("page_size")) {
+        option.page_size = value.get<db::integer>();
+    }
+
+    if (db::value const value = pragma_value("locking_mode")) {
+        option.locking_mode = db::to_locking_mode(value.get<db::text>());
+    }
+
+    if (db::value const value = pragma_value("journal_mode")) {
+        option.journal_mode = db::to_journal_mode(value.get<db::text>());
+    }
+
+    if (db::value const value = pragma_value("synchronous")) {
+        db::integer::type const raw_value = value.get<db::integer>();
+        if (0 <= raw_value && raw_value <= static_cast<db::integer::type>(db::synchronous::extra)) {
+            option.synchronous = static_cast<db::synchronous>(raw_value);
+        }
+    }
+
+    if (db::value const value = pragma_value("cache_size")) {
+        option.cache_size = value.get<db::integer>();
+    }
+
+    if (db::value const value = pragma_value("mmap_size")) {
+        option.mmap_size = value.get<db::integer>();
+    }
+
+    if (db::value const value = pragma_value("temp_store")) {
+        db::integer::type const raw_value = value.get<db::integer>();
+        if (0 <= raw_value && raw_value <= static_cast<db::integer::type>(db::temp_store::memory)) {
+            option.temp_store = static_cast<db::temp_store>(raw_value);
+        }
+    }
+
+    return option;
+}
+
+bool database::is_in_memory() const {
+    return db::is_in_memory_path(this->_database_path);
+}
+
+// shared_memory_path()のようなURIも開けるようにする。file:で始まらないパスの扱いはsqlite3_openと変わらない
 bool database::open() {
     if (this->_sqlite_handle) {
         return true;
     }
 
-    int err = sqlite3_open(this->_database_path.c_str(), &this->_sqlite_handle);
+    int err = sqlite3_open_v2(this->_database_path.c_str(), &this->_sqlite_handle,
+                              SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, NULL);
     if (err != SQLITE_OK) {
         return false;
     }
@@ -86,6 +176,17 @@ bool database::open() {
         this->set_max_busy_retry_time_interval(this->_max_busy_retry_time_interval);
     }
 
+    this->_install_progress_handler();
+    this->_install_trace();
+    this->_install_functions();
+
+    if (!this->_apply_open_option()) {
+        this->close();
+        return false;
+    }
+
+    this->_attach_databases();
+
     return true;
 }
 
@@ -95,7 +196,7 @@ bool database::open(int flags) {
         return true;
     }
 
-    int err = sqlite3_open_v2(this->_database_path.c_str(), &this->_sqlite_handle, flags, NULL);
+    int err = sqlite3_open_v2(this->_database_path.c_str(), &this->_sqlite_handle, flags | SQLITE_OPEN_URI, NULL);
     if (err != SQLITE_OK) {
         return false;
     }
@@ -104,6 +205,17 @@ bool database::open(int flags) {
         this->set_max_busy_retry_time_interval(this->_max_busy_retry_time_interval);
     }
 
+    this->_install_progress_handler();
+    this->_install_trace();
+    this->_install_functions();
+
+    if (!this->_apply_open_option()) {
+        this->close();
+        return false;
+    }
+
+    this->_attach_databases();
+
     return true;
 }
 #endif
@@ -111,6 +223,9 @@ bool database::open(int flags) {
 void database::close() {
     this->clear_cached_statements();
     this->close_opened_row_sets();
+    this->close_prepared_statements();
+    this->close_backups();
+    this->close_blob_streams();
 
     if (!this->_sqlite_handle) {
         return;
@@ -188,6 +303,60 @@ db::update_result_t database::execute_update(std::string const &sql,
     return this->_execute_update(sql, {}, arguments);
 }
 
+db::batch_update_result_t database::execute_update_batch(std::string const &sql,
+                                                         std::span<db::value_vector_t const> const rows) {
+    return this->_execute_update_batch(sql, rows.size(), [&rows](std::size_t const row_idx, sqlite3_stmt *const stmt) {
+        db::value_vector_t const &row = rows[row_idx];
+
+        if (static_cast<int>(row.size()) != sqlite3_bind_parameter_count(stmt)) {
+            return false;
+        }
+
+        int idx = 0;
+        for (db::value const &value : row) {
+            ++idx;
+            db::bind(value, idx, stmt);
+        }
+
+        return true;
+    });
+}
+
+db::batch_update_result_t database::execute_update_batch(std::string const &sql,
+                                                         std::span<db::value_map_t const> const rows) {
+    // パラメータの名前は最初の行を処理する時に一度だけ取得する
+    std::vector<std::string> names;
+
+    return this->_execute_update_batch(
+        sql, rows.size(), [&rows, &names](std::size_t const row_idx, sqlite3_stmt *const stmt) {
+            int const query_count = sqlite3_bind_parameter_count(stmt);
+
+            if (names.empty() && query_count > 0) {
+                names.reserve(query_count);
+                for (int idx = 1; idx <= query_count; ++idx) {
+                    char const *const name = sqlite3_bind_parameter_name(stmt, idx);
+                    names.emplace_back(name ? name + 1 : "");
+                }
+            }
+
+            db::value_map_t const &row = rows[row_idx];
+
+            if (static_cast<int>(row.size()) != query_count) {
+                return false;
+            }
+
+            for (int idx = 1; idx <= query_count; ++idx) {
+                auto const it = row.find(names.at(idx - 1));
+                if (it == row.end()) {
+                    return false;
+                }
+                db::bind(it->second, idx, stmt);
+            }
+
+            return true;
+        });
+}
+
 db::update_result_t database::execute_statements(std::string const &sql) {
     return this->_execute_statements(sql, nullptr);
 }
@@ -212,13 +381,227 @@ db::query_result_t database::execute_query(std::string const &sql, value_map_t c
     return this->_execute_query(sql, {}, arguments);
 }
 
+db::prepared_statement_result_t database::prepare(std::string const &sql) {
+    if (!this->_database_exists()) {
+        return db::prepared_statement_result_t{db::error{db::error_type::closed}};
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    db::sqlite_result_code const result_code = this->_prepare_statement(sql, &stmt);
+
+    if (!result_code) {
+        db::prepared_statement_result_t result{db::error{db::error_type::sqlite, result_code, last_error_message()}};
+        sqlite3_finalize(stmt);
+        return result;
+    }
+
+    auto statement = db::statement::make_shared();
+    statement->set_stmt(stmt);
+    statement->set_query(sql);
+
+    auto prepared = db::prepared_statement::make_shared(sql, statement);
+
+    std::erase_if(this->_prepared_statements, [](auto const &pair) { return pair.second.expired(); });
+    this->_prepared_statements.emplace(prepared->identifier(), prepared);
+
+    return db::prepared_statement_result_t{std::move(prepared)};
+}
+
+db::update_result_t database::execute_update(db::prepared_statement_ptr const &prepared) {
+    if (!this->_database_exists() || prepared->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (prepared->statement()->in_use() || this->_is_executing_statement.exchange(true)) {
+        return db::update_result_t{db::error{db::error_type::in_use}};
+    }
+
+    sqlite3_stmt *const stmt = prepared->statement()->stmt();
+    std::string error_message;
+
+    db::sqlite_result_code result_code = sqlite3_step(stmt);
+
+    if (!result_code) {
+        error_message = this->last_error_message();
+    }
+
+    if (result_code.raw_value() == SQLITE_ROW) {
+        sqlite3_reset(stmt);
+        this->_is_executing_statement = false;
+        throw std::runtime_error(std::string(__PRETTY_FUNCTION__) +
+                                 " : execute_update is being called with a query string '" + prepared->sql() + "'.");
+    }
+
+    db::sqlite_result_code const reset_result_code = sqlite3_reset(stmt);
+
+    if (!reset_result_code && result_code) {
+        result_code = reset_result_code;
+        error_message = this->last_error_message();
+    }
+
+    this->_is_executing_statement = false;
+
+    if (result_code) {
+        return db::update_result_t{nullptr};
+    } else {
+        return db::update_result_t{db::error{db::error_type::sqlite, result_code, error_message}};
+    }
+}
+
+db::query_result_t database::execute_query(db::prepared_statement_ptr const &prepared) const {
+    if (!this->_database_exists() || prepared->is_closed()) {
+        return db::query_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (this->_is_executing_statement || prepared->statement()->in_use()) {
+        return db::query_result_t{db::error{db::error_type::in_use}};
+    }
+
+    sqlite3_reset(prepared->statement()->stmt());
+
+    auto row_set = db::row_set::make_shared(prepared->statement(), this->_weak_database.lock(), {});
+
+    this->_opened_row_sets.insert(std::make_pair(row_set->identifier(), row_set));
+
+    return db::query_result_t{std::move(row_set)};
+}
+
+db::backup_result_t database::make_backup(std::filesystem::path const &path) {
+    if (!this->_database_exists()) {
+        return db::backup_result_t{db::error{db::error_type::closed}};
+    }
+
+    sqlite3 *destination = nullptr;
+    int const open_result = sqlite3_open_v2(path.c_str(), &destination,
+                                            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
+
+    if (open_result != SQLITE_OK) {
+        db::backup_result_t result{db::error{db::error_type::sqlite, open_result,
+                                             destination ? sqlite3_errmsg(destination) : ""}};
+        sqlite3_close(destination);
+        return result;
+    }
+
+    sqlite3_backup *const backup = sqlite3_backup_init(destination, "main", this->_sqlite_handle, "main");
+
+    if (!backup) {
+        db::backup_result_t result{
+            db::error{db::error_type::sqlite, sqlite3_errcode(destination), sqlite3_errmsg(destination)}};
+        sqlite3_close(destination);
+        return result;
+    }
+
+    auto backup_ptr = db::backup::make_shared(path, destination, backup);
+
+    std::erase_if(this->_backups, [](auto const &pair) { return pair.second.expired(); });
+    this->_backups.emplace(backup_ptr->identifier(), backup_ptr);
+
+    return db::backup_result_t{std::move(backup_ptr)};
+}
+
+db::update_result_t database::backup_to(std::filesystem::path const &path, int const pages_per_step,
+                                        db::backup_progress_f const &progress) {
+    auto backup_result = this->make_backup(path);
+    if (!backup_result) {
+        return db::update_result_t{std::move(backup_result.error())};
+    }
+
+    db::backup_ptr const &backup = backup_result.value();
+    int busy_retry_count = 0;
+
+    while (true) {
+        auto step_result = backup->step(pages_per_step);
+
+        if (!step_result) {
+            // ロックが取れなかったら待ってから同じステップをやり直す
+            int const code = step_result.error().code().raw_value();
+            if ((code == SQLITE_BUSY || code == SQLITE_LOCKED) && this->_retry_if_busy(busy_retry_count++)) {
+                continue;
+            }
+            return db::update_result_t{std::move(step_result.error())};
+        }
+
+        busy_retry_count = 0;
+
+        if (progress && !progress(step_result.value())) {
+            return db::update_result_t{db::error{db::error_type::sqlite, SQLITE_INTERRUPT, "backup was canceled."}};
+        }
+
+        if (backup->is_done()) {
+            return db::update_result_t{nullptr};
+        }
+    }
+}
+
+db::blob_stream_result_t database::open_blob(std::string const &table, std::string const &column,
+                                            sqlite3_int64 const rowid, db::blob_open_mode const mode,
+                                            std::string const &schema) {
+    if (!this->_database_exists()) {
+        return db::blob_stream_result_t{db::error{db::error_type::closed}};
+    }
+
+    sqlite3_blob *blob = nullptr;
+    int const flags = (mode == db::blob_open_mode::read_write) ? 1 : 0;
+    int const result_code =
+        sqlite3_blob_open(this->_sqlite_handle, schema.c_str(), table.c_str(), column.c_str(), rowid, flags, &blob);
+
+    if (result_code != SQLITE_OK) {
+        db::blob_stream_result_t result{db::error{db::error_type::sqlite, result_code, this->last_error_message()}};
+        sqlite3_blob_close(blob);
+        return result;
+    }
+
+    auto stream = db::blob_stream::make_shared(this->_sqlite_handle, blob, mode);
+
+    std::erase_if(this->_blob_streams, [](auto const &pair) { return pair.second.expired(); });
+    this->_blob_streams.emplace(stream->identifier(), stream);
+
+    return db::blob_stream_result_t{std::move(stream)};
+}
+
+db::update_result_t database::attach(std::filesystem::path const &path, std::string const &schema) {
+    if (schema.empty() || this->_attached_databases.contains(schema)) {
+        return db::update_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    if (this->_sqlite_handle) {
+        if (auto result = this->_attach(path, schema); !result) {
+            return result;
+        }
+    }
+
+    this->_attached_databases.emplace(schema, path);
+
+    return db::update_result_t{nullptr};
+}
+
+db::update_result_t database::detach(std::string const &schema) {
+    auto const it = this->_attached_databases.find(schema);
+    if (it == this->_attached_databases.end()) {
+        return db::update_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    if (this->_sqlite_handle) {
+        std::string const sql = "DETACH DATABASE " + quote_schema_name(schema) + ";";
+        if (auto result = this->_execute_update(sql, {}, {}); !result) {
+            return result;
+        }
+    }
+
+    this->_attached_databases.erase(it);
+
+    return db::update_result_t{nullptr};
+}
+
+std::map<std::string, std::filesystem::path> const &database::attached_databases() const {
+    return this->_attached_databases;
+}
+
 db::row_result_t database::last_insert_rowid() const {
-    if (this->_is_executing_statement) {
+    if (this->_is_executing_statement.exchange(true)) {
         return db::row_result_t{db::error{db::error_type::in_use}};
     }
 
-    this->_is_executing_statement = true;
-
     sqlite_int64 rowid = sqlite3_last_insert_rowid(this->_sqlite_handle);
 
     this->_is_executing_statement = false;
@@ -227,12 +610,10 @@ db::row_result_t database::last_insert_rowid() const {
 }
 
 db::count_result_t database::changes() const {
-    if (this->_is_executing_statement) {
+    if (this->_is_executing_statement.exchange(true)) {
         return db::count_result_t{db::error{db::error_type::in_use}};
     }
 
-    this->_is_executing_statement = true;
-
     int changes = sqlite3_changes(this->_sqlite_handle);
 
     this->_is_executing_statement = false;
@@ -241,14 +622,7 @@ db::count_result_t database::changes() const {
 }
 
 void database::clear_cached_statements() {
-    for (auto &pair : this->_cached_statements) {
-        for (auto &statement_pair : pair.second) {
-            if (db::closable_ptr const statement = closable::cast(statement_pair.second)) {
-                statement->close();
-            }
-        }
-    }
-    this->_cached_statements.clear();
+    this->_statement_cache.close_all();
 }
 
 void database::close_opened_row_sets() {
@@ -261,10 +635,42 @@ void database::close_opened_row_sets() {
     this->_opened_row_sets.clear();
 }
 
+void database::close_prepared_statements() {
+    for (auto &pair : this->_prepared_statements) {
+        if (db::prepared_statement_ptr const prepared = pair.second.lock()) {
+            closable::cast(prepared)->close();
+        }
+    }
+    this->_prepared_statements.clear();
+}
+
+void database::close_backups() {
+    for (auto &pair : this->_backups) {
+        if (db::backup_ptr const backup = pair.second.lock()) {
+            closable::cast(backup)->close();
+        }
+    }
+    this->_backups.clear();
+}
+
+void database::close_blob_streams() {
+    for (auto &pair : this->_blob_streams) {
+        if (db::blob_stream_ptr const stream = pair.second.lock()) {
+            closable::cast(stream)->close();
+        }
+    }
+    this->_blob_streams.clear();
+}
+
 bool database::has_opened_row_sets() const {
     return this->_opened_row_sets.size() > 0;
 }
 
+bool database::has_backups() const {
+    return std::any_of(this->_backups.begin(), this->_backups.end(),
+                       [](auto const &pair) { return !pair.second.expired(); });
+}
+
 bool database::should_cache_statements() const {
     return this->_should_cache_statements;
 }
@@ -273,10 +679,30 @@ void database::set_should_cache_statements(bool flag) {
     this->_should_cache_statements = flag;
 
     if (!flag) {
-        this->_cached_statements.clear();
+        this->_statement_cache.clear();
     }
 }
 
+std::size_t database::statement_cache_capacity() const {
+    return this->_statement_cache.capacity();
+}
+
+void database::set_statement_cache_capacity(std::size_t const capacity) {
+    this->_statement_cache.set_capacity(capacity);
+}
+
+std::size_t database::cached_statement_count() const {
+    return this->_statement_cache.size();
+}
+
+db::statement_cache_stats const &database::statement_cache_stats() const {
+    return this->_statement_cache.stats();
+}
+
+void database::reset_statement_cache_stats() {
+    this->_statement_cache.reset_stats();
+}
+
 std::string database::last_error_message() const {
     return sqlite3_errmsg(this->_sqlite_handle);
 }
@@ -298,29 +724,12 @@ void database::set_max_busy_retry_time_interval(double const timeout) {
     }
 
     if (timeout > 0) {
-        db::callback_id id{.database = this->_db_key};
-
-        static auto sqlite_busy_handler = [](void *id, int count) {
-            uint8_t const database_id = (db::callback_id){id}.database;
-            if (db::_databases.count(database_id) > 0) {
-                if (auto const database = db::_databases.at(database_id).lock()) {
-                    if (count == 0) {
-                        database->set_start_busy_retry_time(std::chrono::system_clock::now());
-                        return 1;
-                    }
-
-                    std::chrono::duration<double> delta =
-                        std::chrono::system_clock::now() - database->start_busy_retry_time();
-                    if (delta.count() < database->max_busy_retry_time_interval()) {
-                        sqlite3_sleep(50);
-                        return 1;
-                    }
-                }
-            }
-            return 0;
+        // ハンドラはsqliteのハンドルが開いている間しか呼ばれず、ハンドルはdatabaseが閉じるのでポインタを直接渡す
+        static auto sqlite_busy_handler = [](void *context, int count) {
+            return static_cast<db::database *>(context)->_retry_if_busy(count) ? 1 : 0;
         };
 
-        sqlite3_busy_handler(this->_sqlite_handle, sqlite_busy_handler, id.v);
+        sqlite3_busy_handler(this->_sqlite_handle, sqlite_busy_handler, this);
     } else {
         sqlite3_busy_handler(this->_sqlite_handle, nullptr, nullptr);
     }
@@ -338,34 +747,315 @@ std::chrono::time_point<std::chrono::system_clock> database::start_busy_retry_ti
     return this->_start_busy_retry_time;
 }
 
+void database::set_busy_retry_policy(db::busy_retry_policy const &policy) {
+    this->_busy_retry_policy = policy;
+}
+
+db::busy_retry_policy const &database::busy_retry_policy() const {
+    return this->_busy_retry_policy;
+}
+
+db::busy_retry_stats const &database::busy_retry_stats() const {
+    return this->_busy_retry_stats;
+}
+
+void database::reset_busy_retry_stats() {
+    this->_busy_retry_stats = {};
+}
+
+void database::set_interruption_handler(interruption_f handler, int const instruction_interval) {
+    this->_interruption_handler = std::move(handler);
+    this->_interruption_instruction_interval = instruction_interval;
+    this->_install_progress_handler();
+}
+
+database::interruption_f const &database::interruption_handler() const {
+    return this->_interruption_handler;
+}
+
+int database::interruption_instruction_interval() const {
+    return this->_interruption_instruction_interval;
+}
+
+db::update_result_t database::register_function(std::string const &name, db::scalar_function_f function,
+                                               int const argument_count, bool const deterministic) {
+    return this->_register_function(db::function_definition{.name = name,
+                                                            .argument_count = argument_count,
+                                                            .deterministic = deterministic,
+                                                            .scalar = std::move(function)});
+}
+
+db::update_result_t database::unregister_function(std::string const &name, int const argument_count) {
+    auto const it = this->_functions.find(name + "/" + std::to_string(argument_count));
+    if (it == this->_functions.end()) {
+        return db::update_result_t{db::error{db::error_type::invalid_argument}};
+    }
+
+    if (this->_sqlite_handle) {
+        if (int const result_code = it->second->uninstall(this->_sqlite_handle); result_code != SQLITE_OK) {
+            return db::update_result_t{db::error{db::error_type::sqlite, result_code, this->last_error_message()}};
+        }
+    }
+
+    this->_functions.erase(it);
+
+    return db::update_result_t{nullptr};
+}
+
+// 関数は定義のポインタが同じなら登録済みとみなす。接続しているデータベースはパスが違えば接続し直す
+db::update_result_t database::copy_registrations(db::database const &source) {
+    for (auto it = this->_functions.begin(); it != this->_functions.end();) {
+        if (source._functions.contains(it->first)) {
+            ++it;
+            continue;
+        }
+
+        if (this->_sqlite_handle) {
+            if (int const result_code = it->second->uninstall(this->_sqlite_handle); result_code != SQLITE_OK) {
+                return db::update_result_t{db::error{db::error_type::sqlite, result_code, this->last_error_message()}};
+            }
+        }
+
+        it = this->_functions.erase(it);
+    }
+
+    for (auto const &pair : source._functions) {
+        auto const it = this->_functions.find(pair.first);
+        if (it != this->_functions.end() && it->second == pair.second) {
+            continue;
+        }
+
+        if (this->_sqlite_handle) {
+            if (int const result_code = pair.second->install(this->_sqlite_handle); result_code != SQLITE_OK) {
+                return db::update_result_t{db::error{db::error_type::sqlite, result_code, this->last_error_message()}};
+            }
+        }
+
+        this->_functions.insert_or_assign(pair.first, pair.second);
+    }
+
+    std::vector<std::string> detaching_schemas;
+    for (auto const &pair : this->_attached_databases) {
+        auto const it = source._attached_databases.find(pair.first);
+        if (it == source._attached_databases.end() || it->second != pair.second) {
+            detaching_schemas.push_back(pair.first);
+        }
+    }
+
+    for (auto const &schema : detaching_schemas) {
+        if (auto result = this->detach(schema); !result) {
+            return result;
+        }
+    }
+
+    for (auto const &pair : source._attached_databases) {
+        if (this->_attached_databases.contains(pair.first)) {
+            continue;
+        }
+
+        if (auto result = this->attach(pair.second, pair.first); !result) {
+            return result;
+        }
+    }
+
+    return db::update_result_t{nullptr};
+}
+
+void database::set_profiling_enabled(bool const enabled) {
+    this->_query_profiler.set_enabled(enabled);
+    this->_install_trace();
+}
+
+bool database::is_profiling_enabled() const {
+    return this->_query_profiler.is_enabled();
+}
+
+std::vector<db::query_stats> database::query_stats() const {
+    return this->_query_profiler.stats();
+}
+
+void database::reset_query_stats() {
+    this->_query_profiler.reset_stats();
+}
+
+void database::set_slow_query_handler(std::chrono::nanoseconds const threshold, db::slow_query_f handler) {
+    this->_query_profiler.set_slow_query_handler(threshold, std::move(handler));
+    this->_install_trace();
+}
+
+void database::interrupt() {
+    if (this->_sqlite_handle) {
+        sqlite3_interrupt(this->_sqlite_handle);
+    }
+}
+
 void database::_prepare(database_ptr const &shared) {
     this->_weak_database = shared;
+}
 
-    if (auto key = min_empty_key(db::_databases)) {
-        this->_db_key = *key;
-        db::_databases.insert(std::make_pair(*key, to_weak(shared)));
+// 実行中のSQLからinstruction_intervalごとに呼ばれ、ハンドラがtrueを返したらSQLITE_INTERRUPTで中断させる
+void database::_install_progress_handler() {
+    if (!this->_sqlite_handle) {
+        return;
+    }
+
+    if (this->_interruption_handler && this->_interruption_instruction_interval > 0) {
+        static auto progress_handler = [](void *context) {
+            auto *const database = static_cast<db::database *>(context);
+            return database->_interruption_handler() ? 1 : 0;
+        };
+
+        sqlite3_progress_handler(this->_sqlite_handle, this->_interruption_instruction_interval, progress_handler,
+                                 this);
+    } else {
+        sqlite3_progress_handler(this->_sqlite_handle, 0, nullptr, nullptr);
     }
 }
 
+void database::_install_trace() {
+    if (!this->_sqlite_handle) {
+        return;
+    }
+
+    if (this->_query_profiler.is_tracing()) {
+        static auto trace_callback = [](unsigned int type, void *context, void *p, void *x) {
+            auto *const database = static_cast<db::database *>(context);
+
+            if (type == SQLITE_TRACE_ROW) {
+                database->_query_profiler.record_row(static_cast<sqlite3_stmt *>(p));
+            } else if (type == SQLITE_TRACE_PROFILE) {
+                std::chrono::nanoseconds const duration{*static_cast<sqlite3_int64 *>(x)};
+                database->_query_profiler.record_profile(static_cast<sqlite3_stmt *>(p), duration);
+            }
+
+            return 0;
+        };
+
+        sqlite3_trace_v2(this->_sqlite_handle, SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE, trace_callback, this);
+    } else {
+        sqlite3_trace_v2(this->_sqlite_handle, 0, nullptr, nullptr);
+    }
+}
+
+void database::_install_functions() {
+    if (!this->_sqlite_handle) {
+        return;
+    }
+
+    for (auto const &pair : this->_functions) {
+        pair.second->install(this->_sqlite_handle);
+    }
+}
+
+void database::_attach_databases() {
+    if (!this->_sqlite_handle) {
+        return;
+    }
+
+    for (auto const &pair : this->_attached_databases) {
+        this->_attach(pair.second, pair.first);
+    }
+}
+
+db::update_result_t database::_attach(std::filesystem::path const &path, std::string const &schema) {
+    return this->_execute_update("ATTACH DATABASE ? AS " + quote_schema_name(schema) + ";",
+                                 {db::value{path.string()}}, {});
+}
+
+// SQLiteには定義のポインタを渡すので、置き換える場合は新しい定義を登録してから古い定義を破棄する
+db::update_result_t database::_register_function(db::function_definition &&definition) {
+    std::string key = definition.name + "/" + std::to_string(definition.argument_count);
+    auto definition_ptr = std::make_shared<db::function_definition const>(std::move(definition));
+
+    if (this->_sqlite_handle) {
+        if (int const result_code = definition_ptr->install(this->_sqlite_handle); result_code != SQLITE_OK) {
+            return db::update_result_t{db::error{db::error_type::sqlite, result_code, this->last_error_message()}};
+        }
+    }
+
+    this->_functions.insert_or_assign(std::move(key), std::move(definition_ptr));
+
+    return db::update_result_t{nullptr};
+}
+
+// ロックが解除されるまでポリシーに従って間隔を延ばしながら待つ。最大時間を過ぎたらfalseを返して諦める
+bool database::_retry_if_busy(int const count) {
+    auto const now = std::chrono::system_clock::now();
+
+    if (count == 0) {
+        this->_start_busy_retry_time = now;
+        this->_busy_event_wait = std::chrono::microseconds{0};
+        ++this->_busy_retry_stats.busy_count;
+    }
+
+    std::chrono::duration<double> const elapsed = now - this->_start_busy_retry_time;
+    double const remaining = this->_max_busy_retry_time_interval - elapsed.count();
+
+    if (remaining <= 0.0) {
+        ++this->_busy_retry_stats.timeout_count;
+        return false;
+    }
+
+    std::uniform_real_distribution<double> distribution{0.0, 1.0};
+    std::chrono::microseconds const delay =
+        std::min(this->_busy_retry_policy.delay(count, distribution(this->_busy_retry_random)),
+                 std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>{remaining}));
+
+    auto const sleep_begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(delay);
+    auto const waited =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sleep_begin);
+
+    this->_busy_event_wait += waited;
+    ++this->_busy_retry_stats.retry_count;
+    this->_busy_retry_stats.total_wait += waited;
+    this->_busy_retry_stats.max_wait = std::max(this->_busy_retry_stats.max_wait, this->_busy_event_wait);
+
+    return true;
+}
+
+// 結果の行を返すpragmaもあるのでexecute_statementsで実行する
+// journal_modeは設定できなくてもエラーにならず実際のモードを返すので、要求したモードと比べる
+bool database::_apply_open_option() {
+    std::optional<db::journal_mode> applied_journal_mode = std::nullopt;
+
+    callback_f const callback = [&applied_journal_mode](db::value_map_t const &row) {
+        if (auto const iterator = row.find("journal_mode"); iterator != row.end() && iterator->second) {
+            applied_journal_mode = db::to_journal_mode(iterator->second.get<db::text>());
+        }
+        return 0;
+    };
+
+    for (std::string const &sql : this->_open_option.pragma_sqls()) {
+        if (!this->_execute_statements(sql, callback)) {
+            return false;
+        }
+    }
+
+    if (auto const &journal_mode = this->_open_option.journal_mode) {
+        return applied_journal_mode == journal_mode;
+    }
+
+    return true;
+}
+
 db::update_result_t database::_execute_update(std::string const &sql, std::vector<db::value> const &vec,
                                               std::unordered_map<std::string, db::value> const &map) {
     if (!this->_database_exists()) {
         return db::update_result_t{db::error{db::error_type::closed}};
     }
 
-    if (this->_is_executing_statement) {
+    if (this->_is_executing_statement.exchange(true)) {
         return db::update_result_t{db::error{db::error_type::in_use}};
     }
 
-    this->_is_executing_statement = true;
-
     db::sqlite_result_code result_code{SQLITE_OK};
     std::string error_message;
     sqlite3_stmt *stmt = nullptr;
     db::statement_ptr statement{nullptr};
 
     if (this->_should_cache_statements) {
-        statement = this->_cached_statement(sql);
+        statement = this->_statement_cache.get(sql);
         if (statement) {
             stmt = statement->stmt();
             statement->reset();
@@ -373,7 +1063,7 @@ db::update_result_t database::_execute_update(std::string const &sql, std::vecto
     }
 
     if (!stmt) {
-        result_code = sqlite3_prepare_v2(this->_sqlite_handle, sql.c_str(), -1, &stmt, 0);
+        result_code = this->_prepare_statement(sql, &stmt);
 
         if (!result_code) {
             db::update_result_t result{db::error{db::error_type::sqlite, result_code, last_error_message()}};
@@ -408,7 +1098,11 @@ db::update_result_t database::_execute_update(std::string const &sql, std::vecto
     }
 
     if (idx != query_count) {
-        sqlite3_finalize(stmt);
+        if (statement) {
+            statement->reset();
+        } else {
+            sqlite3_finalize(stmt);
+        }
         this->_is_executing_statement = false;
         return db::update_result_t{db::error{db::error_type::invalid_query_count}};
     }
@@ -427,7 +1121,7 @@ db::update_result_t database::_execute_update(std::string const &sql, std::vecto
     if (this->_should_cache_statements && !statement) {
         statement = db::statement::make_shared();
         statement->set_stmt(stmt);
-        this->_set_cached_statement(statement, sql);
+        this->_statement_cache.set(statement, sql);
     }
 
     db::sqlite_result_code close_result_code;
@@ -452,42 +1146,128 @@ db::update_result_t database::_execute_update(std::string const &sql, std::vecto
     }
 }
 
+// 1つのステートメントで複数の行を実行する。行ごとのエラーは記録して残りの行の実行を続ける
+db::batch_update_result_t database::_execute_update_batch(
+    std::string const &sql, std::size_t const row_count,
+    std::function<bool(std::size_t const row_idx, sqlite3_stmt *const)> const &bind_row) {
+    if (!this->_database_exists()) {
+        return db::batch_update_result_t{db::error{db::error_type::closed}};
+    }
+
+    if (this->_is_executing_statement.exchange(true)) {
+        return db::batch_update_result_t{db::error{db::error_type::in_use}};
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    db::statement_ptr statement{nullptr};
+
+    if (this->_should_cache_statements) {
+        statement = this->_statement_cache.get(sql);
+        if (statement) {
+            stmt = statement->stmt();
+            statement->reset();
+        }
+    }
+
+    if (!stmt) {
+        db::sqlite_result_code const result_code = this->_prepare_statement(sql, &stmt);
+
+        if (!result_code) {
+            db::batch_update_result_t result{db::error{db::error_type::sqlite, result_code, last_error_message()}};
+            sqlite3_finalize(stmt);
+            this->_is_executing_statement = false;
+            return result;
+        }
+
+        if (this->_should_cache_statements) {
+            statement = db::statement::make_shared();
+            statement->set_stmt(stmt);
+            this->_statement_cache.set(statement, sql);
+        }
+    }
+
+    db::batch_update_summary summary;
+    summary.last_insert_rowids.reserve(row_count);
+
+    for (std::size_t row_idx = 0; row_idx < row_count; ++row_idx) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+
+        if (!bind_row(row_idx, stmt)) {
+            summary.last_insert_rowids.push_back(0);
+            summary.row_errors.emplace_back(
+                db::batch_row_error{.row_idx = row_idx, .error = db::error{db::error_type::invalid_query_count}});
+            continue;
+        }
+
+        db::sqlite_result_code const result_code = sqlite3_step(stmt);
+
+        if (result_code.raw_value() == SQLITE_ROW) {
+            if (statement) {
+                statement->reset();
+            } else {
+                sqlite3_finalize(stmt);
+            }
+            this->_is_executing_statement = false;
+            throw std::runtime_error(std::string(__PRETTY_FUNCTION__) +
+                                     " : execute_update_batch is being called with a query string '" + sql + "'.");
+        }
+
+        if (result_code) {
+            summary.changes += sqlite3_changes(this->_sqlite_handle);
+            summary.last_insert_rowids.push_back(sqlite3_last_insert_rowid(this->_sqlite_handle));
+        } else {
+            summary.last_insert_rowids.push_back(0);
+            summary.row_errors.emplace_back(db::batch_row_error{
+                .row_idx = row_idx, .error = db::error{db::error_type::sqlite, result_code, last_error_message()}});
+        }
+    }
+
+    if (statement) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    } else {
+        sqlite3_finalize(stmt);
+    }
+
+    this->_is_executing_statement = false;
+
+    return db::batch_update_result_t{std::move(summary)};
+}
+
 db::update_result_t database::_execute_statements(std::string const &sql, callback_f const &function) {
-    db::callback_id callback_id{.database = this->_db_key};
     this->_callback_for_execute_statements = function;
 
-    static auto execute_bulk_sql_callback = [](void *id, int columns, char **values, char **names) {
-        auto database_id = (db::callback_id){id}.database;
-        if (db::_databases.count(database_id) > 0) {
-            if (database_ptr database = db::_databases.at(database_id).lock()) {
-                std::unordered_map<std::string, db::value> map;
-                auto each = make_fast_each(columns);
-                while (yas_each_next(each)) {
-                    int const &idx = yas_each_index(each);
-                    char const *const name = names[idx];
-                    char const *const value = values[idx];
-                    if (name) {
-                        if (value) {
-                            map.insert(std::make_pair(name, db::value{value}));
-                        } else {
-                            map.insert(std::make_pair(name, db::null_value()));
-                        }
-                    }
-                }
-
-                if (callback_f const &callback = database->callback_for_execute_statements()) {
-                    return callback(map);
+    // sqlite3_execの中で同期的に呼ばれるのでdatabaseのポインタを直接渡す
+    static auto execute_bulk_sql_callback = [](void *context, int columns, char **values, char **names) {
+        auto *const database = static_cast<db::database *>(context);
+
+        std::unordered_map<std::string, db::value> map;
+        auto each = make_fast_each(columns);
+        while (yas_each_next(each)) {
+            int const &idx = yas_each_index(each);
+            char const *const name = names[idx];
+            char const *const value = values[idx];
+            if (name) {
+                if (value) {
+                    map.insert(std::make_pair(name, db::value{value}));
+                } else {
+                    map.insert(std::make_pair(name, db::null_value()));
                 }
             }
         }
 
+        if (callback_f const &callback = database->callback_for_execute_statements()) {
+            return callback(map);
+        }
+
         return 0;
     };
 
     char *errmsg = nullptr;
 
     db::sqlite_result_code result_code = sqlite3_exec(
-        this->_sqlite_handle, sql.c_str(), function ? execute_bulk_sql_callback : nullptr, callback_id.v, &errmsg);
+        this->_sqlite_handle, sql.c_str(), function ? execute_bulk_sql_callback : nullptr, this, &errmsg);
 
     this->_callback_for_execute_statements = nullptr;
 
@@ -510,12 +1290,10 @@ db::query_result_t database::_execute_query(std::string const &sql, value_vector
         return db::query_result_t{db::error{db::error_type::closed}};
     }
 
-    if (this->_is_executing_statement) {
+    if (this->_is_executing_statement.exchange(true)) {
         return db::query_result_t{db::error{db::error_type::in_use}};
     }
 
-    this->_is_executing_statement = true;
-
     db::sqlite_result_code result_code = 0;
     std::string error_message;
     sqlite3_stmt *stmt{nullptr};
@@ -523,7 +1301,7 @@ db::query_result_t database::_execute_query(std::string const &sql, value_vector
     row_set_ptr row_set{nullptr};
 
     if (this->_should_cache_statements) {
-        statement = this->_cached_statement(sql);
+        statement = this->_statement_cache.get(sql);
         if (statement) {
             stmt = statement->stmt();
             statement->reset();
@@ -531,7 +1309,7 @@ db::query_result_t database::_execute_query(std::string const &sql, value_vector
     }
 
     if (!stmt) {
-        result_code = sqlite3_prepare_v2(this->_sqlite_handle, sql.c_str(), -1, &stmt, 0);
+        result_code = this->_prepare_statement(sql, &stmt);
 
         if (!result_code) {
             db::query_result_t result{db::error{db::error_type::sqlite, result_code, last_error_message()}};
@@ -569,7 +1347,11 @@ db::query_result_t database::_execute_query(std::string const &sql, value_vector
     }
 
     if (idx != query_count) {
-        sqlite3_finalize(stmt);
+        if (statement) {
+            statement->reset();
+        } else {
+            sqlite3_finalize(stmt);
+        }
         this->_is_executing_statement = false;
         return db::query_result_t{db::error{db::error_type::invalid_query_count, 0, error_message}};
     }
@@ -579,7 +1361,7 @@ db::query_result_t database::_execute_query(std::string const &sql, value_vector
         statement->set_stmt(stmt);
 
         if (this->_should_cache_statements && sql.size() > 0) {
-            this->_set_cached_statement(statement, sql);
+            this->_statement_cache.set(statement, sql);
         }
     }
 
@@ -596,34 +1378,19 @@ bool database::_database_exists() const {
     return this->_sqlite_handle;
 }
 
-db::statement_ptr database::_cached_statement(std::string const &query) const {
-    if (this->_cached_statements.count(query) > 0) {
-        auto &statements = this->_cached_statements.at(query);
-        for (auto &pair : statements) {
-            if (!pair.second->in_use()) {
-                return pair.second;
-            }
-        }
-    }
-    return nullptr;
-}
-
-void database::_set_cached_statement(db::statement_ptr const &statement, std::string const &query) const {
-    statement->set_query(query);
-
-    if (this->_cached_statements.count(query) == 0) {
-        this->_cached_statements.insert(std::make_pair(query, std::unordered_map<uintptr_t, db::statement_ptr>{}));
-    }
-
-    this->_cached_statements.at(query).insert(std::make_pair(statement->identifier(), statement));
+int database::_prepare_statement(std::string const &sql, sqlite3_stmt **stmt) const {
+    auto const begin_time = std::chrono::steady_clock::now();
+    int const result_code = sqlite3_prepare_v2(this->_sqlite_handle, sql.c_str(), -1, stmt, 0);
+    this->_statement_cache.record_prepare(std::chrono::steady_clock::now() - begin_time);
+    return result_code;
 }
 
 void database::row_set_did_close(uintptr_t const id) {
     this->_opened_row_sets.erase(id);
 }
 
-database_ptr database::make_shared(std::filesystem::path const &path) {
-    auto shared = std::shared_ptr<database>(new database{path});
+database_ptr database::make_shared(std::filesystem::path const &path, db::open_option open_option) {
+    auto shared = std::shared_ptr<database>(new database{path, std::move(open_option)});
     shared->_prepare(shared);
     return shared;
 }
@@ -4,27 +4,58 @@
 
 #pragma once
 
+#include <db/yas_db_backup.h>
+#include <db/yas_db_blob_stream.h>
+#include <db/yas_db_busy_retry.h>
+#include <db/yas_db_error.h>
+#include <db/yas_db_function.h>
+#include <db/yas_db_open_option.h>
 #include <db/yas_db_protocol.h>
 #include <db/yas_db_ptr.h>
+#include <db/yas_db_query_profiler.h>
+#include <db/yas_db_statement_cache.h>
 #include <db/yas_db_value.h>
 
+#include <atomic>
 #include <filesystem>
 #include <functional>
+#include <map>
+#include <random>
+#include <span>
+#include <type_traits>
 
 namespace yas::db {
 class error;
 
-union callback_id {
-    void *v;
-    struct {
-        uint8_t database;
-    };
+struct batch_row_error final {
+    std::size_t row_idx;
+    db::error error;
 };
 
+struct batch_update_summary final {
+    int changes = 0;
+    std::vector<sqlite3_int64> last_insert_rowids;
+    std::vector<db::batch_row_error> row_errors;
+
+    [[nodiscard]] bool has_row_errors() const;
+};
+
+using batch_update_result_t = result<db::batch_update_summary, db::error>;
+
+static int const default_interruption_instruction_interval = 1000;
+
+// 接続ごとに別々のメモリ上のデータベースになる
+static std::string const in_memory_path = ":memory:";
+
+// 同じプロセスで同じnameを指定した接続の間で共有される、メモリ上のデータベースのURI。全ての接続が閉じると破棄される
+[[nodiscard]] std::filesystem::path shared_memory_path(std::string const &name);
+[[nodiscard]] bool is_in_memory_path(std::filesystem::path const &);
+
 struct database final : row_set_observable {
     class impl;
 
     using callback_f = std::function<int(db::value_map_t const &)>;
+    using interruption_f = std::function<bool(void)>;
 
     [[nodiscard]] static std::string sqlite_lib_version();
     [[nodiscard]] static bool sqlite_thread_safe();
@@ -33,6 +64,9 @@ struct database final : row_set_observable {
 
     [[nodiscard]] std::filesystem::path const &database_path() const;
     [[nodiscard]] sqlite3 *sqlite_handle() const;
+    [[nodiscard]] db::open_option const &open_option() const;
+    [[nodiscard]] db::open_option effective_open_option() const;
+    [[nodiscard]] bool is_in_memory() const;
 
     bool open();
 #if SQLITE_VERSION_NUMBER >= 3005000
@@ -46,6 +80,10 @@ struct database final : row_set_observable {
     db::update_result_t execute_update(std::string const &sql, db::value_vector_t const &arguments);
     db::update_result_t execute_update(std::string const &sql, db::value_map_t const &arguments);
 
+    db::batch_update_result_t execute_update_batch(std::string const &sql,
+                                                   std::span<db::value_vector_t const> const rows);
+    db::batch_update_result_t execute_update_batch(std::string const &sql, std::span<db::value_map_t const> const rows);
+
     db::update_result_t execute_statements(std::string const &sql);
     db::update_result_t execute_statements(std::string const &sql, callback_f const &callback);
     [[nodiscard]] callback_f const &callback_for_execute_statements() const;
@@ -54,14 +92,46 @@ struct database final : row_set_observable {
     db::query_result_t execute_query(std::string const &sql, db::value_vector_t const &arguments) const;
     db::query_result_t execute_query(std::string const &sql, db::value_map_t const &arguments) const;
 
+    [[nodiscard]] db::prepared_statement_result_t prepare(std::string const &sql);
+    db::update_result_t execute_update(db::prepared_statement_ptr const &);
+    db::query_result_t execute_query(db::prepared_statement_ptr const &) const;
+
+    // pathのファイルへのバックアップを開始する。step()を呼ぶごとに少しずつコピーする
+    [[nodiscard]] db::backup_result_t make_backup(std::filesystem::path const &path);
+    // pathのファイルへpages_per_stepページずつバックアップする。progressがfalseを返したら中止する
+    db::update_result_t backup_to(std::filesystem::path const &path,
+                                  int const pages_per_step = db::default_backup_pages_per_step,
+                                  db::backup_progress_f const &progress = nullptr);
+
+    // tableのcolumnにあるrowidの行のBLOBを、読み込まずに開く
+    [[nodiscard]] db::blob_stream_result_t open_blob(std::string const &table, std::string const &column,
+                                                     sqlite3_int64 const rowid,
+                                                     db::blob_open_mode const mode = db::blob_open_mode::read_only,
+                                                     std::string const &schema = "main");
+
+    // pathのデータベースをschemaの名前で接続する。接続を開き直しても接続したままになる
+    // pathにはshared_memory_path()やin_memory_pathも指定できる。トランザクションの中では接続できない
+    db::update_result_t attach(std::filesystem::path const &path, std::string const &schema);
+    db::update_result_t detach(std::string const &schema);
+    [[nodiscard]] std::map<std::string, std::filesystem::path> const &attached_databases() const;
+
     [[nodiscard]] db::row_result_t last_insert_rowid() const;
     [[nodiscard]] db::count_result_t changes() const;
 
     void clear_cached_statements();
     void close_opened_row_sets();
+    void close_prepared_statements();
+    void close_backups();
+    void close_blob_streams();
     [[nodiscard]] bool has_opened_row_sets() const;
+    [[nodiscard]] bool has_backups() const;
     [[nodiscard]] bool should_cache_statements() const;
     void set_should_cache_statements(bool flag);
+    [[nodiscard]] std::size_t statement_cache_capacity() const;
+    void set_statement_cache_capacity(std::size_t const);
+    [[nodiscard]] std::size_t cached_statement_count() const;
+    [[nodiscard]] db::statement_cache_stats const &statement_cache_stats() const;
+    void reset_statement_cache_stats();
 
     [[nodiscard]] std::string last_error_message() const;
     [[nodiscard]] int last_error_code() const;
@@ -70,28 +140,83 @@ struct database final : row_set_observable {
     [[nodiscard]] double max_busy_retry_time_interval() const;
     void set_start_busy_retry_time(const std::chrono::time_point<std::chrono::system_clock> &time);
     [[nodiscard]] std::chrono::time_point<std::chrono::system_clock> start_busy_retry_time() const;
-
-    [[nodiscard]] static database_ptr make_shared(std::filesystem::path const &path);
+    void set_busy_retry_policy(db::busy_retry_policy const &);
+    [[nodiscard]] db::busy_retry_policy const &busy_retry_policy() const;
+    [[nodiscard]] db::busy_retry_stats const &busy_retry_stats() const;
+    void reset_busy_retry_stats();
+
+    void set_interruption_handler(interruption_f handler,
+                                  int const instruction_interval = db::default_interruption_instruction_interval);
+    [[nodiscard]] interruption_f const &interruption_handler() const;
+    [[nodiscard]] int interruption_instruction_interval() const;
+    void interrupt();
+
+    // 接続を開き直しても登録したままになる。同じ名前と引数の数で登録すると置き換える
+    // argument_countが-1なら引数の数は可変
+    // 関数は読み込み専用の接続にもコピーされ別スレッドから呼ばれることがあるので、スレッドセーフにする
+    db::update_result_t register_function(std::string const &name, db::scalar_function_f, int const argument_count = -1,
+                                          bool const deterministic = false);
+    // initでグループごとの状態を作り、行ごとにstep(state, arguments)を呼び、最後にfinalize(state)の値を結果にする
+    template <typename Init, typename Step, typename Finalize>
+    db::update_result_t register_aggregate(std::string const &name, Init init, Step step, Finalize finalize,
+                                           int const argument_count = -1, bool const deterministic = false) {
+        using state_t = std::invoke_result_t<Init>;
+        using aggregate_state_t = db::typed_aggregate_state<state_t, Step, Finalize>;
+
+        return this->_register_function(db::function_definition{
+            .name = name,
+            .argument_count = argument_count,
+            .deterministic = deterministic,
+            .aggregate = [init = std::move(init), step = std::move(step),
+                          finalize = std::move(finalize)]() -> std::unique_ptr<db::aggregate_state> {
+                return std::make_unique<aggregate_state_t>(init(), step, finalize);
+            }});
+    }
+    db::update_result_t unregister_function(std::string const &name, int const argument_count = -1);
+    // sourceに登録されている関数と接続しているデータベースと同じになるように、この接続に登録する
+    // 同じファイルの別の接続で同じSQLを使えるようにするためのもの。トランザクションの中では呼べない
+    db::update_result_t copy_registrations(db::database const &source);
+
+    void set_profiling_enabled(bool const);
+    [[nodiscard]] bool is_profiling_enabled() const;
+    [[nodiscard]] std::vector<db::query_stats> query_stats() const;
+    void reset_query_stats();
+    void set_slow_query_handler(std::chrono::nanoseconds const threshold, db::slow_query_f);
+
+    [[nodiscard]] static database_ptr make_shared(std::filesystem::path const &path, db::open_option = {});
 
    private:
-    uint8_t _db_key;
     std::filesystem::path const _database_path;
+    db::open_option const _open_option;
     sqlite3 *_sqlite_handle = nullptr;
 
     bool _should_cache_statements = false;
-    mutable bool _is_executing_statement = false;
+    mutable std::atomic<bool> _is_executing_statement = false;
 
     std::chrono::time_point<std::chrono::system_clock> _start_busy_retry_time = std::chrono::system_clock::now();
 
-    mutable std::unordered_map<std::string, std::unordered_map<uintptr_t, db::statement_ptr>> _cached_statements;
+    mutable db::statement_cache _statement_cache{db::default_statement_cache_capacity};
     mutable std::unordered_map<uintptr_t, row_set_wptr> _opened_row_sets;
+    std::unordered_map<uintptr_t, prepared_statement_wptr> _prepared_statements;
+    std::unordered_map<uintptr_t, backup_wptr> _backups;
+    std::unordered_map<uintptr_t, blob_stream_wptr> _blob_streams;
 
     db::database::callback_f _callback_for_execute_statements;
 
     database_wptr _weak_database;
     double _max_busy_retry_time_interval = 2.0;
-
-    explicit database(std::string const &path);
+    db::busy_retry_policy _busy_retry_policy;
+    db::busy_retry_stats _busy_retry_stats;
+    std::chrono::microseconds _busy_event_wait{0};
+    std::minstd_rand _busy_retry_random{std::random_device{}()};
+    interruption_f _interruption_handler = nullptr;
+    int _interruption_instruction_interval = db::default_interruption_instruction_interval;
+    db::query_profiler _query_profiler;
+    // 同じ定義を他の接続と共有することがあるのでshared_ptrで持つ
+    std::unordered_map<std::string, std::shared_ptr<db::function_definition const>> _functions;
+    std::map<std::string, std::filesystem::path> _attached_databases;
+
+    database(std::string const &path, db::open_option &&);
 
     database(database const &) = delete;
     database(database &&) = delete;
@@ -99,13 +224,23 @@ struct database final : row_set_observable {
     database &operator=(database &&) = delete;
 
     void _prepare(database_ptr const &);
+    bool _apply_open_option();
     db::update_result_t _execute_update(std::string const &sql, std::vector<db::value> const &vec,
                                         std::unordered_map<std::string, db::value> const &map);
+    db::batch_update_result_t _execute_update_batch(
+        std::string const &sql, std::size_t const row_count,
+        std::function<bool(std::size_t const row_idx, sqlite3_stmt *const)> const &bind_row);
     db::update_result_t _execute_statements(std::string const &sql, callback_f const &function);
     db::query_result_t _execute_query(std::string const &sql, value_vector_t const &vec, value_map_t const &map) const;
     bool _database_exists() const;
-    db::statement_ptr _cached_statement(std::string const &query) const;
-    void _set_cached_statement(db::statement_ptr const &statement, std::string const &query) const;
+    int _prepare_statement(std::string const &sql, sqlite3_stmt **) const;
+    bool _retry_if_busy(int const count);
+    void _install_progress_handler();
+    void _install_trace();
+    void _install_functions();
+    db::update_result_t _register_function(db::function_definition &&);
+    void _attach_databases();
+    db::update_result_t _attach(std::filesystem::path const &path, std::string const &schema);
 
     void row_set_did_close(uintptr_t const) override;
 };
@@ -0,0 +1,138 @@
+//
+//  yas_db_function.cpp
+//
+
+#include "yas_db_function.h"
+
+#include <exception>
+#include <vector>
+
+using namespace yas;
+using namespace yas::db;
+
+namespace yas::db {
+static db::value to_value(sqlite3_value *const value) {
+    switch (sqlite3_value_type(value)) {
+        case SQLITE_INTEGER:
+            return db::value{sqlite3_value_int64(value)};
+        case SQLITE_FLOAT:
+            return db::value{sqlite3_value_double(value)};
+        case SQLITE_TEXT: {
+            auto const *const text = reinterpret_cast<char const *>(sqlite3_value_text(value));
+            return db::value{std::string{text, static_cast<std::size_t>(sqlite3_value_bytes(value))}};
+        }
+        case SQLITE_BLOB: {
+            void const *const data = sqlite3_value_blob(value);
+            return db::value{data, static_cast<std::size_t>(sqlite3_value_bytes(value))};
+        }
+        default:
+            return db::null_value();
+    }
+}
+
+static std::vector<db::value> to_arguments(int const count, sqlite3_value **const values) {
+    std::vector<db::value> arguments;
+    arguments.reserve(count);
+    for (int idx = 0; idx < count; ++idx) {
+        arguments.emplace_back(db::to_value(values[idx]));
+    }
+    return arguments;
+}
+
+static void set_result(sqlite3_context *const context, db::value const &value) {
+    std::type_info const &type = value.type();
+
+    if (type == typeid(db::integer)) {
+        sqlite3_result_int64(context, value.get<db::integer>());
+    } else if (type == typeid(db::real)) {
+        sqlite3_result_double(context, value.get<db::real>());
+    } else if (type == typeid(db::text)) {
+        auto const &text = value.get<db::text>();
+        sqlite3_result_text(context, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    } else if (type == typeid(db::blob)) {
+        auto const &blob = value.get<db::blob>();
+        sqlite3_result_blob(context, blob.data() ? blob.data() : "", static_cast<int>(blob.size()), SQLITE_TRANSIENT);
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+// 例外はSQLiteを越えて投げられないので、SQLのエラーにする
+template <typename F>
+static void perform(sqlite3_context *const context, F const &function) {
+    try {
+        function();
+    } catch (std::exception const &exception) {
+        sqlite3_result_error(context, exception.what(), -1);
+    } catch (...) {
+        sqlite3_result_error(context, "unknown exception in function.", -1);
+    }
+}
+
+static void scalar_function(sqlite3_context *context, int count, sqlite3_value **values) {
+    auto const *const definition = static_cast<db::function_definition const *>(sqlite3_user_data(context));
+
+    db::perform(context, [&]() {
+        std::vector<db::value> const arguments = db::to_arguments(count, values);
+        db::set_result(context, definition->scalar(arguments));
+    });
+}
+
+// 集約のコンテキストにはaggregate_stateのポインタを置く
+static db::aggregate_state **aggregate_state_ptr(sqlite3_context *context, bool const should_allocate) {
+    return static_cast<db::aggregate_state **>(
+        sqlite3_aggregate_context(context, should_allocate ? sizeof(db::aggregate_state *) : 0));
+}
+
+static void aggregate_step(sqlite3_context *context, int count, sqlite3_value **values) {
+    auto const *const definition = static_cast<db::function_definition const *>(sqlite3_user_data(context));
+
+    db::aggregate_state **const state_ptr = db::aggregate_state_ptr(context, true);
+    if (!state_ptr) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    db::perform(context, [&]() {
+        if (!*state_ptr) {
+            *state_ptr = definition->aggregate().release();
+        }
+
+        std::vector<db::value> const arguments = db::to_arguments(count, values);
+        (*state_ptr)->step(arguments);
+    });
+}
+
+static void aggregate_final(sqlite3_context *context) {
+    auto const *const definition = static_cast<db::function_definition const *>(sqlite3_user_data(context));
+
+    // 1行もなければstepが呼ばれていないので、ここで初期状態を作る
+    db::aggregate_state **const state_ptr = db::aggregate_state_ptr(context, false);
+    std::unique_ptr<db::aggregate_state> state{state_ptr ? *state_ptr : nullptr};
+
+    db::perform(context, [&]() {
+        if (!state) {
+            state = definition->aggregate();
+        }
+        db::set_result(context, state->result());
+    });
+}
+}  // namespace yas::db
+
+int function_definition::install(sqlite3 *const handle) const {
+    int const flags = SQLITE_UTF8 | (this->deterministic ? SQLITE_DETERMINISTIC : 0);
+    void *const user_data = const_cast<db::function_definition *>(this);
+
+    if (this->scalar) {
+        return sqlite3_create_function_v2(handle, this->name.c_str(), this->argument_count, flags, user_data,
+                                          db::scalar_function, nullptr, nullptr, nullptr);
+    } else {
+        return sqlite3_create_function_v2(handle, this->name.c_str(), this->argument_count, flags, user_data,
+                                          nullptr, db::aggregate_step, db::aggregate_final, nullptr);
+    }
+}
+
+int function_definition::uninstall(sqlite3 *const handle) const {
+    return sqlite3_create_function_v2(handle, this->name.c_str(), this->argument_count, SQLITE_UTF8, nullptr, nullptr,
+                                      nullptr, nullptr, nullptr);
+}
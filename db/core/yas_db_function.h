@@ -0,0 +1,63 @@
+//
+//  yas_db_function.h
+//
+
+#pragma once
+
+#include <db/yas_db_value.h>
+#include <sqlite3.h>
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace yas::db {
+using function_arguments_t = std::span<db::value const>;
+using scalar_function_f = std::function<db::value(db::function_arguments_t const)>;
+
+// 集約関数のグループごとの状態
+struct aggregate_state {
+    virtual ~aggregate_state() = default;
+
+    virtual void step(db::function_arguments_t const) = 0;
+    virtual db::value result() = 0;
+};
+
+using aggregate_state_factory_f = std::function<std::unique_ptr<db::aggregate_state>(void)>;
+
+template <typename State, typename Step, typename Finalize>
+struct typed_aggregate_state final : aggregate_state {
+    typed_aggregate_state(State &&state, Step const &step, Finalize const &finalize)
+        : _state(std::move(state)), _step(step), _finalize(finalize) {
+    }
+
+    void step(db::function_arguments_t const arguments) override {
+        this->_step(this->_state, arguments);
+    }
+
+    db::value result() override {
+        return this->_finalize(this->_state);
+    }
+
+   private:
+    State _state;
+    Step _step;
+    Finalize _finalize;
+};
+
+// 接続を開き直した時にも登録し直せるように、データベースが持っておく関数の定義
+// scalarかaggregateのどちらかを持つ
+// copy_registrationsで読み込み専用の接続にもコピーされ別スレッドから呼ばれるので、関数はスレッドセーフにする
+// deterministicは同じ引数で常に同じ結果を返す関数の場合だけtrueにする
+struct function_definition final {
+    std::string name;
+    int argument_count = -1;
+    bool deterministic = false;
+    db::scalar_function_f scalar = nullptr;
+    db::aggregate_state_factory_f aggregate = nullptr;
+
+    int install(sqlite3 *const) const;
+    int uninstall(sqlite3 *const) const;
+};
+}  // namespace yas::db
@@ -0,0 +1,146 @@
+//
+//  yas_db_open_option.cpp
+//
+
+#include "yas_db_open_option.h"
+
+#include <cpp_utils/yas_stl_utils.h>
+
+#include <ostream>
+
+using namespace yas;
+using namespace yas::db;
+
+#pragma mark - open_option
+
+// page_sizeはWALにする前に、locking_modeはjournal_modeより前に設定する必要がある
+std::vector<std::string> open_option::pragma_sqls() const {
+    std::vector<std::string> sqls;
+
+    if (this->page_size) {
+        sqls.emplace_back("PRAGMA page_size = " + std::to_string(*this->page_size) + ";");
+    }
+
+    if (this->locking_mode) {
+        sqls.emplace_back("PRAGMA locking_mode = " + to_string(*this->locking_mode) + ";");
+    }
+
+    if (this->journal_mode) {
+        sqls.emplace_back("PRAGMA journal_mode = " + to_string(*this->journal_mode) + ";");
+    }
+
+    if (this->synchronous) {
+        sqls.emplace_back("PRAGMA synchronous = " + to_string(*this->synchronous) + ";");
+    }
+
+    if (this->cache_size) {
+        sqls.emplace_back("PRAGMA cache_size = " + std::to_string(*this->cache_size) + ";");
+    }
+
+    if (this->mmap_size) {
+        sqls.emplace_back("PRAGMA mmap_size = " + std::to_string(*this->mmap_size) + ";");
+    }
+
+    if (this->temp_store) {
+        sqls.emplace_back("PRAGMA temp_store = " + to_string(*this->temp_store) + ";");
+    }
+
+    return sqls;
+}
+
+#pragma mark -
+
+std::optional<db::journal_mode> db::to_journal_mode(std::string const &text) {
+    std::string const lower_text = to_lower(text);
+
+    for (auto const &mode : {journal_mode::delete_journal, journal_mode::truncate, journal_mode::persist,
+                             journal_mode::memory, journal_mode::wal, journal_mode::off}) {
+        if (lower_text == to_lower(to_string(mode))) {
+            return mode;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<db::locking_mode> db::to_locking_mode(std::string const &text) {
+    std::string const lower_text = to_lower(text);
+
+    for (auto const &mode : {locking_mode::normal, locking_mode::exclusive}) {
+        if (lower_text == to_lower(to_string(mode))) {
+            return mode;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::string yas::to_string(db::journal_mode const &mode) {
+    switch (mode) {
+        case db::journal_mode::delete_journal:
+            return "DELETE";
+        case db::journal_mode::truncate:
+            return "TRUNCATE";
+        case db::journal_mode::persist:
+            return "PERSIST";
+        case db::journal_mode::memory:
+            return "MEMORY";
+        case db::journal_mode::wal:
+            return "WAL";
+        case db::journal_mode::off:
+            return "OFF";
+    }
+}
+
+std::string yas::to_string(db::synchronous const &synchronous) {
+    switch (synchronous) {
+        case db::synchronous::off:
+            return "OFF";
+        case db::synchronous::normal:
+            return "NORMAL";
+        case db::synchronous::full:
+            return "FULL";
+        case db::synchronous::extra:
+            return "EXTRA";
+    }
+}
+
+std::string yas::to_string(db::temp_store const &store) {
+    switch (store) {
+        case db::temp_store::compile_default:
+            return "DEFAULT";
+        case db::temp_store::file:
+            return "FILE";
+        case db::temp_store::memory:
+            return "MEMORY";
+    }
+}
+
+std::string yas::to_string(db::locking_mode const &mode) {
+    switch (mode) {
+        case db::locking_mode::normal:
+            return "NORMAL";
+        case db::locking_mode::exclusive:
+            return "EXCLUSIVE";
+    }
+}
+
+std::ostream &operator<<(std::ostream &os, yas::db::journal_mode const &value) {
+    os << to_string(value);
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, yas::db::synchronous const &value) {
+    os << to_string(value);
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, yas::db::temp_store const &value) {
+    os << to_string(value);
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, yas::db::locking_mode const &value) {
+    os << to_string(value);
+    return os;
+}
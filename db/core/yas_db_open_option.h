@@ -0,0 +1,68 @@
+//
+//  yas_db_open_option.h
+//
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace yas::db {
+enum class journal_mode {
+    delete_journal,
+    truncate,
+    persist,
+    memory,
+    wal,
+    off,
+};
+
+enum class synchronous {
+    off,
+    normal,
+    full,
+    extra,
+};
+
+enum class temp_store {
+    compile_default,
+    file,
+    memory,
+};
+
+enum class locking_mode {
+    normal,
+    exclusive,
+};
+
+struct open_option final {
+    std::optional<int64_t> page_size = std::nullopt;
+    std::optional<db::locking_mode> locking_mode = std::nullopt;
+    std::optional<db::journal_mode> journal_mode = std::nullopt;
+    std::optional<db::synchronous> synchronous = std::nullopt;
+    std::optional<int64_t> cache_size = std::nullopt;
+    std::optional<int64_t> mmap_size = std::nullopt;
+    std::optional<db::temp_store> temp_store = std::nullopt;
+
+    [[nodiscard]] std::vector<std::string> pragma_sqls() const;
+
+    bool operator==(open_option const &) const = default;
+};
+
+[[nodiscard]] std::optional<db::journal_mode> to_journal_mode(std::string const &);
+[[nodiscard]] std::optional<db::locking_mode> to_locking_mode(std::string const &);
+}  // namespace yas::db
+
+namespace yas {
+std::string to_string(db::journal_mode const &);
+std::string to_string(db::synchronous const &);
+std::string to_string(db::temp_store const &);
+std::string to_string(db::locking_mode const &);
+}  // namespace yas
+
+std::ostream &operator<<(std::ostream &, yas::db::journal_mode const &);
+std::ostream &operator<<(std::ostream &, yas::db::synchronous const &);
+std::ostream &operator<<(std::ostream &, yas::db::temp_store const &);
+std::ostream &operator<<(std::ostream &, yas::db::locking_mode const &);
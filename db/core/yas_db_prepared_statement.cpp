@@ -0,0 +1,166 @@
+//
+//  yas_db_prepared_statement.cpp
+//
+
+#include "yas_db_prepared_statement.h"
+
+#include <algorithm>
+
+#include "yas_db_error.h"
+#include "yas_db_statement.h"
+#include "yas_db_value.h"
+
+using namespace yas;
+using namespace yas::db;
+
+#pragma mark - prepared_statement
+
+prepared_statement::prepared_statement(std::string const &sql, db::statement_ptr const &statement)
+    : _sql(sql), _statement(statement) {
+    sqlite3_stmt *const stmt = statement->stmt();
+    int const count = sqlite3_bind_parameter_count(stmt);
+
+    for (int idx = 1; idx <= count; ++idx) {
+        if (char const *const name = sqlite3_bind_parameter_name(stmt, idx)) {
+            // 先頭の:や@や$を除いた名前で引けるようにする
+            this->_parameter_indices.emplace_back(std::string{name + 1}, idx);
+        }
+    }
+}
+
+prepared_statement::~prepared_statement() {
+    this->close();
+}
+
+uintptr_t prepared_statement::identifier() const {
+    return reinterpret_cast<uintptr_t>(this);
+}
+
+std::string const &prepared_statement::sql() const {
+    return this->_sql;
+}
+
+db::statement_ptr const &prepared_statement::statement() const {
+    return this->_statement;
+}
+
+bool prepared_statement::is_closed() const {
+    return this->_statement->stmt() == nullptr;
+}
+
+int prepared_statement::parameter_count() const {
+    if (sqlite3_stmt *const stmt = this->_statement->stmt()) {
+        return sqlite3_bind_parameter_count(stmt);
+    }
+    return 0;
+}
+
+std::optional<int> prepared_statement::parameter_index(std::string_view const name) const {
+    auto const it = std::find_if(this->_parameter_indices.begin(), this->_parameter_indices.end(),
+                                 [&name](auto const &pair) { return pair.first == name; });
+    if (it != this->_parameter_indices.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+db::update_result_t prepared_statement::bind(int const idx, std::nullptr_t) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    return this->_bind_result(sqlite3_bind_null(this->_statement->stmt(), idx));
+}
+
+// 文字列とデータは呼び出し元のメモリが実行時まで残っているとは限らないので、SQLiteにコピーさせる
+db::update_result_t prepared_statement::bind(int const idx, std::string_view const value) {
+    return this->_bind_text(idx, value, SQLITE_TRANSIENT);
+}
+
+db::update_result_t prepared_statement::bind(int const idx, std::span<std::byte const> const value) {
+    return this->_bind_blob(idx, value, SQLITE_TRANSIENT);
+}
+
+db::update_result_t prepared_statement::bind(int const idx, db::value const &value) {
+    std::type_info const &type = value.type();
+
+    if (type == typeid(db::integer)) {
+        return this->bind(idx, value.get<db::integer>());
+    } else if (type == typeid(db::real)) {
+        return this->bind(idx, value.get<db::real>());
+    } else if (type == typeid(db::text)) {
+        return this->bind(idx, std::string_view{value.get<db::text>()});
+    } else if (type == typeid(db::blob)) {
+        db::blob::type const &blob = value.get<db::blob>();
+        return this->bind(idx, std::span<std::byte const>{static_cast<std::byte const *>(blob.data()), blob.size()});
+    } else {
+        return this->bind(idx, nullptr);
+    }
+}
+
+db::update_result_t prepared_statement::bind_static(int const idx, std::string_view const value) {
+    return this->_bind_text(idx, value, SQLITE_STATIC);
+}
+
+db::update_result_t prepared_statement::bind_static(int const idx, std::span<std::byte const> const value) {
+    return this->_bind_blob(idx, value, SQLITE_STATIC);
+}
+
+db::update_result_t prepared_statement::clear_bindings() {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    return this->_bind_result(sqlite3_clear_bindings(this->_statement->stmt()));
+}
+
+db::update_result_t prepared_statement::_bind_integer(int const idx, sqlite3_int64 const value) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    return this->_bind_result(sqlite3_bind_int64(this->_statement->stmt(), idx, value));
+}
+
+db::update_result_t prepared_statement::_bind_real(int const idx, double const value) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    return this->_bind_result(sqlite3_bind_double(this->_statement->stmt(), idx, value));
+}
+
+db::update_result_t prepared_statement::_bind_text(int const idx, std::string_view const value,
+                                                   sqlite3_destructor_type const destructor) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    char const *const data = value.data() ? value.data() : "";
+    return this->_bind_result(
+        sqlite3_bind_text(this->_statement->stmt(), idx, data, static_cast<int>(value.size()), destructor));
+}
+
+db::update_result_t prepared_statement::_bind_blob(int const idx, std::span<std::byte const> const value,
+                                                   sqlite3_destructor_type const destructor) {
+    if (this->is_closed()) {
+        return db::update_result_t{db::error{db::error_type::closed}};
+    }
+    void const *const data = value.data() ? static_cast<void const *>(value.data()) : "";
+    return this->_bind_result(
+        sqlite3_bind_blob(this->_statement->stmt(), idx, data, static_cast<int>(value.size()), destructor));
+}
+
+db::update_result_t prepared_statement::_bind_result(int const result_code) const {
+    if (result_code == SQLITE_OK) {
+        return db::update_result_t{nullptr};
+    }
+
+    std::string message = sqlite3_errmsg(sqlite3_db_handle(this->_statement->stmt()));
+    return db::update_result_t{db::error{db::error_type::sqlite, result_code, std::move(message)}};
+}
+
+void prepared_statement::close() {
+    if (db::closable_ptr const closable = closable::cast(this->_statement)) {
+        closable->close();
+    }
+}
+
+prepared_statement_ptr prepared_statement::make_shared(std::string const &sql, db::statement_ptr const &statement) {
+    return prepared_statement_ptr(new prepared_statement{sql, statement});
+}
@@ -0,0 +1,72 @@
+//
+//  yas_db_prepared_statement.h
+//
+
+#pragma once
+
+#include <db/yas_db_error.h>
+#include <db/yas_db_protocol.h>
+#include <db/yas_db_ptr.h>
+#include <db/yas_db_types.h>
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yas::db {
+struct prepared_statement final : closable {
+    ~prepared_statement();
+
+    [[nodiscard]] uintptr_t identifier() const;
+    [[nodiscard]] std::string const &sql() const;
+    [[nodiscard]] db::statement_ptr const &statement() const;
+    [[nodiscard]] bool is_closed() const;
+
+    [[nodiscard]] int parameter_count() const;
+    [[nodiscard]] std::optional<int> parameter_index(std::string_view const name) const;
+
+    db::update_result_t bind(int const idx, std::nullptr_t);
+    template <std::integral T>
+    db::update_result_t bind(int const idx, T const value) {
+        return this->_bind_integer(idx, static_cast<sqlite3_int64>(value));
+    }
+    template <std::floating_point T>
+    db::update_result_t bind(int const idx, T const value) {
+        return this->_bind_real(idx, static_cast<double>(value));
+    }
+    // 文字列とデータはSQLiteにコピーさせる
+    db::update_result_t bind(int const idx, std::string_view const);
+    db::update_result_t bind(int const idx, std::span<std::byte const> const);
+    db::update_result_t bind(int const idx, db::value const &);
+    // 文字列とデータをコピーせずに渡す。実行し終えてバインドし直すかクリアするまで、呼び出し元でメモリを残しておく
+    db::update_result_t bind_static(int const idx, std::string_view const);
+    db::update_result_t bind_static(int const idx, std::span<std::byte const> const);
+    db::update_result_t clear_bindings();
+
+    [[nodiscard]] static prepared_statement_ptr make_shared(std::string const &sql, db::statement_ptr const &);
+
+   private:
+    std::string const _sql;
+    db::statement_ptr const _statement;
+    std::vector<std::pair<std::string, int>> _parameter_indices;
+
+    prepared_statement(std::string const &sql, db::statement_ptr const &);
+
+    prepared_statement(prepared_statement const &) = delete;
+    prepared_statement(prepared_statement &&) = delete;
+    prepared_statement &operator=(prepared_statement const &) = delete;
+    prepared_statement &operator=(prepared_statement &&) = delete;
+
+    db::update_result_t _bind_integer(int const idx, sqlite3_int64 const);
+    db::update_result_t _bind_real(int const idx, double const);
+    db::update_result_t _bind_text(int const idx, std::string_view const, sqlite3_destructor_type const);
+    db::update_result_t _bind_blob(int const idx, std::span<std::byte const> const, sqlite3_destructor_type const);
+    db::update_result_t _bind_result(int const result_code) const;
+
+    void close() override;
+};
+}  // namespace yas::db
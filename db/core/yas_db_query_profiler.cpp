@@ -0,0 +1,236 @@
+//
+//  yas_db_query_profiler.cpp
+//
+
+#include "yas_db_query_profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+using namespace yas;
+using namespace yas::db;
+
+namespace yas::db {
+static std::size_t const normalized_sql_cache_capacity = 1024;
+
+static bool is_word_char(char const c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '?' || c == ':' || c == '@' || c == '$';
+}
+
+static void append_placeholder(std::string &out) {
+    // IN (1, 2, 3)のような値の並びは、個数が違っても同じSQLになるように1つにまとめる
+    std::size_t end = out.size();
+    while (end > 0 && out[end - 1] == ' ') {
+        --end;
+    }
+    if (end > 0 && out[end - 1] == ',') {
+        std::size_t prev = end - 1;
+        while (prev > 0 && out[prev - 1] == ' ') {
+            --prev;
+        }
+        if (prev > 0 && out[prev - 1] == '?') {
+            out.resize(prev);
+            return;
+        }
+    }
+    out.push_back('?');
+}
+}  // namespace yas::db
+
+#pragma mark - query_stats
+
+std::chrono::nanoseconds query_stats::p50() const {
+    return this->percentile(0.5);
+}
+
+std::chrono::nanoseconds query_stats::p99() const {
+    return this->percentile(0.99);
+}
+
+std::chrono::nanoseconds query_stats::percentile(double const ratio) const {
+    if (this->_samples.empty()) {
+        return std::chrono::nanoseconds{0};
+    }
+
+    auto samples = this->_samples;
+    double const clamped = std::clamp(ratio, 0.0, 1.0);
+    std::size_t const idx = static_cast<std::size_t>(std::ceil(clamped * samples.size())) - (clamped > 0.0 ? 1 : 0);
+    auto const nth = samples.begin() + std::min(idx, samples.size() - 1);
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+void query_stats::add_sample(std::chrono::nanoseconds const duration) {
+    if (this->_samples.size() < db::query_stats_sample_capacity) {
+        this->_samples.push_back(duration);
+    } else {
+        this->_samples.at(this->_next_sample_idx) = duration;
+        this->_next_sample_idx = (this->_next_sample_idx + 1) % db::query_stats_sample_capacity;
+    }
+}
+
+#pragma mark - normalize
+
+std::string db::normalize_sql(std::string_view const sql) {
+    std::string out;
+    out.reserve(sql.size());
+
+    std::size_t idx = 0;
+    std::size_t const size = sql.size();
+
+    while (idx < size) {
+        char const c = sql[idx];
+
+        if (c == '\'') {
+            // 文字列のリテラル。''はエスケープされたクォート
+            ++idx;
+            while (idx < size) {
+                if (sql[idx] == '\'') {
+                    if (idx + 1 < size && sql[idx + 1] == '\'') {
+                        idx += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++idx;
+            }
+            ++idx;
+            db::append_placeholder(out);
+        } else if (c == '"' || c == '`' || c == '[') {
+            // クォートされた識別子はそのまま
+            char const close = (c == '[') ? ']' : c;
+            std::size_t const begin = idx;
+            ++idx;
+            while (idx < size && sql[idx] != close) {
+                ++idx;
+            }
+            idx = std::min(idx + 1, size);
+            out.append(sql.substr(begin, idx - begin));
+        } else if (std::isdigit(static_cast<unsigned char>(c)) && (out.empty() || !db::is_word_char(out.back()))) {
+            // 数値のリテラル
+            while (idx < size && (std::isalnum(static_cast<unsigned char>(sql[idx])) || sql[idx] == '.')) {
+                ++idx;
+            }
+            db::append_placeholder(out);
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            while (idx < size && std::isspace(static_cast<unsigned char>(sql[idx]))) {
+                ++idx;
+            }
+            if (!out.empty() && out.back() != ' ') {
+                out.push_back(' ');
+            }
+        } else {
+            out.push_back(c);
+            ++idx;
+        }
+    }
+
+    while (!out.empty() && out.back() == ' ') {
+        out.pop_back();
+    }
+
+    return out;
+}
+
+#pragma mark - query_profiler
+
+bool query_profiler::is_enabled() const {
+    return this->_is_enabled;
+}
+
+void query_profiler::set_enabled(bool const enabled) {
+    this->_is_enabled = enabled;
+}
+
+void query_profiler::set_slow_query_handler(std::chrono::nanoseconds const threshold, db::slow_query_f handler) {
+    this->_slow_query_threshold = threshold;
+    this->_slow_query_handler = std::move(handler);
+}
+
+bool query_profiler::has_slow_query_handler() const {
+    return this->_slow_query_handler != nullptr;
+}
+
+bool query_profiler::is_tracing() const {
+    return this->_is_enabled || this->has_slow_query_handler();
+}
+
+void query_profiler::record_row(sqlite3_stmt *const stmt) {
+    ++this->_pending_rows[stmt];
+}
+
+void query_profiler::record_profile(sqlite3_stmt *const stmt, std::chrono::nanoseconds const duration) {
+    std::size_t rows = 0;
+    if (auto const it = this->_pending_rows.find(stmt); it != this->_pending_rows.end()) {
+        rows = it->second;
+        this->_pending_rows.erase(it);
+    }
+
+    // ステートメントごとの状態は実行のたびにリセットして、1回分の値を取得する
+    std::size_t const fullscan_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    std::size_t const sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    std::size_t const autoindexes = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+
+    char const *const raw_sql = sqlite3_sql(stmt);
+    if (!raw_sql) {
+        return;
+    }
+
+    std::string const sql{raw_sql};
+    std::string const &normalized_sql = this->_normalized_sql(sql);
+
+    if (this->_is_enabled) {
+        auto [it, inserted] = this->_stats.try_emplace(normalized_sql);
+        db::query_stats &stats = it->second;
+        if (inserted) {
+            stats.sql = normalized_sql;
+        }
+
+        ++stats.count;
+        stats.total_duration += duration;
+        stats.max_duration = std::max(stats.max_duration, duration);
+        stats.rows += rows;
+        stats.fullscan_steps += fullscan_steps;
+        stats.sorts += sorts;
+        stats.autoindexes += autoindexes;
+        stats.add_sample(duration);
+    }
+
+    if (this->_slow_query_handler && duration >= this->_slow_query_threshold) {
+        this->_slow_query_handler(
+            db::slow_query{.sql = sql, .normalized_sql = normalized_sql, .duration = duration, .rows = rows});
+    }
+}
+
+std::vector<db::query_stats> query_profiler::stats() const {
+    std::vector<db::query_stats> result;
+    result.reserve(this->_stats.size());
+
+    for (auto const &pair : this->_stats) {
+        result.push_back(pair.second);
+    }
+
+    std::sort(result.begin(), result.end(), [](db::query_stats const &lhs, db::query_stats const &rhs) {
+        return lhs.total_duration > rhs.total_duration;
+    });
+
+    return result;
+}
+
+void query_profiler::reset_stats() {
+    this->_stats.clear();
+    this->_pending_rows.clear();
+}
+
+std::string const &query_profiler::_normalized_sql(std::string const &sql) {
+    if (auto const it = this->_normalized_sqls.find(sql); it != this->_normalized_sqls.end()) {
+        return it->second;
+    }
+
+    if (this->_normalized_sqls.size() >= db::normalized_sql_cache_capacity) {
+        this->_normalized_sqls.clear();
+    }
+
+    return this->_normalized_sqls.emplace(sql, db::normalize_sql(sql)).first->second;
+}
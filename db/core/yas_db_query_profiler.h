@@ -0,0 +1,79 @@
+//
+//  yas_db_query_profiler.h
+//
+
+#pragma once
+
+#include <sqlite3.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace yas::db {
+static std::size_t const query_stats_sample_capacity = 1024;
+
+struct query_stats final {
+    std::string sql;
+    std::size_t count = 0;
+    std::chrono::nanoseconds total_duration{0};
+    std::chrono::nanoseconds max_duration{0};
+    std::size_t rows = 0;
+    std::size_t fullscan_steps = 0;
+    std::size_t sorts = 0;
+    std::size_t autoindexes = 0;
+
+    [[nodiscard]] std::chrono::nanoseconds p50() const;
+    [[nodiscard]] std::chrono::nanoseconds p99() const;
+    [[nodiscard]] std::chrono::nanoseconds percentile(double const) const;
+
+    void add_sample(std::chrono::nanoseconds const);
+
+   private:
+    // 直近のquery_stats_sample_capacity回分の実行時間だけを持つ
+    std::vector<std::chrono::nanoseconds> _samples;
+    std::size_t _next_sample_idx = 0;
+};
+
+struct slow_query final {
+    std::string sql;
+    std::string normalized_sql;
+    std::chrono::nanoseconds duration;
+    std::size_t rows;
+};
+
+using slow_query_f = std::function<void(db::slow_query const &)>;
+
+// リテラルをプレースホルダに置き換えて、値だけが違うSQLを同じものとして扱えるようにする
+[[nodiscard]] std::string normalize_sql(std::string_view const sql);
+
+struct query_profiler final {
+    [[nodiscard]] bool is_enabled() const;
+    void set_enabled(bool const);
+
+    void set_slow_query_handler(std::chrono::nanoseconds const threshold, db::slow_query_f);
+    [[nodiscard]] bool has_slow_query_handler() const;
+
+    [[nodiscard]] bool is_tracing() const;
+
+    void record_row(sqlite3_stmt *const);
+    void record_profile(sqlite3_stmt *const, std::chrono::nanoseconds const duration);
+
+    [[nodiscard]] std::vector<db::query_stats> stats() const;
+    void reset_stats();
+
+   private:
+    bool _is_enabled = false;
+    std::chrono::nanoseconds _slow_query_threshold{0};
+    db::slow_query_f _slow_query_handler = nullptr;
+
+    std::unordered_map<sqlite3_stmt *, std::size_t> _pending_rows;
+    std::unordered_map<std::string, std::string> _normalized_sqls;
+    std::unordered_map<std::string, db::query_stats> _stats;
+
+    std::string const &_normalized_sql(std::string const &sql);
+};
+}  // namespace yas::db
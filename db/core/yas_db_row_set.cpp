@@ -69,17 +69,34 @@ int row_set::column_count() const {
 }
 
 row_set::index_result_t row_set::column_index(std::string column_name) const {
-    std::string lower_column_name = to_lower(std::move(column_name));
-
     auto const &map = this->_get_or_make_column_name_to_index_map();
 
-    if (map.count(lower_column_name) > 0) {
-        return row_set::index_result_t{map.at(lower_column_name)};
+    if (auto const it = map.find(column_name); it != map.end()) {
+        return row_set::index_result_t{it->second};
+    }
+
+    if (auto const it = map.find(to_lower(std::move(column_name))); it != map.end()) {
+        return row_set::index_result_t{it->second};
     }
 
     return row_set::index_result_t{nullptr};
 }
 
+std::vector<int> row_set::column_indices(std::vector<std::string> const &column_names) const {
+    std::vector<int> indices;
+    indices.reserve(column_names.size());
+
+    for (std::string const &column_name : column_names) {
+        if (auto const index_result = this->column_index(column_name)) {
+            indices.push_back(index_result.value());
+        } else {
+            indices.push_back(-1);
+        }
+    }
+
+    return indices;
+}
+
 std::string row_set::column_name(int const column_idx) const {
     return sqlite3_column_name(this->statement()->stmt(), column_idx);
 }
@@ -110,8 +127,7 @@ db::value row_set::column_value(int const column_idx) const {
                 const void *const data = sqlite3_column_blob(stmt, column_idx);
                 return db::value{data, data_size};
             } else if (type == SQLITE_TEXT) {
-                std::string text = (const char *)sqlite3_column_text(stmt, column_idx);
-                return db::value{text};
+                return db::value{std::string{this->get<std::string_view>(column_idx)}};
             }
         }
     }
@@ -142,6 +158,51 @@ db::value_map_t row_set::values() const {
     return map;
 }
 
+template <>
+int64_t row_set::get<int64_t>(int const column_idx) const {
+    if (column_idx < 0) {
+        return 0;
+    }
+    return sqlite3_column_int64(this->statement()->stmt(), column_idx);
+}
+
+template <>
+double row_set::get<double>(int const column_idx) const {
+    if (column_idx < 0) {
+        return 0.0;
+    }
+    return sqlite3_column_double(this->statement()->stmt(), column_idx);
+}
+
+template <>
+std::string_view row_set::get<std::string_view>(int const column_idx) const {
+    if (column_idx < 0) {
+        return {};
+    }
+
+    sqlite3_stmt *const stmt = this->statement()->stmt();
+    // 先にtextを取得してからbytesを取得する（型変換でポインタが変わらないように）
+    auto const *const text = reinterpret_cast<char const *>(sqlite3_column_text(stmt, column_idx));
+    if (!text) {
+        return {};
+    }
+    return std::string_view{text, static_cast<std::size_t>(sqlite3_column_bytes(stmt, column_idx))};
+}
+
+template <>
+std::span<std::byte const> row_set::get<std::span<std::byte const>>(int const column_idx) const {
+    if (column_idx < 0) {
+        return {};
+    }
+
+    sqlite3_stmt *const stmt = this->statement()->stmt();
+    auto const *const data = static_cast<std::byte const *>(sqlite3_column_blob(stmt, column_idx));
+    if (!data) {
+        return {};
+    }
+    return std::span<std::byte const>{data, static_cast<std::size_t>(sqlite3_column_bytes(stmt, column_idx))};
+}
+
 void row_set::close() {
     this->_statement->reset();
     if (this->_database) {
@@ -10,7 +10,10 @@
 #include <db/yas_db_types.h>
 #include <db/yas_db_value.h>
 
+#include <cstddef>
+#include <span>
 #include <string>
+#include <string_view>
 
 namespace yas {
 template <typename T, typename U>
@@ -41,6 +44,7 @@ struct row_set final : closable, db_settable {
 
     [[nodiscard]] int column_count() const;
     [[nodiscard]] index_result_t column_index(std::string column_name) const;
+    [[nodiscard]] std::vector<int> column_indices(std::vector<std::string> const &column_names) const;
     [[nodiscard]] std::string column_name(int const column_idx) const;
     [[nodiscard]] bool column_is_null(int const column_idx);
     [[nodiscard]] bool column_is_null(std::string column_name);
@@ -50,6 +54,10 @@ struct row_set final : closable, db_settable {
 
     [[nodiscard]] db::value_map_t values() const;
 
+    // db::valueを作らずにカラムの値を取得する。string_viewとspanは次のnext()を呼ぶまで有効
+    template <typename T>
+    [[nodiscard]] T get(int const column_idx) const;
+
     [[nodiscard]] static row_set_ptr make_shared(db::statement_ptr const &, database_ptr const &,
                                                  std::vector<db::value> const &);
 
@@ -66,4 +74,13 @@ struct row_set final : closable, db_settable {
 
     std::unordered_map<std::string, int> const &_get_or_make_column_name_to_index_map() const;
 };
+
+template <>
+int64_t row_set::get<int64_t>(int const) const;
+template <>
+double row_set::get<double>(int const) const;
+template <>
+std::string_view row_set::get<std::string_view>(int const) const;
+template <>
+std::span<std::byte const> row_set::get<std::span<std::byte const>>(int const) const;
 }  // namespace yas::db
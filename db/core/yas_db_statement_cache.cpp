@@ -0,0 +1,96 @@
+//
+//  yas_db_statement_cache.cpp
+//
+
+#include "yas_db_statement_cache.h"
+
+#include "yas_db_statement.h"
+
+using namespace yas;
+using namespace yas::db;
+
+statement_cache::statement_cache(std::size_t const capacity) : _capacity(capacity) {
+}
+
+std::size_t statement_cache::capacity() const {
+    return this->_capacity;
+}
+
+void statement_cache::set_capacity(std::size_t const capacity) {
+    this->_capacity = capacity;
+    this->_evict_if_needed();
+}
+
+std::size_t statement_cache::size() const {
+    return this->_statements.size();
+}
+
+// 使われていないステートメントを取得して、最近使われたものとして先頭に移動する
+db::statement_ptr statement_cache::get(std::string const &query) {
+    if (auto const it = this->_iterators.find(query); it != this->_iterators.end()) {
+        for (auto const &statement_it : it->second) {
+            if (!(*statement_it)->in_use()) {
+                this->_statements.splice(this->_statements.begin(), this->_statements, statement_it);
+                ++this->_stats.hits;
+                return *statement_it;
+            }
+        }
+    }
+
+    ++this->_stats.misses;
+    return nullptr;
+}
+
+void statement_cache::set(db::statement_ptr const &statement, std::string const &query) {
+    statement->set_query(query);
+
+    this->_statements.push_front(statement);
+    this->_iterators[query].push_back(this->_statements.begin());
+
+    this->_evict_if_needed();
+}
+
+void statement_cache::clear() {
+    this->_statements.clear();
+    this->_iterators.clear();
+}
+
+void statement_cache::close_all() {
+    for (auto const &statement : this->_statements) {
+        if (db::closable_ptr const closable = closable::cast(statement)) {
+            closable->close();
+        }
+    }
+    this->clear();
+}
+
+void statement_cache::record_prepare(std::chrono::nanoseconds const duration) {
+    ++this->_stats.prepare_count;
+    this->_stats.prepare_duration += duration;
+}
+
+db::statement_cache_stats const &statement_cache::stats() const {
+    return this->_stats;
+}
+
+void statement_cache::reset_stats() {
+    this->_stats = {};
+}
+
+// 容量を超えていたら最後に使われたのが古いものから取り除く
+// 行の取得中のステートメントはrow_setが保持しているので、row_setが破棄される時にfinalizeされる
+void statement_cache::_evict_if_needed() {
+    while (this->_statements.size() > this->_capacity) {
+        auto const last_it = std::prev(this->_statements.end());
+        auto const &query = (*last_it)->query();
+
+        auto &iterators = this->_iterators.at(query);
+        std::erase(iterators, last_it);
+        if (iterators.empty()) {
+            this->_iterators.erase(query);
+        }
+
+        this->_statements.erase(last_it);
+        ++this->_stats.evictions;
+    }
+}
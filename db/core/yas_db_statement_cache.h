@@ -0,0 +1,52 @@
+//
+//  yas_db_statement_cache.h
+//
+
+#pragma once
+
+#include <db/yas_db_ptr.h>
+
+#include <chrono>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace yas::db {
+static std::size_t const default_statement_cache_capacity = 128;
+
+struct statement_cache_stats final {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+    std::size_t prepare_count = 0;
+    std::chrono::nanoseconds prepare_duration{0};
+};
+
+struct statement_cache final {
+    explicit statement_cache(std::size_t const capacity);
+
+    [[nodiscard]] std::size_t capacity() const;
+    void set_capacity(std::size_t const);
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] db::statement_ptr get(std::string const &query);
+    void set(db::statement_ptr const &, std::string const &query);
+    void clear();
+    void close_all();
+
+    void record_prepare(std::chrono::nanoseconds const);
+    [[nodiscard]] db::statement_cache_stats const &stats() const;
+    void reset_stats();
+
+   private:
+    using statement_list_t = std::list<db::statement_ptr>;
+
+    std::size_t _capacity;
+    statement_list_t _statements;
+    std::unordered_map<std::string, std::vector<statement_list_t::iterator>> _iterators;
+    db::statement_cache_stats _stats;
+
+    void _evict_if_needed();
+};
+}  // namespace yas::db
@@ -22,6 +22,9 @@ static std::string const rowid_field = "rowid";
 
 using update_result_t = result<std::nullptr_t, db::error>;
 using query_result_t = result<db::row_set_ptr, db::error>;
+using prepared_statement_result_t = result<db::prepared_statement_ptr, db::error>;
+using backup_result_t = result<db::backup_ptr, db::error>;
+using blob_stream_result_t = result<db::blob_stream_ptr, db::error>;
 using row_result_t = result<sqlite3_int64, db::error>;
 using count_result_t = result<int, db::error>;
 using integrity_result_t = result<std::nullptr_t, std::string>;
@@ -8,6 +8,8 @@
 #include <db/yas_db_types.h>
 
 #include <memory>
+#include <string>
+#include <variant>
 #include <vector>
 
 namespace yas::db {
@@ -64,11 +66,6 @@ struct null {
 };
 
 struct value final {
-    template <typename T>
-    class typed_impl;
-
-    class impl;
-
     explicit value(uint8_t const &);
     explicit value(int8_t const &);
     explicit value(uint16_t const &);
@@ -109,11 +106,20 @@ struct value final {
     bool operator!=(value const &rhs) const;
 
    private:
-    std::shared_ptr<impl> _impl;
+    using shared_text_t = std::shared_ptr<text::type const>;
+    using shared_blob_t = std::shared_ptr<blob::type const>;
+    using storage_t = std::variant<null::type, integer::type, real::type, text::type, shared_text_t, shared_blob_t>;
+
+    storage_t _storage;
 
-    static std::shared_ptr<db::value::typed_impl<null>> const &null_value_impl_ptr();
+    [[nodiscard]] std::size_t _type_index() const;
 };
 
+template <>
+text::type const &value::get<text>() const;
+template <>
+blob::type const &value::get<blob>() const;
+
 db::value const &null_value();
 }  // namespace yas::db
 
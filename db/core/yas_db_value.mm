@@ -16,8 +16,11 @@ blob::blob() : _vector(), _data(nullptr), _size(0) {
 }
 
 template <>
-blob::blob(const void *const data, std::size_t const size, copy_tag_t const) : _vector(size), _data(data), _size(size) {
+blob::blob(const void *const data, std::size_t const size, copy_tag_t const)
+    : _vector(size), _data(nullptr), _size(size) {
     memcpy(this->_vector.data(), data, size);
+    // コピーした方を指す。元のデータは呼び出し後に破棄されてもよい
+    this->_data = this->_vector.data();
 }
 
 template <>
@@ -56,83 +59,59 @@ std::size_t blob::size() const {
     return this->_size;
 }
 
-#pragma mark - value::impl
-
-struct db::value::impl {
-    virtual std::type_info const &type() const = 0;
-    virtual bool is_equal(std::shared_ptr<impl> const &rhs) const = 0;
-
-    uintptr_t identifier() {
-        return reinterpret_cast<uintptr_t>(this);
-    }
-};
-
-template <typename T>
-struct db::value::typed_impl : impl {
-    typename T::type _value;
-
-    typed_impl(typename T::type const &val) : _value(val) {
-    }
-
-    typed_impl(typename T::type &&val) : _value(std::move(val)) {
-    }
-
-    typed_impl(typed_impl const &) = delete;
-    typed_impl(typed_impl &&) = delete;
-    typed_impl &operator=(typed_impl const &) = delete;
-    typed_impl &operator=(typed_impl &&) = delete;
-
-    ~typed_impl() = default;
-
-    virtual bool is_equal(std::shared_ptr<impl> const &rhs) const override {
-        if (auto casted_rhs = std::dynamic_pointer_cast<typed_impl>(rhs)) {
-            std::type_info const &type_info = type();
-            if (type_info == casted_rhs->type()) {
-                return this->_value == casted_rhs->_value;
-            }
-        }
-
-        return false;
-    }
+#pragma mark - value
 
-    std::type_info const &type() const override {
-        return typeid(T);
-    }
+namespace yas::db {
+// 短いtextはvalueの中に直接持ち、長いtextとblobはコピーしても共有されるバッファに持つ
+static std::size_t constexpr inline_text_max_size = 15;
+
+enum value_storage_index : std::size_t {
+    null_index,
+    integer_index,
+    real_index,
+    text_index,
+    shared_text_index,
+    shared_blob_index,
 };
+}  // namespace yas::db
 
-#pragma mark - value
-
-db::value::value(uint8_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(uint8_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(int8_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(int8_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(uint16_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(uint16_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(int16_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(int16_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(uint32_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(uint32_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(int32_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(int32_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(uint64_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(uint64_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
-db::value::value(int64_t const &value) : _impl(std::make_unique<typed_impl<db::integer>>(value)) {
+db::value::value(int64_t const &value) : _storage(std::in_place_type<integer::type>, value) {
 }
 
-db::value::value(float const &value) : _impl(std::make_unique<typed_impl<real>>(value)) {
+db::value::value(float const &value) : _storage(std::in_place_type<real::type>, value) {
 }
-db::value::value(double const &value) : _impl(std::make_unique<typed_impl<real>>(value)) {
+db::value::value(double const &value) : _storage(std::in_place_type<real::type>, value) {
 }
 
-db::value::value(std::string const &value) : _impl(std::make_unique<typed_impl<text>>(value)) {
+db::value::value(std::string const &text_value) : value(std::string{text_value}) {
 }
-db::value::value(std::string &&value) : _impl(std::make_unique<typed_impl<text>>(std::move(value))) {
+db::value::value(std::string &&value) {
+    if (value.size() <= inline_text_max_size) {
+        this->_storage.emplace<text::type>(std::move(value));
+    } else {
+        this->_storage.emplace<shared_text_t>(std::make_shared<text::type const>(std::move(value)));
+    }
 }
 
-db::value::value(blob::type &&value) : _impl(std::make_unique<typed_impl<blob>>(std::move(value))) {
+db::value::value(blob::type &&value)
+    : _storage(std::in_place_type<shared_blob_t>, std::make_shared<blob::type const>(std::move(value))) {
 }
 
-db::value::value(null::type) : _impl(null_value_impl_ptr()) {
+db::value::value(null::type) : _storage(std::in_place_type<null::type>, nullptr) {
 }
 
 template <>
@@ -149,74 +128,131 @@ db::value::~value() = default;
 
 db::value::value(value const &) = default;
 
-db::value::value(value &&rhs) : _impl(std::move(rhs._impl)) {
-    rhs._impl = null_value_impl_ptr();
+db::value::value(value &&rhs) : _storage(std::move(rhs._storage)) {
+    rhs._storage.emplace<null::type>(nullptr);
 }
 
 db::value &db::value::operator=(value const &) = default;
 
 db::value &db::value::operator=(value &&rhs) {
-    this->_impl = std::move(rhs._impl);
-    rhs._impl = null_value_impl_ptr();
+    if (this != &rhs) {
+        this->_storage = std::move(rhs._storage);
+        rhs._storage.emplace<null::type>(nullptr);
+    }
     return *this;
 }
 
 uintptr_t db::value::identifier() const {
-    return this->_impl->identifier();
+    switch (this->_storage.index()) {
+        case shared_text_index:
+            return reinterpret_cast<uintptr_t>(std::get<shared_text_t>(this->_storage).get());
+        case shared_blob_index:
+            return reinterpret_cast<uintptr_t>(std::get<shared_blob_t>(this->_storage).get());
+        default:
+            return reinterpret_cast<uintptr_t>(this);
+    }
 }
 
 db::value::operator bool() const {
-    return this->_impl != nullptr && this->type() != typeid(db::null);
+    return this->_storage.index() != null_index;
 }
 
 std::type_info const &db::value::type() const {
-    return this->_impl->type();
+    switch (this->_type_index()) {
+        case integer_index:
+            return typeid(db::integer);
+        case real_index:
+            return typeid(db::real);
+        case text_index:
+            return typeid(db::text);
+        case shared_blob_index:
+            return typeid(db::blob);
+        default:
+            return typeid(db::null);
+    }
 }
 
 template <typename T>
 typename T::type const &db::value::get() const {
-    if (auto typed = std::dynamic_pointer_cast<typed_impl<T>>(this->_impl)) {
-        return typed->_value;
+    if (auto const *const stored = std::get_if<typename T::type>(&this->_storage)) {
+        return *stored;
     }
 
     static const typename T::type _default{};
     return _default;
 }
 
+template <>
+db::text::type const &db::value::get<db::text>() const {
+    if (auto const *const stored = std::get_if<text::type>(&this->_storage)) {
+        return *stored;
+    } else if (auto const *const shared = std::get_if<shared_text_t>(&this->_storage)) {
+        return **shared;
+    }
+
+    static const text::type _default{};
+    return _default;
+}
+
+template <>
+blob::type const &db::value::get<blob>() const {
+    if (auto const *const shared = std::get_if<shared_blob_t>(&this->_storage)) {
+        return **shared;
+    }
+
+    static const blob::type _default{};
+    return _default;
+}
+
 template db::integer::type const &db::value::get<db::integer>() const;
 template db::real::type const &db::value::get<db::real>() const;
-template db::text::type const &db::value::get<db::text>() const;
-template blob::type const &db::value::get<blob>() const;
 template db::null::type const &db::value::get<db::null>() const;
 
 std::string db::value::sql() const {
-    std::type_info const &type_info = type();
-    if (type_info == typeid(db::integer)) {
-        return std::to_string(get<db::integer>());
-    } else if (type_info == typeid(db::real)) {
-        return std::to_string(get<db::real>());
-    } else if (type_info == typeid(db::text)) {
-        return "'" + get<db::text>() + "'";
-    } else if (type_info == typeid(blob)) {
-        throw std::runtime_error("don't get sql from blob value");
-    } else {
-        return "null";
+    switch (this->_type_index()) {
+        case integer_index:
+            return std::to_string(get<db::integer>());
+        case real_index:
+            return std::to_string(get<db::real>());
+        case text_index:
+            return "'" + get<db::text>() + "'";
+        case shared_blob_index:
+            throw std::runtime_error("don't get sql from blob value");
+        default:
+            return "null";
     }
 }
 
-std::shared_ptr<db::value::typed_impl<db::null>> const &db::value::null_value_impl_ptr() {
-    static auto _impl_ptr = std::make_shared<db::value::typed_impl<db::null>>(nullptr);
-    return _impl_ptr;
-}
-
 bool db::value::operator==(value const &rhs) const {
-    return this->_impl && rhs._impl && this->_impl->is_equal(rhs._impl);
+    std::size_t const type_index = this->_type_index();
+
+    if (type_index != rhs._type_index()) {
+        return false;
+    }
+
+    switch (type_index) {
+        case integer_index:
+            return std::get<integer::type>(this->_storage) == std::get<integer::type>(rhs._storage);
+        case real_index:
+            return std::get<real::type>(this->_storage) == std::get<real::type>(rhs._storage);
+        case text_index:
+            return this->get<db::text>() == rhs.get<db::text>();
+        case shared_blob_index:
+            return this->get<db::blob>() == rhs.get<db::blob>();
+        default:
+            return true;
+    }
 }
 
 bool db::value::operator!=(value const &rhs) const {
     return !(*this == rhs);
 }
 
+std::size_t db::value::_type_index() const {
+    std::size_t const index = this->_storage.index();
+    return index == shared_text_index ? text_index : index;
+}
+
 #pragma mark -
 
 db::value const &db::null_value() {
@@ -8,24 +8,35 @@
 #include <optional>
 
 namespace yas::db {
+class backup;
+class blob_stream;
 class database;
 class info;
 class manager;
+class prepared_statement;
 class row_set;
 class statement;
 class object_id;
 class const_object;
 class object;
+class reader_pool;
+class query_plan_checker;
 
 class closable;
 class row_set_observable;
 class db_settable;
 class manageable_object;
 
+using backup_ptr = std::shared_ptr<backup>;
+using backup_wptr = std::weak_ptr<backup>;
+using blob_stream_ptr = std::shared_ptr<blob_stream>;
+using blob_stream_wptr = std::weak_ptr<blob_stream>;
 using database_ptr = std::shared_ptr<database>;
 using database_wptr = std::weak_ptr<database>;
 using manager_ptr = std::shared_ptr<manager>;
 using manager_wptr = std::weak_ptr<manager>;
+using prepared_statement_ptr = std::shared_ptr<prepared_statement>;
+using prepared_statement_wptr = std::weak_ptr<prepared_statement>;
 using row_set_ptr = std::shared_ptr<row_set>;
 using row_set_wptr = std::weak_ptr<row_set>;
 using statement_ptr = std::shared_ptr<statement>;
@@ -33,6 +44,8 @@ using object_id_ptr = std::shared_ptr<object_id>;
 using const_object_ptr = std::shared_ptr<const_object>;
 using object_ptr = std::shared_ptr<object>;
 using object_wptr = std::weak_ptr<object>;
+using reader_pool_ptr = std::shared_ptr<reader_pool>;
+using query_plan_checker_ptr = std::shared_ptr<query_plan_checker>;
 
 using closable_ptr = std::shared_ptr<closable>;
 using row_set_observable_ptr = std::shared_ptr<row_set_observable>;
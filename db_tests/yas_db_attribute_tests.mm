@@ -122,6 +122,14 @@ using namespace yas;
     XCTAssertEqual(attr.sql(), "pk_id INTEGER PRIMARY KEY AUTOINCREMENT");
 }
 
+- (void)test_clustered_id_sql {
+    auto const &attr = db::attribute::clustered_id_attribute();
+
+    XCTAssertEqual(attr.name, "pk_id");
+    XCTAssertEqual(attr.primary, false);
+    XCTAssertEqual(attr.sql(), "pk_id INTEGER UNIQUE");
+}
+
 - (void)test_full_sql {
     db::attribute attr{{"test_name", db::attribute_type::integer, db::value{5}, true, true, true}};
 
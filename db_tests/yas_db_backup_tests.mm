@@ -0,0 +1,160 @@
+//
+//  yas_db_backup_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_backup_tests : XCTestCase
+
+@end
+
+@implementation yas_db_backup_tests
+
+- (void)setUp {
+    [super setUp];
+    [yas_db_test_utils deleteDatabase];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_backup_progress {
+    XCTAssertTrue((db::backup_progress{.remaining = 0, .page_count = 10}).is_done());
+    XCTAssertFalse((db::backup_progress{.remaining = 1, .page_count = 10}).is_done());
+}
+
+- (void)test_step {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+    std::vector<std::byte> const data(1000, std::byte{1});
+    std::vector<db::value_vector_t> rows;
+    for (int idx = 0; idx < 100; ++idx) {
+        rows.push_back({db::value{idx}, db::value{data.data(), data.size()}});
+    }
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"field_a", "field_b"}), rows));
+
+    auto backup_result = db->make_backup([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_result);
+
+    db::backup_ptr const &backup = backup_result.value();
+    XCTAssertEqual(backup->destination_path(), [yas_db_test_utils backup_database_path]);
+    XCTAssertFalse(backup->is_closed());
+    XCTAssertFalse(backup->is_done());
+    XCTAssertTrue(db->has_backups());
+
+    auto step_result = backup->step(1);
+    XCTAssertTrue(step_result);
+    XCTAssertGreaterThan(step_result.value().page_count, 1);
+    XCTAssertEqual(step_result.value().remaining, step_result.value().page_count - 1);
+    XCTAssertFalse(backup->is_done());
+
+    // 同じ接続で書き込めばバックアップにも反映される
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"field_a", "field_b"}),
+                                           std::span{rows.data(), 10}));
+
+    while (!backup->is_done()) {
+        step_result = backup->step(5);
+        XCTAssertTrue(step_result);
+    }
+
+    XCTAssertTrue(step_result.value().is_done());
+    auto const backup_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_db->open());
+    auto const select_result = db::select(backup_db, {.table = "test_table"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 110);
+}
+
+- (void)test_close_with_database {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    auto backup_result = db->make_backup([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_result);
+
+    db::backup_ptr const &backup = backup_result.value();
+
+    db->close();
+
+    XCTAssertTrue(backup->is_closed());
+    XCTAssertFalse(db->has_backups());
+
+    auto const step_result = backup->step(1);
+    XCTAssertFalse(step_result);
+    XCTAssertEqual(step_result.error().type(), db::error_type::closed);
+}
+
+- (void)test_make_backup_closed {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+
+    auto const backup_result = db->make_backup([yas_db_test_utils backup_database_path]);
+    XCTAssertFalse(backup_result);
+    XCTAssertEqual(backup_result.error().type(), db::error_type::closed);
+}
+
+- (void)test_backup_to {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+    std::vector<std::byte> const data(1000, std::byte{1});
+    std::vector<db::value_vector_t> rows;
+    for (int idx = 0; idx < 100; ++idx) {
+        rows.push_back({db::value{idx}, db::value{data.data(), data.size()}});
+    }
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"field_a", "field_b"}), rows));
+
+    std::vector<db::backup_progress> progresses;
+
+    auto const result = db->backup_to([yas_db_test_utils backup_database_path], 5,
+                                      [&progresses](db::backup_progress const &progress) {
+                                          progresses.push_back(progress);
+                                          return true;
+                                      });
+
+    XCTAssertTrue(result);
+    XCTAssertGreaterThan(progresses.size(), 1);
+    XCTAssertTrue(progresses.back().is_done());
+    XCTAssertFalse(db->has_backups());
+    auto const backup_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_db->open());
+    auto const select_result = db::select(backup_db, {.table = "test_table"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 100);
+}
+
+- (void)test_backup_to_cancel {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+    std::vector<std::byte> const data(1000, std::byte{1});
+    std::vector<db::value_vector_t> rows;
+    for (int idx = 0; idx < 100; ++idx) {
+        rows.push_back({db::value{idx}, db::value{data.data(), data.size()}});
+    }
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"field_a", "field_b"}), rows));
+
+    std::size_t called = 0;
+
+    auto const result = db->backup_to([yas_db_test_utils backup_database_path], 1,
+                                      [&called](db::backup_progress const &) {
+                                          ++called;
+                                          return false;
+                                      });
+
+    XCTAssertFalse(result);
+    XCTAssertEqual(result.error().code().raw_value(), SQLITE_INTERRUPT);
+    XCTAssertEqual(called, 1);
+    XCTAssertFalse(db->has_backups());
+}
+
+@end
@@ -0,0 +1,188 @@
+//
+//  yas_db_blob_stream_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_blob_stream_tests : XCTestCase
+
+@end
+
+@implementation yas_db_blob_stream_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_write_and_read {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+    XCTAssertTrue(db->execute_update("INSERT INTO test_table(blob_field) VALUES(zeroblob(1000));"));
+
+    auto const rowid_result = db->last_insert_rowid();
+    XCTAssertTrue(rowid_result);
+    sqlite3_int64 const rowid = rowid_result.value();
+
+    auto open_result = db->open_blob("test_table", "blob_field", rowid, db::blob_open_mode::read_write);
+    XCTAssertTrue(open_result);
+
+    db::blob_stream_ptr const &stream = open_result.value();
+    XCTAssertFalse(stream->is_closed());
+    XCTAssertEqual(stream->mode(), db::blob_open_mode::read_write);
+    XCTAssertEqual(stream->size(), 1000);
+
+    for (std::size_t idx = 0; idx < 10; ++idx) {
+        std::vector<std::byte> const chunk(100, std::byte(idx));
+        XCTAssertTrue(stream->write(idx * 100, chunk));
+    }
+
+    std::vector<std::byte> buffer(150);
+    auto read_result = stream->read(50, buffer);
+    XCTAssertTrue(read_result);
+    XCTAssertEqual(read_result.value(), 150);
+    XCTAssertEqual(buffer.at(0), std::byte{0});
+    XCTAssertEqual(buffer.at(49), std::byte{0});
+    XCTAssertEqual(buffer.at(50), std::byte{1});
+    XCTAssertEqual(buffer.at(149), std::byte{1});
+
+    // 末尾を越える分は読まない
+    read_result = stream->read(900, buffer);
+    XCTAssertTrue(read_result);
+    XCTAssertEqual(read_result.value(), 100);
+    XCTAssertEqual(buffer.at(99), std::byte{9});
+
+    XCTAssertFalse(stream->read(1001, buffer));
+
+    // サイズを越える書き込みはできない
+    auto const write_result = stream->write(950, std::vector<std::byte>(100));
+    XCTAssertFalse(write_result);
+    XCTAssertEqual(write_result.error().type(), db::error_type::invalid_argument);
+
+    auto const select_result = db::select(db, {.table = "test_table"});
+    XCTAssertTrue(select_result);
+    auto const &blob = select_result.value().at(0).at("blob_field").get<db::blob>();
+    XCTAssertEqual(blob.size(), 1000);
+    XCTAssertEqual(static_cast<uint8_t const *>(blob.data())[999], 9);
+}
+
+- (void)test_read_chunks {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+
+    std::vector<std::byte> data(250);
+    for (std::size_t idx = 0; idx < data.size(); ++idx) {
+        data.at(idx) = std::byte(idx);
+    }
+    XCTAssertTrue(
+        db->execute_update(db::insert_sql("test_table", {"blob_field"}), {db::value{data.data(), data.size()}}));
+
+    auto open_result = db->open_blob("test_table", "blob_field", 1);
+    XCTAssertTrue(open_result);
+
+    db::blob_stream_ptr const &stream = open_result.value();
+    XCTAssertEqual(stream->mode(), db::blob_open_mode::read_only);
+
+    std::vector<std::size_t> chunk_sizes;
+    std::vector<std::byte> read_data;
+
+    auto read_result = stream->read_chunks(100, [&chunk_sizes, &read_data](std::span<std::byte const> const chunk) {
+        chunk_sizes.push_back(chunk.size());
+        read_data.insert(read_data.end(), chunk.begin(), chunk.end());
+        return true;
+    });
+
+    XCTAssertTrue(read_result);
+    XCTAssertEqual(read_result.value(), 250);
+    XCTAssertEqual(chunk_sizes, (std::vector<std::size_t>{100, 100, 50}));
+    XCTAssertTrue(read_data == data);
+
+    std::size_t called = 0;
+
+    read_result = stream->read_chunks(100, [&called](std::span<std::byte const> const) {
+        ++called;
+        return false;
+    });
+
+    XCTAssertTrue(read_result);
+    XCTAssertEqual(read_result.value(), 100);
+    XCTAssertEqual(called, 1);
+
+    XCTAssertFalse(stream->read_chunks(0, [](std::span<std::byte const> const) { return true; }));
+
+    // 読み込み専用では書き込めない
+    XCTAssertFalse(stream->write(0, std::vector<std::byte>(10)));
+}
+
+- (void)test_reopen {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+    XCTAssertTrue(db->execute_update("INSERT INTO test_table(blob_field) VALUES(zeroblob(10));"));
+    XCTAssertTrue(db->execute_update("INSERT INTO test_table(blob_field) VALUES(zeroblob(20));"));
+
+    auto open_result = db->open_blob("test_table", "blob_field", 1);
+    XCTAssertTrue(open_result);
+
+    db::blob_stream_ptr const &stream = open_result.value();
+    XCTAssertEqual(stream->size(), 10);
+
+    XCTAssertTrue(stream->reopen(2));
+    XCTAssertEqual(stream->size(), 20);
+
+    XCTAssertFalse(stream->reopen(3));
+}
+
+- (void)test_open_failed {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+
+    auto open_result = db->open_blob("test_table", "blob_field", 1);
+    XCTAssertFalse(open_result);
+    XCTAssertEqual(open_result.error().type(), db::error_type::closed);
+
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+
+    open_result = db->open_blob("test_table", "blob_field", 1);
+    XCTAssertFalse(open_result);
+    XCTAssertEqual(open_result.error().type(), db::error_type::sqlite);
+
+    open_result = db->open_blob("test_table", "unknown_field", 1);
+    XCTAssertFalse(open_result);
+}
+
+- (void)test_close_with_database {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+    XCTAssertTrue(db->execute_update("INSERT INTO test_table(blob_field) VALUES(zeroblob(10));"));
+
+    auto open_result = db->open_blob("test_table", "blob_field", 1);
+    XCTAssertTrue(open_result);
+
+    db::blob_stream_ptr const stream = open_result.value();
+
+    db->close();
+
+    XCTAssertTrue(stream->is_closed());
+    XCTAssertEqual(stream->size(), 0);
+
+    std::vector<std::byte> buffer(10);
+    auto const read_result = stream->read(0, buffer);
+    XCTAssertFalse(read_result);
+    XCTAssertEqual(read_result.error().type(), db::error_type::closed);
+}
+
+@end
@@ -0,0 +1,87 @@
+//
+//  yas_db_busy_retry_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_busy_retry_tests : XCTestCase
+
+@end
+
+@implementation yas_db_busy_retry_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_default_policy {
+    db::busy_retry_policy const policy;
+
+    XCTAssertEqual(policy.initial_delay.count(), 100);
+    XCTAssertEqual(policy.max_delay.count(), 50000);
+    XCTAssertEqual(policy.multiplier, 2.0);
+    XCTAssertEqual(policy.jitter, 0.5);
+}
+
+- (void)test_delay {
+    db::busy_retry_policy const policy{.initial_delay = std::chrono::microseconds{100},
+                                       .max_delay = std::chrono::microseconds{1000},
+                                       .multiplier = 2.0,
+                                       .jitter = 0.5};
+
+    XCTAssertEqual(policy.delay(0, 0.0).count(), 100);
+    XCTAssertEqual(policy.delay(1, 0.0).count(), 200);
+    XCTAssertEqual(policy.delay(3, 0.0).count(), 800);
+    XCTAssertEqual(policy.delay(4, 0.0).count(), 1000);
+    XCTAssertEqual(policy.delay(10, 0.0).count(), 1000);
+
+    XCTAssertEqual(policy.delay(0, 0.5).count(), 75);
+    XCTAssertEqual(policy.delay(10, 0.999).count(), 500);
+}
+
+- (void)test_delay_without_jitter {
+    db::busy_retry_policy const policy{.jitter = 0.0};
+
+    XCTAssertEqual(policy.delay(0, 0.9).count(), policy.delay(0, 0.0).count());
+}
+
+- (void)test_database_stats {
+    db::database_ptr const locking_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(locking_db->open());
+    XCTAssertTrue(db::create_table(locking_db, "test_table", {"field_a"}));
+
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    db->set_max_busy_retry_time_interval(0.05);
+    db->set_busy_retry_policy({.initial_delay = std::chrono::microseconds{1000}});
+    XCTAssertTrue(db->open());
+
+    XCTAssertEqual(db->busy_retry_stats().busy_count, 0);
+
+    XCTAssertTrue(db::begin_transaction(locking_db));
+
+    XCTAssertFalse(db->execute_update("insert into test_table(field_a) values(1)"));
+
+    XCTAssertTrue(db::rollback(locking_db));
+
+    auto const &stats = db->busy_retry_stats();
+    XCTAssertEqual(stats.busy_count, 1);
+    XCTAssertEqual(stats.timeout_count, 1);
+    XCTAssertGreaterThan(stats.retry_count, 0);
+    XCTAssertGreaterThan(stats.total_wait.count(), 0);
+    XCTAssertEqual(stats.max_wait.count(), stats.total_wait.count());
+
+    db->reset_busy_retry_stats();
+
+    XCTAssertEqual(db->busy_retry_stats().busy_count, 0);
+    XCTAssertTrue(db->execute_update("insert into test_table(field_a) values(1)"));
+    XCTAssertEqual(db->busy_retry_stats().busy_count, 0);
+}
+
+@end
@@ -0,0 +1,139 @@
+//
+//  yas_db_column_batch_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_column_batch_tests : XCTestCase
+
+@end
+
+@implementation yas_db_column_batch_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_select_columns {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"int_field", "real_field", "text_field"}));
+
+    std::vector<std::string> const fields{"int_field", "real_field", "text_field"};
+    XCTAssertTrue(db->execute_update(db::insert_sql("test_table", fields),
+                                     {db::value{1}, db::value{1.5}, db::value{"a"}}));
+    XCTAssertTrue(db->execute_update(db::insert_sql("test_table", fields),
+                                     {db::null_value(), db::value{2.5}, db::value{"bc"}}));
+    XCTAssertTrue(db->execute_update(db::insert_sql("test_table", fields),
+                                     {db::value{3}, db::null_value(), db::null_value()}));
+
+    std::vector<db::column_spec> const specs{{.name = "int_field", .type = db::column_type::integer},
+                                             {.name = "real_field", .type = db::column_type::real},
+                                             {.name = "text_field", .type = db::column_type::text}};
+
+    std::size_t called = 0;
+
+    auto const result = db::select_columns(
+        db, {.table = "test_table", .field_orders = {{"int_field", db::order::ascending}}}, specs,
+        [&called](db::column_batch const &batch) {
+            ++called;
+
+            XCTAssertEqual(batch.row_count, 3);
+
+            auto const &int_column = batch.column("int_field");
+            XCTAssertEqual(int_column.integers, (std::vector<int64_t>{0, 1, 3}));
+            XCTAssertTrue(int_column.is_null(0));
+            XCTAssertFalse(int_column.is_null(1));
+
+            auto const &real_column = batch.column("real_field");
+            XCTAssertEqual(real_column.reals, (std::vector<double>{2.5, 1.5, 0.0}));
+            XCTAssertTrue(real_column.is_null(2));
+
+            auto const &text_column = batch.column("text_field");
+            XCTAssertTrue(text_column.text(0) == "bc");
+            XCTAssertTrue(text_column.text(1) == "a");
+            XCTAssertTrue(text_column.text(2).empty());
+            XCTAssertTrue(text_column.is_null(2));
+            XCTAssertEqual(text_column.offsets, (std::vector<std::size_t>{0, 2, 3, 3}));
+
+            return true;
+        });
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 3);
+    XCTAssertEqual(called, 1);
+}
+
+- (void)test_select_columns_in_batches {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"int_field"}));
+
+    std::vector<db::value_vector_t> rows;
+    for (int idx = 0; idx < 100; ++idx) {
+        rows.push_back({db::value{idx}});
+    }
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"int_field"}), rows));
+
+    std::vector<std::size_t> batch_sizes;
+    int64_t sum = 0;
+
+    auto const result = db::select_columns(
+        db, {.table = "test_table"}, {{.name = "int_field", .type = db::column_type::integer}},
+        [&batch_sizes, &sum](db::column_batch const &batch) {
+            batch_sizes.push_back(batch.row_count);
+            for (int64_t const value : batch.columns.at(0).integers) {
+                sum += value;
+            }
+            return true;
+        },
+        30);
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 100);
+    XCTAssertEqual(batch_sizes, (std::vector<std::size_t>{30, 30, 30, 10}));
+    XCTAssertEqual(sum, 4950);
+}
+
+- (void)test_select_columns_stop {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"blob_field"}));
+
+    std::vector<std::byte> const blob{std::byte{1}, std::byte{2}};
+
+    std::vector<db::value_vector_t> rows;
+    for (int idx = 0; idx < 10; ++idx) {
+        rows.push_back({db::value{blob.data(), blob.size()}});
+    }
+    XCTAssertTrue(db->execute_update_batch(db::insert_sql("test_table", {"blob_field"}), rows));
+
+    std::size_t called = 0;
+
+    auto const result = db::select_columns(
+        db, {.table = "test_table"}, {{.name = "blob_field", .type = db::column_type::blob}},
+        [&called, &blob](db::column_batch const &batch) {
+            ++called;
+            auto const span = batch.columns.at(0).blob(1);
+            XCTAssertTrue(std::equal(span.begin(), span.end(), blob.begin(), blob.end()));
+            return false;
+        },
+        4);
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 4);
+    XCTAssertEqual(called, 1);
+    XCTAssertFalse(db->has_opened_row_sets());
+}
+
+@end
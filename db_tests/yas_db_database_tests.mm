@@ -3,6 +3,7 @@
 //
 
 #include <cpp_utils/yas_file_manager.h>
+#include <thread>
 #import "yas_db_test_utils.h"
 
 using namespace yas;
@@ -65,6 +66,47 @@ using namespace yas;
     XCTAssertTrue(file_manager::content_exists(db_path));
 }
 
+- (void)test_open_with_option {
+    auto const db_path = [yas_db_test_utils database_path];
+
+    db::database_ptr const db = db::database::make_shared(
+        db_path, {.journal_mode = db::journal_mode::wal,
+                  .synchronous = db::synchronous::normal,
+                  .cache_size = -4000,
+                  .temp_store = db::temp_store::memory});
+
+    XCTAssertEqual(db->open_option().journal_mode, db::journal_mode::wal);
+
+    XCTAssertTrue(db->open());
+
+    auto const effective_option = db->effective_open_option();
+    XCTAssertEqual(effective_option.journal_mode, db::journal_mode::wal);
+    XCTAssertEqual(effective_option.synchronous, db::synchronous::normal);
+    XCTAssertEqual(effective_option.cache_size, -4000);
+    XCTAssertEqual(effective_option.temp_store, db::temp_store::memory);
+    XCTAssertEqual(effective_option.locking_mode, db::locking_mode::normal);
+    XCTAssertTrue(effective_option.page_size.has_value());
+
+    db->close();
+}
+
+- (void)test_effective_open_option_default {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertEqual(db->effective_open_option().journal_mode, db::journal_mode::delete_journal);
+
+    db->close();
+}
+
+- (void)test_open_failed_when_journal_mode_not_applied {
+    // メモリ上のデータベースはWALにできずmemoryのままになる
+    db::database_ptr const db = db::database::make_shared(db::in_memory_path, {.journal_mode = db::journal_mode::wal});
+
+    XCTAssertFalse(db->open());
+    XCTAssertTrue(db->sqlite_handle() == nullptr);
+}
+
 - (void)test_create_table {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -186,6 +228,70 @@ using namespace yas;
     }));
 }
 
+- (void)test_many_databases {
+    db::database_ptr const first_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(first_db->open());
+    XCTAssertTrue(db::create_table(first_db, "test_table", {"field_a"}));
+    XCTAssertTrue(first_db->execute_update("insert into test_table(field_a) values(1)"));
+
+    std::vector<db::database_ptr> databases;
+
+    for (std::size_t idx = 0; idx < 300; ++idx) {
+        db::database_ptr const db = [yas_db_test_utils create_test_database];
+        XCTAssertTrue(db->open());
+        databases.push_back(db);
+    }
+
+    for (auto const &db : databases) {
+        std::size_t count = 0;
+        XCTAssertTrue(db->execute_statements("select * from test_table;", [&count](db::value_map_t const &) {
+            ++count;
+            return 0;
+        }));
+        XCTAssertEqual(count, 1);
+    }
+}
+
+- (void)test_execute_on_multiple_threads {
+    db::database_ptr const setup_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(setup_db->open());
+    XCTAssertTrue(db::create_table(setup_db, "test_table", {"field_a"}));
+    XCTAssertTrue(setup_db->execute_update("insert into test_table(field_a) values(1)"));
+    XCTAssertTrue(setup_db->execute_update("insert into test_table(field_a) values(2)"));
+
+    std::size_t const thread_count = 4;
+    std::vector<std::size_t> counts(thread_count, 0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        threads.emplace_back([&counts, thread_idx]() {
+            db::database_ptr const db = [yas_db_test_utils create_test_database];
+            if (!db->open()) {
+                return;
+            }
+
+            for (std::size_t idx = 0; idx < 100; ++idx) {
+                auto const result =
+                    db->execute_statements("select * from test_table;", [&counts, thread_idx](auto const &) {
+                        ++counts.at(thread_idx);
+                        return 0;
+                    });
+                if (!result) {
+                    return;
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t const count : counts) {
+        XCTAssertEqual(count, 200);
+    }
+}
+
 - (void)test_execute_query_with_vector {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -284,6 +390,159 @@ using namespace yas;
     XCTAssertNotEqual(query_result_1.value()->statement(), query_result_3.value()->statement());
 }
 
+- (void)test_statement_cache_stats {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"test_field"}));
+
+    db->set_should_cache_statements(true);
+    db->set_statement_cache_capacity(2);
+    db->reset_statement_cache_stats();
+
+    std::string const insert_query = "insert into test_table(test_field) values(:value)";
+
+    XCTAssertTrue(db->execute_update(insert_query, db::value_map_t{{"value", db::value{1}}}));
+    XCTAssertTrue(db->execute_update(insert_query, db::value_map_t{{"value", db::value{2}}}));
+
+    auto const &stats = db->statement_cache_stats();
+    XCTAssertEqual(stats.misses, 1);
+    XCTAssertEqual(stats.hits, 1);
+    XCTAssertEqual(stats.prepare_count, 1);
+    XCTAssertEqual(db->cached_statement_count(), 1);
+
+    XCTAssertTrue(db->execute_query("select * from test_table"));
+    XCTAssertTrue(db->execute_query("select count(*) from test_table"));
+
+    XCTAssertEqual(db->cached_statement_count(), 2);
+    XCTAssertEqual(db->statement_cache_stats().evictions, 1);
+    XCTAssertEqual(db->statement_cache_stats().prepare_count, 3);
+}
+
+- (void)test_execute_update_batch {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    std::vector<db::value_vector_t> const rows{{db::value{1}, db::value{"a"}},
+                                               {db::value{2}, db::value{"b"}},
+                                               {db::value{3}, db::value{"c"}}};
+
+    auto const result = db->execute_update_batch("insert into test_table(field_a, field_b) values(?, ?)", rows);
+
+    XCTAssertTrue(result);
+
+    auto const &summary = result.value();
+    XCTAssertEqual(summary.changes, 3);
+    XCTAssertFalse(summary.has_row_errors());
+    XCTAssertEqual(summary.last_insert_rowids.size(), 3);
+    XCTAssertEqual(summary.last_insert_rowids.at(0), 1);
+    XCTAssertEqual(summary.last_insert_rowids.at(2), 3);
+
+    XCTAssertEqual(db::max(db, "test_table", "field_a").get<db::integer>(), 3);
+}
+
+- (void)test_execute_update_batch_with_named_parameters {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    std::vector<db::value_map_t> const rows{{{"a", db::value{10}}, {"b", db::value{"x"}}},
+                                            {{"a", db::value{20}}, {"b", db::value{"y"}}}};
+
+    auto const result = db->execute_update_batch("insert into test_table(field_a, field_b) values(:a, :b)", rows);
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value().changes, 2);
+    XCTAssertEqual(db::max(db, "test_table", "field_a").get<db::integer>(), 20);
+}
+
+- (void)test_execute_update_batch_row_errors {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db->execute_update("create table test_table(field_a integer unique)"));
+
+    std::vector<db::value_vector_t> const rows{
+        {db::value{1}}, {db::value{2}, db::value{3}}, {db::value{1}}, {db::value{4}}};
+
+    auto const result = db->execute_update_batch("insert into test_table(field_a) values(?)", rows);
+
+    XCTAssertTrue(result);
+
+    auto const &summary = result.value();
+    XCTAssertEqual(summary.changes, 2);
+    XCTAssertTrue(summary.has_row_errors());
+    XCTAssertEqual(summary.row_errors.size(), 2);
+    XCTAssertEqual(summary.row_errors.at(0).row_idx, 1);
+    XCTAssertEqual(summary.row_errors.at(0).error.type(), db::error_type::invalid_query_count);
+    XCTAssertEqual(summary.row_errors.at(1).row_idx, 2);
+    XCTAssertEqual(summary.row_errors.at(1).error.type(), db::error_type::sqlite);
+    XCTAssertEqual(summary.last_insert_rowids.size(), 4);
+    XCTAssertEqual(summary.last_insert_rowids.at(1), 0);
+}
+
+- (void)test_interruption_handler {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    std::string const heavy_sql =
+        "with recursive counter(x) as (select 1 union all select x + 1 from counter where x < 1000000) "
+        "select count(*) from counter;";
+
+    std::size_t call_count = 0;
+    db->set_interruption_handler(
+        [&call_count]() {
+            ++call_count;
+            return call_count > 10;
+        },
+        100);
+
+    auto const result = db->execute_statements(heavy_sql);
+    XCTAssertFalse(result);
+    XCTAssertEqual(result.error().code().raw_value(), SQLITE_INTERRUPT);
+    XCTAssertEqual(call_count, 11);
+
+    db->set_interruption_handler([]() { return false; });
+    XCTAssertTrue(db->execute_statements(heavy_sql));
+
+    db->set_interruption_handler(nullptr);
+    XCTAssertFalse(db->interruption_handler());
+}
+
+- (void)test_interruption_handler_after_reopen {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+
+    db->set_interruption_handler([]() { return true; }, 1);
+
+    XCTAssertTrue(db->open());
+    XCTAssertEqual(db->interruption_instruction_interval(), 1);
+
+    XCTAssertFalse(db->execute_statements("select 1;"));
+}
+
+- (void)test_rollback_after_interruption {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a"}));
+
+    XCTAssertTrue(db::begin_transaction(db));
+    XCTAssertTrue(db->execute_update("insert into test_table(field_a) values(1)"));
+
+    db->set_interruption_handler([]() { return true; }, 1);
+
+    XCTAssertFalse(db->execute_statements("select * from test_table;"));
+    XCTAssertTrue(db::rollback(db));
+    XCTAssertTrue(db->interruption_handler());
+
+    db->set_interruption_handler(nullptr);
+
+    XCTAssertFalse(db::max(db, "test_table", "field_a"));
+}
+
 - (void)test_open_row_sets {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -371,6 +630,112 @@ using namespace yas;
     XCTAssertTrue(result.is_success());
 }
 
+- (void)test_in_memory {
+    XCTAssertTrue(db::is_in_memory_path(db::in_memory_path));
+    XCTAssertTrue(db::is_in_memory_path(db::shared_memory_path("test")));
+    XCTAssertTrue(db::is_in_memory_path("file::memory:"));
+    XCTAssertFalse(db::is_in_memory_path([yas_db_test_utils database_path]));
+    XCTAssertEqual(db::shared_memory_path("test"), "file:test?mode=memory&cache=shared");
+
+    db::database_ptr const db = db::database::make_shared(db::in_memory_path);
+    XCTAssertTrue(db->is_in_memory());
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a"}));
+    XCTAssertTrue(db->execute_update(db::insert_sql("test_table", {"field_a"}), {db::value{1}}));
+
+    // 別の接続からは見えない
+    db::database_ptr const other_db = db::database::make_shared(db::in_memory_path);
+    XCTAssertTrue(other_db->open());
+    XCTAssertFalse(db::table_exists(other_db, "test_table"));
+
+    // 閉じると破棄される
+    db->close();
+    XCTAssertTrue(db->open());
+    XCTAssertFalse(db::table_exists(db, "test_table"));
+}
+
+- (void)test_shared_memory {
+    db::database_ptr const db_a = db::database::make_shared(db::shared_memory_path("test_shared_memory"));
+    db::database_ptr const db_b = db::database::make_shared(db::shared_memory_path("test_shared_memory"));
+    XCTAssertTrue(db_a->is_in_memory());
+    XCTAssertTrue(db_a->open());
+    XCTAssertTrue(db_b->open());
+
+    XCTAssertTrue(db::create_table(db_a, "test_table", {"field_a"}));
+    XCTAssertTrue(db_a->execute_update(db::insert_sql("test_table", {"field_a"}), {db::value{1}}));
+
+    auto const select_result = db::select(db_b, {.table = "test_table"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 1);
+
+    // 全ての接続が閉じると破棄される
+    db_a->close();
+    db_b->close();
+    XCTAssertTrue(db_a->open());
+    XCTAssertFalse(db::table_exists(db_a, "test_table"));
+}
+
+- (void)test_attach {
+    db::database_ptr const file_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(file_db->open());
+    XCTAssertTrue(db::create_table(file_db, "file_table", {"field_a"}));
+    XCTAssertTrue(file_db->execute_update(db::insert_sql("file_table", {"field_a"}), {db::value{"file_value"}}));
+    file_db->close();
+
+    db::database_ptr const db = db::database::make_shared(db::in_memory_path);
+
+    // 開く前に接続しておくこともできる
+    XCTAssertTrue(db->attach([yas_db_test_utils database_path], "file_db"));
+    XCTAssertFalse(db->attach([yas_db_test_utils database_path], "file_db"));
+    XCTAssertFalse(db->attach([yas_db_test_utils database_path], ""));
+    XCTAssertEqual(db->attached_databases().size(), 1);
+    XCTAssertEqual(db->attached_databases().at("file_db"), [yas_db_test_utils database_path]);
+
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "memory_table", {"field_a"}));
+    XCTAssertTrue(db->execute_update("INSERT INTO memory_table SELECT field_a FROM file_db.file_table;"));
+
+    auto select_result = db::select(db, {.table = "memory_table"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 1);
+    XCTAssertEqual(select_result.value().at(0).at("field_a").get<db::text>(), "file_value");
+
+    // 開き直しても接続したまま
+    db->close();
+    XCTAssertTrue(db->open());
+    select_result = db::select(db, {.table = "file_db.file_table"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 1);
+
+    XCTAssertTrue(db->detach("file_db"));
+    XCTAssertFalse(db->detach("file_db"));
+    XCTAssertEqual(db->attached_databases().size(), 0);
+    XCTAssertFalse(db::select(db, {.table = "file_db.file_table"}));
+}
+
+- (void)test_attach_with_quoted_schema_name {
+    db::database_ptr const file_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(file_db->open());
+    XCTAssertTrue(db::create_table(file_db, "file_table", {"field_a"}));
+    file_db->close();
+
+    db::database_ptr const db = db::database::make_shared(db::in_memory_path);
+    XCTAssertTrue(db->open());
+
+    // スキーマ名は識別子としてクォートされる
+    std::string const schema = "file \"db\"; DROP";
+    XCTAssertTrue(db->attach([yas_db_test_utils database_path], schema));
+    XCTAssertTrue(db->execute_query("SELECT * FROM \"file \"\"db\"\"; DROP\".file_table;"));
+
+    db->close();
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db->execute_query("SELECT * FROM \"file \"\"db\"\"; DROP\".file_table;"));
+
+    XCTAssertTrue(db->detach(schema));
+    XCTAssertEqual(db->attached_databases().size(), 0);
+}
+
 - (void)test_error_type_to_string {
     XCTAssertEqual(to_string(db::error_type::closed), "closed");
     XCTAssertEqual(to_string(db::error_type::in_use), "in_use");
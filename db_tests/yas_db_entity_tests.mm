@@ -35,9 +35,60 @@ using namespace yas;
     XCTAssertEqual(entity.all_attributes.size(), 5);
     XCTAssertEqual(entity.custom_attributes.size(), 1);
     XCTAssertEqual(entity.relations.size(), 1);
+    XCTAssertEqual(entity.head_table, "head_entity_name");
+    XCTAssertEqual(entity.sql_for_create_head(),
+                   "CREATE TABLE IF NOT EXISTS head_entity_name (obj_id INTEGER PRIMARY KEY, pk_id INTEGER NOT NULL, "
+                   "removed INTEGER NOT NULL);");
+    XCTAssertEqual(entity.sql_for_replace_head(),
+                   "INSERT OR REPLACE INTO head_entity_name(obj_id, pk_id, removed) "
+                   "VALUES(:obj_id, :pk_id, :removed);");
+
+    XCTAssertEqual(entity.layout, db::table_layout::rowid);
+    XCTAssertEqual(entity.version_rows, db::version_rows::full);
+    XCTAssertEqual(entity.sql_for_create().find(db::changed_field), std::string::npos);
 
     std::cout << entity.sql_for_create() << std::endl;
     std::cout << entity.sql_for_update() << std::endl;
 }
 
+- (void)test_create_clustered {
+    db::attribute_args attr{.name = "attr_name", .type = db::attribute_type::integer, .default_value = db::value{1}};
+    db::relation_args rel{.name = "rel_name", .target = "test_target"};
+
+    db::entity entity{
+        {.name = "entity_name", .attributes = {attr}, .relations = {rel}, .layout = db::table_layout::clustered}, {}};
+
+    XCTAssertEqual(entity.layout, db::table_layout::clustered);
+    XCTAssertEqual(entity.relations.at("rel_name").layout, db::table_layout::clustered);
+    XCTAssertEqual(entity.all_attributes.at("pk_id").sql(), "pk_id INTEGER UNIQUE");
+
+    std::string const create_sql = entity.sql_for_create();
+    XCTAssertEqual(create_sql.find("CREATE TABLE IF NOT EXISTS entity_name ("), 0);
+    XCTAssertNotEqual(create_sql.find(", PRIMARY KEY(obj_id, save_id)) WITHOUT ROWID;"), std::string::npos);
+
+    std::string const insert_sql = entity.sql_for_insert();
+    XCTAssertEqual(insert_sql.find("INSERT OR REPLACE INTO entity_name("), 0);
+    XCTAssertNotEqual(insert_sql.find(":pk_id"), std::string::npos);
+}
+
+- (void)test_create_delta {
+    db::attribute_args attr{.name = "attr_name", .type = db::attribute_type::integer, .default_value = db::value{1}};
+
+    db::entity entity{{.name = "entity_name", .attributes = {attr}, .version_rows = db::version_rows::delta}, {}};
+
+    XCTAssertEqual(entity.version_rows, db::version_rows::delta);
+    XCTAssertNotEqual(entity.sql_for_create().find(", changed TEXT);"), std::string::npos);
+    XCTAssertNotEqual(entity.sql_for_insert().find(":changed"), std::string::npos);
+
+    // ヘッドには全てのアトリビュートを持つ
+    XCTAssertEqual(entity.head_fields,
+                   (std::vector<std::string>{"obj_id", "pk_id", "removed", "save_id", "action", "attr_name"}));
+    XCTAssertEqual(entity.sql_for_create_head(),
+                   "CREATE TABLE IF NOT EXISTS head_entity_name (obj_id INTEGER PRIMARY KEY, pk_id INTEGER NOT NULL, "
+                   "removed INTEGER NOT NULL, save_id INTEGER, action TEXT, attr_name INTEGER);");
+    XCTAssertEqual(entity.sql_for_replace_head(),
+                   "INSERT OR REPLACE INTO head_entity_name(obj_id, pk_id, removed, save_id, action, attr_name) "
+                   "VALUES(:obj_id, :pk_id, :removed, :save_id, :action, :attr_name);");
+}
+
 @end
@@ -0,0 +1,215 @@
+//
+//  yas_db_function_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_function_tests : XCTestCase
+
+@end
+
+@implementation yas_db_function_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_register_function {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+    for (int idx = 0; idx < 5; ++idx) {
+        XCTAssertTrue(db->execute_update(db::insert_sql("test_table", {"field_a", "field_b"}),
+                                         db::value_vector_t{db::value{idx}, db::value{"text"}}));
+    }
+
+    auto const result = db->register_function(
+        "distance",
+        [](db::function_arguments_t const arguments) {
+            return db::value{std::abs(arguments[0].get<db::integer>() - arguments[1].get<db::integer>())};
+        },
+        2);
+    XCTAssertTrue(result);
+
+    auto const select_result =
+        db::select(db, {.table = "test_table",
+                        .fields = {"field_a", "distance(field_a, 2) AS dist"},
+                        .where_exprs = "distance(field_a, 2) <= 1",
+                        .field_orders = {{"field_a", db::order::ascending}}});
+
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 3);
+    XCTAssertEqual(select_result.value().at(0).at("field_a").get<db::integer>(), 1);
+    XCTAssertEqual(select_result.value().at(0).at("dist").get<db::integer>(), 1);
+    XCTAssertEqual(select_result.value().at(1).at("dist").get<db::integer>(), 0);
+    XCTAssertEqual(select_result.value().at(2).at("field_a").get<db::integer>(), 3);
+}
+
+- (void)test_function_definition_default {
+    db::function_definition const definition{.name = "test"};
+
+    XCTAssertEqual(definition.argument_count, -1);
+    XCTAssertFalse(definition.deterministic);
+}
+
+- (void)test_marshal_values {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    std::vector<db::value> received;
+
+    XCTAssertTrue(db->register_function("identity", [&received](db::function_arguments_t const arguments) {
+        received.assign(arguments.begin(), arguments.end());
+        return arguments.empty() ? db::null_value() : arguments.back();
+    }));
+
+    std::vector<uint8_t> const data{1, 2, 3};
+
+    auto query_result = db->execute_query("select identity(1, 1.5, 'text', null, :blob);",
+                                          db::value_vector_t{db::value{data.data(), data.size()}});
+    XCTAssertTrue(query_result);
+    XCTAssertTrue(query_result.value()->next());
+
+    db::value const returned = query_result.value()->column_value(0);
+    XCTAssertTrue(returned.type() == typeid(db::blob));
+    XCTAssertEqual(returned.get<db::blob>().size(), 3);
+
+    XCTAssertEqual(received.size(), 5);
+    XCTAssertEqual(received.at(0), db::value{1});
+    XCTAssertEqual(received.at(1), db::value{1.5});
+    XCTAssertEqual(received.at(2), db::value{"text"});
+    XCTAssertFalse(received.at(3));
+    XCTAssertTrue(received.at(4).type() == typeid(db::blob));
+}
+
+- (void)test_register_aggregate {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"group_id", "score"}));
+    db::value_vector_t const rows[] = {{db::value{1}, db::value{2.0}},
+                                       {db::value{1}, db::value{4.0}},
+                                       {db::value{2}, db::value{10.0}}};
+    for (auto const &row : rows) {
+        XCTAssertTrue(db->execute_update(db::insert_sql("test_table", {"group_id", "score"}), row));
+    }
+
+    struct mean_state {
+        double sum = 0.0;
+        std::size_t count = 0;
+    };
+
+    auto const result = db->register_aggregate(
+        "score_mean", []() { return mean_state{}; },
+        [](mean_state &state, db::function_arguments_t const arguments) {
+            state.sum += arguments[0].get<db::real>();
+            ++state.count;
+        },
+        [](mean_state &state) {
+            return state.count > 0 ? db::value{state.sum / state.count} : db::null_value();
+        },
+        1);
+    XCTAssertTrue(result);
+
+    auto const select_result = db::select(
+        db, {.table = "test_table", .fields = {"group_id", "score_mean(score) AS mean"}, .group_by = "group_id"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 2);
+
+    std::unordered_map<db::integer::type, db::real::type> means;
+    for (auto const &values : select_result.value()) {
+        means.emplace(values.at("group_id").get<db::integer>(), values.at("mean").get<db::real>());
+    }
+    XCTAssertEqual(means.at(1), 3.0);
+    XCTAssertEqual(means.at(2), 10.0);
+
+    // 行がなければstepは呼ばれずに初期状態で結果を返す
+    auto const empty_result =
+        db::select(db, {.table = "test_table", .fields = {"score_mean(score) AS mean"}, .where_exprs = "group_id = 3"});
+    XCTAssertTrue(empty_result);
+    XCTAssertEqual(empty_result.value().size(), 1);
+    XCTAssertFalse(empty_result.value().at(0).at("mean"));
+}
+
+- (void)test_function_exception {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db->register_function("fail", [](db::function_arguments_t const) -> db::value {
+        throw std::runtime_error("function failed.");
+    }));
+
+    auto query_result = db->execute_query("select fail();");
+    if (query_result) {
+        XCTAssertFalse(query_result.value()->next());
+    }
+    XCTAssertEqual(db->last_error_message(), "function failed.");
+}
+
+- (void)test_keep_functions_after_reopen {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+
+    // 開く前に登録しても開いた時に使えるようになる
+    XCTAssertTrue(db->register_function("one", [](db::function_arguments_t const) { return db::value{1}; }, 0));
+
+    XCTAssertTrue(db->open());
+
+    auto query_result = db->execute_query("select one();");
+    XCTAssertTrue(query_result);
+    XCTAssertTrue(query_result.value()->next());
+    XCTAssertEqual(query_result.value()->column_value(0), db::value{1});
+
+    db->close();
+    XCTAssertTrue(db->open());
+
+    query_result = db->execute_query("select one();");
+    XCTAssertTrue(query_result);
+    XCTAssertTrue(query_result.value()->next());
+    XCTAssertEqual(query_result.value()->column_value(0), db::value{1});
+
+    XCTAssertTrue(db->unregister_function("one", 0));
+    XCTAssertFalse(db->execute_query("select one();"));
+    XCTAssertFalse(db->unregister_function("one", 0));
+}
+
+- (void)test_copy_registrations {
+    db::database_ptr const source = [yas_db_test_utils create_test_database];
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(source->open());
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(source->register_function("one", [](db::function_arguments_t const) { return db::value{1}; }, 0));
+    XCTAssertTrue(source->attach([yas_db_test_utils backup_database_path], "other"));
+
+    XCTAssertFalse(db->execute_query("select one();"));
+
+    XCTAssertTrue(db->copy_registrations(*source));
+
+    {
+        auto query_result = db->execute_query("select one();");
+        XCTAssertTrue(query_result);
+        XCTAssertTrue(query_result.value()->next());
+        XCTAssertEqual(query_result.value()->column_value(0), db::value{1});
+    }
+
+    XCTAssertEqual(db->attached_databases(), source->attached_databases());
+
+    // sourceで登録を外したものは外れる
+    XCTAssertTrue(source->unregister_function("one", 0));
+    XCTAssertTrue(source->detach("other"));
+
+    XCTAssertTrue(db->copy_registrations(*source));
+
+    XCTAssertFalse(db->execute_query("select one();"));
+    XCTAssertTrue(db->attached_databases().empty());
+}
+
+@end
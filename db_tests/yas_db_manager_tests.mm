@@ -73,6 +73,104 @@ using namespace yas;
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
+- (void)test_interrupt_execution_on_cancel {
+    auto const manager = [yas_db_test_utils create_test_manager];
+
+    auto is_canceled = std::make_shared<std::atomic<bool>>(false);
+
+    manager->execute([is_canceled]() { return is_canceled->load(); },
+                     [self, &manager, is_canceled](auto const &) {
+                         *is_canceled = true;
+
+                         auto const result = manager->database()->execute_statements(
+                             "with recursive counter(x) as "
+                             "(select 1 union all select x + 1 from counter where x < 100000000) "
+                             "select count(*) from counter;");
+
+                         XCTAssertFalse(result);
+                         XCTAssertEqual(result.error().code().raw_value(), SQLITE_INTERRUPT);
+                     });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+
+    manager->execute(db::no_cancellation, [self, &manager, exp](auto const &) {
+        XCTAssertFalse(manager->database()->interruption_handler());
+        XCTAssertTrue(manager->database()->execute_statements("select 1;"));
+        [exp fulfill];
+    });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_cancel_fetch_while_executing {
+    db::model model = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
+
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1000}}; },
+        [self](auto result) { XCTAssertTrue(result); });
+
+    // タスクの開始時にはキャンセルされておらず、実行中にキャンセルされる
+    auto call_count = std::make_shared<std::atomic<int>>(0);
+
+    manager->fetch_objects(
+        [call_count]() { return ++*call_count > 1; },
+        []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self](db::manager_vector_result_t result) {
+            // 途中までの結果を成功として返さない
+            XCTAssertFalse(result);
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_cancel_save_while_executing {
+    db::model model = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
+
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    db::object_ptr object = nullptr;
+
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            object = result.value().at("sample_a").at(0);
+            object->set_attribute_value("name", db::value{"name_value"});
+        });
+
+    auto call_count = std::make_shared<std::atomic<int>>(0);
+
+    manager->save([call_count]() { return ++*call_count > 1; },
+                  [self](db::manager_map_result_t result) { XCTAssertFalse(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        // キャンセルされたセーブはコミットされない
+        auto const select_result = db::select(manager->database(), {.table = "sample_a"});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 1);
+
+        auto const info_result = db::fetch_info(manager->database());
+        XCTAssertTrue(info_result);
+        XCTAssertEqual(info_result.value().current_save_id(), 1);
+    });
+
+    // 変更は残っているので、キャンセルしなければ保存できる
+    manager->save(db::no_cancellation, [self, &manager](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{2});
+    });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
 - (void)test_setup {
     db::model model = [yas_db_test_utils model_0_0_1];
     auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
@@ -101,6 +199,12 @@ using namespace yas;
         XCTAssertTrue(db::index_exists(db, "sample_a_name"));
         XCTAssertTrue(db::index_exists(db, "sample_a_others"));
         XCTAssertFalse(db::index_exists(db, "sample_b_name"));
+
+        XCTAssertTrue(db::index_exists(db, "auto_sample_a_obj_id_save_id"));
+        XCTAssertTrue(db::index_exists(db, "auto_sample_b_obj_id_save_id"));
+        XCTAssertTrue(db::index_exists(db, "auto_rel_sample_a_child_save_id_src_obj_id"));
+        XCTAssertTrue(db::index_exists(db, "auto_rel_sample_a_child_src_pk_id"));
+        XCTAssertTrue(db::index_exists(db, "auto_rel_sample_a_child_tgt_obj_id"));
     });
 
     XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
@@ -108,74 +212,44 @@ using namespace yas;
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_create_object {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
-
-    db::object_vector_t objects;
-
-    manager->setup([self, &manager, &objects](auto result) {
-        XCTAssertTrue(result);
-
-        objects.emplace_back(manager->create_object("sample_a"));
-        objects.emplace_back(manager->create_object("sample_a"));
-
-        for (auto const &idx : make_each_index(2)) {
-            auto const &object = objects[idx];
-
-            XCTAssertEqual(object->status(), db::object_status::created);
-            XCTAssertTrue(object->object_id().is_temporary());
-            XCTAssertEqual(object->attribute_value(db::action_field), db::insert_action_value());
-            XCTAssertEqual(object->attribute_value("name"), db::value{"default_value"});
-            XCTAssertEqual(object->attribute_value("age"), db::value{10});
-            XCTAssertEqual(object->attribute_value("weight"), db::value{65.4});
-
-            XCTAssertFalse(object->attribute_value(db::pk_id_field));
-            XCTAssertEqual(object->attribute_value(db::save_id_field), db::value{0});
-        }
-
-        objects[0]->set_attribute_value("name", db::value{"test_name_0_created"});
-        objects[1]->set_attribute_value("name", db::value{"test_name_1_created"});
+- (void)test_close_database_each_task {
+    auto const manager = [yas_db_test_utils create_test_manager];
 
-        XCTAssertEqual(objects[0]->status(), db::object_status::created);
-        XCTAssertEqual(objects[1]->status(), db::object_status::created);
+    XCTAssertFalse(manager->connection_option().persistent);
 
-        XCTAssertTrue(manager->has_created_objects());
-        XCTAssertEqual(manager->created_object_count("sample_a"), 2);
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
+        XCTAssertTrue(db->execute_update("create temp table test_temp_table (field_a);"));
+        XCTAssertTrue(db::table_exists(db, "test_temp_table"));
     });
 
-    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{1});
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        XCTAssertFalse(db::table_exists(manager->database(), "test_temp_table"));
+    });
 
-        db::object_map_t &a_objects = result.value().at("sample_a");
-        XCTAssertEqual(a_objects.size(), 2);
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-        auto each = make_fast_each(objects.size());
-        while (yas_each_next(each)) {
-            auto const &idx = yas_each_index(each);
-            auto const &object = objects.at(idx);
-            auto const &saved_object = a_objects.at(object->object_id().stable());
+- (void)test_persistent_connection {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_0],
+                                                  1, {.persistent = true});
 
-            XCTAssertEqual(saved_object, object);
-            XCTAssertTrue(saved_object->object_id().stable_value());
+    XCTAssertTrue(manager->connection_option().persistent);
 
-            XCTAssertEqual(saved_object->status(), db::object_status::saved);
-            XCTAssertEqual(saved_object->attribute_value(db::action_field), db::insert_action_value());
-            XCTAssertEqual(saved_object->attribute_value("age"), db::value{10});
-            XCTAssertEqual(saved_object->attribute_value("weight"), db::value{65.4});
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        XCTAssertTrue(manager->database()->execute_update("create temp table test_temp_table (field_a);"));
+    });
 
-            XCTAssertEqual(saved_object->attribute_value(db::save_id_field), db::value{1});
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        XCTAssertTrue(db::table_exists(manager->database(), "test_temp_table"));
+    });
 
-            if (idx == 0) {
-                XCTAssertEqual(saved_object->attribute_value("name"), db::value{"test_name_0_created"});
-            } else if (idx == 1) {
-                XCTAssertEqual(saved_object->attribute_value("name"), db::value{"test_name_1_created"});
-            }
-        }
+    manager->close_database();
 
-        XCTAssertFalse(manager->has_created_objects());
-        XCTAssertEqual(manager->created_object_count("sample_a"), 0);
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        XCTAssertFalse(db::table_exists(manager->database(), "test_temp_table"));
     });
 
     XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
@@ -183,613 +257,636 @@ using namespace yas;
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_create_and_save_objects {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
-
-    db::object_vector_t objects{};
-
-    manager->setup([self, &manager, &objects](auto result) {
-        XCTAssertTrue(result);
-
-        objects.emplace_back(manager->create_object("sample_a"));
-        objects.emplace_back(manager->create_object("sample_a"));
+- (void)test_persistent_connection_idle_timeout {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_0],
+                                                  1, {.persistent = true, .idle_timeout = 0.1});
 
-        objects[0]->set_attribute_value("name", db::value{"test_name_0_created"});
-        objects[1]->set_attribute_value("name", db::value{"test_name_1_created"});
+    XCTestExpectation *create_exp = [self expectationWithDescription:@"create"];
 
-        XCTAssertTrue(manager->has_created_objects());
-        XCTAssertEqual(manager->created_object_count("sample_a"), 2);
+    manager->execute(db::no_cancellation, [self, &manager, create_exp](auto const &) {
+        XCTAssertTrue(manager->database()->execute_update("create temp table test_temp_table (field_a);"));
+        [create_exp fulfill];
     });
 
-    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
-        XCTAssertFalse(manager->has_created_objects());
-
-        XCTAssertEqual(objects[0]->status(), db::object_status::saved);
-        XCTAssertEqual(objects[1]->status(), db::object_status::saved);
-        XCTAssertTrue(manager->cached_or_created_object("sample_a", objects[0]->object_id()));
-        XCTAssertTrue(manager->cached_or_created_object("sample_a", objects[1]->object_id()));
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-        objects[0]->set_attribute_value("name", db::value{"test_name_0_saved"});
-        objects[0]->set_attribute_value("age", db::value{0});
-        objects[1]->set_attribute_value("name", db::value{"test_name_1_saved"});
-        objects[1]->set_attribute_value("age", db::value{1});
+    [NSThread sleepForTimeInterval:0.5];
 
-        XCTAssertEqual(objects[0]->status(), db::object_status::changed);
-        XCTAssertEqual(objects[1]->status(), db::object_status::changed);
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
 
-        XCTAssertTrue(manager->has_changed_objects());
-        XCTAssertEqual(manager->changed_object_count("sample_a"), 2);
-        XCTAssertFalse(manager->has_created_objects());
-        XCTAssertEqual(manager->created_object_count("sample_a"), 0);
+    manager->execute(db::no_cancellation, [self, &manager, exp](auto const &) {
+        XCTAssertFalse(db::table_exists(manager->database(), "test_temp_table"));
+        [exp fulfill];
+    });
 
-        objects.emplace_back(manager->create_object("sample_a"));
-        objects.emplace_back(manager->create_object("sample_a"));
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-        objects[2]->set_attribute_value("name", db::value{"test_name_2_created"});
-        objects[2]->set_attribute_value("age", db::value{2});
-        objects[3]->set_attribute_value("name", db::value{"test_name_3_created"});
-        objects[3]->set_attribute_value("age", db::value{3});
+- (void)test_fetch_with_readers {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_1],
+                                                  1, {.reader_count = 2});
 
-        XCTAssertTrue(manager->has_created_objects());
-    });
+    XCTAssertEqual(manager->database()->open_option().journal_mode, db::journal_mode::wal);
 
-    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-        XCTAssertEqual(objects[0]->attribute_value("name"), db::value{"test_name_0_saved"});
-        XCTAssertEqual(objects[1]->attribute_value("name"), db::value{"test_name_1_saved"});
-        XCTAssertEqual(objects[2]->attribute_value("name"), db::value{"test_name_2_created"});
-        XCTAssertEqual(objects[3]->attribute_value("name"), db::value{"test_name_3_created"});
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 2}}; },
+        [](auto result) {
+            XCTAssertTrue(result);
+            auto &objects = result.value().at("sample_a");
+            objects.at(0)->set_attribute_value("name", db::value{"value_0"});
+            objects.at(1)->set_attribute_value("name", db::value{"value_1"});
+        });
 
-        XCTAssertEqual(objects[0]->status(), db::object_status::saved);
-        XCTAssertEqual(objects[1]->status(), db::object_status::saved);
-        XCTAssertEqual(objects[2]->status(), db::object_status::saved);
-        XCTAssertEqual(objects[3]->status(), db::object_status::saved);
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-        XCTAssertTrue(objects[0]->object_id().stable_value());
-        XCTAssertTrue(objects[1]->object_id().stable_value());
-        XCTAssertTrue(objects[2]->object_id().stable_value());
-        XCTAssertTrue(objects[3]->object_id().stable_value());
-    });
+    XCTestExpectation *fetch_exp = [self expectationWithDescription:@"fetch"];
+    XCTestExpectation *const_fetch_exp = [self expectationWithDescription:@"const_fetch"];
 
-    manager->fetch_const_objects(
+    manager->fetch_objects(
         db::no_cancellation,
         []() {
-            return db::to_fetch_option(db::select_option{
-                .table = "sample_a", .field_orders = {db::field_order{.field = "age", .order = db::order::ascending}}});
+            return db::to_fetch_option(
+                db::select_option{.table = "sample_a", .field_orders = {{db::object_id_field, db::order::ascending}}});
         },
-        [self, &manager](auto result) {
+        [fetch_exp](db::manager_vector_result_t result) {
             XCTAssertTrue(result);
+            auto const &objects = result.value().at("sample_a");
+            XCTAssertEqual(objects.size(), 2);
+            XCTAssertEqual(objects.at(0)->attribute_value("name"), db::value{"value_0"});
+            XCTAssertEqual(objects.at(1)->attribute_value("name"), db::value{"value_1"});
+            [fetch_exp fulfill];
+        });
 
-            db::const_object_vector_t &objects = result.value().at("sample_a");
-            XCTAssertEqual(objects.size(), 4);
-
-            XCTAssertEqual(objects[0]->attribute_value("name"), db::value{"test_name_0_saved"});
-            XCTAssertEqual(objects[1]->attribute_value("name"), db::value{"test_name_1_saved"});
-            XCTAssertEqual(objects[2]->attribute_value("name"), db::value{"test_name_2_created"});
-            XCTAssertEqual(objects[3]->attribute_value("name"), db::value{"test_name_3_created"});
+    manager->fetch_const_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [const_fetch_exp](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(result.value().at("sample_a").size(), 2);
+            [const_fetch_exp fulfill];
         });
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_set_relation_to_temporary_object {
-    // temporaryなオブジェクトのrelationにtemporaryなオブジェクトをセットして保存するテスト
+- (void)test_fetch_with_readers_using_function {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_1],
+                                                  1, {.reader_count = 1});
 
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+    // 書き込み用の接続に登録した関数を、読み込み専用の接続でのフェッチでも使える
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto is_target = [](db::function_arguments_t const arguments) {
+            return db::value{arguments[0] == db::value{"target"} ? 1 : 0};
+        };
+        XCTAssertTrue(manager->database()->register_function("is_target", std::move(is_target), 1));
+    });
 
-    manager->setup([self, &manager, &setupExp](auto result) {
-        XCTAssertTrue(result);
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 2}}; },
+        [](auto result) {
+            XCTAssertTrue(result);
+            result.value().at("sample_a").at(1)->set_attribute_value("name", db::value{"target"});
+        });
 
-        [setupExp fulfill];
-    });
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-    [self waitForExpectations:@[setupExp] timeout:10.0];
+    XCTestExpectation *exp = [self expectationWithDescription:@"fetch"];
 
-    auto object_a = manager->create_object("sample_a");
-    auto object_b1 = manager->create_object("sample_b");
-    auto object_b2 = manager->create_object("sample_b");
+    manager->fetch_const_objects(
+        db::no_cancellation,
+        []() { return db::to_fetch_option(db::select_option{.table = "sample_a", .where_exprs = "is_target(name)"}); },
+        [exp](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(result.value().at("sample_a").size(), 1);
+            [exp fulfill];
+        });
 
-    XCTAssertTrue(object_a->object_id().is_temporary());
-    XCTAssertTrue(object_b1->object_id().is_temporary());
-    XCTAssertTrue(object_b2->object_id().is_temporary());
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-    XCTAssertNoThrow(object_a->add_relation_object("child", object_b1));
-    XCTAssertNoThrow(object_a->add_relation_object("child", object_b2));
+- (void)test_fetch_with_readers_after_save {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_1],
+                                                  1, {.persistent = true, .reader_count = 1});
 
-    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    db::object_map_map_t result_objects;
+    db::object_ptr object = nullptr;
 
-    manager->save(db::no_cancellation, [self, &result_objects, &saveExp](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [&object](auto result) {
+            XCTAssertTrue(result);
+            object = result.value().at("sample_a").at(0);
+            object->set_attribute_value("name", db::value{"value_0"});
+        });
 
-        result_objects = std::move(result.value());
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-        [saveExp fulfill];
-    });
+    XCTestExpectation *fetch_exp = [self expectationWithDescription:@"fetch"];
 
-    [self waitForExpectations:@[saveExp] timeout:10.0];
-
-    XCTAssertTrue(object_a->object_id().is_stable());
-    XCTAssertTrue(object_b1->object_id().is_stable());
-    XCTAssertTrue(object_b2->object_id().is_stable());
-
-    XCTAssertEqual(object_a->relation_id("child", 0), object_b1->object_id());
-    XCTAssertEqual(object_a->relation_id("child", 1), object_b2->object_id());
-
-    XCTAssertEqual(manager->relation_object_at(object_a, "child", 0), object_b1);
-    XCTAssertEqual(manager->relation_object_at(object_a, "child", 1), object_b2);
+    manager->fetch_const_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [fetch_exp](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
+            auto const &objects = result.value().at("sample_a");
+            XCTAssertEqual(objects.size(), 1);
+            XCTAssertEqual(objects.at(0)->attribute_value("name"), db::value{"value_0"});
+            [fetch_exp fulfill];
+        });
 
-    db::object_ptr const &result_object_a = result_objects.at("sample_a").begin()->second;
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTAssertEqual(object_a, result_object_a);
-    XCTAssertTrue(result_objects.at("sample_b").count(object_b1->object_id().stable()) > 0);
-    XCTAssertTrue(result_objects.at("sample_b").count(object_b2->object_id().stable()) > 0);
+    manager->close_database();
 }
 
-- (void)test_set_temporary_relation_to_saved_object {
-    // stableなオブジェクトのrelationにtemporaryなオブジェクトをセットして保存するテスト
+- (void)test_fetch_with_readers_while_saving {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_1],
+                                                  1, {.reader_count = 1});
 
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    {
-        XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+    // 読み込み専用の接続でのフェッチの間にセーブが終わるように、1行ごとに待つ関数を登録する
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto slow_name = [](db::function_arguments_t const arguments) {
+            [NSThread sleepForTimeInterval:0.2];
+            return arguments[0];
+        };
+        XCTAssertTrue(manager->database()->register_function("slow_name", std::move(slow_name), 1));
+    });
 
-        manager->setup([self, &manager, &setupExp](auto result) {
-            XCTAssertTrue(result);
+    db::object_vector_t objects;
 
-            [setupExp fulfill];
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 2}}; },
+        [&objects](auto result) {
+            XCTAssertTrue(result);
+            objects = result.value().at("sample_a");
+            objects.at(0)->set_attribute_value("name", db::value{"value_0"});
+            objects.at(1)->set_attribute_value("name", db::value{"value_1"});
         });
 
-        [self waitForExpectations:@[setupExp] timeout:10.0];
-    }
-
-    auto object_a = manager->create_object("sample_a");
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-    {
-        XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+    XCTestExpectation *save_exp = [self expectationWithDescription:@"save"];
+    XCTestExpectation *fetch_exp = [self expectationWithDescription:@"fetch"];
 
-        manager->save(db::no_cancellation, [self, &saveExp](db::manager_map_result_t result) {
+    manager->fetch_objects(
+        db::no_cancellation,
+        []() {
+            return db::to_fetch_option(
+                db::select_option{.table = "sample_a",
+                                  .where_exprs = "slow_name(name) IS NOT NULL",
+                                  .field_orders = {{db::object_id_field, db::order::ascending}}});
+        },
+        [fetch_exp](db::manager_vector_result_t result) {
             XCTAssertTrue(result);
-
-            [saveExp fulfill];
+            // 取得している間にセーブされたオブジェクトは、セーブした後のデータになる
+            auto const &fetched_objects = result.value().at("sample_a");
+            XCTAssertEqual(fetched_objects.size(), 2);
+            XCTAssertEqual(fetched_objects.at(0)->attribute_value("name"), db::value{"changed_0"});
+            XCTAssertEqual(fetched_objects.at(1)->attribute_value("name"), db::value{"value_1"});
+            [fetch_exp fulfill];
         });
 
-        [self waitForExpectations:@[saveExp] timeout:10.0];
-    }
+    objects.at(0)->set_attribute_value("name", db::value{"changed_0"});
 
-    XCTAssertTrue(object_a->object_id().is_stable());
+    manager->save(db::no_cancellation, [save_exp](auto result) {
+        XCTAssertTrue(result);
+        [save_exp fulfill];
+    });
 
-    auto object_b = manager->create_object("sample_b");
+    [self waitForExpectations:@[save_exp, fetch_exp] timeout:10.0 enforceOrder:YES];
 
-    object_a->add_relation_object("child", object_b);
+    XCTAssertEqual(objects.at(0)->attribute_value("name"), db::value{"changed_0"});
+    XCTAssertEqual(objects.at(0)->status(), db::object_status::saved);
+}
 
-    {
-        XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+- (void)test_query_plan_warning {
+    auto warned_plans = std::make_shared<std::vector<db::query_plan>>();
 
-        manager->save(db::no_cancellation, [self, &saveExp](db::manager_map_result_t result) {
-            XCTAssertTrue(result);
+    auto const manager = db::manager::make_shared(
+        [yas_db_test_utils database_path], [yas_db_test_utils model_0_0_2], 1,
+        {.query_plan_warning_handler = [warned_plans](db::query_plan const &plan) { warned_plans->push_back(plan); }});
 
-            [saveExp fulfill];
-        });
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-        [self waitForExpectations:@[saveExp] timeout:10.0];
+    for (int idx = 0; idx < 2; ++idx) {
+        manager->fetch_objects(
+            db::no_cancellation,
+            [idx]() {
+                return db::to_fetch_option(
+                    db::select_option{.table = "sample_a", .where_exprs = "tall = " + std::to_string(idx)});
+            },
+            [](db::manager_vector_result_t result) { XCTAssertTrue(result); });
     }
 
-    XCTAssertTrue(object_a->relation_id("child", 0).is_stable());
-    XCTAssertEqual(manager->relation_object_at(object_a, "child", 0)->get()->object_id(), object_b->object_id());
-}
+    XCTestExpectation *exp = [self expectationWithDescription:@"fetch"];
 
-- (void)test_object_relation_objects {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
 
-    XCTestExpectation *setup_exp = [self expectationWithDescription:@"setup manager"];
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    manager->setup([setup_exp](auto result) { [setup_exp fulfill]; });
+    // 値だけが違う条件は同じ形なので1度だけ知らせる
+    XCTAssertEqual(warned_plans->size(), 1);
+    XCTAssertTrue(warned_plans->at(0).has_table_scan());
+}
 
-    [self waitForExpectations:@[setup_exp] timeout:10.0];
+- (void)test_backup {
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
 
-    db::object_ptr obj = manager->create_object("sample_a");
-    db::object_ptr obj_b1 = manager->create_object("sample_b");
-    db::object_ptr obj_b2 = manager->create_object("sample_b");
-    db::object_ptr obj_b3 = manager->create_object("sample_b");
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    XCTestExpectation *save_exp = [self expectationWithDescription:@"setup manager"];
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 100}}; },
+        [](auto result) { XCTAssertTrue(result); });
 
-    manager->save(db::no_cancellation, [save_exp](db::manager_map_result_t save_result) { [save_exp fulfill]; });
+    XCTestExpectation *exp = [self expectationWithDescription:@"backup"];
 
-    [self waitForExpectations:@[save_exp] timeout:10.0];
+    std::size_t progress_count = 0;
 
-    obj->add_relation_object("child", obj_b1);
-    obj->add_relation_object("child", obj_b2);
-    obj->add_relation_object("child", obj_b3);
+    manager->backup(
+        db::no_cancellation, [yas_db_test_utils backup_database_path],
+        [&progress_count](db::backup_progress const &) {
+            XCTAssertTrue([NSThread isMainThread]);
+            ++progress_count;
+            return true;
+        },
+        [exp](db::manager_result_t result) {
+            XCTAssertTrue(result);
+            [exp fulfill];
+        },
+        1);
 
-    auto rel_objects = manager->relation_objects(obj, "child");
+    // バックアップの途中に追加したタスクも実行される
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [](auto result) { XCTAssertTrue(result); });
 
-    XCTAssertEqual(rel_objects.size(), 3);
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTAssertTrue(rel_objects.at(0));
-    XCTAssertTrue(rel_objects.at(1));
-    XCTAssertTrue(rel_objects.at(2));
+    XCTAssertGreaterThan(progress_count, 1);
 
-    XCTAssertEqual(rel_objects.at(0)->get()->object_id().stable_value(), obj_b1->object_id().stable_value());
-    XCTAssertEqual(rel_objects.at(1)->get()->object_id().stable_value(), obj_b2->object_id().stable_value());
-    XCTAssertEqual(rel_objects.at(2)->get()->object_id().stable_value(), obj_b3->object_id().stable_value());
+    auto const backup_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_db->open());
+
+    auto const select_result = db::select_last(backup_db, db::select_option{.table = "sample_a"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 101);
 }
 
-- (void)test_setup_migration {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    db::manager_ptr manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+- (void)test_backup_while_destination_locked {
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
 
-    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
-        auto &db = manager->database();
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 10}}; },
+        [](auto result) { XCTAssertTrue(result); });
 
-        db::begin_transaction(db);
+    // 別の接続でバックアップ先をロックしておく
+    auto const locking_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(locking_db->open());
+    XCTAssertTrue(locking_db->execute_update("BEGIN EXCLUSIVE TRANSACTION;"));
 
-        bool rollback = false;
+    bool is_backup_completed = false;
+    XCTestExpectation *backup_exp = [self expectationWithDescription:@"backup"];
 
-        if (!db->execute_update(db::insert_sql("sample_a", {"age", "name", "weight"}),
-                                {db::value{2}, db::value{"xyz"}, db::value{451.2}})) {
-            rollback = true;
-        }
+    manager->backup(
+        db::no_cancellation, [yas_db_test_utils backup_database_path], nullptr,
+        [&is_backup_completed, backup_exp](db::manager_result_t result) {
+            XCTAssertTrue(result);
+            is_backup_completed = true;
+            [backup_exp fulfill];
+        },
+        1);
 
-        if (!db->execute_update(db::insert_sql("sample_b", {"name"}), {db::value{"qwerty"}})) {
-            rollback = true;
-        }
+    // ロックが解除されるのを待っている間も、後から追加したタスクは実行される
+    XCTestExpectation *insert_exp = [self expectationWithDescription:@"insert"];
 
-        db::select_option option_a{.table = "sample_a", .fields = {db::object_id_field}};
-        auto select_result_a = db::select(db, option_a);
-        auto &src_obj_id = select_result_a.value().at(0).at(db::object_id_field);
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [&is_backup_completed, insert_exp](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertFalse(is_backup_completed);
+            [insert_exp fulfill];
+        });
 
-        db::select_option option_b{.table = "sample_b", .fields = {db::object_id_field}};
-        auto select_result_b = db::select(db, option_b);
-        auto &tgt_obj_id = select_result_b.value().at(0).at(db::object_id_field);
+    [self waitForExpectations:@[insert_exp] timeout:10.0];
 
-        auto sql = db::insert_sql("rel_sample_a_child", {db::src_obj_id_field, db::tgt_obj_id_field});
-        if (!db->execute_update(sql, db::value_vector_t{src_obj_id, tgt_obj_id})) {
-            rollback = true;
-        }
+    XCTAssertFalse(is_backup_completed);
+    XCTAssertTrue(db::commit(locking_db));
+    locking_db->close();
 
-        db::value const save_id{100};
-        if (!db->execute_update(db::update_sql(db::info_table, {db::current_save_id_field, db::last_save_id_field}, ""),
-                                db::value_vector_t{save_id, save_id})) {
-            rollback = true;
-        }
+    [self waitForExpectations:@[backup_exp] timeout:10.0];
 
-        XCTAssertFalse(rollback);
+    auto const backup_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_db->open());
 
-        if (rollback) {
-            db::rollback(db);
-        } else {
-            db::commit(db);
-        }
-    });
+    auto const select_result = db::select_last(backup_db, db::select_option{.table = "sample_a"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 11);
+}
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+- (void)test_cancel_backup_between_steps {
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
 
-    manager = nullptr;
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
-    manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 100}}; },
+        [](auto result) { XCTAssertTrue(result); });
 
-    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+    auto const is_canceled = std::make_shared<std::atomic<bool>>(false);
+    std::size_t progress_count = 0;
 
-    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
-        auto &db = manager->database();
+    XCTestExpectation *exp = [self expectationWithDescription:@"backup"];
 
-        XCTAssertTrue(db::table_exists(db, db::info_table));
-        auto select_infos_result = db::select(db, db::select_option{.table = db::info_table});
-        XCTAssertTrue(select_infos_result);
-        XCTAssertEqual(select_infos_result.value().size(), 1);
-        XCTAssertEqual(select_infos_result.value().at(0).at(db::version_field).get<db::text>(), "0.0.2");
-        XCTAssertEqual(select_infos_result.value().at(0).at(db::current_save_id_field).get<db::integer>(), 100);
-        XCTAssertEqual(select_infos_result.value().at(0).at(db::last_save_id_field).get<db::integer>(), 100);
+    // 最初のステップの後にキャンセルしても、completionはキャンセルのエラーで呼ばれる
+    manager->backup(
+        [is_canceled]() { return is_canceled->load(); }, [yas_db_test_utils backup_database_path],
+        [&progress_count, is_canceled](db::backup_progress const &) {
+            ++progress_count;
+            is_canceled->store(true);
+            return true;
+        },
+        [self, exp](db::manager_result_t result) {
+            XCTAssertFalse(result);
+            XCTAssertEqual(result.error().type(), db::manager_error_type::canceled);
+            [exp fulfill];
+        },
+        1);
 
-        XCTAssertTrue(db::table_exists(db, "sample_a"));
-        auto select_result_a = db::select(db, db::select_option{.table = "sample_a"});
-        XCTAssertTrue(select_result_a);
-        XCTAssertEqual(select_result_a.value().size(), 1);
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-        auto const &sample_a = select_result_a.value().at(0);
-        XCTAssertEqual(sample_a.at("age").get<db::integer>(), 2);
-        XCTAssertEqual(sample_a.at("name").get<db::text>(), "xyz");
-        XCTAssertEqual(sample_a.at("weight").get<db::real>(), 451.2);
+    XCTAssertEqual(progress_count, 1);
+}
 
-        XCTAssertTrue(db::table_exists(db, "sample_b"));
-        auto select_result_b = db::select(db, db::select_option{.table = "sample_b"});
-        XCTAssertTrue(select_result_b);
-        XCTAssertEqual(select_result_b.value().size(), 1);
+- (void)test_backup_over_idle_timeout {
+    auto const manager = db::manager::make_shared([yas_db_test_utils database_path], [yas_db_test_utils model_0_0_1],
+                                                  1, {.persistent = true, .idle_timeout = 0.01});
 
-        auto const &sample_b = select_result_b.value().at(0);
-        XCTAssertEqual(sample_b.at("name").get<db::text>(), "qwerty");
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-        XCTAssertTrue(db::table_exists(db, "sample_c"));
-        auto select_result_c = db::select(db, db::select_option{.table = "sample_c"});
-        XCTAssertTrue(select_result_c);
-        XCTAssertEqual(select_result_c.value().size(), 0);
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 10}}; },
+        [](auto result) { XCTAssertTrue(result); });
 
-        XCTAssertTrue(db::table_exists(db, "rel_sample_a_child"));
-        auto select_rels_result = db::select(db, db::select_option{.table = "rel_sample_a_child"});
-        XCTAssertEqual(select_rels_result.value().size(), 1);
+    auto const locking_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(locking_db->open());
+    XCTAssertTrue(locking_db->execute_update("BEGIN EXCLUSIVE TRANSACTION;"));
 
-        auto &src_obj_id = sample_a.at(db::object_id_field);
-        auto &tgt_obj_id = sample_b.at(db::object_id_field);
+    XCTestExpectation *exp = [self expectationWithDescription:@"backup"];
 
-        auto &rel = select_rels_result.value().at(0);
-        XCTAssertEqual(rel.at(db::src_obj_id_field), src_obj_id);
-        XCTAssertEqual(rel.at(db::tgt_obj_id_field), tgt_obj_id);
+    manager->backup(
+        db::no_cancellation, [yas_db_test_utils backup_database_path], nullptr,
+        [exp](db::manager_result_t result) {
+            XCTAssertTrue(result);
+            [exp fulfill];
+        },
+        1);
 
-        XCTAssertTrue(db::index_exists(db, "sample_a_name"));
-        XCTAssertTrue(db::index_exists(db, "sample_a_others"));
-        XCTAssertTrue(db::index_exists(db, "sample_b_name"));
-    });
+    // ロックを待っている間にアイドルの時間が過ぎても、バックアップの途中では閉じられない
+    [NSThread sleepForTimeInterval:0.3];
+
+    XCTAssertTrue(db::commit(locking_db));
+    locking_db->close();
 
-    exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
-}
 
-- (void)test_insert_objects_by_count {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    auto const backup_db = db::database::make_shared([yas_db_test_utils backup_database_path]);
+    XCTAssertTrue(backup_db->open());
 
-    XCTestExpectation *exp1 = [self expectationWithDescription:@"insert_1"];
+    auto const select_result = db::select_last(backup_db, db::select_option{.table = "sample_a"});
+    XCTAssertTrue(select_result);
+    XCTAssertEqual(select_result.value().size(), 10);
+}
 
-    manager->setup([self, &manager](auto result) {
-        XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{0});
-        XCTAssertEqual(manager->last_save_id(), db::value{0});
-    });
+- (void)test_read_attribute_blob {
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
 
-    db::object_vector_map_t inserted_objects_1;
+    manager->setup([](auto result) { XCTAssertTrue(result); });
+
+    std::vector<std::byte> data(1000);
+    for (std::size_t idx = 0; idx < data.size(); ++idx) {
+        data.at(idx) = std::byte(idx);
+    }
 
     manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 3}};
-        },
-        [self, exp1, &inserted_objects_1](auto result) {
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [&data](auto result) {
             XCTAssertTrue(result);
+            result.value().at("sample_a").at(0)->set_attribute_value("data", db::value{data.data(), data.size()});
+        });
 
-            inserted_objects_1 = std::move(result.value());
-            XCTAssertGreaterThan(inserted_objects_1.count("sample_a"), 0);
-
-            db::object_vector_t const &objects = inserted_objects_1.at("sample_a");
-            XCTAssertEqual(objects.size(), 3);
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-            XCTAssertEqual(objects.at(0)->object_id().stable_value(), db::value{1});
-            XCTAssertEqual(objects.at(1)->object_id().stable_value(), db::value{2});
-            XCTAssertEqual(objects.at(2)->object_id().stable_value(), db::value{3});
+    XCTestExpectation *exp = [self expectationWithDescription:@"read"];
 
-            XCTAssertEqual(objects.at(0)->save_id(), db::value{1});
-            XCTAssertEqual(objects.at(1)->save_id(), db::value{1});
-            XCTAssertEqual(objects.at(2)->save_id(), db::value{1});
+    std::vector<std::size_t> chunk_sizes;
+    std::vector<std::byte> read_data;
 
-            XCTAssertEqual(objects.at(0)->action(), db::insert_action_value());
-            XCTAssertEqual(objects.at(1)->action(), db::insert_action_value());
-            XCTAssertEqual(objects.at(2)->action(), db::insert_action_value());
+    manager->fetch_const_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [&manager, &chunk_sizes, &read_data, exp](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
 
-            [exp1 fulfill];
+            manager->read_attribute_blob(
+                db::no_cancellation, result.value().at("sample_a").at(0), "data",
+                [&chunk_sizes, &read_data](std::span<std::byte const> const chunk) {
+                    XCTAssertFalse([NSThread isMainThread]);
+                    chunk_sizes.push_back(chunk.size());
+                    read_data.insert(read_data.end(), chunk.begin(), chunk.end());
+                    return true;
+                },
+                [exp](db::manager_result_t result) {
+                    XCTAssertTrue(result);
+                    [exp fulfill];
+                },
+                400);
         });
 
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTAssertEqual(inserted_objects_1.size(), 1);
-    XCTAssertGreaterThan(inserted_objects_1.count("sample_a"), 0);
-    XCTAssertEqual(inserted_objects_1.at("sample_a").size(), 3);
+    XCTAssertEqual(chunk_sizes, (std::vector<std::size_t>{400, 400, 200}));
+    XCTAssertTrue(read_data == data);
+}
 
-    XCTAssertEqual(manager->current_save_id(), db::value{1});
-    XCTAssertEqual(manager->last_save_id(), db::value{1});
+- (void)test_fetch_excluding_attributes {
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
 
-    XCTestExpectation *exp2 = [self expectationWithDescription:@"insert_2"];
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-    db::object_vector_map_t inserted_objects_2;
+    std::vector<std::byte> data(100, std::byte(1));
 
     manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}};
-        },
-        [self, exp2, &inserted_objects_2](auto result) {
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [&data](auto result) {
             XCTAssertTrue(result);
+            auto const &object = result.value().at("sample_a").at(0);
+            object->set_attribute_value("name", db::value{"value_0"});
+            object->set_attribute_value("data", db::value{data.data(), data.size()});
+        });
 
-            inserted_objects_2 = std::move(result.value());
-            db::object_vector_t const &objects = inserted_objects_2.at("sample_a");
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-            XCTAssertEqual(objects.size(), 1);
+    db::object_ptr object = nullptr;
 
-            XCTAssertEqual(objects.at(0)->object_id().stable_value(), db::value{4});
-            XCTAssertEqual(objects.at(0)->save_id(), db::value{2});
-            XCTAssertEqual(objects.at(0)->action(), db::insert_action_value());
+    manager->fetch_objects(
+        db::no_cancellation,
+        []() {
+            db::fetch_option option = db::to_fetch_option(db::select_option{.table = "sample_a"});
+            option.exclude_attributes("sample_a", {"data"});
+            return option;
+        },
+        [&object](db::manager_vector_result_t result) {
+            XCTAssertTrue(result);
+            object = result.value().at("sample_a").at(0);
+            XCTAssertFalse(object->is_attribute_loaded("data"));
+            XCTAssertTrue(object->is_attribute_loaded("name"));
+            XCTAssertEqual(object->attribute_value("name"), db::value{"value_0"});
 
-            [exp2 fulfill];
+            // 読み込んでいないアトリビュートは、他のアトリビュートを変更してセーブしても前の値のまま
+            object->set_attribute_value("name", db::value{"value_1"});
         });
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-
-    XCTAssertEqual(inserted_objects_2.size(), 1);
-    XCTAssertEqual(inserted_objects_2.count("sample_a"), 1);
-    XCTAssertEqual(inserted_objects_2.at("sample_a").size(), 1);
-
-    XCTAssertEqual(manager->current_save_id(), db::value{2});
-    XCTAssertEqual(manager->last_save_id(), db::value{2});
-
-    auto const object_1 = manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{1}));
-    XCTAssertTrue(object_1);
-    XCTAssertEqual(object_1->get()->object_id().stable_value(), db::value{1});
-
-    XCTAssertFalse(manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{5})));
-}
+    XCTestExpectation *exp = [self expectationWithDescription:@"read"];
 
-- (void)test_insert_objects_by_values {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    std::vector<std::byte> read_data;
 
-    manager->setup([self, &manager](auto result) {
+    manager->save(db::no_cancellation, [&manager, &object, &read_data, exp](auto result) {
         XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{0});
-    });
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            db::value_map_t obj1{{"name", db::value{"test_name_1"}}, {"age", db::value{43}}};
-            db::value_map_t obj2{{"name", db::value{"test_name_2"}}, {"age", db::value{67}}};
-            db::value_map_vector_t sample_as{std::move(obj1), std::move(obj2)};
-            return db::value_map_vector_map_t{{"sample_a", std::move(sample_as)}};
-        },
-        [self, &manager](auto result) {
-            XCTAssertTrue(result);
+        // 読み込んでいないアトリビュートの値はread_attribute_blobで読み込む
+        manager->read_attribute_blob(
+            db::no_cancellation, object, "data",
+            [&read_data](std::span<std::byte const> const chunk) {
+                read_data.insert(read_data.end(), chunk.begin(), chunk.end());
+                return true;
+            },
+            [exp](db::manager_result_t result) {
+                XCTAssertTrue(result);
+                [exp fulfill];
+            });
+    });
 
-            auto &objects = result.value();
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-            XCTAssertEqual(objects.count("sample_a"), 1);
+    XCTAssertEqual(object->attribute_value("name"), db::value{"value_1"});
+    XCTAssertFalse(object->is_attribute_loaded("data"));
+    XCTAssertTrue(read_data == data);
+}
 
-            auto &a_objects = objects.at("sample_a");
+- (void)test_in_memory {
+    auto const manager = db::manager::make_shared(db::in_memory_path, [yas_db_test_utils model_0_0_1], 1,
+                                                  {.persistent = false, .reader_count = 1});
 
-            XCTAssertEqual(a_objects.size(), 2);
+    XCTAssertTrue(manager->connection_option().persistent);
+    XCTAssertEqual(manager->connection_option().reader_count, 0);
 
-            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"test_name_1"});
-            XCTAssertEqual(a_objects.at(0)->attribute_value("age"), db::value{43});
-            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"test_name_2"});
-            XCTAssertEqual(a_objects.at(1)->attribute_value("age"), db::value{67});
+    manager->setup([](auto result) { XCTAssertTrue(result); });
 
-            XCTAssertEqual(manager->current_save_id(), db::value{1});
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 2}}; },
+        [](auto result) {
+            XCTAssertTrue(result);
+            result.value().at("sample_a").at(0)->set_attribute_value("name", db::value{"value_0"});
         });
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-}
-
-- (void)test_insert_many_entity_objects {
-    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+    manager->save(db::no_cancellation, [](auto result) { XCTAssertTrue(result); });
 
-    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+    XCTestExpectation *exp = [self expectationWithDescription:@"fetch"];
 
-    manager->insert_objects(
+    // タスクごとに閉じられずに、保存したデータが残っている
+    manager->fetch_const_objects(
         db::no_cancellation,
         []() {
-            return db::entity_count_map_t{{"sample_a", 3}, {"sample_b", 5}};
+            return db::to_fetch_option(
+                db::select_option{.table = "sample_a", .field_orders = {{db::object_id_field, db::order::ascending}}});
         },
-        [](auto result) {
-            db::object_vector_map_t const &objects = result.value();
+        [exp](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
+            auto const &objects = result.value().at("sample_a");
             XCTAssertEqual(objects.size(), 2);
-
-            XCTAssertGreaterThan(objects.count("sample_a"), 0);
-
-            db::object_vector_t const &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 3);
-
-            XCTAssertGreaterThan(objects.count("sample_b"), 0);
-
-            db::object_vector_t const &b_objects = objects.at("sample_b");
-            XCTAssertEqual(b_objects.size(), 5);
+            XCTAssertEqual(objects.at(0)->attribute_value("name"), db::value{"value_0"});
+            [exp fulfill];
         });
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertFalse(std::filesystem::exists(db::in_memory_path));
 }
 
-- (void)test_insert_with_delete {
+- (void)test_create_object {
     db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
     auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
 
-    manager->setup([self, &manager](auto result) {
+    db::object_vector_t objects;
+
+    manager->setup([self, &manager, &objects](auto result) {
         XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{0});
-        XCTAssertEqual(manager->last_save_id(), db::value{0});
-    });
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}};
-        },
-        [self, &manager](auto result) {
-            XCTAssertTrue(result);
-            XCTAssertEqual(manager->current_save_id(), db::value{1});
+        objects.emplace_back(manager->create_object("sample_a"));
+        objects.emplace_back(manager->create_object("sample_a"));
 
-            auto &objects = result.value();
-            auto &object = objects.at("sample_a").at(0);
-            XCTAssertEqual(object->save_id(), db::value{1});
+        for (auto const &idx : make_each_index(2)) {
+            auto const &object = objects[idx];
 
-            object->set_attribute_value("name", db::value{"first_name_value"});
-        });
+            XCTAssertEqual(object->status(), db::object_status::created);
+            XCTAssertTrue(object->object_id().is_temporary());
+            XCTAssertEqual(object->attribute_value(db::action_field), db::insert_action_value());
+            XCTAssertEqual(object->attribute_value("name"), db::value{"default_value"});
+            XCTAssertEqual(object->attribute_value("age"), db::value{10});
+            XCTAssertEqual(object->attribute_value("weight"), db::value{65.4});
 
-    manager->save(db::no_cancellation, [self, &manager](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{2});
-    });
+            XCTAssertFalse(object->attribute_value(db::pk_id_field));
+            XCTAssertEqual(object->attribute_value(db::save_id_field), db::value{0});
+        }
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}};
-        },
-        [self, &manager](auto result) {
-            XCTAssertTrue(result);
-            XCTAssertEqual(manager->current_save_id(), db::value{3});
+        objects[0]->set_attribute_value("name", db::value{"test_name_0_created"});
+        objects[1]->set_attribute_value("name", db::value{"test_name_1_created"});
 
-            auto &objects = result.value();
-            auto &object = objects.at("sample_a").at(0);
-            XCTAssertEqual(object->save_id(), db::value{3});
+        XCTAssertEqual(objects[0]->status(), db::object_status::created);
+        XCTAssertEqual(objects[1]->status(), db::object_status::created);
 
-            object->set_attribute_value("name", db::value{"second_name_value"});
-        });
+        XCTAssertTrue(manager->has_created_objects());
+        XCTAssertEqual(manager->created_object_count("sample_a"), 2);
+    });
 
-    manager->save(db::no_cancellation, [self, &manager](db::manager_map_result_t result) {
+    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
         XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{4});
-    });
+        XCTAssertEqual(manager->current_save_id(), db::value{1});
 
-    manager->revert(
-        db::no_cancellation, []() { return 2; },
-        [self, &manager](auto result) {
-            XCTAssertTrue(result);
-            XCTAssertEqual(manager->current_save_id(), db::value{2});
-        });
+        db::object_map_t &a_objects = result.value().at("sample_a");
+        XCTAssertEqual(a_objects.size(), 2);
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}};
-        },
-        [self, &manager](auto result) {
-            XCTAssertTrue(result);
-            XCTAssertEqual(manager->current_save_id(), db::value{3});
+        auto each = make_fast_each(objects.size());
+        while (yas_each_next(each)) {
+            auto const &idx = yas_each_index(each);
+            auto const &object = objects.at(idx);
+            auto const &saved_object = a_objects.at(object->object_id().stable());
 
-            auto &objects = result.value();
-            auto &object = objects.at("sample_a").at(0);
-            XCTAssertEqual(object->save_id(), db::value{3});
-        });
+            XCTAssertEqual(saved_object, object);
+            XCTAssertTrue(saved_object->object_id().stable_value());
 
-    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
-        auto &db = manager->database();
-        auto result = db::select(db, {.table = "sample_a"});
+            XCTAssertEqual(saved_object->status(), db::object_status::saved);
+            XCTAssertEqual(saved_object->attribute_value(db::action_field), db::insert_action_value());
+            XCTAssertEqual(saved_object->attribute_value("age"), db::value{10});
+            XCTAssertEqual(saved_object->attribute_value("weight"), db::value{65.4});
 
-        auto &object_datas = result.value();
-        XCTAssertEqual(object_datas.size(), 3);
+            XCTAssertEqual(saved_object->attribute_value(db::save_id_field), db::value{1});
 
-        for (auto &object_data : object_datas) {
-            XCTAssertNotEqual(object_data.at("name"), db::value{"second_name_value"});
+            if (idx == 0) {
+                XCTAssertEqual(saved_object->attribute_value("name"), db::value{"test_name_0_created"});
+            } else if (idx == 1) {
+                XCTAssertEqual(saved_object->attribute_value("name"), db::value{"test_name_1_created"});
+            }
         }
+
+        XCTAssertFalse(manager->has_created_objects());
+        XCTAssertEqual(manager->created_object_count("sample_a"), 0);
     });
 
     XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
@@ -797,145 +894,93 @@ using namespace yas;
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_fetch_objects {
+- (void)test_create_and_save_objects {
     db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
     auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
 
-    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
-
-    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    db::object_vector_t objects{};
 
-    db::object_vector_map_t objects;
+    manager->setup([self, &manager, &objects](auto result) {
+        XCTAssertTrue(result);
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 3}, {"sample_b", 2}};
-        },
-        [self, exp1, &objects](auto result) {
-            XCTAssertTrue(result);
+        objects.emplace_back(manager->create_object("sample_a"));
+        objects.emplace_back(manager->create_object("sample_a"));
 
-            objects = std::move(result.value());
+        objects[0]->set_attribute_value("name", db::value{"test_name_0_created"});
+        objects[1]->set_attribute_value("name", db::value{"test_name_1_created"});
 
-            XCTAssertGreaterThan(objects.count("sample_a"), 0);
-            auto &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 3);
-            XCTAssertEqual(a_objects.at(0)->object_id().stable(), 1);
-            XCTAssertEqual(a_objects.at(1)->object_id().stable(), 2);
-            XCTAssertEqual(a_objects.at(2)->object_id().stable(), 3);
-            XCTAssertEqual(a_objects.at(0)->save_id().get<db::integer>(), 1);
-            XCTAssertEqual(a_objects.at(1)->save_id().get<db::integer>(), 1);
-            XCTAssertEqual(a_objects.at(2)->save_id().get<db::integer>(), 1);
-            XCTAssertEqual(a_objects.at(0)->attribute_value("name").get<db::text>(), "default_value");
-            XCTAssertEqual(a_objects.at(1)->attribute_value("name").get<db::text>(), "default_value");
-            XCTAssertEqual(a_objects.at(2)->attribute_value("name").get<db::text>(), "default_value");
+        XCTAssertTrue(manager->has_created_objects());
+        XCTAssertEqual(manager->created_object_count("sample_a"), 2);
+    });
 
-            XCTAssertGreaterThan(objects.count("sample_b"), 0);
-            auto &b_objects = objects.at("sample_b");
-            XCTAssertEqual(b_objects.size(), 2);
-            XCTAssertEqual(b_objects.at(0)->object_id().stable(), 1);
-            XCTAssertEqual(b_objects.at(1)->object_id().stable(), 2);
-            XCTAssertEqual(b_objects.at(0)->save_id().get<db::integer>(), 1);
-            XCTAssertEqual(b_objects.at(1)->save_id().get<db::integer>(), 1);
-            XCTAssertFalse(b_objects.at(0)->attribute_value("name"));
-            XCTAssertFalse(b_objects.at(1)->attribute_value("name"));
+    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+        XCTAssertFalse(manager->has_created_objects());
 
-            [exp1 fulfill];
-        });
+        XCTAssertEqual(objects[0]->status(), db::object_status::saved);
+        XCTAssertEqual(objects[1]->status(), db::object_status::saved);
+        XCTAssertTrue(manager->cached_or_created_object("sample_a", objects[0]->object_id()));
+        XCTAssertTrue(manager->cached_or_created_object("sample_a", objects[1]->object_id()));
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-
-    XCTAssertEqual(manager->current_save_id(), db::value{1});
-    XCTAssertEqual(manager->last_save_id(), db::value{1});
-    objects.at("sample_a").at(1)->set_attribute_value("name", db::value{"value_1"});
-    objects.at("sample_a").at(1)->add_relation_id("child", objects.at("sample_b").at(0)->object_id());
-
-    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
-
-    manager->save(db::no_cancellation, [self, exp2](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
-
-        [exp2 fulfill];
-    });
-
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-
-    XCTAssertEqual(manager->current_save_id(), db::value{2});
-    XCTAssertEqual(manager->last_save_id(), db::value{2});
-
-    XCTestExpectation *exp3 = [self expectationWithDescription:@"3"];
-
-    manager->fetch_objects(
-        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
-        [self, exp3](auto fetch_result) {
-            XCTAssertTrue(fetch_result);
+        objects[0]->set_attribute_value("name", db::value{"test_name_0_saved"});
+        objects[0]->set_attribute_value("age", db::value{0});
+        objects[1]->set_attribute_value("name", db::value{"test_name_1_saved"});
+        objects[1]->set_attribute_value("age", db::value{1});
 
-            auto const &objects = fetch_result.value();
-            XCTAssertGreaterThan(objects.count("sample_a"), 0);
-            auto &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 3);
-            XCTAssertEqual(a_objects.at(0)->object_id().stable_value(), db::value{1});
-            XCTAssertEqual(a_objects.at(1)->object_id().stable_value(), db::value{3});
-            XCTAssertEqual(a_objects.at(2)->object_id().stable_value(), db::value{2});
-            XCTAssertEqual(a_objects.at(0)->save_id(), db::value{1});
-            XCTAssertEqual(a_objects.at(1)->save_id(), db::value{1});
-            XCTAssertEqual(a_objects.at(2)->save_id(), db::value{2});
-            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"default_value"});
-            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"default_value"});
-            XCTAssertEqual(a_objects.at(2)->attribute_value("name"), db::value{"value_1"});
+        XCTAssertEqual(objects[0]->status(), db::object_status::changed);
+        XCTAssertEqual(objects[1]->status(), db::object_status::changed);
 
-            XCTAssertEqual(a_objects.at(2)->relation_size("child"), 1);
-            XCTAssertEqual(a_objects.at(2)->relation_ids("child").size(), 1);
-            XCTAssertEqual(a_objects.at(2)->relation_id("child", 0).stable(), 1);
+        XCTAssertTrue(manager->has_changed_objects());
+        XCTAssertEqual(manager->changed_object_count("sample_a"), 2);
+        XCTAssertFalse(manager->has_created_objects());
+        XCTAssertEqual(manager->created_object_count("sample_a"), 0);
 
-            [exp3 fulfill];
-        });
+        objects.emplace_back(manager->create_object("sample_a"));
+        objects.emplace_back(manager->create_object("sample_a"));
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+        objects[2]->set_attribute_value("name", db::value{"test_name_2_created"});
+        objects[2]->set_attribute_value("age", db::value{2});
+        objects[3]->set_attribute_value("name", db::value{"test_name_3_created"});
+        objects[3]->set_attribute_value("age", db::value{3});
 
-    objects.at("sample_a").at(2)->set_attribute_value("name", db::value{"value_2"});
-    objects.at("sample_a").at(2)->remove_all_relations("child");
-    objects.at("sample_a").at(2)->add_relation_id("child", objects.at("sample_b").at(1)->object_id());
-    objects.at("sample_a").at(2)->add_relation_id("child", objects.at("sample_b").at(0)->object_id());
+        XCTAssertTrue(manager->has_created_objects());
+    });
 
-    XCTestExpectation *exp4 = [self expectationWithDescription:@"4"];
+    manager->save(db::no_cancellation, [self, &manager, &objects](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
 
-    manager->save(db::no_cancellation, [self, exp4](db::manager_map_result_t result) { [exp4 fulfill]; });
+        XCTAssertEqual(objects[0]->attribute_value("name"), db::value{"test_name_0_saved"});
+        XCTAssertEqual(objects[1]->attribute_value("name"), db::value{"test_name_1_saved"});
+        XCTAssertEqual(objects[2]->attribute_value("name"), db::value{"test_name_2_created"});
+        XCTAssertEqual(objects[3]->attribute_value("name"), db::value{"test_name_3_created"});
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+        XCTAssertEqual(objects[0]->status(), db::object_status::saved);
+        XCTAssertEqual(objects[1]->status(), db::object_status::saved);
+        XCTAssertEqual(objects[2]->status(), db::object_status::saved);
+        XCTAssertEqual(objects[3]->status(), db::object_status::saved);
 
-    XCTAssertEqual(manager->current_save_id(), db::value{3});
-    XCTAssertEqual(manager->last_save_id(), db::value{3});
+        XCTAssertTrue(objects[0]->object_id().stable_value());
+        XCTAssertTrue(objects[1]->object_id().stable_value());
+        XCTAssertTrue(objects[2]->object_id().stable_value());
+        XCTAssertTrue(objects[3]->object_id().stable_value());
+    });
 
-    manager->fetch_objects(
+    manager->fetch_const_objects(
         db::no_cancellation,
         []() {
-            return db::to_fetch_option(db::select_option{.table = "sample_a",
-                                                         .where_exprs = db::field_expr("name", "like"),
-                                                         .arguments = {{"name", db::value{"value_%"}}},
-                                                         .field_orders = {{db::object_id_field, db::order::descending}},
-                                                         .limit_range = db::range{0, 3}});
+            return db::to_fetch_option(db::select_option{
+                .table = "sample_a", .field_orders = {db::field_order{.field = "age", .order = db::order::ascending}}});
         },
-        [self, &objects](auto fetch_result) {
-            XCTAssertTrue(fetch_result);
-
-            auto const &objects = fetch_result.value();
-            XCTAssertGreaterThan(objects.count("sample_a"), 0);
-            auto &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 2);
-
-            XCTAssertEqual(a_objects.at(0)->object_id().stable_value(), db::value{3});
-            XCTAssertEqual(a_objects.at(0)->save_id(), db::value{3});
-            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"value_2"});
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
 
-            XCTAssertEqual(a_objects.at(1)->object_id().stable_value(), db::value{2});
-            XCTAssertEqual(a_objects.at(1)->save_id(), db::value{2});
-            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"value_1"});
+            db::const_object_vector_t &objects = result.value().at("sample_a");
+            XCTAssertEqual(objects.size(), 4);
 
-            XCTAssertEqual(a_objects.at(0)->relation_size("child"), 2);
-            XCTAssertEqual(a_objects.at(0)->relation_ids("child").size(), 2);
-            XCTAssertEqual(a_objects.at(0)->relation_id("child", 0).stable(), 2);
-            XCTAssertEqual(a_objects.at(0)->relation_id("child", 1).stable(), 1);
+            XCTAssertEqual(objects[0]->attribute_value("name"), db::value{"test_name_0_saved"});
+            XCTAssertEqual(objects[1]->attribute_value("name"), db::value{"test_name_1_saved"});
+            XCTAssertEqual(objects[2]->attribute_value("name"), db::value{"test_name_2_created"});
+            XCTAssertEqual(objects[3]->attribute_value("name"), db::value{"test_name_3_created"});
         });
 
     XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
@@ -943,544 +988,1653 @@ using namespace yas;
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_fetch_const_objects {
+- (void)test_set_relation_to_temporary_object {
+    // temporaryなオブジェクトのrelationにtemporaryなオブジェクトをセットして保存するテスト
+
     db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
     auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
 
-    manager->setup([self, &manager](auto result) mutable { XCTAssertTrue(result); });
+    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 1}};
-        },
-        [self, &manager](auto result) mutable {
-            XCTAssertTrue(result);
-            auto &objects = result.value();
+    manager->setup([self, &manager, &setupExp](auto result) {
+        XCTAssertTrue(result);
 
-            XCTAssertEqual(manager->current_save_id(), db::value{1});
-            XCTAssertEqual(manager->last_save_id(), db::value{1});
+        [setupExp fulfill];
+    });
 
-            objects.at("sample_a").at(0)->set_attribute_value("name", db::value{"value_0"});
+    [self waitForExpectations:@[setupExp] timeout:10.0];
 
-            auto &object_b = objects.at("sample_b").at(0);
-            objects.at("sample_a").at(0)->add_relation_id("child", object_b->object_id());
+    auto object_a = manager->create_object("sample_a");
+    auto object_b1 = manager->create_object("sample_b");
+    auto object_b2 = manager->create_object("sample_b");
 
-            XCTAssertEqual(object_b->object_id().stable_value(), db::value{1});
-        });
+    XCTAssertTrue(object_a->object_id().is_temporary());
+    XCTAssertTrue(object_b1->object_id().is_temporary());
+    XCTAssertTrue(object_b2->object_id().is_temporary());
 
-    manager->save(db::no_cancellation, [](db::manager_map_result_t result) { XCTAssertTrue(result); });
+    XCTAssertNoThrow(object_a->add_relation_object("child", object_b1));
+    XCTAssertNoThrow(object_a->add_relation_object("child", object_b2));
 
-    manager->fetch_const_objects(
-        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
-        [](db::manager_const_vector_result_t fetch_result) mutable {
-            XCTAssertTrue(fetch_result);
+    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
 
-            auto const &objects = fetch_result.value();
-            XCTAssertGreaterThan(objects.count("sample_a"), 0);
-            auto &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 1);
-            XCTAssertEqual(a_objects.at(0)->object_id().stable(), 1);
-            XCTAssertEqual(a_objects.at(0)->save_id().get<db::integer>(), 2);
-            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"value_0"});
+    db::object_map_map_t result_objects;
 
-            XCTAssertEqual(a_objects.at(0)->relation_size("child"), 1);
-            XCTAssertEqual(a_objects.at(0)->relation_ids("child").size(), 1);
-            XCTAssertEqual(a_objects.at(0)->relation_id("child", 0).stable(), 1);
-        });
+    manager->save(db::no_cancellation, [self, &result_objects, &saveExp](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-}
+        result_objects = std::move(result.value());
 
-- (void)test_fetch_objects_of_relations {
-    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+        [saveExp fulfill];
+    });
 
-    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+    [self waitForExpectations:@[saveExp] timeout:10.0];
 
-    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    XCTAssertTrue(object_a->object_id().is_stable());
+    XCTAssertTrue(object_b1->object_id().is_stable());
+    XCTAssertTrue(object_b2->object_id().is_stable());
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 1}, {"sample_c", 1}};
-        },
-        [self, exp1](auto result) {
-            XCTAssertTrue(result);
+    XCTAssertEqual(object_a->relation_id("child", 0), object_b1->object_id());
+    XCTAssertEqual(object_a->relation_id("child", 1), object_b2->object_id());
 
-            auto const &objects = result.value();
-            XCTAssertEqual(objects.size(), 3);
-            XCTAssertEqual(objects.count("sample_a"), 1);
-            XCTAssertEqual(objects.count("sample_b"), 1);
-            XCTAssertEqual(objects.count("sample_c"), 1);
+    XCTAssertEqual(manager->relation_object_at(object_a, "child", 0), object_b1);
+    XCTAssertEqual(manager->relation_object_at(object_a, "child", 1), object_b2);
 
-            auto const &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 1);
+    db::object_ptr const &result_object_a = result_objects.at("sample_a").begin()->second;
 
-            auto const &b_objects = objects.at("sample_b");
-            XCTAssertEqual(b_objects.size(), 1);
+    XCTAssertEqual(object_a, result_object_a);
+    XCTAssertTrue(result_objects.at("sample_b").count(object_b1->object_id().stable()) > 0);
+    XCTAssertTrue(result_objects.at("sample_b").count(object_b2->object_id().stable()) > 0);
+}
 
-            auto const &c_objects = objects.at("sample_c");
-            XCTAssertEqual(c_objects.size(), 1);
+- (void)test_set_temporary_relation_to_saved_object {
+    // stableなオブジェクトのrelationにtemporaryなオブジェクトをセットして保存するテスト
 
-            auto object_a = a_objects.at(0);
-            auto object_b = b_objects.at(0);
-            auto object_c = c_objects.at(0);
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
 
-            object_a->add_relation_object("child", object_b);
-            object_a->add_relation_object("friend", object_c);
+    {
+        XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
 
-            object_b->add_relation_object("parent", object_a);
-            object_c->add_relation_object("friend", object_a);
+        manager->setup([self, &manager, &setupExp](auto result) {
+            XCTAssertTrue(result);
 
-            [exp1 fulfill];
+            [setupExp fulfill];
         });
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+        [self waitForExpectations:@[setupExp] timeout:10.0];
+    }
 
-    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    auto object_a = manager->create_object("sample_a");
 
-    manager->save(db::no_cancellation, [&manager, self, exp2](db::manager_map_result_t save_result) {
-        XCTAssertTrue(save_result);
+    {
+        XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
 
-        db::object_map_map_t const &objects = save_result.value();
+        manager->save(db::no_cancellation, [self, &saveExp](db::manager_map_result_t result) {
+            XCTAssertTrue(result);
 
-        XCTAssertEqual(objects.size(), 3);
-        XCTAssertEqual(objects.at("sample_a").size(), 1);
-        XCTAssertEqual(objects.at("sample_b").size(), 1);
-        XCTAssertEqual(objects.at("sample_c").size(), 1);
+            [saveExp fulfill];
+        });
 
-        auto const &a_object = objects.at("sample_a").begin()->second;
-        auto const &b_object = objects.at("sample_b").begin()->second;
+        [self waitForExpectations:@[saveExp] timeout:10.0];
+    }
+
+    XCTAssertTrue(object_a->object_id().is_stable());
+
+    auto object_b = manager->create_object("sample_b");
+
+    object_a->add_relation_object("child", object_b);
+
+    {
+        XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+
+        manager->save(db::no_cancellation, [self, &saveExp](db::manager_map_result_t result) {
+            XCTAssertTrue(result);
+
+            [saveExp fulfill];
+        });
+
+        [self waitForExpectations:@[saveExp] timeout:10.0];
+    }
+
+    XCTAssertTrue(object_a->relation_id("child", 0).is_stable());
+    XCTAssertEqual(manager->relation_object_at(object_a, "child", 0)->get()->object_id(), object_b->object_id());
+}
+
+- (void)test_object_relation_objects {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    XCTestExpectation *setup_exp = [self expectationWithDescription:@"setup manager"];
+
+    manager->setup([setup_exp](auto result) { [setup_exp fulfill]; });
+
+    [self waitForExpectations:@[setup_exp] timeout:10.0];
+
+    db::object_ptr obj = manager->create_object("sample_a");
+    db::object_ptr obj_b1 = manager->create_object("sample_b");
+    db::object_ptr obj_b2 = manager->create_object("sample_b");
+    db::object_ptr obj_b3 = manager->create_object("sample_b");
+
+    XCTestExpectation *save_exp = [self expectationWithDescription:@"setup manager"];
+
+    manager->save(db::no_cancellation, [save_exp](db::manager_map_result_t save_result) { [save_exp fulfill]; });
+
+    [self waitForExpectations:@[save_exp] timeout:10.0];
+
+    obj->add_relation_object("child", obj_b1);
+    obj->add_relation_object("child", obj_b2);
+    obj->add_relation_object("child", obj_b3);
+
+    auto rel_objects = manager->relation_objects(obj, "child");
+
+    XCTAssertEqual(rel_objects.size(), 3);
+
+    XCTAssertTrue(rel_objects.at(0));
+    XCTAssertTrue(rel_objects.at(1));
+    XCTAssertTrue(rel_objects.at(2));
+
+    XCTAssertEqual(rel_objects.at(0)->get()->object_id().stable_value(), obj_b1->object_id().stable_value());
+    XCTAssertEqual(rel_objects.at(1)->get()->object_id().stable_value(), obj_b2->object_id().stable_value());
+    XCTAssertEqual(rel_objects.at(2)->get()->object_id().stable_value(), obj_b3->object_id().stable_value());
+}
+
+- (void)test_setup_migration {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    db::manager_ptr manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
+
+        db::begin_transaction(db);
+
+        bool rollback = false;
+
+        if (!db->execute_update(db::insert_sql("sample_a", {"age", "name", "weight"}),
+                                {db::value{2}, db::value{"xyz"}, db::value{451.2}})) {
+            rollback = true;
+        }
+
+        if (!db->execute_update(db::insert_sql("sample_b", {"name"}), {db::value{"qwerty"}})) {
+            rollback = true;
+        }
+
+        db::select_option option_a{.table = "sample_a", .fields = {db::object_id_field}};
+        auto select_result_a = db::select(db, option_a);
+        auto &src_obj_id = select_result_a.value().at(0).at(db::object_id_field);
+
+        db::select_option option_b{.table = "sample_b", .fields = {db::object_id_field}};
+        auto select_result_b = db::select(db, option_b);
+        auto &tgt_obj_id = select_result_b.value().at(0).at(db::object_id_field);
+
+        auto sql = db::insert_sql("rel_sample_a_child", {db::src_obj_id_field, db::tgt_obj_id_field});
+        if (!db->execute_update(sql, db::value_vector_t{src_obj_id, tgt_obj_id})) {
+            rollback = true;
+        }
+
+        db::value const save_id{100};
+        if (!db->execute_update(db::update_sql(db::info_table, {db::current_save_id_field, db::last_save_id_field}, ""),
+                                db::value_vector_t{save_id, save_id})) {
+            rollback = true;
+        }
+
+        XCTAssertFalse(rollback);
+
+        if (rollback) {
+            db::rollback(db);
+        } else {
+            db::commit(db);
+        }
+    });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    manager = nullptr;
+
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+
+    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
+
+        XCTAssertTrue(db::table_exists(db, db::info_table));
+        auto select_infos_result = db::select(db, db::select_option{.table = db::info_table});
+        XCTAssertTrue(select_infos_result);
+        XCTAssertEqual(select_infos_result.value().size(), 1);
+        XCTAssertEqual(select_infos_result.value().at(0).at(db::version_field).get<db::text>(), "0.0.2");
+        XCTAssertEqual(select_infos_result.value().at(0).at(db::current_save_id_field).get<db::integer>(), 100);
+        XCTAssertEqual(select_infos_result.value().at(0).at(db::last_save_id_field).get<db::integer>(), 100);
+
+        XCTAssertTrue(db::table_exists(db, "sample_a"));
+        auto select_result_a = db::select(db, db::select_option{.table = "sample_a"});
+        XCTAssertTrue(select_result_a);
+        XCTAssertEqual(select_result_a.value().size(), 1);
+
+        auto const &sample_a = select_result_a.value().at(0);
+        XCTAssertEqual(sample_a.at("age").get<db::integer>(), 2);
+        XCTAssertEqual(sample_a.at("name").get<db::text>(), "xyz");
+        XCTAssertEqual(sample_a.at("weight").get<db::real>(), 451.2);
+
+        XCTAssertTrue(db::table_exists(db, "sample_b"));
+        auto select_result_b = db::select(db, db::select_option{.table = "sample_b"});
+        XCTAssertTrue(select_result_b);
+        XCTAssertEqual(select_result_b.value().size(), 1);
+
+        auto const &sample_b = select_result_b.value().at(0);
+        XCTAssertEqual(sample_b.at("name").get<db::text>(), "qwerty");
+
+        XCTAssertTrue(db::table_exists(db, "sample_c"));
+        auto select_result_c = db::select(db, db::select_option{.table = "sample_c"});
+        XCTAssertTrue(select_result_c);
+        XCTAssertEqual(select_result_c.value().size(), 0);
+
+        XCTAssertTrue(db::table_exists(db, "rel_sample_a_child"));
+        auto select_rels_result = db::select(db, db::select_option{.table = "rel_sample_a_child"});
+        XCTAssertEqual(select_rels_result.value().size(), 1);
+
+        auto &src_obj_id = sample_a.at(db::object_id_field);
+        auto &tgt_obj_id = sample_b.at(db::object_id_field);
+
+        auto &rel = select_rels_result.value().at(0);
+        XCTAssertEqual(rel.at(db::src_obj_id_field), src_obj_id);
+        XCTAssertEqual(rel.at(db::tgt_obj_id_field), tgt_obj_id);
+
+        XCTAssertTrue(db::index_exists(db, "sample_a_name"));
+        XCTAssertTrue(db::index_exists(db, "sample_a_others"));
+        XCTAssertTrue(db::index_exists(db, "sample_b_name"));
+    });
+
+    exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_insert_objects_by_count {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"insert_1"];
+
+    manager->setup([self, &manager](auto result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{0});
+        XCTAssertEqual(manager->last_save_id(), db::value{0});
+    });
+
+    db::object_vector_map_t inserted_objects_1;
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 3}};
+        },
+        [self, exp1, &inserted_objects_1](auto result) {
+            XCTAssertTrue(result);
+
+            inserted_objects_1 = std::move(result.value());
+            XCTAssertGreaterThan(inserted_objects_1.count("sample_a"), 0);
+
+            db::object_vector_t const &objects = inserted_objects_1.at("sample_a");
+            XCTAssertEqual(objects.size(), 3);
+
+            XCTAssertEqual(objects.at(0)->object_id().stable_value(), db::value{1});
+            XCTAssertEqual(objects.at(1)->object_id().stable_value(), db::value{2});
+            XCTAssertEqual(objects.at(2)->object_id().stable_value(), db::value{3});
+
+            XCTAssertEqual(objects.at(0)->save_id(), db::value{1});
+            XCTAssertEqual(objects.at(1)->save_id(), db::value{1});
+            XCTAssertEqual(objects.at(2)->save_id(), db::value{1});
+
+            XCTAssertEqual(objects.at(0)->action(), db::insert_action_value());
+            XCTAssertEqual(objects.at(1)->action(), db::insert_action_value());
+            XCTAssertEqual(objects.at(2)->action(), db::insert_action_value());
+
+            [exp1 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(inserted_objects_1.size(), 1);
+    XCTAssertGreaterThan(inserted_objects_1.count("sample_a"), 0);
+    XCTAssertEqual(inserted_objects_1.at("sample_a").size(), 3);
+
+    XCTAssertEqual(manager->current_save_id(), db::value{1});
+    XCTAssertEqual(manager->last_save_id(), db::value{1});
+
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"insert_2"];
+
+    db::object_vector_map_t inserted_objects_2;
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}};
+        },
+        [self, exp2, &inserted_objects_2](auto result) {
+            XCTAssertTrue(result);
+
+            inserted_objects_2 = std::move(result.value());
+            db::object_vector_t const &objects = inserted_objects_2.at("sample_a");
+
+            XCTAssertEqual(objects.size(), 1);
+
+            XCTAssertEqual(objects.at(0)->object_id().stable_value(), db::value{4});
+            XCTAssertEqual(objects.at(0)->save_id(), db::value{2});
+            XCTAssertEqual(objects.at(0)->action(), db::insert_action_value());
+
+            [exp2 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(inserted_objects_2.size(), 1);
+    XCTAssertEqual(inserted_objects_2.count("sample_a"), 1);
+    XCTAssertEqual(inserted_objects_2.at("sample_a").size(), 1);
+
+    XCTAssertEqual(manager->current_save_id(), db::value{2});
+    XCTAssertEqual(manager->last_save_id(), db::value{2});
+
+    auto const object_1 = manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{1}));
+    XCTAssertTrue(object_1);
+    XCTAssertEqual(object_1->get()->object_id().stable_value(), db::value{1});
+
+    XCTAssertFalse(manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{5})));
+}
+
+- (void)test_insert_objects_by_values {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{0});
+    });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            db::value_map_t obj1{{"name", db::value{"test_name_1"}}, {"age", db::value{43}}};
+            db::value_map_t obj2{{"name", db::value{"test_name_2"}}, {"age", db::value{67}}};
+            db::value_map_vector_t sample_as{std::move(obj1), std::move(obj2)};
+            return db::value_map_vector_map_t{{"sample_a", std::move(sample_as)}};
+        },
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
+
+            auto &objects = result.value();
+
+            XCTAssertEqual(objects.count("sample_a"), 1);
+
+            auto &a_objects = objects.at("sample_a");
+
+            XCTAssertEqual(a_objects.size(), 2);
+
+            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"test_name_1"});
+            XCTAssertEqual(a_objects.at(0)->attribute_value("age"), db::value{43});
+            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"test_name_2"});
+            XCTAssertEqual(a_objects.at(1)->attribute_value("age"), db::value{67});
+
+            XCTAssertEqual(manager->current_save_id(), db::value{1});
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_insert_many_entity_objects {
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+
+    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 3}, {"sample_b", 5}};
+        },
+        [](auto result) {
+            db::object_vector_map_t const &objects = result.value();
+            XCTAssertEqual(objects.size(), 2);
+
+            XCTAssertGreaterThan(objects.count("sample_a"), 0);
+
+            db::object_vector_t const &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 3);
+
+            XCTAssertGreaterThan(objects.count("sample_b"), 0);
+
+            db::object_vector_t const &b_objects = objects.at("sample_b");
+            XCTAssertEqual(b_objects.size(), 5);
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_insert_with_delete {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{0});
+        XCTAssertEqual(manager->last_save_id(), db::value{0});
+    });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}};
+        },
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(manager->current_save_id(), db::value{1});
+
+            auto &objects = result.value();
+            auto &object = objects.at("sample_a").at(0);
+            XCTAssertEqual(object->save_id(), db::value{1});
+
+            object->set_attribute_value("name", db::value{"first_name_value"});
+        });
+
+    manager->save(db::no_cancellation, [self, &manager](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{2});
+    });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}};
+        },
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(manager->current_save_id(), db::value{3});
+
+            auto &objects = result.value();
+            auto &object = objects.at("sample_a").at(0);
+            XCTAssertEqual(object->save_id(), db::value{3});
+
+            object->set_attribute_value("name", db::value{"second_name_value"});
+        });
+
+    manager->save(db::no_cancellation, [self, &manager](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{4});
+    });
+
+    manager->revert(
+        db::no_cancellation, []() { return 2; },
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(manager->current_save_id(), db::value{2});
+        });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}};
+        },
+        [self, &manager](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(manager->current_save_id(), db::value{3});
+
+            auto &objects = result.value();
+            auto &object = objects.at("sample_a").at(0);
+            XCTAssertEqual(object->save_id(), db::value{3});
+        });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
+        auto result = db::select(db, {.table = "sample_a"});
+
+        auto &object_datas = result.value();
+        XCTAssertEqual(object_datas.size(), 3);
+
+        for (auto &object_data : object_datas) {
+            XCTAssertNotEqual(object_data.at("name"), db::value{"second_name_value"});
+        }
+    });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_fetch_objects {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+
+    db::object_vector_map_t objects;
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 3}, {"sample_b", 2}};
+        },
+        [self, exp1, &objects](auto result) {
+            XCTAssertTrue(result);
+
+            objects = std::move(result.value());
+
+            XCTAssertGreaterThan(objects.count("sample_a"), 0);
+            auto &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 3);
+            XCTAssertEqual(a_objects.at(0)->object_id().stable(), 1);
+            XCTAssertEqual(a_objects.at(1)->object_id().stable(), 2);
+            XCTAssertEqual(a_objects.at(2)->object_id().stable(), 3);
+            XCTAssertEqual(a_objects.at(0)->save_id().get<db::integer>(), 1);
+            XCTAssertEqual(a_objects.at(1)->save_id().get<db::integer>(), 1);
+            XCTAssertEqual(a_objects.at(2)->save_id().get<db::integer>(), 1);
+            XCTAssertEqual(a_objects.at(0)->attribute_value("name").get<db::text>(), "default_value");
+            XCTAssertEqual(a_objects.at(1)->attribute_value("name").get<db::text>(), "default_value");
+            XCTAssertEqual(a_objects.at(2)->attribute_value("name").get<db::text>(), "default_value");
+
+            XCTAssertGreaterThan(objects.count("sample_b"), 0);
+            auto &b_objects = objects.at("sample_b");
+            XCTAssertEqual(b_objects.size(), 2);
+            XCTAssertEqual(b_objects.at(0)->object_id().stable(), 1);
+            XCTAssertEqual(b_objects.at(1)->object_id().stable(), 2);
+            XCTAssertEqual(b_objects.at(0)->save_id().get<db::integer>(), 1);
+            XCTAssertEqual(b_objects.at(1)->save_id().get<db::integer>(), 1);
+            XCTAssertFalse(b_objects.at(0)->attribute_value("name"));
+            XCTAssertFalse(b_objects.at(1)->attribute_value("name"));
+
+            [exp1 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(manager->current_save_id(), db::value{1});
+    XCTAssertEqual(manager->last_save_id(), db::value{1});
+    objects.at("sample_a").at(1)->set_attribute_value("name", db::value{"value_1"});
+    objects.at("sample_a").at(1)->add_relation_id("child", objects.at("sample_b").at(0)->object_id());
+
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+
+    manager->save(db::no_cancellation, [self, exp2](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+
+        [exp2 fulfill];
+    });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(manager->current_save_id(), db::value{2});
+    XCTAssertEqual(manager->last_save_id(), db::value{2});
+
+    XCTestExpectation *exp3 = [self expectationWithDescription:@"3"];
+
+    manager->fetch_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self, exp3](auto fetch_result) {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+            XCTAssertGreaterThan(objects.count("sample_a"), 0);
+            auto &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 3);
+            XCTAssertEqual(a_objects.at(0)->object_id().stable_value(), db::value{1});
+            XCTAssertEqual(a_objects.at(1)->object_id().stable_value(), db::value{3});
+            XCTAssertEqual(a_objects.at(2)->object_id().stable_value(), db::value{2});
+            XCTAssertEqual(a_objects.at(0)->save_id(), db::value{1});
+            XCTAssertEqual(a_objects.at(1)->save_id(), db::value{1});
+            XCTAssertEqual(a_objects.at(2)->save_id(), db::value{2});
+            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"default_value"});
+            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"default_value"});
+            XCTAssertEqual(a_objects.at(2)->attribute_value("name"), db::value{"value_1"});
+
+            XCTAssertEqual(a_objects.at(2)->relation_size("child"), 1);
+            XCTAssertEqual(a_objects.at(2)->relation_ids("child").size(), 1);
+            XCTAssertEqual(a_objects.at(2)->relation_id("child", 0).stable(), 1);
+
+            [exp3 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    objects.at("sample_a").at(2)->set_attribute_value("name", db::value{"value_2"});
+    objects.at("sample_a").at(2)->remove_all_relations("child");
+    objects.at("sample_a").at(2)->add_relation_id("child", objects.at("sample_b").at(1)->object_id());
+    objects.at("sample_a").at(2)->add_relation_id("child", objects.at("sample_b").at(0)->object_id());
+
+    XCTestExpectation *exp4 = [self expectationWithDescription:@"4"];
+
+    manager->save(db::no_cancellation, [self, exp4](db::manager_map_result_t result) { [exp4 fulfill]; });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(manager->current_save_id(), db::value{3});
+    XCTAssertEqual(manager->last_save_id(), db::value{3});
+
+    manager->fetch_objects(
+        db::no_cancellation,
+        []() {
+            return db::to_fetch_option(db::select_option{.table = "sample_a",
+                                                         .where_exprs = db::field_expr("name", "like"),
+                                                         .arguments = {{"name", db::value{"value_%"}}},
+                                                         .field_orders = {{db::object_id_field, db::order::descending}},
+                                                         .limit_range = db::range{0, 3}});
+        },
+        [self, &objects](auto fetch_result) {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+            XCTAssertGreaterThan(objects.count("sample_a"), 0);
+            auto &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 2);
+
+            XCTAssertEqual(a_objects.at(0)->object_id().stable_value(), db::value{3});
+            XCTAssertEqual(a_objects.at(0)->save_id(), db::value{3});
+            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"value_2"});
+
+            XCTAssertEqual(a_objects.at(1)->object_id().stable_value(), db::value{2});
+            XCTAssertEqual(a_objects.at(1)->save_id(), db::value{2});
+            XCTAssertEqual(a_objects.at(1)->attribute_value("name"), db::value{"value_1"});
+
+            XCTAssertEqual(a_objects.at(0)->relation_size("child"), 2);
+            XCTAssertEqual(a_objects.at(0)->relation_ids("child").size(), 2);
+            XCTAssertEqual(a_objects.at(0)->relation_id("child", 0).stable(), 2);
+            XCTAssertEqual(a_objects.at(0)->relation_id("child", 1).stable(), 1);
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_fetch_const_objects {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) mutable { XCTAssertTrue(result); });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 1}};
+        },
+        [self, &manager](auto result) mutable {
+            XCTAssertTrue(result);
+            auto &objects = result.value();
+
+            XCTAssertEqual(manager->current_save_id(), db::value{1});
+            XCTAssertEqual(manager->last_save_id(), db::value{1});
+
+            objects.at("sample_a").at(0)->set_attribute_value("name", db::value{"value_0"});
+
+            auto &object_b = objects.at("sample_b").at(0);
+            objects.at("sample_a").at(0)->add_relation_id("child", object_b->object_id());
+
+            XCTAssertEqual(object_b->object_id().stable_value(), db::value{1});
+        });
+
+    manager->save(db::no_cancellation, [](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+    manager->fetch_const_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [](db::manager_const_vector_result_t fetch_result) mutable {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+            XCTAssertGreaterThan(objects.count("sample_a"), 0);
+            auto &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 1);
+            XCTAssertEqual(a_objects.at(0)->object_id().stable(), 1);
+            XCTAssertEqual(a_objects.at(0)->save_id().get<db::integer>(), 2);
+            XCTAssertEqual(a_objects.at(0)->attribute_value("name"), db::value{"value_0"});
+
+            XCTAssertEqual(a_objects.at(0)->relation_size("child"), 1);
+            XCTAssertEqual(a_objects.at(0)->relation_ids("child").size(), 1);
+            XCTAssertEqual(a_objects.at(0)->relation_id("child", 0).stable(), 1);
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_fetch_objects_of_relations {
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+
+    manager->setup([self, &manager](auto result) { XCTAssertTrue(result); });
+
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 1}, {"sample_c", 1}};
+        },
+        [self, exp1](auto result) {
+            XCTAssertTrue(result);
+
+            auto const &objects = result.value();
+            XCTAssertEqual(objects.size(), 3);
+            XCTAssertEqual(objects.count("sample_a"), 1);
+            XCTAssertEqual(objects.count("sample_b"), 1);
+            XCTAssertEqual(objects.count("sample_c"), 1);
+
+            auto const &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 1);
+
+            auto const &b_objects = objects.at("sample_b");
+            XCTAssertEqual(b_objects.size(), 1);
+
+            auto const &c_objects = objects.at("sample_c");
+            XCTAssertEqual(c_objects.size(), 1);
+
+            auto object_a = a_objects.at(0);
+            auto object_b = b_objects.at(0);
+            auto object_c = c_objects.at(0);
+
+            object_a->add_relation_object("child", object_b);
+            object_a->add_relation_object("friend", object_c);
+
+            object_b->add_relation_object("parent", object_a);
+            object_c->add_relation_object("friend", object_a);
+
+            [exp1 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+
+    manager->save(db::no_cancellation, [&manager, self, exp2](db::manager_map_result_t save_result) {
+        XCTAssertTrue(save_result);
+
+        db::object_map_map_t const &objects = save_result.value();
+
+        XCTAssertEqual(objects.size(), 3);
+        XCTAssertEqual(objects.at("sample_a").size(), 1);
+        XCTAssertEqual(objects.at("sample_b").size(), 1);
+        XCTAssertEqual(objects.at("sample_c").size(), 1);
+
+        auto const &a_object = objects.at("sample_a").begin()->second;
+        auto const &b_object = objects.at("sample_b").begin()->second;
         auto const &c_object = objects.at("sample_c").begin()->second;
 
-        XCTAssertEqual(a_object->relation_size("child"), 1);
-        XCTAssertEqual(manager->relation_object_at(a_object, "child", 0), b_object);
-        XCTAssertEqual(a_object->relation_id("child", 0).stable(), 1);
-        XCTAssertEqual(a_object->relation_size("friend"), 1);
-        XCTAssertEqual(manager->relation_object_at(a_object, "friend", 0), c_object);
-        XCTAssertEqual(a_object->relation_id("friend", 0).stable(), 1);
+        XCTAssertEqual(a_object->relation_size("child"), 1);
+        XCTAssertEqual(manager->relation_object_at(a_object, "child", 0), b_object);
+        XCTAssertEqual(a_object->relation_id("child", 0).stable(), 1);
+        XCTAssertEqual(a_object->relation_size("friend"), 1);
+        XCTAssertEqual(manager->relation_object_at(a_object, "friend", 0), c_object);
+        XCTAssertEqual(a_object->relation_id("friend", 0).stable(), 1);
+
+        XCTAssertEqual(b_object->relation_size("parent"), 1);
+        XCTAssertEqual(manager->relation_object_at(b_object, "parent", 0), a_object);
+
+        XCTAssertEqual(c_object->relation_size("friend"), 1);
+        XCTAssertEqual(manager->relation_object_at(c_object, "friend", 0), a_object);
+
+        [exp2 fulfill];
+    });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertFalse(manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{1})));
+    XCTAssertFalse(manager->cached_or_created_object("sample_b", db::make_stable_id(db::value{1})));
+    XCTAssertFalse(manager->cached_or_created_object("sample_c", db::make_stable_id(db::value{1})));
+
+    XCTestExpectation *exp3 = [self expectationWithDescription:@"3"];
+
+    db::object_ptr object_a = nullptr;
+
+    manager->fetch_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self, exp3, &object_a, &manager](auto const &fetch_result) {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+
+            XCTAssertEqual(objects.size(), 1);
+
+            object_a = objects.at("sample_a").at(0);
+            XCTAssertEqual(objects.at("sample_a").at(0)->relation_size("child"), 1);
+            XCTAssertFalse(manager->relation_object_at(objects.at("sample_a").at(0), "child", 0));
+            XCTAssertEqual(objects.at("sample_a").at(0)->relation_size("friend"), 1);
+            XCTAssertFalse(manager->relation_object_at(objects.at("sample_a").at(0), "friend", 0));
+
+            [exp3 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    manager->fetch_objects(
+        db::no_cancellation, db::to_ids_preparation([object_a]() {
+            return db::object_vector_map_t{std::make_pair("sample_a", db::object_vector_t{object_a})};
+        }),
+        [self, object_a, &manager](auto const &fetch_result) {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+
+            XCTAssertEqual(objects.size(), 2);
+            XCTAssertEqual(objects.count("sample_b"), 1);
+            XCTAssertEqual(objects.count("sample_c"), 1);
+
+            XCTAssertEqual(objects.at("sample_b").size(), 1);
+            XCTAssertEqual(manager->relation_object_at(object_a, "child", 0), objects.at("sample_b").at(1));
+            XCTAssertEqual(manager->relation_object_at(objects.at("sample_b").at(1), "parent", 0), object_a);
+
+            XCTAssertEqual(objects.at("sample_c").size(), 1);
+            XCTAssertEqual(manager->relation_object_at(object_a, "friend", 0), objects.at("sample_c").at(1));
+            XCTAssertEqual(manager->relation_object_at(objects.at("sample_c").at(1), "friend", 0), object_a);
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+- (void)test_fetch_const_objects_by_ids {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) mutable { XCTAssertTrue(result); });
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 3}};
+        },
+        [self, &manager](auto result) mutable {
+            XCTAssertTrue(result);
+            auto &objects = result.value();
+
+            XCTAssertEqual(manager->current_save_id(), db::value{1});
+            XCTAssertEqual(manager->last_save_id(), db::value{1});
+
+            objects.at("sample_a").at(0)->set_attribute_value("name", db::value{"value_1"});
+            objects.at("sample_a").at(1)->set_attribute_value("name", db::value{"value_2"});
+            objects.at("sample_a").at(2)->set_attribute_value("name", db::value{"value_3"});
+
+            XCTAssertEqual(objects.at("sample_a").at(0)->object_id().stable_value(), db::value{1});
+            XCTAssertEqual(objects.at("sample_a").at(1)->object_id().stable_value(), db::value{2});
+            XCTAssertEqual(objects.at("sample_a").at(2)->object_id().stable_value(), db::value{3});
+        });
+
+    manager->save(db::no_cancellation, [](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+    manager->fetch_const_objects(
+        db::no_cancellation,
+        []() {
+            return db::integer_set_map_t{{"sample_a", {2}}};
+        },
+        [](auto fetch_result) mutable {
+            XCTAssertTrue(fetch_result);
+
+            auto const &objects = fetch_result.value();
+            XCTAssertEqual(objects.count("sample_a"), 1);
+            auto &a_objects = objects.at("sample_a");
+            XCTAssertEqual(a_objects.size(), 1);
+            XCTAssertEqual(a_objects.at(2)->object_id().stable_value(), db::value{2});
+            XCTAssertEqual(a_objects.at(2)->attribute_value("name"), db::value{"value_2"});
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-        XCTAssertEqual(b_object->relation_size("parent"), 1);
-        XCTAssertEqual(manager->relation_object_at(b_object, "parent", 0), a_object);
+- (void)test_fetch_relation_objects {
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    db::manager_ptr const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
 
-        XCTAssertEqual(c_object->relation_size("friend"), 1);
-        XCTAssertEqual(manager->relation_object_at(c_object, "friend", 0), a_object);
+    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+
+    manager->setup([setupExp](db::manager_result_t) { [setupExp fulfill]; });
+
+    [self waitForExpectations:@[setupExp] timeout:10.0];
+
+    db::object_ptr obj_a_1 = manager->create_object("sample_a");
+    db::object_ptr obj_a_2 = manager->create_object("sample_a");
+    db::object_ptr obj_b_1 = manager->create_object("sample_b");
+    db::object_ptr obj_b_2 = manager->create_object("sample_b");
+    db::object_ptr obj_b_3 = manager->create_object("sample_b");
+    db::object_ptr obj_b_4 = manager->create_object("sample_b");
+    db::object_ptr obj_c_1 = manager->create_object("sample_c");
+
+    obj_a_1->add_relation_object("child", obj_b_1);
+    obj_a_1->add_relation_object("child", obj_b_2);
+    obj_a_1->add_relation_object("child", obj_b_3);
+    obj_a_2->add_relation_object("child", obj_b_3);
+    obj_a_2->add_relation_object("child", obj_b_4);
+    obj_a_1->add_relation_object("friend", obj_c_1);
+
+    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+
+    db::object_map_map_t saved_objects;
+
+    manager->save(db::no_cancellation, [saveExp, &saved_objects](db::manager_map_result_t result) {
+        saved_objects = std::move(result.value());
+
+        [saveExp fulfill];
+    });
+
+    [self waitForExpectations:@[saveExp] timeout:10.0];
+
+    db::object_vector_t objects{obj_a_1, obj_a_2};
+
+    db::object_map_map_t fetched_objects;
+
+    XCTestExpectation *fetchExp = [self expectationWithDescription:@"fetch"];
+
+    manager->fetch_objects(db::no_cancellation, db::to_ids_preparation([objects]() { return objects; }),
+                           [&fetched_objects, fetchExp](db::manager_map_result_t result) {
+                               fetched_objects = std::move(result.value());
+
+                               [fetchExp fulfill];
+                           });
+
+    [self waitForExpectations:@[fetchExp] timeout:10.0];
+
+    XCTAssertEqual(fetched_objects.size(), 2);
+
+    db::object_map_t const &fetched_b_objects = fetched_objects.at("sample_b");
+    XCTAssertEqual(fetched_b_objects.size(), 4);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_1->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_2->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_3->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_4->object_id().stable()), 1);
+
+    db::object_map_t const &fetched_c_objects = fetched_objects.at("sample_c");
+    XCTAssertEqual(fetched_c_objects.size(), 1);
+    XCTAssertEqual(fetched_c_objects.count(obj_c_1->object_id().stable()), 1);
+}
+
+- (void)test_fetch_const_relation_objects {
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    db::manager_ptr const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+
+    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+
+    manager->setup([setupExp](db::manager_result_t) { [setupExp fulfill]; });
+
+    [self waitForExpectations:@[setupExp] timeout:10.0];
+
+    db::object_ptr obj_a_1 = manager->create_object("sample_a");
+    db::object_ptr obj_a_2 = manager->create_object("sample_a");
+    db::object_ptr obj_b_1 = manager->create_object("sample_b");
+    db::object_ptr obj_b_2 = manager->create_object("sample_b");
+    db::object_ptr obj_b_3 = manager->create_object("sample_b");
+    db::object_ptr obj_b_4 = manager->create_object("sample_b");
+    db::object_ptr obj_c_1 = manager->create_object("sample_c");
+
+    obj_a_1->add_relation_object("child", obj_b_1);
+    obj_a_1->add_relation_object("child", obj_b_2);
+    obj_a_1->add_relation_object("child", obj_b_3);
+    obj_a_2->add_relation_object("child", obj_b_3);
+    obj_a_2->add_relation_object("child", obj_b_4);
+    obj_a_1->add_relation_object("friend", obj_c_1);
+
+    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+
+    db::object_map_map_t saved_objects;
+
+    manager->save(db::no_cancellation, [saveExp, &saved_objects](db::manager_map_result_t result) {
+        saved_objects = std::move(result.value());
+
+        [saveExp fulfill];
+    });
+
+    [self waitForExpectations:@[saveExp] timeout:10.0];
+
+    db::object_vector_t objects{obj_a_1, obj_a_2};
+
+    db::const_object_map_map_t fetched_objects;
+
+    XCTestExpectation *fetchExp = [self expectationWithDescription:@"fetch"];
+
+    manager->fetch_const_objects(db::no_cancellation, db::to_ids_preparation([objects]() { return objects; }),
+                                 [&fetched_objects, fetchExp](db::manager_const_map_result_t result) {
+                                     fetched_objects = std::move(result.value());
+
+                                     [fetchExp fulfill];
+                                 });
+
+    [self waitForExpectations:@[fetchExp] timeout:10.0];
+
+    XCTAssertEqual(fetched_objects.size(), 2);
+
+    db::const_object_map_t const &fetched_b_objects = fetched_objects.at("sample_b");
+    XCTAssertEqual(fetched_b_objects.size(), 4);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_1->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_2->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_3->object_id().stable()), 1);
+    XCTAssertEqual(fetched_b_objects.count(obj_b_4->object_id().stable()), 1);
+
+    db::const_object_map_t const &fetched_c_objects = fetched_objects.at("sample_c");
+    XCTAssertEqual(fetched_c_objects.size(), 1);
+    XCTAssertEqual(fetched_c_objects.count(obj_c_1->object_id().stable()), 1);
+}
+
+- (void)test_save_objects {
+    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+
+    manager->setup([self, &manager](auto result) {
+        XCTAssertTrue(result);
+        XCTAssertEqual(manager->current_save_id(), db::value{0});
+        XCTAssertEqual(manager->last_save_id(), db::value{0});
+    });
+
+    std::unordered_map<db::integer::type, db::object_ptr> main_objects;
+
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+
+    manager->insert_objects(
+        db::no_cancellation,
+        []() {
+            return db::entity_count_map_t{{"sample_a", 1}};
+        },
+        [self, &main_objects, exp1](auto result) {
+            db::object_vector_map_t const &objects = result.value();
+            db::object_vector_t const &a_objects = objects.at("sample_a");
+            for (auto const &obj : a_objects) {
+                main_objects.insert(std::make_pair(obj->object_id().stable(), obj));
+            }
+
+            XCTAssertEqual(main_objects.size(), 1);
+
+            auto const &obj = a_objects.at(0);
+            XCTAssertEqual(obj->save_id(), db::value{1});
+            XCTAssertEqual(obj->attribute_value("name"), db::value{"default_value"});
+            XCTAssertEqual(obj->status(), db::object_status::saved);
+            XCTAssertEqual(obj->action(), db::insert_action_value());
+
+            [exp1 fulfill];
+        });
+
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+
+    XCTAssertEqual(manager->current_save_id(), db::value{1});
+    XCTAssertEqual(manager->last_save_id(), db::value{1});
+
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+
+    manager->save(db::no_cancellation, [self, exp2](db::manager_map_result_t result) {
+        auto const &objects = result.value();
+        XCTAssertEqual(objects.size(), 0);
 
         [exp2 fulfill];
     });
 
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTAssertFalse(manager->cached_or_created_object("sample_a", db::make_stable_id(db::value{1})));
-    XCTAssertFalse(manager->cached_or_created_object("sample_b", db::make_stable_id(db::value{1})));
-    XCTAssertFalse(manager->cached_or_created_object("sample_c", db::make_stable_id(db::value{1})));
+    XCTAssertEqual(main_objects.size(), 1);
+    auto &object = main_objects.at(1);
+    object->set_attribute_value("name", db::value{"new_value"});
+    object->set_attribute_value("age", db::value{77});
+    object->add_relation_id("child", db::make_stable_id(db::value{100}));
+    object->add_relation_id("child", db::make_stable_id(db::value{200}));
+    XCTAssertEqual(object->status(), db::object_status::changed);
 
     XCTestExpectation *exp3 = [self expectationWithDescription:@"3"];
 
-    db::object_ptr object_a = nullptr;
+    manager->save(db::no_cancellation, [self, exp3](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
 
-    manager->fetch_objects(
-        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
-        [self, exp3, &object_a, &manager](auto const &fetch_result) {
-            XCTAssertTrue(fetch_result);
+        auto const &objects = result.value();
+        XCTAssertGreaterThan(objects.count("sample_a"), 0);
 
-            auto const &objects = fetch_result.value();
+        auto const &a_objects = objects.at("sample_a");
+        XCTAssertEqual(a_objects.size(), 1);
 
-            XCTAssertEqual(objects.size(), 1);
+        auto const &obj = a_objects.begin()->second;
+        XCTAssertEqual(obj->save_id(), db::value{2});
+        XCTAssertEqual(obj->attribute_value("name"), db::value{"new_value"});
+        XCTAssertEqual(obj->attribute_value("age"), db::value{77});
+        XCTAssertEqual(obj->status(), db::object_status::saved);
+        XCTAssertEqual(obj->action(), db::update_action_value());
+        XCTAssertEqual(obj->relation_size("child"), 2);
+        XCTAssertEqual(obj->relation_ids("child").size(), 2);
+        XCTAssertEqual(obj->relation_id("child", 0).stable(), 100);
+        XCTAssertEqual(obj->relation_id("child", 1).stable(), 200);
+    });
 
-            object_a = objects.at("sample_a").at(0);
-            XCTAssertEqual(objects.at("sample_a").at(0)->relation_size("child"), 1);
-            XCTAssertFalse(manager->relation_object_at(objects.at("sample_a").at(0), "child", 0));
-            XCTAssertEqual(objects.at("sample_a").at(0)->relation_size("friend"), 1);
-            XCTAssertFalse(manager->relation_object_at(objects.at("sample_a").at(0), "friend", 0));
+    manager->execute(db::no_cancellation, [self, exp3, &manager](auto const &) {
+        auto &db = manager->database();
 
-            [exp3 fulfill];
-        });
+        auto value_result = db::select(db, db::select_option{.table = "sample_a"});
+        auto const &selected_values = value_result.value();
+
+        XCTAssertEqual(selected_values.size(), 2);
+        XCTAssertEqual(selected_values.at(0).at("name"), db::value{"default_value"});
+        XCTAssertEqual(selected_values.at(0).at("age"), db::value{10});
+        XCTAssertEqual(selected_values.at(0).at(db::save_id_field), db::value{1});
+        XCTAssertEqual(selected_values.at(0).at(db::action_field), db::insert_action_value());
+        XCTAssertEqual(selected_values.at(1).at("name"), db::value{"new_value"});
+        XCTAssertEqual(selected_values.at(1).at("age"), db::value{77});
+        XCTAssertEqual(selected_values.at(1).at(db::save_id_field), db::value{2});
+        XCTAssertEqual(selected_values.at(1).at(db::action_field), db::update_action_value());
+
+        auto relation_result =
+            db::select(db, db::select_option{.table = manager->model().relation("sample_a", "child").table});
+        auto const &selected_relations = relation_result.value();
 
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+        XCTAssertEqual(selected_relations.size(), 2);
+        XCTAssertEqual(selected_relations.at(0).at(db::tgt_obj_id_field), db::value{100});
+        XCTAssertEqual(selected_relations.at(1).at(db::tgt_obj_id_field), db::value{200});
 
-    manager->fetch_objects(
-        db::no_cancellation, db::to_ids_preparation([object_a]() {
-            return db::object_vector_map_t{std::make_pair("sample_a", db::object_vector_t{object_a})};
-        }),
-        [self, object_a, &manager](auto const &fetch_result) {
-            XCTAssertTrue(fetch_result);
+        [exp3 fulfill];
+    });
 
-            auto const &objects = fetch_result.value();
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-            XCTAssertEqual(objects.size(), 2);
-            XCTAssertEqual(objects.count("sample_b"), 1);
-            XCTAssertEqual(objects.count("sample_c"), 1);
+    XCTAssertEqual(manager->current_save_id(), db::value{2});
+    XCTAssertEqual(manager->last_save_id(), db::value{2});
+    XCTAssertEqual(object->attribute_value("name"), db::value{"new_value"});
+    XCTAssertEqual(object->attribute_value("age"), db::value{77});
+    XCTAssertEqual(object->save_id(), db::value{2});
+    XCTAssertEqual(object->status(), db::object_status::saved);
+    XCTAssertEqual(object->relation_size("child"), 2);
+    XCTAssertEqual(object->relation_ids("child").size(), 2);
+    XCTAssertEqual(object->relation_id("child", 0).stable(), 100);
+    XCTAssertEqual(object->relation_id("child", 1).stable(), 200);
 
-            XCTAssertEqual(objects.at("sample_b").size(), 1);
-            XCTAssertEqual(manager->relation_object_at(object_a, "child", 0), objects.at("sample_b").at(1));
-            XCTAssertEqual(manager->relation_object_at(objects.at("sample_b").at(1), "parent", 0), object_a);
+    object->remove();
 
-            XCTAssertEqual(objects.at("sample_c").size(), 1);
-            XCTAssertEqual(manager->relation_object_at(object_a, "friend", 0), objects.at("sample_c").at(1));
-            XCTAssertEqual(manager->relation_object_at(objects.at("sample_c").at(1), "friend", 0), object_a);
-        });
+    XCTAssertEqual(object->status(), db::object_status::changed);
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
-    manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
-    [self waitForExpectationsWithTimeout:10.0 handler:nil];
-}
+    XCTestExpectation *exp4 = [self expectationWithDescription:@"4"];
 
-- (void)test_fetch_const_objects_by_ids {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+    manager->save(db::no_cancellation, [self, exp4](db::manager_map_result_t save_result) {
+        XCTAssertTrue(save_result);
 
-    manager->setup([self, &manager](auto result) mutable { XCTAssertTrue(result); });
+        auto const &objects = save_result.value();
+        XCTAssertGreaterThan(objects.count("sample_a"), 0);
 
-    manager->insert_objects(
-        db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 3}};
-        },
-        [self, &manager](auto result) mutable {
-            XCTAssertTrue(result);
-            auto &objects = result.value();
+        auto const &a_objects = objects.at("sample_a");
+        XCTAssertEqual(a_objects.size(), 1);
 
-            XCTAssertEqual(manager->current_save_id(), db::value{1});
-            XCTAssertEqual(manager->last_save_id(), db::value{1});
+        auto const &obj = a_objects.begin()->second;
+        XCTAssertEqual(obj->save_id(), db::value{3});
+        XCTAssertEqual(obj->attribute_value("name"), db::null_value());
+        XCTAssertEqual(obj->attribute_value("age"), db::value{10});
+        XCTAssertEqual(obj->relation_size("child"), 0);
+        XCTAssertEqual(obj->relation_ids("child").size(), 0);
+        XCTAssertTrue(obj->is_removed());
+        XCTAssertEqual(obj->status(), db::object_status::saved);
+        XCTAssertEqual(obj->action(), db::remove_action_value());
 
-            objects.at("sample_a").at(0)->set_attribute_value("name", db::value{"value_1"});
-            objects.at("sample_a").at(1)->set_attribute_value("name", db::value{"value_2"});
-            objects.at("sample_a").at(2)->set_attribute_value("name", db::value{"value_3"});
+        [exp4 fulfill];
+    });
 
-            XCTAssertEqual(objects.at("sample_a").at(0)->object_id().stable_value(), db::value{1});
-            XCTAssertEqual(objects.at("sample_a").at(1)->object_id().stable_value(), db::value{2});
-            XCTAssertEqual(objects.at("sample_a").at(2)->object_id().stable_value(), db::value{3});
-        });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    manager->save(db::no_cancellation, [](db::manager_map_result_t result) { XCTAssertTrue(result); });
+    XCTAssertEqual(manager->current_save_id(), db::value{3});
+    XCTAssertEqual(manager->last_save_id(), db::value{3});
 
-    manager->fetch_const_objects(
-        db::no_cancellation,
-        []() {
-            return db::integer_set_map_t{{"sample_a", {2}}};
-        },
-        [](auto fetch_result) mutable {
-            XCTAssertTrue(fetch_result);
+    manager->save(db::no_cancellation, [](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
 
-            auto const &objects = fetch_result.value();
-            XCTAssertEqual(objects.count("sample_a"), 1);
-            auto &a_objects = objects.at("sample_a");
-            XCTAssertEqual(a_objects.size(), 1);
-            XCTAssertEqual(a_objects.at(2)->object_id().stable_value(), db::value{2});
-            XCTAssertEqual(a_objects.at(2)->attribute_value("name"), db::value{"value_2"});
-        });
+        auto const &objects = result.value();
+        XCTAssertEqual(objects.size(), 0);
+    });
 
     XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
     manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
-}
-
-- (void)test_fetch_relation_objects {
-    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
-    db::manager_ptr const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
 
-    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+    XCTAssertEqual(manager->current_save_id(), db::value{3});
+    XCTAssertEqual(manager->last_save_id(), db::value{3});
+}
 
-    manager->setup([setupExp](db::manager_result_t) { [setupExp fulfill]; });
+- (void)test_clustered_layout {
+    db::entity_args sample_a{.name = "sample_a",
+                             .attributes = {{.name = "name", .type = db::attribute_type::text}},
+                             .relations = {{.name = "child", .target = "sample_b", .many = true}}};
+    db::entity_args sample_b{.name = "sample_b", .attributes = {{.name = "name", .type = db::attribute_type::text}}};
+    db::model model{db::model_args{.version = yas::version{"0.0.1"},
+                                   .entities = {std::move(sample_a), std::move(sample_b)},
+                                   .indices = {},
+                                   .layout = db::table_layout::clustered}};
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
 
-    [self waitForExpectations:@[setupExp] timeout:10.0];
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
 
-    db::object_ptr obj_a_1 = manager->create_object("sample_a");
-    db::object_ptr obj_a_2 = manager->create_object("sample_a");
-    db::object_ptr obj_b_1 = manager->create_object("sample_b");
-    db::object_ptr obj_b_2 = manager->create_object("sample_b");
-    db::object_ptr obj_b_3 = manager->create_object("sample_b");
-    db::object_ptr obj_b_4 = manager->create_object("sample_b");
-    db::object_ptr obj_c_1 = manager->create_object("sample_c");
+    db::object_ptr object = nullptr;
 
-    obj_a_1->add_relation_object("child", obj_b_1);
-    obj_a_1->add_relation_object("child", obj_b_2);
-    obj_a_1->add_relation_object("child", obj_b_3);
-    obj_a_2->add_relation_object("child", obj_b_3);
-    obj_a_2->add_relation_object("child", obj_b_4);
-    obj_a_1->add_relation_object("friend", obj_c_1);
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            object = result.value().at("sample_a").at(0);
+            XCTAssertEqual(object->attribute_value(db::pk_id_field), db::value{1});
+        });
 
-    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    manager->execute(db::no_cancellation, [exp1](auto const &) { [exp1 fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    db::object_map_map_t saved_objects;
+    object->set_attribute_value("name", db::value{"name_value"});
+    object->add_relation_id("child", db::make_stable_id(db::value{300}));
+    object->add_relation_id("child", db::make_stable_id(db::value{100}));
+    object->add_relation_id("child", db::make_stable_id(db::value{200}));
 
-    manager->save(db::no_cancellation, [saveExp, &saved_objects](db::manager_map_result_t result) {
-        saved_objects = std::move(result.value());
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
 
-        [saveExp fulfill];
+        auto const &obj = result.value().at("sample_a").at(1);
+        XCTAssertEqual(obj->save_id(), db::value{2});
+        XCTAssertEqual(obj->attribute_value(db::pk_id_field), db::value{2});
+        XCTAssertEqual(obj->relation_size("child"), 3);
+        XCTAssertEqual(obj->relation_id("child", 0).stable(), 300);
+        XCTAssertEqual(obj->relation_id("child", 1).stable(), 100);
+        XCTAssertEqual(obj->relation_id("child", 2).stable(), 200);
     });
 
-    [self waitForExpectations:@[saveExp] timeout:10.0];
-
-    db::object_vector_t objects{obj_a_1, obj_a_2};
-
-    db::object_map_map_t fetched_objects;
-
-    XCTestExpectation *fetchExp = [self expectationWithDescription:@"fetch"];
-
-    manager->fetch_objects(db::no_cancellation, db::to_ids_preparation([objects]() { return objects; }),
-                           [&fetched_objects, fetchExp](db::manager_map_result_t result) {
-                               fetched_objects = std::move(result.value());
-
-                               [fetchExp fulfill];
-                           });
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
 
-    [self waitForExpectations:@[fetchExp] timeout:10.0];
+        auto const master_result = db::select_single(
+            db, {.table = "sqlite_master", .fields = {"sql"}, .where_exprs = "name = 'sample_a'"});
+        XCTAssertTrue(master_result);
+        XCTAssertNotEqual(master_result.value().at("sql").get<db::text>().find("WITHOUT ROWID"), std::string::npos);
+
+        auto const rel_result = db::select(db, {.table = "rel_sample_a_child",
+                                                .where_exprs = "src_pk_id = 2",
+                                                .field_orders = {{db::position_field, db::order::ascending}}});
+        XCTAssertTrue(rel_result);
+        XCTAssertEqual(rel_result.value().size(), 3);
+        XCTAssertEqual(rel_result.value().at(0).at(db::tgt_obj_id_field), db::value{300});
+        XCTAssertEqual(rel_result.value().at(2).at(db::position_field), db::value{2});
+    });
 
-    XCTAssertEqual(fetched_objects.size(), 2);
+    manager->revert(
+        db::no_cancellation, []() { return 1; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(object->save_id(), db::value{1});
+            XCTAssertEqual(object->attribute_value("name"), db::null_value());
+            XCTAssertEqual(object->relation_size("child"), 0);
+        });
 
-    db::object_map_t const &fetched_b_objects = fetched_objects.at("sample_b");
-    XCTAssertEqual(fetched_b_objects.size(), 4);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_1->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_2->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_3->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_4->object_id().stable()), 1);
+    manager->revert(
+        db::no_cancellation, []() { return 2; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(object->attribute_value("name"), db::value{"name_value"});
+            XCTAssertEqual(object->relation_size("child"), 3);
+            XCTAssertEqual(object->relation_id("child", 0).stable(), 300);
+        });
 
-    db::object_map_t const &fetched_c_objects = fetched_objects.at("sample_c");
-    XCTAssertEqual(fetched_c_objects.size(), 1);
-    XCTAssertEqual(fetched_c_objects.count(obj_c_1->object_id().stable()), 1);
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    manager->execute(db::no_cancellation, [exp2](auto const &) { [exp2 fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 }
 
-- (void)test_fetch_const_relation_objects {
-    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
-    db::manager_ptr const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+- (void)test_clustered_layout_remove_relations_twice_at_save {
+    db::entity_args sample_a{.name = "sample_a",
+                             .relations = {{.name = "child", .target = "sample_b", .many = true},
+                                           {.name = "other", .target = "sample_c", .many = true}}};
+    db::entity_args sample_b{.name = "sample_b"};
+    db::entity_args sample_c{.name = "sample_c"};
+    db::model model{db::model_args{.version = yas::version{"0.0.1"},
+                                   .entities = {std::move(sample_a), std::move(sample_b), std::move(sample_c)},
+                                   .indices = {},
+                                   .layout = db::table_layout::clustered}};
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
 
-    XCTestExpectation *setupExp = [self expectationWithDescription:@"setup"];
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
 
-    manager->setup([setupExp](db::manager_result_t) { [setupExp fulfill]; });
+    db::object_ptr object_b = nullptr;
+    db::object_ptr object_c = nullptr;
 
-    [self waitForExpectations:@[setupExp] timeout:10.0];
+    // sample_aはキャッシュに残さず、削除された関連先をデータベース上で外させる
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 1}, {"sample_c", 1}}; },
+        [self, &object_b, &object_c](auto result) {
+            XCTAssertTrue(result);
+            auto const &object_a = result.value().at("sample_a").at(0);
+            object_b = result.value().at("sample_b").at(0);
+            object_c = result.value().at("sample_c").at(0);
+            object_a->add_relation_object("child", object_b);
+            object_a->add_relation_object("other", object_c);
+        });
 
-    db::object_ptr obj_a_1 = manager->create_object("sample_a");
-    db::object_ptr obj_a_2 = manager->create_object("sample_a");
-    db::object_ptr obj_b_1 = manager->create_object("sample_b");
-    db::object_ptr obj_b_2 = manager->create_object("sample_b");
-    db::object_ptr obj_b_3 = manager->create_object("sample_b");
-    db::object_ptr obj_b_4 = manager->create_object("sample_b");
-    db::object_ptr obj_c_1 = manager->create_object("sample_c");
+    manager->save(db::no_cancellation, [self](auto result) { XCTAssertTrue(result); });
 
-    obj_a_1->add_relation_object("child", obj_b_1);
-    obj_a_1->add_relation_object("child", obj_b_2);
-    obj_a_1->add_relation_object("child", obj_b_3);
-    obj_a_2->add_relation_object("child", obj_b_3);
-    obj_a_2->add_relation_object("child", obj_b_4);
-    obj_a_1->add_relation_object("friend", obj_c_1);
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    manager->execute(db::no_cancellation, [exp1](auto const &) { [exp1 fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTestExpectation *saveExp = [self expectationWithDescription:@"save"];
+    // 同じセーブで2つのエンティティの関連先が削除されるので、sample_aは1つのセーブで2回保存し直される
+    object_b->remove();
+    object_c->remove();
 
-    db::object_map_map_t saved_objects;
+    manager->save(db::no_cancellation, [self](auto result) { XCTAssertTrue(result); });
 
-    manager->save(db::no_cancellation, [saveExp, &saved_objects](db::manager_map_result_t result) {
-        saved_objects = std::move(result.value());
+    manager->fetch_const_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self](db::manager_const_vector_result_t result) {
+            XCTAssertTrue(result);
+            auto const &object_a = result.value().at("sample_a").at(0);
+            XCTAssertEqual(object_a->save_id(), db::value{3});
+            XCTAssertEqual(object_a->relation_size("child"), 0);
+            XCTAssertEqual(object_a->relation_size("other"), 0);
+        });
 
-        [saveExp fulfill];
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
+
+        auto const select_result = db::select(db, {.table = "sample_a"});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 3);
+
+        // 保存し直したデータの関連だけが残り、参照先の無い関連のデータはない
+        for (std::string const table : {"rel_sample_a_child", "rel_sample_a_other"}) {
+            auto const rel_result = db::select(
+                db, {.table = table, .where_exprs = "src_pk_id NOT IN (SELECT pk_id FROM sample_a)"});
+            XCTAssertTrue(rel_result);
+            XCTAssertEqual(rel_result.value().size(), 0);
+        }
     });
 
-    [self waitForExpectations:@[saveExp] timeout:10.0];
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    manager->execute(db::no_cancellation, [exp2](auto const &) { [exp2 fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-    db::object_vector_t objects{obj_a_1, obj_a_2};
+- (void)test_packed_relation {
+    db::relation_args child{
+        .name = "child", .target = "sample_b", .many = true, .encoding = db::relation_encoding::packed};
+    db::entity_args sample_a{.name = "sample_a", .relations = {std::move(child)}};
+    db::entity_args sample_b{.name = "sample_b"};
+    db::model model{db::model_args{
+        .version = yas::version{"0.0.1"}, .entities = {std::move(sample_a), std::move(sample_b)}, .indices = {}}};
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
 
-    db::const_object_map_map_t fetched_objects;
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
 
-    XCTestExpectation *fetchExp = [self expectationWithDescription:@"fetch"];
+    db::object_vector_map_t objects;
 
-    manager->fetch_const_objects(db::no_cancellation, db::to_ids_preparation([objects]() { return objects; }),
-                                 [&fetched_objects, fetchExp](db::manager_const_map_result_t result) {
-                                     fetched_objects = std::move(result.value());
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}, {"sample_b", 2}}; },
+        [self, &objects](auto result) {
+            XCTAssertTrue(result);
+            objects = std::move(result.value());
+        });
 
-                                     [fetchExp fulfill];
-                                 });
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    manager->execute(db::no_cancellation, [exp1](auto const &) { [exp1 fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    [self waitForExpectations:@[fetchExp] timeout:10.0];
+    db::object_ptr const obj_a = objects.at("sample_a").at(0);
+    db::object_ptr const obj_b0 = objects.at("sample_b").at(0);
+    db::object_ptr const obj_b1 = objects.at("sample_b").at(1);
 
-    XCTAssertEqual(fetched_objects.size(), 2);
+    obj_a->set_relation_objects("child", {obj_b1, obj_b0});
 
-    db::const_object_map_t const &fetched_b_objects = fetched_objects.at("sample_b");
-    XCTAssertEqual(fetched_b_objects.size(), 4);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_1->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_2->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_3->object_id().stable()), 1);
-    XCTAssertEqual(fetched_b_objects.count(obj_b_4->object_id().stable()), 1);
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager, &obj_b0, &obj_b1](auto const &) {
+        auto &db = manager->database();
 
-    db::const_object_map_t const &fetched_c_objects = fetched_objects.at("sample_c");
-    XCTAssertEqual(fetched_c_objects.size(), 1);
-    XCTAssertEqual(fetched_c_objects.count(obj_c_1->object_id().stable()), 1);
-}
+        // 関連先が2つでも1行だけ保存されている
+        auto const rel_result = db::select(db, {.table = "rel_sample_a_child"});
+        XCTAssertTrue(rel_result);
+        XCTAssertEqual(rel_result.value().size(), 1);
 
-- (void)test_save_objects {
-    db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
-    auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1)];
+        db::blob const &blob = rel_result.value().at(0).at(db::tgt_obj_ids_field).get<db::blob>();
+        XCTAssertEqual(blob.size(), 1 + sizeof(int64_t) * 2);
 
-    manager->setup([self, &manager](auto result) {
-        XCTAssertTrue(result);
-        XCTAssertEqual(manager->current_save_id(), db::value{0});
-        XCTAssertEqual(manager->last_save_id(), db::value{0});
+        auto const ids = db::unpack_relation_ids({static_cast<std::byte const *>(blob.data()), blob.size()});
+        XCTAssertTrue(ids);
+        XCTAssertEqual(ids.value(), (db::value_vector_t{obj_b1->object_id().stable_value(),
+                                                        obj_b0->object_id().stable_value()}));
     });
 
-    std::unordered_map<db::integer::type, db::object_ptr> main_objects;
+    // 関連先を削除すると、保存時にDB上の関連からも取り除かれる
+    obj_b1->remove();
 
-    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
 
-    manager->insert_objects(
+    manager->fetch_objects(
         db::no_cancellation,
-        []() {
-            return db::entity_count_map_t{{"sample_a", 1}};
-        },
-        [self, &main_objects, exp1](auto result) {
-            db::object_vector_map_t const &objects = result.value();
-            db::object_vector_t const &a_objects = objects.at("sample_a");
-            for (auto const &obj : a_objects) {
-                main_objects.insert(std::make_pair(obj->object_id().stable(), obj));
-            }
-
-            XCTAssertEqual(main_objects.size(), 1);
+        []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self, &obj_b0](db::manager_vector_result_t result) {
+            XCTAssertTrue(result);
 
-            auto const &obj = a_objects.at(0);
-            XCTAssertEqual(obj->save_id(), db::value{1});
-            XCTAssertEqual(obj->attribute_value("name"), db::value{"default_value"});
-            XCTAssertEqual(obj->status(), db::object_status::saved);
-            XCTAssertEqual(obj->action(), db::insert_action_value());
+            auto const &fetched_a = result.value().at("sample_a").at(0);
+            XCTAssertEqual(fetched_a->relation_size("child"), 1);
+            XCTAssertEqual(fetched_a->relation_id("child", 0).stable(), obj_b0->object_id().stable());
+        });
 
-            [exp1 fulfill];
+    manager->revert(
+        db::no_cancellation, []() { return 2; },
+        [self, &obj_a](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(obj_a->relation_size("child"), 2);
         });
 
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    manager->execute(db::no_cancellation, [exp2](auto const &) { [exp2 fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-    XCTAssertEqual(manager->current_save_id(), db::value{1});
-    XCTAssertEqual(manager->last_save_id(), db::value{1});
+- (void)test_delta_version_rows {
+    db::entity_args sample_a{.name = "sample_a",
+                             .attributes = {{.name = "name", .type = db::attribute_type::text},
+                                            {.name = "age", .type = db::attribute_type::integer}},
+                             .version_rows = db::version_rows::delta};
+    db::model model{
+        db::model_args{.version = yas::version{"0.0.1"}, .entities = {std::move(sample_a)}, .indices = {}}};
+    auto const manager = [yas_db_test_utils create_test_manager:std::move(model)];
 
-    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
 
-    manager->save(db::no_cancellation, [self, exp2](db::manager_map_result_t result) {
-        auto const &objects = result.value();
-        XCTAssertEqual(objects.size(), 0);
+    db::object_ptr object = nullptr;
 
-        [exp2 fulfill];
-    });
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            object = result.value().at("sample_a").at(0);
+        });
 
+    XCTestExpectation *exp1 = [self expectationWithDescription:@"1"];
+    manager->execute(db::no_cancellation, [exp1](auto const &) { [exp1 fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
 
-    XCTAssertEqual(main_objects.size(), 1);
-    auto &object = main_objects.at(1);
-    object->set_attribute_value("name", db::value{"new_value"});
-    object->set_attribute_value("age", db::value{77});
-    object->add_relation_id("child", db::make_stable_id(db::value{100}));
-    object->add_relation_id("child", db::make_stable_id(db::value{200}));
-    XCTAssertEqual(object->status(), db::object_status::changed);
-
-    XCTestExpectation *exp3 = [self expectationWithDescription:@"3"];
+    object->set_attribute_value("name", db::value{"name_value"});
+    object->set_attribute_value("age", db::value{1});
 
-    manager->save(db::no_cancellation, [self, exp3](db::manager_map_result_t result) {
+    manager->save(db::no_cancellation, [self, &object](db::manager_map_result_t result) {
         XCTAssertTrue(result);
+        object->set_attribute_value("age", db::value{2});
+    });
 
-        auto const &objects = result.value();
-        XCTAssertGreaterThan(objects.count("sample_a"), 0);
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
 
-        auto const &a_objects = objects.at("sample_a");
-        XCTAssertEqual(a_objects.size(), 1);
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto &db = manager->database();
 
-        auto const &obj = a_objects.begin()->second;
-        XCTAssertEqual(obj->save_id(), db::value{2});
-        XCTAssertEqual(obj->attribute_value("name"), db::value{"new_value"});
-        XCTAssertEqual(obj->attribute_value("age"), db::value{77});
-        XCTAssertEqual(obj->status(), db::object_status::saved);
-        XCTAssertEqual(obj->action(), db::update_action_value());
-        XCTAssertEqual(obj->relation_size("child"), 2);
-        XCTAssertEqual(obj->relation_ids("child").size(), 2);
-        XCTAssertEqual(obj->relation_id("child", 0).stable(), 100);
-        XCTAssertEqual(obj->relation_id("child", 1).stable(), 200);
+        // 変更したアトリビュートだけ保存されている
+        auto const select_result = db::select_single(db, {.table = "sample_a", .where_exprs = "save_id = 3"});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().at(db::changed_field), db::value{"age"});
+        XCTAssertEqual(select_result.value().at("age"), db::value{2});
+        XCTAssertEqual(select_result.value().at("name"), db::null_value());
     });
 
-    manager->execute(db::no_cancellation, [self, exp3, &manager](auto const &) {
-        auto &db = manager->database();
+    manager->fetch_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self](db::manager_vector_result_t result) {
+            XCTAssertTrue(result);
 
-        auto value_result = db::select(db, db::select_option{.table = "sample_a"});
-        auto const &selected_values = value_result.value();
+            auto const &fetched = result.value().at("sample_a").at(0);
+            XCTAssertEqual(fetched->attribute_value("name"), db::value{"name_value"});
+            XCTAssertEqual(fetched->attribute_value("age"), db::value{2});
+        });
 
-        XCTAssertEqual(selected_values.size(), 2);
-        XCTAssertEqual(selected_values.at(0).at("name"), db::value{"default_value"});
-        XCTAssertEqual(selected_values.at(0).at("age"), db::value{10});
-        XCTAssertEqual(selected_values.at(0).at(db::save_id_field), db::value{1});
-        XCTAssertEqual(selected_values.at(0).at(db::action_field), db::insert_action_value());
-        XCTAssertEqual(selected_values.at(1).at("name"), db::value{"new_value"});
-        XCTAssertEqual(selected_values.at(1).at("age"), db::value{77});
-        XCTAssertEqual(selected_values.at(1).at(db::save_id_field), db::value{2});
-        XCTAssertEqual(selected_values.at(1).at(db::action_field), db::update_action_value());
+    manager->revert(
+        db::no_cancellation, []() { return 2; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(object->attribute_value("name"), db::value{"name_value"});
+            XCTAssertEqual(object->attribute_value("age"), db::value{1});
+        });
 
-        auto relation_result =
-            db::select(db, db::select_option{.table = manager->model().relation("sample_a", "child").table});
-        auto const &selected_relations = relation_result.value();
+    manager->revert(
+        db::no_cancellation, []() { return 3; },
+        [self, &object](auto result) {
+            XCTAssertTrue(result);
+            XCTAssertEqual(object->attribute_value("age"), db::value{2});
+        });
 
-        XCTAssertEqual(selected_relations.size(), 2);
-        XCTAssertEqual(selected_relations.at(0).at(db::tgt_obj_id_field), db::value{100});
-        XCTAssertEqual(selected_relations.at(1).at(db::tgt_obj_id_field), db::value{200});
+    // パージすると残ったデータに全てのアトリビュートが書き戻される
+    manager->purge(db::no_cancellation, [self](auto result) { XCTAssertTrue(result); });
 
-        [exp3 fulfill];
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto const select_result = db::select(manager->database(), {.table = "sample_a"});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 1);
+
+        auto const &row = select_result.value().at(0);
+        XCTAssertEqual(row.at(db::changed_field), db::null_value());
+        XCTAssertEqual(row.at("name"), db::value{"name_value"});
+        XCTAssertEqual(row.at("age"), db::value{2});
     });
 
+    XCTestExpectation *exp2 = [self expectationWithDescription:@"2"];
+    manager->execute(db::no_cancellation, [exp2](auto const &) { [exp2 fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-    XCTAssertEqual(manager->current_save_id(), db::value{2});
-    XCTAssertEqual(manager->last_save_id(), db::value{2});
-    XCTAssertEqual(object->attribute_value("name"), db::value{"new_value"});
-    XCTAssertEqual(object->attribute_value("age"), db::value{77});
-    XCTAssertEqual(object->save_id(), db::value{2});
-    XCTAssertEqual(object->status(), db::object_status::saved);
-    XCTAssertEqual(object->relation_size("child"), 2);
-    XCTAssertEqual(object->relation_ids("child").size(), 2);
-    XCTAssertEqual(object->relation_id("child", 0).stable(), 100);
-    XCTAssertEqual(object->relation_id("child", 1).stable(), 200);
+- (void)test_setup_delta_version_rows_with_index {
+    auto const make_model = []() {
+        db::entity_args sample_a{.name = "sample_a",
+                                 .attributes = {{.name = "name", .type = db::attribute_type::text}},
+                                 .version_rows = db::version_rows::delta};
+        db::index_args name_index{.name = "sample_a_name", .entity = "sample_a", .attributes = {"name"}};
+        return db::model{db::model_args{
+            .version = yas::version{"0.0.1"}, .entities = {std::move(sample_a)}, .indices = {std::move(name_index)}}};
+    };
 
-    object->remove();
+    std::string const head_index_name = "auto_" + db::head_table_name("sample_a") + "_name";
 
-    XCTAssertEqual(object->status(), db::object_status::changed);
+    auto const manager = [yas_db_test_utils create_test_manager:make_model()];
 
-    XCTestExpectation *exp4 = [self expectationWithDescription:@"4"];
+    // 新規のデータベースでもヘッドにインデックスが作られる
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
 
-    manager->save(db::no_cancellation, [self, exp4](db::manager_map_result_t save_result) {
-        XCTAssertTrue(save_result);
+    manager->execute(db::no_cancellation, [self, &manager, &head_index_name](auto const &) {
+        auto const &db = manager->database();
+        XCTAssertTrue(db::index_exists(db, head_index_name));
 
-        auto const &objects = save_result.value();
-        XCTAssertGreaterThan(objects.count("sample_a"), 0);
+        // アトリビュートが足りない古いヘッドにする
+        XCTAssertTrue(db->execute_update(db::drop_table_sql(db::head_table_name("sample_a"))));
+        XCTAssertTrue(db::create_table(db, db::head_table_name("sample_a"),
+                                       {db::object_id_field, db::pk_id_field, db::removed_field}));
+        XCTAssertFalse(db::index_exists(db, head_index_name));
+    });
 
-        auto const &a_objects = objects.at("sample_a");
-        XCTAssertEqual(a_objects.size(), 1);
+    {
+        XCTestExpectation *exp = [self expectationWithDescription:@"first"];
+        manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+        [self waitForExpectationsWithTimeout:10.0 handler:nil];
+    }
 
-        auto const &obj = a_objects.begin()->second;
-        XCTAssertEqual(obj->save_id(), db::value{3});
-        XCTAssertEqual(obj->attribute_value("name"), db::null_value());
-        XCTAssertEqual(obj->attribute_value("age"), db::value{10});
-        XCTAssertEqual(obj->relation_size("child"), 0);
-        XCTAssertEqual(obj->relation_ids("child").size(), 0);
-        XCTAssertTrue(obj->is_removed());
-        XCTAssertEqual(obj->status(), db::object_status::saved);
-        XCTAssertEqual(obj->action(), db::remove_action_value());
+    // 作り直したヘッドにもインデックスが作られる
+    auto const next_manager = [yas_db_test_utils create_test_manager:make_model()];
 
-        [exp4 fulfill];
+    next_manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    next_manager->execute(db::no_cancellation, [self, &next_manager, &head_index_name](auto const &) {
+        XCTAssertTrue(db::index_exists(next_manager->database(), head_index_name));
     });
 
+    XCTestExpectation *exp = [self expectationWithDescription:@"second"];
+    next_manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
 
-    XCTAssertEqual(manager->current_save_id(), db::value{3});
-    XCTAssertEqual(manager->last_save_id(), db::value{3});
+- (void)test_setup_delta_to_full_version_rows {
+    auto const make_model = [](db::version_rows const version_rows) {
+        db::entity_args sample_a{.name = "sample_a",
+                                 .attributes = {{.name = "name", .type = db::attribute_type::text},
+                                                {.name = "age", .type = db::attribute_type::integer}},
+                                 .version_rows = version_rows};
+        return db::model{
+            db::model_args{.version = yas::version{"0.0.1"}, .entities = {std::move(sample_a)}, .indices = {}}};
+    };
 
-    manager->save(db::no_cancellation, [](db::manager_map_result_t result) {
-        XCTAssertTrue(result);
+    {
+        auto const manager = [yas_db_test_utils create_test_manager:make_model(db::version_rows::delta)];
 
-        auto const &objects = result.value();
-        XCTAssertEqual(objects.size(), 0);
+        manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+        db::object_ptr object = nullptr;
+
+        manager->insert_objects(
+            db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 1}}; },
+            [self, &object](auto result) {
+                XCTAssertTrue(result);
+                object = result.value().at("sample_a").at(0);
+                object->set_attribute_value("name", db::value{"name_value"});
+                object->set_attribute_value("age", db::value{1});
+            });
+
+        manager->save(db::no_cancellation, [self, &object](db::manager_map_result_t result) {
+            XCTAssertTrue(result);
+            object->set_attribute_value("age", db::value{2});
+        });
+
+        manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+        XCTestExpectation *exp = [self expectationWithDescription:@"delta"];
+        manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+        [self waitForExpectationsWithTimeout:10.0 handler:nil];
+    }
+
+    // fullに変えると、アトリビュートが足りないデータに前のデータから値が埋められる
+    auto const manager = [yas_db_test_utils create_test_manager:make_model(db::version_rows::full)];
+
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto const select_result = db::select(
+            manager->database(), {.table = "sample_a", .where_exprs = db::expr(db::save_id_field, "=", "3")});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 1);
+
+        auto const &row = select_result.value().at(0);
+        XCTAssertEqual(row.at(db::changed_field), db::null_value());
+        XCTAssertEqual(row.at("name"), db::value{"name_value"});
+        XCTAssertEqual(row.at("age"), db::value{2});
     });
 
-    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    manager->revert(
+        db::no_cancellation, []() { return 2; }, [self](auto result) { XCTAssertTrue(result); });
+
+    manager->fetch_objects(
+        db::no_cancellation, []() { return db::to_fetch_option(db::select_option{.table = "sample_a"}); },
+        [self](db::manager_vector_result_t result) {
+            XCTAssertTrue(result);
+
+            auto const &fetched = result.value().at("sample_a").at(0);
+            XCTAssertEqual(fetched->attribute_value("name"), db::value{"name_value"});
+            XCTAssertEqual(fetched->attribute_value("age"), db::value{1});
+        });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"full"];
     manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
     [self waitForExpectationsWithTimeout:10.0 handler:nil];
-
-    XCTAssertEqual(manager->current_save_id(), db::value{3});
-    XCTAssertEqual(manager->last_save_id(), db::value{3});
 }
 
 - (void)test_save_with_delete {
@@ -1779,6 +2933,115 @@ using namespace yas;
     }
 }
 
+- (void)test_heads_match_last {
+    // ヘッドを更新する操作のあとで、ヘッドのテーブルがselect_lastの結果と一致しているかテスト
+
+    auto const manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_1]];
+
+    auto const assert_heads = [self, &manager]() {
+        manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+            XCTAssertTrue([yas_db_test_utils heads_match_last:manager->database() model:manager->model()]);
+        });
+    };
+
+    manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    db::object_vector_map_t objects;
+
+    manager->insert_objects(
+        db::no_cancellation, []() { return db::entity_count_map_t{{"sample_a", 2}, {"sample_b", 2}}; },
+        [self, &objects](auto result) {
+            XCTAssertTrue(result);
+            objects = result.value();
+
+            objects.at("sample_a").at(0)->set_relation_objects("child", {objects.at("sample_b").at(0)});
+            objects.at("sample_a").at(1)->set_attribute_value("name", db::value{"name_2"});
+        });
+
+    assert_heads();
+
+    // save
+    manager->save(db::no_cancellation, [self, &objects](db::manager_map_result_t result) {
+        XCTAssertTrue(result);
+        objects.at("sample_a").at(1)->remove();
+    });
+
+    assert_heads();
+
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+    assert_heads();
+
+    // undo
+    manager->revert(
+        db::no_cancellation, []() { return 2; }, [self](auto result) { XCTAssertTrue(result); });
+
+    assert_heads();
+
+    // redo
+    manager->revert(
+        db::no_cancellation, []() { return 3; },
+        [self, &objects](auto result) {
+            XCTAssertTrue(result);
+
+            // sample_aをキャッシュから外して、sample_b0の削除をDB上で関連から外させる
+            objects.erase("sample_a");
+            objects.at("sample_b").at(0)->remove();
+        });
+
+    assert_heads();
+
+    // remove_relations_at_save
+    manager->save(db::no_cancellation, [self](db::manager_map_result_t result) { XCTAssertTrue(result); });
+
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        // 関連を外したsample_a0のデータが追加されている
+        auto const select_result = db::select(
+            manager->database(), {.table = "sample_a", .where_exprs = db::expr(db::save_id_field, "=", "4")});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 1);
+    });
+
+    assert_heads();
+
+    // purge
+    manager->purge(db::no_cancellation, [self](auto result) { XCTAssertTrue(result); });
+
+    assert_heads();
+
+    // ヘッドのない既存のデータベースとしてマイグレーションさせる
+    manager->execute(db::no_cancellation, [self, &manager](auto const &) {
+        auto const &db = manager->database();
+        XCTAssertTrue(db->execute_update(db::drop_table_sql(db::head_table_name("sample_a"))));
+        XCTAssertTrue(db->execute_update(db::drop_table_sql(db::head_table_name("sample_b"))));
+    });
+
+    {
+        XCTestExpectation *exp = [self expectationWithDescription:@"before_migration"];
+        manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+        [self waitForExpectationsWithTimeout:10.0 handler:nil];
+    }
+
+    objects.clear();
+
+    auto const migrated_manager = [yas_db_test_utils create_test_manager:[yas_db_test_utils model_0_0_2]];
+
+    migrated_manager->setup([self](auto result) { XCTAssertTrue(result); });
+
+    migrated_manager->execute(db::no_cancellation, [self, &migrated_manager](auto const &) {
+        auto const &db = migrated_manager->database();
+        XCTAssertTrue([yas_db_test_utils heads_match_last:db model:migrated_manager->model()]);
+
+        auto const select_result = db::select(db, {.table = db::head_table_name("sample_a")});
+        XCTAssertTrue(select_result);
+        XCTAssertEqual(select_result.value().size(), 2);
+    });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"exp"];
+    migrated_manager->execute(db::no_cancellation, [exp](auto const &) { [exp fulfill]; });
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
 - (void)test_suspend_count {
     db::model model_0_0_1 = [yas_db_test_utils model_0_0_1];
     auto const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_1) priority_count:2];
@@ -2822,6 +4085,7 @@ using namespace yas;
 - (void)test_to_string_from_error {
     XCTAssertEqual(to_string(db::manager_error_type::begin_transaction_failed), "begin_transaction_failed");
     XCTAssertEqual(to_string(db::manager_error_type::vacuum_failed), "vacuum_failed");
+    XCTAssertEqual(to_string(db::manager_error_type::backup_failed), "backup_failed");
     XCTAssertEqual(to_string(db::manager_error_type::select_info_failed), "select_info_failed");
     XCTAssertEqual(to_string(db::manager_error_type::update_info_failed), "update_info_failed");
     XCTAssertEqual(to_string(db::manager_error_type::version_not_found), "version_not_found");
@@ -2832,6 +4096,8 @@ using namespace yas;
     XCTAssertEqual(to_string(db::manager_error_type::create_entity_table_failed), "create_entity_table_failed");
     XCTAssertEqual(to_string(db::manager_error_type::create_relation_table_failed), "create_relation_table_failed");
     XCTAssertEqual(to_string(db::manager_error_type::create_index_failed), "create_index_failed");
+    XCTAssertEqual(to_string(db::manager_error_type::create_head_table_failed), "create_head_table_failed");
+    XCTAssertEqual(to_string(db::manager_error_type::update_head_failed), "update_head_failed");
     XCTAssertEqual(to_string(db::manager_error_type::insert_attributes_failed), "insert_attributes_failed");
     XCTAssertEqual(to_string(db::manager_error_type::insert_relation_failed), "insert_relation_failed");
     XCTAssertEqual(to_string(db::manager_error_type::save_id_not_found), "save_id_not_found");
@@ -2842,10 +4108,12 @@ using namespace yas;
     XCTAssertEqual(to_string(db::manager_error_type::select_last_failed), "select_last_failed");
     XCTAssertEqual(to_string(db::manager_error_type::select_revert_failed), "select_revert_failed");
     XCTAssertEqual(to_string(db::manager_error_type::select_relation_removed_failed), "select_relation_removed_failed");
+    XCTAssertEqual(to_string(db::manager_error_type::explain_query_plan_failed), "explain_query_plan_failed");
     XCTAssertEqual(to_string(db::manager_error_type::make_object_datas_failed), "make_object_datas_failed");
     XCTAssertEqual(to_string(db::manager_error_type::out_of_range_save_id), "out_of_range_save_id");
     XCTAssertEqual(to_string(db::manager_error_type::select_failed), "select_failed");
     XCTAssertEqual(to_string(db::manager_error_type::last_insert_rowid_failed), "last_insert_rowid_failed");
+    XCTAssertEqual(to_string(db::manager_error_type::canceled), "canceled");
     XCTAssertEqual(to_string(db::manager_error_type::none), "none");
 }
 
@@ -2862,6 +4130,8 @@ using namespace yas;
                          db::manager_error_type::create_entity_table_failed,
                          db::manager_error_type::create_relation_table_failed,
                          db::manager_error_type::create_index_failed,
+                         db::manager_error_type::create_head_table_failed,
+                         db::manager_error_type::update_head_failed,
                          db::manager_error_type::insert_attributes_failed,
                          db::manager_error_type::insert_relation_failed,
                          db::manager_error_type::save_id_not_found,
@@ -2875,6 +4145,7 @@ using namespace yas;
                          db::manager_error_type::out_of_range_save_id,
                          db::manager_error_type::select_failed,
                          db::manager_error_type::last_insert_rowid_failed,
+                         db::manager_error_type::canceled,
                          db::manager_error_type::none};
 
     for (auto const &value : values) {
@@ -65,6 +65,53 @@ using namespace yas;
     XCTAssertEqual(select_result.value().at(0).at(field_name).get<db::text>(), "value_2");
 }
 
+- (void)test_select_last_each {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    auto const table_name = "table_a";
+    auto const field_name = "field_a";
+    std::vector<std::string> const fields{db::object_id_field, field_name, db::save_id_field, db::action_field};
+
+    XCTAssertTrue(db::create_table(db, table_name, fields));
+
+    db::value_vector_t args;
+    args = {db::value{1}, db::value{"value_1_a"}, db::value{1}, db::insert_action_value()};
+    XCTAssertTrue(db->execute_update(db::insert_sql(table_name, fields), args));
+    args = {db::value{2}, db::value{"value_2_a"}, db::value{1}, db::insert_action_value()};
+    XCTAssertTrue(db->execute_update(db::insert_sql(table_name, fields), args));
+    args = {db::value{1}, db::value{"value_1_b"}, db::value{2}, db::update_action_value()};
+    XCTAssertTrue(db->execute_update(db::insert_sql(table_name, fields), args));
+
+    std::vector<std::string> values;
+
+    auto result = db::select_last_each(db,
+                                       db::select_option{.table = table_name,
+                                                         .field_orders = {{db::object_id_field, db::order::ascending}}},
+                                       db::value{2}, [&values, &field_name](db::row_set &row_set) {
+                                           values.push_back(row_set.column_value(field_name).get<db::text>());
+                                           return true;
+                                       });
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 2);
+    XCTAssertEqual(values, (std::vector<std::string>{"value_1_b", "value_2_a"}));
+
+    values.clear();
+
+    result = db::select_last_each(db,
+                                  db::select_option{.table = table_name,
+                                                    .field_orders = {{db::object_id_field, db::order::ascending}}},
+                                  db::value{2}, [&values, &field_name](db::row_set &row_set) {
+                                      values.push_back(row_set.column_value(field_name).get<db::text>());
+                                      return false;
+                                  });
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 1);
+    XCTAssertEqual(values, (std::vector<std::string>{"value_1_b"}));
+}
+
 - (void)test_select_last_by_save_id {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -160,6 +207,44 @@ using namespace yas;
     XCTAssertEqual(select_result.value().at(0).at(field_name).get<db::text>(), "value_2_b");
 }
 
+- (void)test_to_head_select_option {
+    db::select_option const option = db::to_head_select_option({.table = "sample_a",
+                                                                .fields = {"name"},
+                                                                .where_exprs = "age = 10",
+                                                                .limit_range = {.location = 0, .length = 5}});
+
+    XCTAssertEqual(option.table, "sample_a");
+    XCTAssertEqual(option.fields, (std::vector<std::string>{"name"}));
+    XCTAssertEqual(option.where_exprs,
+                   "pk_id IN (SELECT pk_id FROM head_sample_a WHERE (removed = 0)) AND (age = 10)");
+    XCTAssertEqual(option.limit_range.length, 5);
+
+    db::select_option const removed_option = db::to_head_select_option({.table = "sample_a"}, true);
+
+    XCTAssertEqual(removed_option.where_exprs, "pk_id IN (SELECT pk_id FROM head_sample_a)");
+}
+
+- (void)test_to_snapshot_select_option {
+    db::entity const entity{{.name = "sample_a",
+                             .attributes = {{.name = "name", .type = db::attribute_type::text}},
+                             .version_rows = db::version_rows::delta},
+                            {}};
+
+    db::select_option const option =
+        db::to_snapshot_select_option(entity, {.table = "sample_a", .fields = {"name"}, .where_exprs = "name = 'a'"});
+
+    XCTAssertEqual(option.table, "head_sample_a");
+    XCTAssertEqual(option.fields, (std::vector<std::string>{"name"}));
+    XCTAssertEqual(option.where_exprs, "(removed = 0) AND (name = 'a')");
+
+    // 全てのフィールドならヘッドの管理用のフィールドは含まない
+    db::select_option const all_option = db::to_snapshot_select_option(entity, {.table = "sample_a"}, true);
+
+    XCTAssertEqual(all_option.fields.size(), entity.all_attributes.size());
+    XCTAssertEqual(std::count(all_option.fields.begin(), all_option.fields.end(), db::removed_field), 0);
+    XCTAssertEqual(all_option.where_exprs, "");
+}
+
 - (void)test_select_undo {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -755,4 +840,33 @@ using namespace yas;
     XCTAssertEqual(entity_b_ids.count(obj_c_1->object_id().stable()), 1);
 }
 
+- (void)test_explain_fetch {
+    db::model model_0_0_2 = [yas_db_test_utils model_0_0_2];
+    db::manager_ptr const manager = [yas_db_test_utils create_test_manager:std::move(model_0_0_2)];
+
+    manager->setup([](db::manager_result_t result) { XCTAssertTrue(result); });
+
+    XCTestExpectation *exp = [self expectationWithDescription:@"explain"];
+
+    manager->execute(db::no_cancellation, [&manager, exp](auto const &) {
+        db::fetch_option fetch_option;
+        fetch_option.add_select_option(db::select_option{.table = "sample_a", .where_exprs = "tall = 1"});
+        fetch_option.add_select_option(db::select_option{.table = "sample_b", .where_exprs = "name = 'b'"});
+
+        auto const result = db::explain_fetch(manager->database(), manager->model(), fetch_option);
+
+        XCTAssertTrue(result);
+
+        auto const &plans = result.value();
+        XCTAssertEqual(plans.size(), 2);
+        XCTAssertTrue(plans.at("sample_a").has_table_scan());
+        XCTAssertTrue(plans.at("sample_a").sql.find("head_sample_a") != std::string::npos);
+        XCTAssertTrue(plans.at("sample_b").sql.find("name = 'b'") != std::string::npos);
+
+        [exp fulfill];
+    });
+
+    [self waitForExpectations:@[exp] timeout:10.0];
+}
+
 @end
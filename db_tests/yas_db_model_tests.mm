@@ -277,4 +277,93 @@ using namespace yas;
     XCTAssertFalse(model.index_exists("sample_b_name"));
 }
 
+- (void)test_auto_indices {
+    db::model model = [yas_db_test_utils model_0_0_1];
+
+    auto const &auto_indices = model.auto_indices();
+
+    XCTAssertEqual(auto_indices.size(), 5);
+
+    db::index const &entity_index = auto_indices.at("auto_sample_a_obj_id_save_id");
+    XCTAssertEqual(entity_index.entity, "sample_a");
+    XCTAssertEqual(entity_index.attributes, (std::vector<std::string>{"obj_id", "save_id"}));
+
+    XCTAssertEqual(auto_indices.count("auto_sample_b_obj_id_save_id"), 1);
+
+    db::index const &rel_index = auto_indices.at("auto_rel_sample_a_child_save_id_src_obj_id");
+    XCTAssertEqual(rel_index.entity, "rel_sample_a_child");
+    XCTAssertEqual(rel_index.attributes, (std::vector<std::string>{"save_id", "src_obj_id"}));
+
+    XCTAssertEqual(auto_indices.at("auto_rel_sample_a_child_src_pk_id").attributes,
+                   (std::vector<std::string>{"src_pk_id"}));
+    XCTAssertEqual(auto_indices.at("auto_rel_sample_a_child_tgt_obj_id").attributes,
+                   (std::vector<std::string>{"tgt_obj_id"}));
+
+    XCTAssertFalse(model.index_exists("auto_sample_a_obj_id_save_id"));
+}
+
+- (void)test_auto_indices_disabled {
+    db::entity_args sample_a{.name = "sample_a", .relations = {{.name = "child", .target = "sample_a"}}};
+    db::model model{db::model_args{
+        .version = yas::version{"0.0.1"}, .entities = {std::move(sample_a)}, .indices = {}, .auto_indices = false}};
+
+    XCTAssertEqual(model.auto_indices().size(), 0);
+}
+
+- (void)test_layout {
+    db::entity_args sample_a{.name = "sample_a", .relations = {{.name = "child", .target = "sample_b"}}};
+    db::entity_args sample_b{.name = "sample_b", .layout = db::table_layout::rowid};
+    db::model model{db::model_args{.version = yas::version{"0.0.1"},
+                                   .entities = {std::move(sample_a), std::move(sample_b)},
+                                   .indices = {},
+                                   .layout = db::table_layout::clustered}};
+
+    XCTAssertEqual(model.entity("sample_a").layout, db::table_layout::clustered);
+    XCTAssertEqual(model.relation("sample_a", "child").layout, db::table_layout::clustered);
+    XCTAssertEqual(model.entity("sample_b").layout, db::table_layout::rowid);
+
+    // 主キーと同じ並びのインデックスは作らない
+    auto const &auto_indices = model.auto_indices();
+    XCTAssertEqual(auto_indices.count("auto_sample_a_obj_id_save_id"), 0);
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_src_pk_id"), 0);
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_save_id_src_obj_id"), 1);
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_tgt_obj_id"), 1);
+    XCTAssertEqual(auto_indices.count("auto_sample_b_obj_id_save_id"), 1);
+}
+
+- (void)test_packed_relation {
+    db::entity_args sample_a{
+        .name = "sample_a",
+        .relations = {{.name = "child", .target = "sample_a", .encoding = db::relation_encoding::packed}}};
+    db::model model{
+        db::model_args{.version = yas::version{"0.0.1"}, .entities = {std::move(sample_a)}, .indices = {}}};
+
+    XCTAssertEqual(model.relation("sample_a", "child").encoding, db::relation_encoding::packed);
+
+    // src_pk_idはrowidで、関連先のidはBLOBの中なので、インデックスはセーブIDとソースのオブジェクトIDだけ
+    auto const &auto_indices = model.auto_indices();
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_save_id_src_obj_id"), 1);
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_src_pk_id"), 0);
+    XCTAssertEqual(auto_indices.count("auto_rel_sample_a_child_tgt_obj_id"), 0);
+}
+
+- (void)test_delta_version_rows {
+    db::entity_args sample_a{.name = "sample_a",
+                             .attributes = {{.name = "name", .type = db::attribute_type::text}},
+                             .version_rows = db::version_rows::delta};
+    db::entity_args sample_b{.name = "sample_b", .attributes = {{.name = "name", .type = db::attribute_type::text}}};
+    db::model model{db::model_args{.version = yas::version{"0.0.1"},
+                                   .entities = {std::move(sample_a), std::move(sample_b)},
+                                   .indices = {{.name = "a_name", .entity = "sample_a", .attributes = {"name"}},
+                                               {.name = "b_name", .entity = "sample_b", .attributes = {"name"}}}}};
+
+    XCTAssertEqual(model.entity("sample_a").version_rows, db::version_rows::delta);
+    XCTAssertEqual(model.entity("sample_b").version_rows, db::version_rows::full);
+
+    // deltaのエンティティのインデックスだけヘッドにも作る
+    auto const &auto_indices = model.auto_indices();
+    XCTAssertEqual(auto_indices.count("auto_head_sample_a_name"), 1);
+    XCTAssertEqual(auto_indices.at("auto_head_sample_a_name").entity, "head_sample_a");
+    XCTAssertEqual(auto_indices.count("auto_head_sample_b_name"), 0);
+}
 @end
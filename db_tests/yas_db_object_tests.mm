@@ -419,6 +419,48 @@ using namespace yas;
     XCTAssertEqual(data.attributes.count(db::save_id_field), 0);
 }
 
+- (void)test_save_data_of_delta_entity {
+    db::entity entity{{.name = "sample_a",
+                       .attributes = {{.name = "name", .type = db::attribute_type::text},
+                                      {.name = "age", .type = db::attribute_type::integer}},
+                       .version_rows = db::version_rows::delta},
+                      {}};
+    auto obj = db::object::make_shared(entity);
+
+    db::manageable_object::cast(obj)->load_data(
+        {.object_id = db::make_stable_id(db::value{1}),
+         .attributes = {{"name", db::value{"name_value"}},
+                        {"age", db::value{1}},
+                        {db::save_id_field, db::value{1}},
+                        {db::action_field, db::insert_action_value()}},
+         .relations = {}},
+        false);
+
+    db::object_id_pool obj_id_pool;
+
+    // 変更したアトリビュートの名前だけがchangedに入る
+    obj->set_attribute_value("age", db::value{2});
+
+    auto data = obj->save_data(obj_id_pool);
+    XCTAssertEqual(data.attributes.at(db::action_field), db::update_action_value());
+    XCTAssertEqual(data.attributes.at(db::changed_field), db::value{"age"});
+    XCTAssertEqual(data.attributes.at("name"), db::value{"name_value"});
+
+    obj->set_attribute_value("name", db::value{"name_value_2"});
+    XCTAssertEqual(obj->save_data(obj_id_pool).attributes.at(db::changed_field), db::value{"age,name"});
+
+    // 読み込み直すと変更していないことになる
+    db::manageable_object::cast(obj)->load_data(
+        {.object_id = db::make_stable_id(db::value{1}),
+         .attributes = {{"name", db::value{"name_value_2"}},
+                        {"age", db::value{2}},
+                        {db::save_id_field, db::value{2}},
+                        {db::action_field, db::update_action_value()}},
+         .relations = {}},
+        true);
+    XCTAssertEqual(obj->save_data(obj_id_pool).attributes.at(db::changed_field), db::value{""});
+}
+
 - (void)test_object_id_of_save_data {
     // save_dataで返されるobject_idが共通になっているか
     db::model model = [yas_db_test_utils model_0_0_1];
@@ -0,0 +1,86 @@
+//
+//  yas_db_open_option_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_open_option_tests : XCTestCase
+
+@end
+
+@implementation yas_db_open_option_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)test_default_pragma_sqls {
+    db::open_option option;
+    XCTAssertEqual(option.pragma_sqls().size(), 0);
+}
+
+- (void)test_pragma_sqls {
+    db::open_option option{.page_size = 8192,
+                           .locking_mode = db::locking_mode::normal,
+                           .journal_mode = db::journal_mode::wal,
+                           .synchronous = db::synchronous::normal,
+                           .cache_size = -2000,
+                           .mmap_size = 268435456,
+                           .temp_store = db::temp_store::memory};
+
+    auto const sqls = option.pragma_sqls();
+
+    XCTAssertEqual(sqls.size(), 7);
+    XCTAssertEqual(sqls.at(0), "PRAGMA page_size = 8192;");
+    XCTAssertEqual(sqls.at(1), "PRAGMA locking_mode = NORMAL;");
+    XCTAssertEqual(sqls.at(2), "PRAGMA journal_mode = WAL;");
+    XCTAssertEqual(sqls.at(3), "PRAGMA synchronous = NORMAL;");
+    XCTAssertEqual(sqls.at(4), "PRAGMA cache_size = -2000;");
+    XCTAssertEqual(sqls.at(5), "PRAGMA mmap_size = 268435456;");
+    XCTAssertEqual(sqls.at(6), "PRAGMA temp_store = MEMORY;");
+}
+
+- (void)test_to_journal_mode {
+    XCTAssertEqual(db::to_journal_mode("delete"), db::journal_mode::delete_journal);
+    XCTAssertEqual(db::to_journal_mode("truncate"), db::journal_mode::truncate);
+    XCTAssertEqual(db::to_journal_mode("persist"), db::journal_mode::persist);
+    XCTAssertEqual(db::to_journal_mode("memory"), db::journal_mode::memory);
+    XCTAssertEqual(db::to_journal_mode("wal"), db::journal_mode::wal);
+    XCTAssertEqual(db::to_journal_mode("WAL"), db::journal_mode::wal);
+    XCTAssertEqual(db::to_journal_mode("off"), db::journal_mode::off);
+    XCTAssertFalse(db::to_journal_mode("unknown"));
+}
+
+- (void)test_to_locking_mode {
+    XCTAssertEqual(db::to_locking_mode("normal"), db::locking_mode::normal);
+    XCTAssertEqual(db::to_locking_mode("exclusive"), db::locking_mode::exclusive);
+    XCTAssertFalse(db::to_locking_mode("unknown"));
+}
+
+- (void)test_to_string {
+    XCTAssertEqual(to_string(db::journal_mode::delete_journal), "DELETE");
+    XCTAssertEqual(to_string(db::journal_mode::wal), "WAL");
+    XCTAssertEqual(to_string(db::synchronous::off), "OFF");
+    XCTAssertEqual(to_string(db::synchronous::extra), "EXTRA");
+    XCTAssertEqual(to_string(db::temp_store::compile_default), "DEFAULT");
+    XCTAssertEqual(to_string(db::temp_store::file), "FILE");
+    XCTAssertEqual(to_string(db::locking_mode::exclusive), "EXCLUSIVE");
+}
+
+- (void)test_journal_mode_ostream {
+    auto const values = {db::journal_mode::delete_journal, db::journal_mode::wal};
+
+    for (auto const &value : values) {
+        std::ostringstream stream;
+        stream << value;
+        XCTAssertEqual(stream.str(), to_string(value));
+    }
+}
+
+@end
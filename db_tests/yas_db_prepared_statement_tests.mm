@@ -0,0 +1,191 @@
+//
+//  yas_db_prepared_statement_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_prepared_statement_tests : XCTestCase
+
+@end
+
+@implementation yas_db_prepared_statement_tests
+
+- (void)setUp {
+    [super setUp];
+    [yas_db_test_utils deleteDatabase];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_prepare {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    auto const prepare_result = db->prepare("insert into test_table(field_a, field_b) values(:a, :b)");
+    XCTAssertTrue(prepare_result);
+
+    auto const &prepared = prepare_result.value();
+    XCTAssertEqual(prepared->sql(), "insert into test_table(field_a, field_b) values(:a, :b)");
+    XCTAssertEqual(prepared->parameter_count(), 2);
+    XCTAssertEqual(prepared->parameter_index("a"), 1);
+    XCTAssertEqual(prepared->parameter_index("b"), 2);
+    XCTAssertFalse(prepared->parameter_index("c"));
+    XCTAssertFalse(prepared->is_closed());
+}
+
+- (void)test_prepare_failed {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+
+    auto const closed_result = db->prepare("select * from test_table");
+    XCTAssertFalse(closed_result);
+    XCTAssertEqual(closed_result.error().type(), db::error_type::closed);
+
+    XCTAssertTrue(db->open());
+
+    auto const invalid_result = db->prepare("select * from not_exists_table");
+    XCTAssertFalse(invalid_result);
+    XCTAssertEqual(invalid_result.error().type(), db::error_type::sqlite);
+}
+
+- (void)test_bind_and_execute_update {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_int", "field_real", "field_text", "field_blob"}));
+
+    auto const prepared =
+        db->prepare("insert into test_table(field_int, field_real, field_text, field_blob) values(?, ?, ?, ?)").value();
+
+    std::array<std::byte, 2> const blob{std::byte{1}, std::byte{2}};
+
+    for (int64_t idx = 0; idx < 3; ++idx) {
+        XCTAssertTrue(prepared->bind(1, idx));
+        XCTAssertTrue(prepared->bind(2, 0.5));
+        XCTAssertTrue(prepared->bind(3, std::string_view{"text"}));
+        XCTAssertTrue(prepared->bind(4, std::span<std::byte const>{blob}));
+        XCTAssertTrue(db->execute_update(prepared));
+    }
+
+    auto const select_result = db::select(db, {.table = "test_table", .field_orders = {{"field_int"}}});
+    XCTAssertTrue(select_result);
+
+    auto const &rows = select_result.value();
+    XCTAssertEqual(rows.size(), 3);
+    XCTAssertEqual(rows.at(2).at("field_int"), db::value{2});
+    XCTAssertEqual(rows.at(2).at("field_real"), db::value{0.5});
+    XCTAssertEqual(rows.at(2).at("field_text"), db::value{"text"});
+    XCTAssertEqual(rows.at(2).at("field_blob").get<db::blob>().size(), 2);
+}
+
+- (void)test_bind_value_and_null {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    auto const prepared = db->prepare("insert into test_table(field_a, field_b) values(:a, :b)").value();
+
+    XCTAssertTrue(prepared->bind(*prepared->parameter_index("a"), db::value{"value_a"}));
+    XCTAssertTrue(prepared->bind(*prepared->parameter_index("b"), nullptr));
+    XCTAssertTrue(db->execute_update(prepared));
+
+    auto const rows = db::select(db, {.table = "test_table"}).value();
+    XCTAssertEqual(rows.size(), 1);
+    XCTAssertEqual(rows.at(0).at("field_a"), db::value{"value_a"});
+    XCTAssertEqual(rows.at(0).at("field_b"), db::null_value());
+
+    XCTAssertFalse(prepared->bind(3, 1));
+}
+
+- (void)test_bind_arithmetic_types {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b", "field_c", "field_d"}));
+
+    auto const prepared =
+        db->prepare("insert into test_table(field_a, field_b, field_c, field_d) values(?, ?, ?, ?)").value();
+
+    XCTAssertTrue(prepared->bind(1, std::size_t{1}));
+    XCTAssertTrue(prepared->bind(2, 2L));
+    XCTAssertTrue(prepared->bind(3, 3U));
+    XCTAssertTrue(prepared->bind(4, 0.5F));
+    XCTAssertTrue(db->execute_update(prepared));
+
+    auto const rows = db::select(db, {.table = "test_table"}).value();
+    XCTAssertEqual(rows.size(), 1);
+    XCTAssertEqual(rows.at(0).at("field_a"), db::value{1});
+    XCTAssertEqual(rows.at(0).at("field_b"), db::value{2});
+    XCTAssertEqual(rows.at(0).at("field_c"), db::value{3});
+    XCTAssertEqual(rows.at(0).at("field_d"), db::value{0.5});
+}
+
+- (void)test_bind_static {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_text", "field_blob"}));
+
+    auto const prepared = db->prepare("insert into test_table(field_text, field_blob) values(?, ?)").value();
+
+    // 実行し終えるまで文字列とデータを残しておく
+    std::string const text = "text";
+    std::array<std::byte, 2> const blob{std::byte{1}, std::byte{2}};
+
+    XCTAssertTrue(prepared->bind_static(1, std::string_view{text}));
+    XCTAssertTrue(prepared->bind_static(2, std::span<std::byte const>{blob}));
+    XCTAssertTrue(db->execute_update(prepared));
+    XCTAssertTrue(prepared->clear_bindings());
+
+    auto const rows = db::select(db, {.table = "test_table"}).value();
+    XCTAssertEqual(rows.size(), 1);
+    XCTAssertEqual(rows.at(0).at("field_text"), db::value{"text"});
+    XCTAssertEqual(rows.at(0).at("field_blob").get<db::blob>().size(), 2);
+}
+
+- (void)test_execute_query {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a"}));
+    XCTAssertTrue(db->execute_update("insert into test_table(field_a) values(1)"));
+    XCTAssertTrue(db->execute_update("insert into test_table(field_a) values(2)"));
+
+    auto const prepared = db->prepare("select field_a from test_table where field_a >= :min").value();
+
+    XCTAssertTrue(prepared->bind(*prepared->parameter_index("min"), 1));
+
+    {
+        auto const row_set = db->execute_query(prepared).value();
+        XCTAssertTrue(row_set->next());
+
+        XCTAssertEqual(db->execute_query(prepared).error().type(), db::error_type::in_use);
+
+        XCTAssertTrue(row_set->next());
+        XCTAssertFalse(row_set->next());
+    }
+
+    XCTAssertTrue(prepared->bind(*prepared->parameter_index("min"), 2));
+
+    auto const row_set = db->execute_query(prepared).value();
+    XCTAssertTrue(row_set->next());
+    XCTAssertEqual(row_set->column_value(0), db::value{2});
+    XCTAssertFalse(row_set->next());
+}
+
+- (void)test_close_with_database {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a"}));
+
+    auto const prepared = db->prepare("insert into test_table(field_a) values(?)").value();
+
+    db->close();
+
+    XCTAssertTrue(prepared->is_closed());
+    XCTAssertEqual(prepared->bind(1, 1).error().type(), db::error_type::closed);
+    XCTAssertEqual(db->execute_update(prepared).error().type(), db::error_type::closed);
+}
+
+@end
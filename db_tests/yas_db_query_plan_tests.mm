@@ -0,0 +1,103 @@
+//
+//  yas_db_query_plan_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_query_plan_tests : XCTestCase
+
+@end
+
+@implementation yas_db_query_plan_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_query_plan_step {
+    XCTAssertTrue((db::query_plan_step{.detail = "SCAN test_table"}).is_table_scan());
+    XCTAssertTrue((db::query_plan_step{.detail = "SCAN TABLE test_table"}).is_table_scan());
+    XCTAssertFalse((db::query_plan_step{.detail = "SCAN test_table USING INDEX test_index"}).is_table_scan());
+    XCTAssertTrue((db::query_plan_step{.detail = "SCAN test_table USING INDEX test_index"}).is_index_scan());
+    XCTAssertFalse((db::query_plan_step{.detail = "SCAN CONSTANT ROW"}).is_table_scan());
+    XCTAssertFalse((db::query_plan_step{.detail = "SEARCH test_table USING INDEX test_index (a=?)"}).is_table_scan());
+    XCTAssertTrue((db::query_plan_step{.detail = "USE TEMP B-TREE FOR ORDER BY"}).uses_temp_b_tree());
+    XCTAssertFalse((db::query_plan_step{.detail = "SCAN test_table"}).uses_temp_b_tree());
+}
+
+- (void)test_explain_query_plan {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    db::select_option const option{.table = "test_table",
+                                   .where_exprs = db::equal_field_expr("field_a"),
+                                   .arguments = {{"field_a", db::value{1}}}};
+
+    auto result = db::explain_query_plan(db, option);
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value().sql, db::select_sql(option) + ";");
+    XCTAssertGreaterThan(result.value().steps.size(), 0);
+    XCTAssertTrue(result.value().has_table_scan());
+    XCTAssertFalse(result.value().has_temp_b_tree());
+
+    XCTAssertTrue(db::create_index(db, "test_index", "test_table", {"field_a"}));
+
+    result = db::explain_query_plan(db, option);
+    XCTAssertTrue(result);
+    XCTAssertFalse(result.value().has_table_scan());
+    XCTAssertFalse(result.value().has_temp_b_tree());
+
+    db::select_option sorted_option = option;
+    sorted_option.field_orders = {{"field_b", db::order::ascending}};
+
+    result = db::explain_query_plan(db, sorted_option);
+    XCTAssertTrue(result);
+    XCTAssertFalse(result.value().has_table_scan());
+    XCTAssertTrue(result.value().has_temp_b_tree());
+}
+
+- (void)test_explain_query_plan_failed {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    auto const result = db::explain_query_plan(db, db::select_option{.table = "not_exists_table"});
+    XCTAssertFalse(result);
+}
+
+- (void)test_query_plan_checker {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+    XCTAssertTrue(db::create_index(db, "test_index", "test_table", {"field_a"}));
+
+    std::vector<db::query_plan> warned_plans;
+
+    auto const checker = db::query_plan_checker::make_shared(
+        [&warned_plans](db::query_plan const &plan) { warned_plans.push_back(plan); });
+
+    checker->check(db, {.table = "test_table", .where_exprs = "field_b = 1"});
+
+    XCTAssertEqual(warned_plans.size(), 1);
+    XCTAssertEqual(warned_plans.at(0).sql, "SELECT * FROM test_table WHERE field_b = 1;");
+    XCTAssertTrue(warned_plans.at(0).has_table_scan());
+
+    // 値だけが違う場合は同じ形として調べない
+    checker->check(db, {.table = "test_table", .where_exprs = "field_b = 2"});
+    XCTAssertEqual(warned_plans.size(), 1);
+
+    // インデックスが使われていれば知らせない
+    checker->check(db, {.table = "test_table", .where_exprs = "field_a = 1"});
+    XCTAssertEqual(warned_plans.size(), 1);
+}
+
+@end
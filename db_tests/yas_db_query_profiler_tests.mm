@@ -0,0 +1,116 @@
+//
+//  yas_db_query_profiler_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_query_profiler_tests : XCTestCase
+
+@end
+
+@implementation yas_db_query_profiler_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_normalize_sql {
+    XCTAssertEqual(db::normalize_sql("SELECT * FROM t WHERE a = 10 AND b = 'x''y'"),
+                   "SELECT * FROM t WHERE a = ? AND b = ?");
+    XCTAssertEqual(db::normalize_sql("select *  from t\n where obj_id IN (1, 2, 3)"),
+                   "select * from t where obj_id IN (?)");
+    XCTAssertEqual(db::normalize_sql("select * from t1 where x = ?1 and y = :name2"),
+                   "select * from t1 where x = ?1 and y = :name2");
+    XCTAssertEqual(db::normalize_sql("select \"col 1\" from t"), "select \"col 1\" from t");
+}
+
+- (void)test_percentile {
+    db::query_stats stats;
+
+    XCTAssertEqual(stats.p50().count(), 0);
+
+    for (int idx = 1; idx <= 100; ++idx) {
+        stats.add_sample(std::chrono::nanoseconds{idx});
+    }
+
+    XCTAssertEqual(stats.p50().count(), 50);
+    XCTAssertEqual(stats.p99().count(), 99);
+    XCTAssertEqual(stats.percentile(1.0).count(), 100);
+    XCTAssertEqual(stats.percentile(0.0).count(), 1);
+}
+
+- (void)test_database_query_stats {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db::create_table(db, "test_table", {"field_a", "field_b"}));
+
+    db->set_profiling_enabled(true);
+    XCTAssertTrue(db->is_profiling_enabled());
+
+    for (int idx = 0; idx < 3; ++idx) {
+        XCTAssertTrue(db->execute_update("insert into test_table(field_a, field_b) values(" + std::to_string(idx) +
+                                         ", 'text')"));
+    }
+
+    XCTAssertTrue(db::select(db, {.table = "test_table", .field_orders = {{"field_b", db::order::ascending}}}));
+
+    auto const stats = db->query_stats();
+
+    auto const insert_it = std::find_if(stats.begin(), stats.end(), [](db::query_stats const &stats) {
+        return stats.sql == "insert into test_table(field_a, field_b) values(?)";
+    });
+    XCTAssertTrue(insert_it != stats.end());
+    XCTAssertEqual(insert_it->count, 3);
+    XCTAssertGreaterThan(insert_it->total_duration.count(), 0);
+
+    auto const select_it = std::find_if(stats.begin(), stats.end(), [](db::query_stats const &stats) {
+        return stats.sql.starts_with("SELECT * FROM test_table");
+    });
+    XCTAssertTrue(select_it != stats.end());
+    XCTAssertEqual(select_it->count, 1);
+    XCTAssertEqual(select_it->rows, 3);
+    XCTAssertEqual(select_it->sorts, 1);
+    XCTAssertGreaterThan(select_it->fullscan_steps, 0);
+
+    db->reset_query_stats();
+    XCTAssertEqual(db->query_stats().size(), 0);
+
+    db->set_profiling_enabled(false);
+    XCTAssertTrue(db->execute_update("insert into test_table(field_a, field_b) values(10, 'text')"));
+    XCTAssertEqual(db->query_stats().size(), 0);
+}
+
+- (void)test_slow_query_handler {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    std::vector<db::slow_query> slow_queries;
+
+    db->set_slow_query_handler(std::chrono::nanoseconds{0},
+                               [&slow_queries](db::slow_query const &query) { slow_queries.push_back(query); });
+
+    XCTAssertTrue(db->execute_statements("select 1;"));
+
+    XCTAssertEqual(slow_queries.size(), 1);
+    XCTAssertEqual(slow_queries.at(0).sql, "select 1;");
+    XCTAssertEqual(slow_queries.at(0).normalized_sql, "select ?;");
+    XCTAssertEqual(slow_queries.at(0).rows, 1);
+    XCTAssertFalse(db->is_profiling_enabled());
+
+    db->set_slow_query_handler(std::chrono::hours{1}, [&slow_queries](db::slow_query const &query) {
+        slow_queries.push_back(query);
+    });
+
+    XCTAssertTrue(db->execute_statements("select 2;"));
+    XCTAssertEqual(slow_queries.size(), 1);
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  yas_db_reader_pool_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_reader_pool_tests : XCTestCase
+
+@end
+
+@implementation yas_db_reader_pool_tests
+
+- (void)setUp {
+    [super setUp];
+    [yas_db_test_utils deleteDatabase];
+}
+
+- (void)tearDown {
+    [yas_db_test_utils deleteDatabase];
+    [super tearDown];
+}
+
+- (void)test_make_shared {
+    auto const pool = db::reader_pool::make_shared([yas_db_test_utils database_path],
+                                                   {.journal_mode = db::journal_mode::wal, .cache_size = -4000}, 2);
+
+    XCTAssertEqual(pool->count(), 2);
+    XCTAssertEqual(pool->idle_count(), 2);
+
+    auto const &option = pool->reader_at(0).database->open_option();
+    XCTAssertFalse(option.journal_mode.has_value());
+    XCTAssertEqual(option.cache_size, -4000);
+}
+
+- (void)test_acquire_and_release {
+    auto const pool = db::reader_pool::make_shared([yas_db_test_utils database_path], {}, 2);
+
+    auto const idx_0 = pool->acquire();
+    XCTAssertTrue(idx_0.has_value());
+    XCTAssertEqual(pool->idle_count(), 1);
+
+    auto const idx_1 = pool->acquire();
+    XCTAssertTrue(idx_1.has_value());
+    XCTAssertNotEqual(*idx_0, *idx_1);
+    XCTAssertEqual(pool->idle_count(), 0);
+
+    XCTAssertFalse(pool->acquire().has_value());
+
+    pool->release(*idx_0);
+    XCTAssertEqual(pool->idle_count(), 1);
+
+    auto const idx_2 = pool->acquire();
+    XCTAssertEqual(idx_2, idx_0);
+}
+
+- (void)test_open_read_only {
+    auto const db_path = [yas_db_test_utils database_path];
+
+    auto const writer = db::database::make_shared(db_path, {.journal_mode = db::journal_mode::wal});
+    XCTAssertTrue(writer->open());
+    XCTAssertTrue(writer->execute_update("create table test_table (field_a);"));
+
+    auto const pool = db::reader_pool::make_shared(db_path, writer->open_option(), 1);
+    auto const idx = pool->acquire();
+
+    XCTAssertTrue(pool->open(*idx));
+
+    auto const &reader_db = pool->reader_at(*idx).database;
+    XCTAssertTrue(db::table_exists(reader_db, "test_table"));
+    XCTAssertFalse(reader_db->execute_update("insert into test_table(field_a) values(1);"));
+
+    reader_db->close();
+    writer->close();
+}
+
+- (void)test_acquire_after_close_all {
+    auto const pool = db::reader_pool::make_shared([yas_db_test_utils database_path], {}, 1);
+    auto const &queue = pool->reader_at(0).queue;
+
+    queue->suspend();
+    pool->close_all();
+
+    // 閉じるタスクが終わるまでは取得できない
+    XCTAssertEqual(pool->idle_count(), 1);
+    XCTAssertFalse(pool->acquire().has_value());
+
+    queue->resume();
+    queue->wait_until_all_tasks_are_finished();
+
+    XCTAssertTrue(pool->acquire().has_value());
+}
+
+@end
@@ -27,6 +27,8 @@ using namespace yas;
     XCTAssertEqual(relation.name, "test_name");
     XCTAssertEqual(relation.target, "test_target");
     XCTAssertEqual(relation.many, true);
+    XCTAssertEqual(relation.encoding, db::relation_encoding::rows);
+    XCTAssertEqual(relation.layout, db::table_layout::rowid);
 }
 
 - (void)test_table_name {
@@ -52,4 +54,69 @@ using namespace yas;
                                               "VALUES(:src_pk_id, :src_obj_id, :tgt_obj_id, :save_id);");
 }
 
+- (void)test_clustered_sql {
+    db::relation relation{{.name = "b", .target = "c", .many = true}, "a", db::table_layout::clustered};
+
+    XCTAssertEqual(relation.sql_for_create(),
+                   "CREATE TABLE IF NOT EXISTS rel_a_b (src_pk_id INTEGER, position INTEGER, src_obj_id INTEGER, "
+                   "tgt_obj_id INTEGER, save_id INTEGER, PRIMARY KEY(src_pk_id, position)) WITHOUT ROWID;");
+    XCTAssertEqual(relation.sql_for_insert(),
+                   "INSERT INTO rel_a_b(src_pk_id, src_obj_id, tgt_obj_id, save_id, position) "
+                   "VALUES(:src_pk_id, :src_obj_id, :tgt_obj_id, :save_id, :position);");
+}
+
+- (void)test_packed_sql {
+    db::relation relation{{.name = "b", .target = "c", .many = true, .encoding = db::relation_encoding::packed}, "a"};
+
+    XCTAssertEqual(relation.sql_for_create(),
+                   "CREATE TABLE IF NOT EXISTS rel_a_b (src_pk_id INTEGER PRIMARY KEY, src_obj_id INTEGER, "
+                   "save_id INTEGER, tgt_obj_ids BLOB);");
+    XCTAssertEqual(relation.sql_for_insert(),
+                   "INSERT INTO rel_a_b(src_pk_id, src_obj_id, save_id, tgt_obj_ids) "
+                   "VALUES(:src_pk_id, :src_obj_id, :save_id, :tgt_obj_ids);");
+
+    db::relation clustered{
+        {.name = "b", .target = "c", .many = true, .encoding = db::relation_encoding::packed},
+        "a",
+        db::table_layout::clustered};
+
+    XCTAssertEqual(clustered.sql_for_create(), relation.sql_for_create());
+}
+
+- (void)test_pack_relation_ids {
+    db::value_vector_t const ids{db::value{1}, db::value{int64_t{-2}}, db::value{std::numeric_limits<int64_t>::max()}};
+
+    db::value const packed = db::pack_relation_ids(ids);
+    db::blob const &blob = packed.get<db::blob>();
+    XCTAssertEqual(blob.size(), 1 + sizeof(int64_t) * 3);
+
+    auto const *bytes = static_cast<std::byte const *>(blob.data());
+    XCTAssertEqual(bytes[0], std::byte{db::packed_ids_version});
+    XCTAssertEqual(bytes[1], std::byte{1});
+    XCTAssertEqual(bytes[2], std::byte{0});
+
+    auto const unpacked = db::unpack_relation_ids({bytes, blob.size()});
+    XCTAssertTrue(unpacked);
+    XCTAssertEqual(unpacked.value(), ids);
+
+    db::value const packed_empty = db::pack_relation_ids({});
+    db::blob const &empty_blob = packed_empty.get<db::blob>();
+    XCTAssertEqual(empty_blob.size(), 1);
+
+    auto const empty =
+        db::unpack_relation_ids({static_cast<std::byte const *>(empty_blob.data()), empty_blob.size()});
+    XCTAssertTrue(empty);
+    XCTAssertEqual(empty.value().size(), 0);
+}
+
+- (void)test_unpack_invalid_relation_ids {
+    std::vector<std::byte> const unknown_version{std::byte{0}};
+    XCTAssertFalse(db::unpack_relation_ids(unknown_version));
+
+    std::vector<std::byte> const broken_size{std::byte{db::packed_ids_version}, std::byte{1}};
+    XCTAssertFalse(db::unpack_relation_ids(broken_size));
+
+    XCTAssertFalse(db::unpack_relation_ids({}));
+}
+
 @end
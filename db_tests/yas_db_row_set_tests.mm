@@ -142,6 +142,46 @@ using namespace yas;
     XCTAssertFalse(row_set->next());
 }
 
+- (void)test_get {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(
+        db->execute_update("create table test_table (int_field, float_field, text_field, blob_field, null_field);"));
+
+    std::vector<std::byte> const blob{std::byte{1}, std::byte{2}, std::byte{0}, std::byte{3}};
+
+    db::value_vector_t args{db::value{10}, db::value{2.5}, db::value{"text_value"},
+                            db::value{blob.data(), blob.size()}, db::null_value()};
+    XCTAssertTrue(db->execute_update("insert into test_table values(?, ?, ?, ?, ?)", args));
+
+    auto query_result = db->execute_query("select * from test_table");
+    XCTAssertTrue(query_result);
+
+    auto &row_set = query_result.value();
+    XCTAssertTrue(row_set->next());
+
+    auto const indices =
+        row_set->column_indices({"int_field", "FLOAT_FIELD", "text_field", "blob_field", "null_field", "none"});
+    XCTAssertEqual(indices, (std::vector<int>{0, 1, 2, 3, 4, -1}));
+
+    XCTAssertEqual(row_set->get<int64_t>(indices.at(0)), 10);
+    XCTAssertEqual(row_set->get<double>(indices.at(1)), 2.5);
+    XCTAssertTrue(row_set->get<std::string_view>(indices.at(2)) == "text_value");
+
+    auto const blob_span = row_set->get<std::span<std::byte const>>(indices.at(3));
+    XCTAssertEqual(blob_span.size(), 4);
+    XCTAssertTrue(std::equal(blob_span.begin(), blob_span.end(), blob.begin(), blob.end()));
+
+    XCTAssertEqual(row_set->get<int64_t>(indices.at(4)), 0);
+    XCTAssertTrue(row_set->get<std::string_view>(indices.at(4)).empty());
+    XCTAssertTrue(row_set->get<std::span<std::byte const>>(indices.at(4)).empty());
+
+    XCTAssertEqual(row_set->get<int64_t>(indices.at(5)), 0);
+    XCTAssertEqual(row_set->get<double>(indices.at(5)), 0.0);
+    XCTAssertTrue(row_set->get<std::string_view>(indices.at(5)).empty());
+}
+
 - (void)test_result_map {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
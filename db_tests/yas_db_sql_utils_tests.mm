@@ -25,6 +25,13 @@ using namespace yas;
                    "CREATE TABLE IF NOT EXISTS test_table (field_a, field_b);");
 }
 
+- (void)test_create_without_rowid_table_sql {
+    XCTAssertEqual(
+        db::create_without_rowid_table_sql("test_table", {"field_a", "field_b", "field_c"}, {"field_a", "field_b"}),
+        "CREATE TABLE IF NOT EXISTS test_table (field_a, field_b, field_c, PRIMARY KEY(field_a, field_b)) "
+        "WITHOUT ROWID;");
+}
+
 - (void)test_alter_table_sql {
     XCTAssertEqual(db::alter_table_sql("test_table", "field_a"), "ALTER TABLE test_table ADD COLUMN field_a;");
 }
@@ -47,6 +54,10 @@ using namespace yas;
     XCTAssertEqual(db::insert_sql("bbb"), "INSERT INTO bbb DEFAULT VALUES;");
 }
 
+- (void)test_replace_sql {
+    XCTAssertEqual(db::replace_sql("aaa", {"abc", "def"}), "INSERT OR REPLACE INTO aaa(abc, def) VALUES(:abc, :def);");
+}
+
 - (void)test_update_sql {
     XCTAssertEqual(db::update_sql("ccc", {"qwe", "rty"}, "(uio = :uio)"),
                    "UPDATE ccc SET qwe = :qwe, rty = :rty WHERE (uio = :uio);");
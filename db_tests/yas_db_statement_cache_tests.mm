@@ -0,0 +1,121 @@
+//
+//  yas_db_statement_cache_tests.mm
+//
+
+#import "yas_db_test_utils.h"
+
+using namespace yas;
+
+@interface yas_db_statement_cache_tests : XCTestCase
+
+@end
+
+@implementation yas_db_statement_cache_tests
+
+- (void)setUp {
+    [super setUp];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)test_get_and_set {
+    db::statement_cache cache{2};
+
+    XCTAssertEqual(cache.capacity(), 2);
+    XCTAssertEqual(cache.size(), 0);
+
+    XCTAssertFalse(cache.get("query_a"));
+    XCTAssertEqual(cache.stats().misses, 1);
+
+    auto const statement = db::statement::make_shared();
+    cache.set(statement, "query_a");
+
+    XCTAssertEqual(cache.size(), 1);
+    XCTAssertEqual(statement->query(), "query_a");
+    XCTAssertEqual(cache.get("query_a"), statement);
+    XCTAssertEqual(cache.stats().hits, 1);
+}
+
+- (void)test_skip_statement_in_use {
+    db::statement_cache cache{2};
+
+    auto const statement = db::statement::make_shared();
+    cache.set(statement, "query_a");
+
+    statement->set_in_use(true);
+    XCTAssertFalse(cache.get("query_a"));
+
+    auto const other_statement = db::statement::make_shared();
+    cache.set(other_statement, "query_a");
+    XCTAssertEqual(cache.get("query_a"), other_statement);
+
+    statement->set_in_use(false);
+    other_statement->set_in_use(true);
+    XCTAssertEqual(cache.get("query_a"), statement);
+}
+
+- (void)test_evict_least_recently_used {
+    db::statement_cache cache{2};
+
+    auto const statement_a = db::statement::make_shared();
+    auto const statement_b = db::statement::make_shared();
+    auto const statement_c = db::statement::make_shared();
+
+    cache.set(statement_a, "query_a");
+    cache.set(statement_b, "query_b");
+
+    XCTAssertEqual(cache.get("query_a"), statement_a);
+
+    cache.set(statement_c, "query_c");
+
+    XCTAssertEqual(cache.size(), 2);
+    XCTAssertEqual(cache.stats().evictions, 1);
+    XCTAssertFalse(cache.get("query_b"));
+    XCTAssertEqual(cache.get("query_a"), statement_a);
+    XCTAssertEqual(cache.get("query_c"), statement_c);
+}
+
+- (void)test_set_capacity {
+    db::statement_cache cache{3};
+
+    cache.set(db::statement::make_shared(), "query_a");
+    cache.set(db::statement::make_shared(), "query_b");
+    cache.set(db::statement::make_shared(), "query_c");
+
+    cache.set_capacity(1);
+
+    XCTAssertEqual(cache.size(), 1);
+    XCTAssertEqual(cache.stats().evictions, 2);
+    XCTAssertTrue(cache.get("query_c"));
+}
+
+- (void)test_record_prepare_and_reset_stats {
+    db::statement_cache cache{1};
+
+    cache.record_prepare(std::chrono::nanoseconds{100});
+    cache.record_prepare(std::chrono::nanoseconds{200});
+
+    XCTAssertEqual(cache.stats().prepare_count, 2);
+    XCTAssertEqual(cache.stats().prepare_duration, std::chrono::nanoseconds{300});
+
+    XCTAssertFalse(cache.get("query_a"));
+
+    cache.reset_stats();
+
+    XCTAssertEqual(cache.stats().prepare_count, 0);
+    XCTAssertEqual(cache.stats().misses, 0);
+}
+
+- (void)test_clear {
+    db::statement_cache cache{2};
+
+    cache.set(db::statement::make_shared(), "query_a");
+    cache.clear();
+
+    XCTAssertEqual(cache.size(), 0);
+    XCTAssertFalse(cache.get("query_a"));
+}
+
+@end
@@ -14,7 +14,9 @@
 + (yas::db::manager_ptr)create_test_manager:(yas::db::model const &)model;
 + (yas::db::manager_ptr)create_test_manager:(yas::db::model const &)model priority_count:(size_t)count;
 + (std::filesystem::path)database_path;
++ (std::filesystem::path)backup_database_path;
 + (void)deleteDatabase;
++ (bool)heads_match_last:(yas::db::database_ptr const &)db model:(yas::db::model const &)model;
 
 + (yas::db::model)model_0_0_0;
 + (yas::db::model)model_0_0_1;
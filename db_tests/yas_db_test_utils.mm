@@ -31,8 +31,54 @@ using namespace yas;
     return path.append("db_test.db");
 }
 
++ (std::filesystem::path)backup_database_path {
+    auto path = system_path_utils::directory_path(system_path_utils::dir::document);
+    return path.append("db_test_backup.db");
+}
+
 + (void)deleteDatabase {
     file_manager::remove_content([self database_path]);
+    file_manager::remove_content([self backup_database_path]);
+}
+
++ (bool)heads_match_last:(db::database_ptr const &)db model:(db::model const &)model {
+    // ヘッドのテーブルが、カレントセーブIDの時点でselect_lastで取得した最後のデータと一致しているか
+    auto const info_result = db::fetch_info(db);
+    if (!info_result) {
+        return false;
+    }
+    db::value const save_id = info_result.value().current_save_id_value();
+
+    for (auto const &entity_pair : model.entities()) {
+        db::entity const &entity = entity_pair.second;
+
+        auto const head_result = db::select(db, {.table = entity.head_table});
+        auto const last_result = db::select_last(db, {.table = entity.name}, save_id, true, db::pk_id_field);
+        if (!head_result || !last_result || head_result.value().size() != last_result.value().size()) {
+            return false;
+        }
+
+        std::map<db::integer::type, db::value_map_t const *> heads;
+        for (db::value_map_t const &head : head_result.value()) {
+            heads.emplace(head.at(db::object_id_field).get<db::integer>(), &head);
+        }
+
+        for (db::value_map_t const &last : last_result.value()) {
+            auto const it = heads.find(last.at(db::object_id_field).get<db::integer>());
+            if (it == heads.end()) {
+                return false;
+            }
+
+            db::value_map_t const &head = *it->second;
+            bool const removed = last.at(db::action_field).get<db::text>() == db::remove_action;
+            if (head.at(db::pk_id_field) != last.at(db::pk_id_field) ||
+                head.at(db::removed_field) != db::value{db::integer::type{removed ? 1 : 0}}) {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 + (yas::db::model)model_0_0_0 {
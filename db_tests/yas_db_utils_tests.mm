@@ -99,6 +99,31 @@ using namespace yas;
     XCTAssertFalse(query_result_2.value()->next());
 }
 
+- (void)test_deferred_transaction_does_not_block_other_readers {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    XCTAssertTrue(db->execute_update(db::create_table_sql("test_table", {"test_field"})));
+    XCTAssertTrue(db->execute_update("insert into test_table(test_field) values('value1')"));
+
+    db::database_ptr const other_db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(other_db->open());
+
+    XCTAssertTrue(db::begin_deferred_transaction(db));
+    XCTAssertEqual(db::select(db, {.table = "test_table"}).value().size(), 1);
+
+    XCTAssertTrue(db::begin_deferred_transaction(other_db));
+    auto const other_result = db::select(other_db, {.table = "test_table"});
+    XCTAssertTrue(other_result);
+    XCTAssertEqual(other_result.value().size(), 1);
+    XCTAssertTrue(db::commit(other_db));
+
+    XCTAssertTrue(db::commit(db));
+
+    other_db->close();
+    db->close();
+}
+
 - (void)test_save_point {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -338,6 +363,71 @@ using namespace yas;
     XCTAssertEqual(select_result.value().size(), 1);
 }
 
+- (void)test_select_each {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    auto const table = "table_a";
+    auto const field_a = "field_a";
+
+    XCTAssertTrue(db::create_table(db, table, {field_a}));
+
+    for (auto const &value : {1, 2, 3, 4}) {
+        XCTAssertTrue(db->execute_update(db::insert_sql(table, {field_a}), {db::value{value}}));
+    }
+
+    std::vector<db::integer::type> values;
+
+    auto const result = db::select_each(db, {.table = table, .field_orders = {{field_a, db::order::ascending}}},
+                                        [&values, &field_a](db::row_set &row_set) {
+                                            values.push_back(row_set.column_value(field_a).get<db::integer>());
+                                            return true;
+                                        });
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 4);
+    XCTAssertEqual(values, (std::vector<db::integer::type>{1, 2, 3, 4}));
+    XCTAssertFalse(db->has_opened_row_sets());
+}
+
+- (void)test_select_each_stop {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    auto const table = "table_a";
+    auto const field_a = "field_a";
+
+    XCTAssertTrue(db::create_table(db, table, {field_a}));
+
+    for (auto const &value : {1, 2, 3, 4}) {
+        XCTAssertTrue(db->execute_update(db::insert_sql(table, {field_a}), {db::value{value}}));
+    }
+
+    auto const result = db::select_each(db, {.table = table, .field_orders = {{field_a, db::order::ascending}}},
+                                        [&field_a](db::row_set &row_set) {
+                                            return row_set.column_value(field_a).get<db::integer>() < 2;
+                                        });
+
+    XCTAssertTrue(result);
+    XCTAssertEqual(result.value(), 2);
+    XCTAssertFalse(db->has_opened_row_sets());
+}
+
+- (void)test_select_each_failed {
+    db::database_ptr const db = [yas_db_test_utils create_test_database];
+    XCTAssertTrue(db->open());
+
+    bool called = false;
+
+    auto const result = db::select_each(db, {.table = "not_exists"}, [&called](db::row_set &) {
+        called = true;
+        return true;
+    });
+
+    XCTAssertFalse(result);
+    XCTAssertFalse(called);
+}
+
 - (void)test_max {
     db::database_ptr const db = [yas_db_test_utils create_test_database];
     XCTAssertTrue(db->open());
@@ -3,6 +3,7 @@
 //
 
 #import <chrono>
+#import <optional>
 #import "yas_db_test_utils.h"
 
 using namespace yas;
@@ -156,6 +157,52 @@ using namespace yas;
     XCTAssertFalse(value_b);
 }
 
+- (void)test_copy_shares_large_values {
+    db::value const short_text{"short"};
+    db::value const copied_short_text = short_text;
+
+    XCTAssertEqual(copied_short_text.get<db::text>(), "short");
+    XCTAssertNotEqual(copied_short_text.identifier(), short_text.identifier());
+
+    db::value const long_text{std::string(100, 'a')};
+    db::value const copied_long_text = long_text;
+
+    XCTAssertTrue(copied_long_text == long_text);
+    XCTAssertTrue(copied_long_text.type() == typeid(db::text));
+    XCTAssertEqual(copied_long_text.identifier(), long_text.identifier());
+    XCTAssertEqual(&copied_long_text.get<db::text>(), &long_text.get<db::text>());
+
+    std::vector<uint8_t> const vec{1, 2, 3};
+    db::value const blob{vec.data(), vec.size()};
+    db::value const copied_blob = blob;
+
+    XCTAssertEqual(copied_blob.identifier(), blob.identifier());
+    XCTAssertEqual(copied_blob.get<db::blob>().data(), blob.get<db::blob>().data());
+}
+
+- (void)test_get_other_type {
+    db::value const value{1};
+
+    XCTAssertEqual(value.get<db::real>(), 0.0);
+    XCTAssertEqual(value.get<db::text>(), "");
+    XCTAssertEqual(value.get<db::blob>().size(), 0);
+}
+
+- (void)test_copied_blob_outlives_source {
+    std::optional<db::value> blob_value;
+
+    {
+        std::vector<uint8_t> const vec{4, 5, 6};
+        blob_value.emplace(vec.data(), vec.size());
+        XCTAssertNotEqual(blob_value->get<db::blob>().data(), vec.data());
+    }
+
+    auto const data = static_cast<uint8_t const *>(blob_value->get<db::blob>().data());
+    XCTAssertEqual(blob_value->get<db::blob>().size(), 3);
+    XCTAssertEqual(data[0], 4);
+    XCTAssertEqual(data[2], 6);
+}
+
 - (void)test_create_empty_blob {
     db::blob empty_blob{};
     XCTAssertEqual(empty_blob.data(), nullptr);